@@ -102,6 +102,27 @@ classdef CMatrix
          r = CMatrix.UnaryOp('double', a);
       end
       
+      function r = toText(a, format, digits)
+         % The entries of a in column major order as text, one per line.
+         % format is 'decimal' (default) with digits significant digits
+         % (default: all of the type) or 'hex', which reads back exactly.
+         if nargin < 2, format = 'decimal'; end
+         if nargin < 3, digits = 0; end
+         a = full(a);
+         r = char(CMatrix.mex('toText', a.x, format, digits));
+      end
+      
+      function writeFile(a, filename, chunkBytes, compress)
+         % Write a (dense or sparse) to a binary file for readFile. The
+         % columns are stored in chunks of about chunkBytes bytes (default
+         % 1 MiB); if compress is true, the chunks that shrink are stored
+         % compressed, which pays off for values converted from double.
+         % See matrixFile.h for the format.
+         if nargin < 3, chunkBytes = 2^20; end
+         if nargin < 4, compress = false; end
+         CMatrix.mex('writeFile', a.x, filename, chunkBytes, logical(compress));
+      end
+      
       function r = logical(a)
          r = CMatrix.UnaryOp('logical', a);
       end
@@ -244,16 +265,22 @@ classdef CMatrix
       end
       
       %% Arithmetic
-      function r = plus(a, b)
-         r = CMatrix.BinaryOp('plus', a, b);
+      % plus, minus, times and rdivide take an optional arithmetic, 'sloppy' or 'accurate',
+      % e.g. plus(a, b, 'accurate') adds with the IEEE-style error bound even though
+      % a + b uses the faster algorithms chosen in qd_config.h
+      function r = plus(a, b, arithmetic)
+         if nargin < 3, arithmetic = 'default'; end
+         r = CMatrix.BinaryOp('plus', a, b, arithmetic);
       end
       
-      function r = minus(a, b)
-         r = CMatrix.BinaryOp('minus', a, b);
+      function r = minus(a, b, arithmetic)
+         if nargin < 3, arithmetic = 'default'; end
+         r = CMatrix.BinaryOp('minus', a, b, arithmetic);
       end
       
-      function r = times(a, b)
-         r = CMatrix.BinaryOp('times', a, b);
+      function r = times(a, b, arithmetic)
+         if nargin < 3, arithmetic = 'default'; end
+         r = CMatrix.BinaryOp('times', a, b, arithmetic);
       end
       
       function r = power(a, b)
@@ -261,11 +288,12 @@ classdef CMatrix
          r = a .* a;
       end
       
-      function r = rdivide(a, b)
+      function r = rdivide(a, b, arithmetic)
+         if nargin < 3, arithmetic = 'default'; end
          if issparse(b)
             b = full(b);
          end
-         r = CMatrix.BinaryOp('rdivide', a, b);
+         r = CMatrix.BinaryOp('rdivide', a, b, arithmetic);
          
          if issparse(a) % To fix the bug regarding x / 0
             r2 = double(a) ./ double(b);
@@ -293,6 +321,15 @@ classdef CMatrix
          r = CMatrix.UnaryOp('sqrt', a);
       end
       
+      function r = exp(a)
+         r = CMatrix.UnaryOp('exp', a);
+      end
+      
+      function r = log(a)
+         % log(0) = -Inf and log(a) = NaN for a < 0 (there is no complex CMatrix)
+         r = CMatrix.UnaryOp('log', a);
+      end
+      
       function r = sum(varargin)
          r = CMatrix.ReductionOp('sum', varargin{:});
       end
@@ -551,6 +588,32 @@ classdef CMatrix
          end
       end
       
+      function r = fromText(s, sz)
+         % Inverse of toText; the numbers may be separated by blanks,
+         % commas, semicolons or newlines. sz is the size of the result
+         % (default: a column of all the numbers).
+         if nargin < 2
+            r = CMatrix(CMatrix.mex('fromText', uint8(s)));
+         else
+            r = CMatrix(CMatrix.mex('fromText', uint8(s), sz(1), sz(2)));
+         end
+      end
+      
+      function r = readFile(filename)
+         % Read a matrix written by writeFile. The file may also come from
+         % C++ (writeMatrixFile) in double or a lower precision type.
+         r = CMatrix(CMatrix.mex('readFile', filename));
+      end
+      
+      function failed = selfCheck()
+         % The names of the arithmetic checks of qd/self_check.h that fail
+         % in this build and process, e.g. 'contraction' if the compiler
+         % fused a * b + c; empty if the results are the same bits on every
+         % machine. Build with compileCMatrix(struct('deterministic', true))
+         % to make the other calls throw on any failure.
+         failed = CMatrix.mex('selfCheck');
+      end
+      
       function r = UnaryOp(cmd, a)
          a = CMatrix.toMex(a);
          r = CMatrix.mex(cmd, a);
@@ -560,10 +623,10 @@ classdef CMatrix
          end
       end
       
-      function r = BinaryOp(cmd, a, b)
+      function r = BinaryOp(cmd, a, b, varargin)
          a = CMatrix.toMex(a);
          b = CMatrix.toMex(b);
-         r = CMatrix.mex(cmd, a, b);
+         r = CMatrix.mex(cmd, a, b, varargin{:});
          
          if iscell(r) || isa(r, 'uint8')
             r = CMatrix(r);
@@ -0,0 +1,59 @@
+#pragma once
+// Types and helpers shared by the kernels. Nothing here (or in the kernel headers that
+// include it) depends on mex, so the kernels can be used from plain C++; mexUtils.h and
+// CMatrixUtils.h only add the conversion from and to mxArray on top.
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+#include <Eigen/SparseQR>
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#undef eigen_assert
+#define eigen_assert(x) \
+  if (!(x)) { throw (std::runtime_error("Eigen runtime error.")); }
+
+#ifndef assertThrow
+#define assertThrow(val, msg) if (!(val)) throw std::runtime_error(msg);
+#endif
+
+// same as MexEnvironment::SignedIndex, the signed counterpart of mwIndex
+using SignedIndex = std::make_signed<size_t>::type;
+
+template<class T>
+using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+template<class T>
+using Map = Eigen::Map<Matrix<T>, Eigen::Aligned32>;
+
+template<class T>
+using SparseMatrix = Eigen::SparseMatrix<T, Eigen::ColMajor, SignedIndex>;
+
+template<class T>
+using SparseMap = Eigen::Map<SparseMatrix<T>, Eigen::Aligned32>;
+
+template<typename T>
+struct DefaultNumTraits : Eigen::GenericNumTraits<T>
+{
+	static inline T dummy_precision() { return 1000 * std::numeric_limits<T>::epsilon(); }
+	static inline T epsilon() { return std::numeric_limits<T>::epsilon(); }
+};
+
+template<typename T>
+bool isZero(T x, int eps_factor = 1)
+{
+	T eps = eps_factor * std::numeric_limits<T>::epsilon();
+	return x < eps&& x > -eps;
+}
+
+template<>
+inline bool isZero(bool x, int _)
+{
+	return !x;
+}
@@ -1,5 +1,13 @@
 #include "CMatrixUtils.h"
 #include "binaryOperator.h"
+#include "unaryOperator.h"
+#include "operators.h"
+#include "denseProduct.h"
+#include "sparseProduct.h"
+#include "linearSolve.h"
+#include "scratchAllocator.h"
+#include "matrixFile.h"
+#include <qd/text.h>
 
 template <typename Tx, typename Ti>
 struct KeepTrue
@@ -11,85 +19,71 @@ struct KeepTrue
 };
 
 
-template <typename O, typename Tx = CType>
-void runUnaryOperator()
+// Output a sparse result, dropping the false entries of a logical result
+template <typename OutputType, typename Derived>
+void outputSparseResult(MexContext& ctx, const Eigen::SparseCompressedBase<Derived>& C, bool native_output)
 {
-	if (isInputSparse(1))
+	if (std::is_same<OutputType, bool>::value)
 	{
-		auto A = inputSparseMatrix<Tx>();
-		auto m = A.rows(), n = A.cols();
-
-		using OutputType = decltype(O::f(1, 1, Tx(1.0)));
-		using Ti = typename SparseMap<Tx>::StorageIndex;
-		SparseMatrix<OutputType> C(A.template cast<OutputType>());
-
-		// Compute C
-		auto Ax = A.valuePtr();
-		auto Cx = C.valuePtr();
-		auto Ci = C.innerIndexPtr(), Cj = C.outerIndexPtr();
-
-		for (auto j = 0; j < n; ++j)
-		{
-			for (auto p = Cj[j]; p < Cj[j + 1]; ++p)
-			{
-				auto i = Ci[p];
-				Cx[p] = O::f(i, j, Ax[p]);
-			}
-		}
-
-		if (std::is_same<OutputType, bool>::value)
-			C.prune(KeepTrue<OutputType, Ti>());
+		SparseMatrix<OutputType> Cp(C);
+		Cp.prune(KeepTrue<OutputType, SignedIndex>());
+		outputSparseMatrix<OutputType>(ctx, Cp, native_output);
+	}
+	else
+		outputSparseMatrix<OutputType>(ctx, C, native_output);
+}
 
-		outputSparseMatrix<OutputType>(C, O::NativeOutput);
+template <typename O, typename Tx = CType>
+void runUnaryOperator(MexContext& ctx)
+{
+	using OutputType = decltype(O::f(1, 1, Tx(1.0)));
+	if (isInputSparse(ctx, 1) && O::KeepsZero)
+		outputSparseResult<OutputType>(ctx, unaryOperator<O>(inputSparseMatrix<Tx>(ctx)), O::NativeOutput);
+	else if (isInputSparse(ctx, 1))
+	{
+		// f(0) != 0, e.g. exp, so the result is dense
+		auto A = inputSparseMatrix<Tx>(ctx);
+		auto denseA = scratchMatrix<Tx>(A.rows(), A.cols());
+		denseA = A;
+		unaryOperator<O>(denseA, outputDenseMatrix<OutputType>(ctx, A.rows(), A.cols(), O::NativeOutput));
 	}
 	else
 	{
-		auto A = inputDenseMatrix<Tx>();
-		auto m = A.rows(), n = A.cols();
-
-		using OutputType = decltype(O::f(1, 1, Tx(1.0)));
-		Matrix<OutputType> C(m, n);
-
-		for (auto j = 0; j < n; ++j)
-			for (auto i = 0; i < m; ++i)
-				C(i, j) = O::f(i, j, A(i, j));
-
-		outputDenseMatrix<OutputType>(C, O::NativeOutput);
+		auto A = inputDenseMatrix<Tx>(ctx);
+		unaryOperator<O>(A, outputDenseMatrix<OutputType>(ctx, A.rows(), A.cols(), O::NativeOutput));
 	}
 }
 
 template <typename O, typename Tx = CType>
-void runBinaryOperator()
+void runBinaryOperator(MexContext& ctx)
 {
-	bool isASparse = isInputSparse(1), isBSparse = isInputSparse(2);
+	bool isASparse = isInputSparse(ctx, 1), isBSparse = isInputSparse(ctx, 2);
 	SparseMap<Tx> sparseA(0, 0, 0, nullptr, nullptr, nullptr), sparseB(0, 0, 0, nullptr, nullptr, nullptr);
 	Map<Tx> denseA(nullptr, 0, 0), denseB(nullptr, 0, 0);
 
-	SparseMatrix<Tx> sparseAMat, sparseBMat;
-	Matrix<Tx> denseAMat, denseBMat;
 	using Ti = typename SparseMap<Tx>::StorageIndex;
 
 	Ti Am, An, Bm, Bn;
 	if (isASparse)
 	{
-		sparseA = inputSparseMatrix<Tx>();
+		sparseA = inputSparseMatrix<Tx>(ctx);
 		Am = sparseA.rows(); An = sparseA.cols();
 	}
 	else
 	{
-		auto A = inputDenseMatrix<Tx>();
+		auto A = inputDenseMatrix<Tx>(ctx);
 		new (&denseA) Map<Tx>(A);
 		Am = denseA.rows(); An = denseA.cols();
 	}
 
 	if (isBSparse)
 	{
-		sparseB = inputSparseMatrix<Tx>();
+		sparseB = inputSparseMatrix<Tx>(ctx);
 		Bm = sparseB.rows(); Bn = sparseB.cols();
 	}
 	else
 	{
-		auto B = inputDenseMatrix<Tx>();
+		auto B = inputDenseMatrix<Tx>(ctx);
 		new (&denseB) Map<Tx>(B);
 		Bm = denseB.rows(); Bn = denseB.cols();
 	}
@@ -105,389 +99,119 @@ void runBinaryOperator()
 	else if (!isASparse && !isBSparse)
 		sparseOutput = O::DenseDenseToSparse;
 
-	// Densify the matrices if it is a row or column or if the output is dense
-	if (isASparse && (!sparseOutput || Am == 1 || An == 1))
+	// A dense output is computed from one sparse operand without densifying it,
+	// so only the second of two sparse operands is densified.
+	// Sparse rows, columns and scalars are broadcast by the sparse kernels.
+	if (isASparse && isBSparse && !sparseOutput)
 	{
-		if (!sparseOutput)
-		{
-			denseAMat = sparseA;
-			new (&denseA) Map<Tx>(denseAMat.data(), Am, An);
-			isASparse = false;
-		}
-		else
-		{
-			if (Am == 1 && An == 1)
-				sparseAMat = SparseMatrix<Tx>(Matrix<Tx>::Constant(Bm, Bn, sparseA.coeff(0, 0)).sparseView());
-			else if (Am == 1)
-				sparseAMat = SparseMatrix<Tx>(Matrix<Tx>::Ones(Bm, 1).sparseView()) * sparseA;
-			else
-				sparseAMat = sparseA * SparseMatrix<Tx>(Matrix<Tx>::Ones(1, Bn).sparseView());
-			
-			new (&sparseA) SparseMap<Tx>(sparseAMat.rows(), sparseAMat.cols(),
-				sparseAMat.nonZeros(),
-				sparseAMat.outerIndexPtr(), sparseAMat.innerIndexPtr(),
-				sparseAMat.valuePtr());
-		}
-	}
-
-	if (isBSparse && (!sparseOutput || Bm == 1 || Bn == 1))
-	{
-		if (!sparseOutput)
-		{
-			denseBMat = sparseB;
-			new (&denseB) Map<Tx>(denseBMat.data(), Bm, Bn);
-			isBSparse = false;
-		}
-		else
-		{
-			if (Bm == 1 && Bn == 1)
-				sparseBMat = SparseMatrix<Tx>(Matrix<Tx>::Constant(Am, An, sparseB.coeff(0, 0)).sparseView());
-			else if (Bm == 1)
-				sparseBMat = SparseMatrix<Tx>(Matrix<Tx>::Ones(Am, 1).sparseView()) * sparseB;
-			else
-				sparseBMat = sparseB * SparseMatrix<Tx>(Matrix<Tx>::Ones(1, An).sparseView());
-			new (&sparseB) SparseMap<Tx>(sparseBMat.rows(), sparseBMat.cols(),
-				sparseBMat.nonZeros(),
-				sparseBMat.outerIndexPtr(), sparseBMat.innerIndexPtr(),
-				sparseBMat.valuePtr());
-		}
+		auto denseBMat = scratchMatrix<Tx>(Bm, Bn);
+		denseBMat = sparseB;
+		new (&denseB) Map<Tx>(denseBMat.data(), Bm, Bn);
+		isBSparse = false;
 	}
 
 	// Run the operator
 	using OutputType = decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet));
-	if (isASparse && isBSparse)
-	{
-		auto C = binaryOperator<O>(sparseA, sparseB);
-		if (std::is_same<OutputType, bool>::value)
-			C.prune(KeepTrue<OutputType, Ti>());
-		outputSparseMatrix<OutputType>(C, O::NativeOutput);
-	}
-	else if (!isASparse && isBSparse)
-	{
-		auto C = binaryOperator<O>(denseA, sparseB);
-		if (std::is_same<OutputType, bool>::value)
-			C.prune(KeepTrue<OutputType, Ti>());
-		outputSparseMatrix<OutputType>(C, O::NativeOutput);
-	}
-	else if (isASparse && !isBSparse)
+	if (sparseOutput)
 	{
-		auto C = binaryOperator<O>(sparseA, denseB);
-		if (std::is_same<OutputType, bool>::value)
-			C.prune(KeepTrue<OutputType, Ti>());
-		outputSparseMatrix<OutputType>(C, O::NativeOutput);
+		if (isASparse && isBSparse)
+			outputSparseResult<OutputType>(ctx, binaryOperator<O>(sparseA, sparseB), O::NativeOutput);
+		else if (!isASparse && isBSparse)
+			outputSparseResult<OutputType>(ctx, binaryOperator<O>(denseA, sparseB), O::NativeOutput);
+		else if (isASparse && !isBSparse)
+			outputSparseResult<OutputType>(ctx, binaryOperator<O>(sparseA, denseB), O::NativeOutput);
 	}
-	else if (!isASparse && !isBSparse)
+	else
 	{
-		auto C = binaryOperator<O>(denseA, denseB);
-		outputDenseMatrix<OutputType>(C, O::NativeOutput);
+		auto [m, n] = computeBinaryOperatorOuputSize(Am, An, Bm, Bn);
+		auto C = outputDenseMatrix<OutputType>(ctx, m, n, O::NativeOutput);
+		if (isASparse)
+			binaryOperator<O>(sparseA, denseB, C);
+		else if (isBSparse)
+			binaryOperator<O>(denseA, sparseB, C);
+		else
+			binaryOperator<O>(denseA, denseB, C);
 	}
 }
 
 template <typename O, typename Tx = CType>
-void runReductionOperator()
+void runReductionOperator(MexContext& ctx)
 {
-	if (isInputSparse(1))
+	using OutputType = decltype(O::f(Tx(1.0), Tx(1.0)));
+	if (isInputSparse(ctx, 1))
 	{
-		auto A = inputSparseMatrix<Tx>();
-		auto m = A.rows(), n = A.cols();
-
-		using OutputType = decltype(O::f(Tx(1.0), Tx(1.0)));
-		Matrix<OutputType> C(1, n);
-
-		// Compute C
-		auto Ax = A.valuePtr();
-		auto Ai = A.innerIndexPtr(), Aj = A.outerIndexPtr();
-
-		for (auto j = 0; j < n; ++j)
-		{
-			Tx value = Tx(0.0);
-			bool null_value = true;
-			for (auto p = Aj[j]; p < Aj[j + 1]; ++p)
-			{
-				{
-					if (null_value)
-					{
-						value = Ax[p];
-						null_value = false;
-					}
-					else
-						value = O::f(value, Ax[p]);
-				}
-				C(0, j) = value;
-			}
-		}
-		outputDenseMatrix<OutputType>(C);
+		auto A = inputSparseMatrix<Tx>(ctx);
+		reductionOperator<O>(A, outputDenseMatrix<OutputType>(ctx, 1, A.cols()));
 	}
 	else
 	{
-		auto A = inputDenseMatrix<Tx>();
-		auto m = A.rows(), n = A.cols();
-
-		using OutputType = decltype(O::f(Tx(1.0), Tx(1.0)));
-		Matrix<OutputType> C(1, n);
-
-		for (auto j = 0; j < n; ++j)
-		{
-			Tx value = Tx(0.0);
-			bool null_value = true;
-
-			for (auto i = 0; i < m; ++i)
-			{
-				if (null_value)
-				{
-					value = A(i, j);
-					null_value = false;
-				}
-				else
-					value = O::f(value, A(i, j));
-			}
-			C(0, j) = value;
-		}
-
-		outputDenseMatrix<OutputType>(C);
+		auto A = inputDenseMatrix<Tx>(ctx);
+		reductionOperator<O>(A, outputDenseMatrix<OutputType>(ctx, 1, A.cols()));
 	}
 }
 
-struct UnaryOperatorConfig
-{
-	const static bool NativeOutput = false;
-};
-
-template<typename T = CType>
-struct absFunc : UnaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x)
-	{
-		return abs(x);
-	}
-};
-
-template<typename T = CType>
-struct sqrtFunc : UnaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x)
-	{
-		return sqrt(x);
-	}
-};
-
-template<typename T = CType>
-struct uminusFunc : UnaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x)
-	{
-		return -x;
-	}
-};
-
-template<typename T = CType>
-struct notFunc : UnaryOperatorConfig
-{
-	static bool f(size_t i, size_t j, T x)
-	{
-		return isZero(x);
-	}
-};
-
-template<typename T = CType>
-struct doubleFunc : UnaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static double f(size_t i, size_t j, T x)
-	{
-		return double(x);
-	}
-};
-
-template<typename T = CType>
-struct logicalFunc : UnaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static bool f(size_t i, size_t j, T x)
-	{
-		return !isZero(x);
-	}
-};
-
-struct BinaryOperatorConfig
-{
-	const static bool NativeOutput = false;
-	const static bool DenseDenseToSparse = false;
-	const static bool SparseDenseToSparse = false;
-	const static bool DenseSparseToSparse = false;
-	const static bool SparseSparseToSparse = true;
-};
-
-template<typename T = CType>
-struct ltFunc : BinaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return (x1 < x2);
-	}
-};
-
-template<typename T = CType>
-struct gtFunc : BinaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return (x1 > x2);
-	}
-};
-
-template<typename T = CType>
-struct neFunc : BinaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return (x1 != x2);
-	}
-};
-
-template<typename T = CType>
-struct orFunc : BinaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return ((!isZero(x1)) | (!isZero(x2)));
-	}
-};
-
-template<typename T = CType>
-struct andFunc : BinaryOperatorConfig
-{
-	const static bool NativeOutput = true;
-	const static bool SparseDenseToSparse = true;
-	const static bool DenseSparseToSparse = true;
-	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return ((!isZero(x1)) & (!isZero(x2)));
-	}
-};
-
-template<typename T = CType>
-struct plusFunc : BinaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return x1 + x2;
-	}
-};
-
-template<typename T = CType>
-struct minusFunc : BinaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return x1 - x2;
-	}
-};
 
-template<typename T = CType>
-struct timesFunc : BinaryOperatorConfig
+// the optional arithmetic after the operands, e.g. plus(A, B, 'accurate'); it is read ahead
+// since it selects the instantiation that reads the operands
+ArithmeticMode inputArithmetic(MexContext& ctx, size_t operands)
 {
-	const static bool SparseDenseToSparse = true;
-	const static bool DenseSparseToSparse = true;
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return x1 * x2;
-	}
-};
-
-template<typename T = CType>
-struct rdivideFunc : BinaryOperatorConfig
-{
-	const static bool SparseSparseToSparse = false;
-	const static bool SparseDenseToSparse = true;
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return x1 / x2;
-	}
-};
-
-template<typename T = CType>
-struct max2Func : BinaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return std::max(x1, x2);
-	}
-};
-
-template<typename T = CType>
-struct min2Func : BinaryOperatorConfig
-{
-	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
-	{
-		return std::min(x1, x2);
-	}
-};
-
-template<typename T = CType>
-struct maxFunc
-{
-	static T f(T x, T y)
-	{
-		return std::max(x, y);
-	}
-};
-
-template<typename T = CType>
-struct minFunc
-{
-	static T f(T x, T y)
-	{
-		return std::min(x, y);
-	}
-};
-
-template<typename T = CType>
-struct prodFunc
-{
-	static T f(T x, T y)
-	{
-		return x * y;
-	}
-};
+	if (ctx.rhs_id + operands >= ctx.nrhs)
+		return kDefaultArithmetic;
+
+	size_t rhs_id = ctx.rhs_id;
+	ctx.rhs_id += operands;
+	auto mode = arithmeticMode(inputString(ctx));
+	ctx.rhs_id = rhs_id;
+	return mode;
+}
 
-template<typename T = CType>
-struct sumFunc
+// the format of toText: 'decimal' or 'hex'
+qd::text::format textFormat(const std::string& name)
 {
-	static T f(T x, T y)
-	{
-		return x + y;
-	}
-};
-
-
-#define DEFINE_UNARY_OP(O) case str2int(#O): runUnaryOperator<O##Func<CType>>(); break;
-#define DEFINE_BINARY_OP(O) case str2int(#O): runBinaryOperator<O##Func<CType>>(); break;
-#define DEFINE_REDUCT_OP(O) case str2int(#O): runReductionOperator<O##Func<CType>>(); break;
+	if (name == "decimal")
+		return qd::text::decimal;
+	else if (name == "hex")
+		return qd::text::hex;
+	throw std::runtime_error("The text format should be 'decimal' or 'hex'.");
+}
 
-int main()
+#define DEFINE_UNARY_OP(O) case str2int(#O): runUnaryOperator<O##Func<CType>>(ctx); break;
+#define DEFINE_BINARY_OP(O) case str2int(#O): runBinaryOperator<O##Func<CType>>(ctx); break;
+#define DEFINE_ARITHMETIC_OP(O) case str2int(#O): \
+	switch (inputArithmetic(ctx, 2)) \
+	{ \
+	case kSloppyArithmetic: runBinaryOperator<O##Func<CType, SloppyArithmetic>>(ctx); break; \
+	case kAccurateArithmetic: runBinaryOperator<O##Func<CType, AccurateArithmetic>>(ctx); break; \
+	default: runBinaryOperator<O##Func<CType>>(ctx); \
+	} \
+	break;
+#define DEFINE_REDUCT_OP(O) case str2int(#O): runReductionOperator<O##Func<CType>>(ctx); break;
+
+int mexMain(MexContext& ctx)
 {
-	auto cmd = inputString();
+	qd::fpu_guard fpu;
+	ScratchScope scratch;
+	auto cmd = inputString(ctx);
 	auto cmd_hash = str2int(cmd.c_str());
+	if (cmd_hash != str2int("selfCheck"))
+		checkArithmetic();
 	switch (cmd_hash)
 	{
 	case str2int("toMex"):
 #if defined(CUSTOM_TOMEX)
-		customToMex();
+		customToMex(ctx);
 		break;
 #else
-		if (isInputSparse(1))
-			outputSparseMatrix<CType>(inputSparseMatrix<double>());
+		if (isInputSparse(ctx, 1))
+			outputSparseMatrix<CType>(ctx, inputSparseMatrix<double>(ctx));
 		else
-			outputDenseMatrix<CType>(inputDenseMatrix<double>());
+			outputDenseMatrix<CType>(ctx, inputDenseMatrix<double>(ctx));
 		break;
 #endif
 	DEFINE_UNARY_OP(abs)
 	DEFINE_UNARY_OP(sqrt)
+	DEFINE_UNARY_OP(exp)
+	DEFINE_UNARY_OP(log)
 	DEFINE_UNARY_OP(uminus)
 	DEFINE_UNARY_OP(not)
 	DEFINE_UNARY_OP(double)
@@ -497,10 +221,10 @@ int main()
 	DEFINE_BINARY_OP(ne)
 	DEFINE_BINARY_OP(and)
 	DEFINE_BINARY_OP(or )
-	DEFINE_BINARY_OP(plus)
-	DEFINE_BINARY_OP(minus)
-	DEFINE_BINARY_OP(times)
-	DEFINE_BINARY_OP(rdivide)
+	DEFINE_ARITHMETIC_OP(plus)
+	DEFINE_ARITHMETIC_OP(minus)
+	DEFINE_ARITHMETIC_OP(times)
+	DEFINE_ARITHMETIC_OP(rdivide)
 	DEFINE_BINARY_OP(max2)
 	DEFINE_BINARY_OP(min2)
 	DEFINE_REDUCT_OP(max)
@@ -509,181 +233,148 @@ int main()
 	DEFINE_REDUCT_OP(prod)
 	case str2int("transpose"):
 		{
-			if (isInputSparse(1))
-				outputSparseMatrix<CType>(inputSparseMatrix<CType>().transpose());
+			if (isInputSparse(ctx, 1))
+				outputSparseMatrix<CType>(ctx, inputSparseMatrix<CType>(ctx).transpose());
 			else
-				outputDenseMatrix<CType>(inputDenseMatrix<CType>().transpose());
+				outputDenseMatrix<CType>(ctx, inputDenseMatrix<CType>(ctx).transpose());
 			break;
 		}
 	case str2int("mtimes"):
 	{
-		if (isInputSparse(1) && isInputSparse(2))
+		if (isInputSparse(ctx, 1) && isInputSparse(ctx, 2))
 		{
-			auto A = inputSparseMatrix<CType>();
-			auto B = inputSparseMatrix<CType>();
+			auto A = inputSparseMatrix<CType>(ctx);
+			auto B = inputSparseMatrix<CType>(ctx);
 			assertThrow(A.cols() == B.rows(), "mtimes: Incompatible sizes.");
 
-			SparseMatrix<CType> C = A * B;
-			outputSparseMatrix<CType>(C);
+			SparseMatrix<CType> C = sparseProduct(A, B);
+			outputSparseMatrix<CType>(ctx, C);
 		}
-		else if (!isInputSparse(1) && isInputSparse(2))
+		else if (!isInputSparse(ctx, 1) && isInputSparse(ctx, 2))
 		{
-			auto A = inputDenseMatrix<CType>();
-			auto B = inputSparseMatrix<CType>();
+			auto A = inputDenseMatrix<CType>(ctx);
+			auto B = inputSparseMatrix<CType>(ctx);
 			assertThrow(A.cols() == B.rows(), "mtimes: Incompatible sizes.");
 
-			Matrix<CType> C = A * B;
-			outputDenseMatrix<CType>(C);
+			denseSparseProduct<CType>(A, B, outputDenseMatrix<CType>(ctx, A.rows(), B.cols()));
 		}
-		else if (isInputSparse(1) && !isInputSparse(2))
+		else if (isInputSparse(ctx, 1) && !isInputSparse(ctx, 2))
 		{
-			auto A = inputSparseMatrix<CType>();
-			auto B = inputDenseMatrix<CType>();
+			auto A = inputSparseMatrix<CType>(ctx);
+			auto B = inputDenseMatrix<CType>(ctx);
 			assertThrow(A.cols() == B.rows(), "mtimes: Incompatible sizes.");
 
-			Matrix<CType> C = A * B;
-			outputDenseMatrix<CType>(C);
+			sparseDenseProduct<CType>(A, B, outputDenseMatrix<CType>(ctx, A.rows(), B.cols()));
 		}
 		else
 		{
-			auto A = inputDenseMatrix<CType>();
-			auto B = inputDenseMatrix<CType>();
+			auto A = inputDenseMatrix<CType>(ctx);
+			auto B = inputDenseMatrix<CType>(ctx);
 			assertThrow(A.cols() == B.rows(), "mtimes: Incompatible sizes.");
 
-			Matrix<CType> C = A * B;
-			outputDenseMatrix<CType>(C);
+			denseProduct<CType>(A, B, outputDenseMatrix<CType>(ctx, A.rows(), B.cols()));
 		}
 		break;
 	}
 	case str2int("mldivide"):
 	{
-		Matrix<CType> C;
-		if (isInputSparse(1))
+		if (isInputSparse(ctx, 1))
 		{
-			auto A = inputSparseMatrix<CType>();
-			auto B = inputDenseMatrix<CType>();
-			assertThrow(A.rows() == B.rows(), "mldivide: Incompatible sizes.");
-
-			bool solved = false;
-			if (A.cols() == B.rows())
-			{
-				auto A_lower = A.triangularView<Eigen::Lower>();
-				if (!solved && A.isApprox(A_lower))
-				{
-					C = A_lower.solve(B);
-					solved = true;
-				}
-
-				auto A_upper = A.triangularView<Eigen::Upper>();
-				if (!solved && A.isApprox(A_upper))
-				{
-					C = A_upper.solve(B);
-					solved = true;
-				}
-
-				if (!solved && A.isApprox(A.transpose()))
-				{
-					Eigen::SimplicialLDLT<SparseMatrix<CType>> solver(A);
-					if (solver.info() == Eigen::Success)
-					{
-						C = solver.solve(B);
-						solved = true;
-					}
-				}
-
-				if (!solved)
-				{
-					Eigen::SparseLU<SparseMatrix<CType>> solver(A);
-					if (solver.info() == Eigen::Success)
-					{
-						C = solver.solve(B);
-						solved = true;
-					}
-				}
-			}
-
-			if (!solved)
-			{
-				Eigen::SparseQR<SparseMatrix<CType>, Eigen::COLAMDOrdering<Eigen::Index>> solver(A);
-				assertThrow(solver.info() == Eigen::Success, "mldivide: solver failed.");
-				C = solver.solve(B);
-			}
+			auto A = inputSparseMatrix<CType>(ctx);
+			auto B = inputDenseMatrix<CType>(ctx);
+			outputDenseMatrix<CType>(ctx, mldivide(A, B));
 		}
 		else
 		{
-			auto A = inputDenseMatrix<CType>();
-			auto B = inputDenseMatrix<CType>();
-			assertThrow(A.rows() == B.rows(), "mldivide: Incompatible sizes.");
-
-			bool solved = false;
-
-			if (A.cols() == B.rows())
-			{
-				if (A.isLowerTriangular())
-				{
-					C = A.triangularView<Eigen::Lower>().solve(B);
-					solved = true;
-				}
-				else if (A.isUpperTriangular())
-				{
-					C = A.triangularView<Eigen::Upper>().solve(B);
-					solved = true;
-				}
-				else if (A.isUnitary())
-				{
-					auto solver = A.ldlt();
-					if (solver.info() == Eigen::Success)
-					{
-						C = solver.solve(B);
-						solved = true;
-					}
-				}
-
-				if (!solved)
-					C = A.fullPivLu().solve(B);
-			}
-			else
-			{
-				auto solver = A.colPivHouseholderQr();
-				assertThrow(solver.info() == Eigen::Success, "mldivide: solver failed.");
-				C = solver.solve(B);
-			}
+			auto A = inputDenseMatrix<CType>(ctx);
+			auto B = inputDenseMatrix<CType>(ctx);
+			outputDenseMatrix<CType>(ctx, mldivide(A, B));
 		}
-
-		outputDenseMatrix<CType>(C);
 		break;
 	}
 	case str2int("chol"):
 	{
-		if (isInputSparse(1))
-		{
-			auto A = inputSparseMatrix<CType>();
-			assertThrow(A.rows() == A.cols(), "chol: Incompatible sizes.");
-
-			Eigen::SimplicialLLT<SparseMatrix<CType>, Eigen::Upper, Eigen::NaturalOrdering<Eigen::Index>> lltOfA(A); // compute the Cholesky decomposition of A
-			assertThrow(lltOfA.info() == Eigen::Success, "chol: solver failed.");
-			SparseMatrix<CType> U = lltOfA.matrixU();
-			outputSparseMatrix<CType>(U);
-		}
+		if (isInputSparse(ctx, 1))
+			outputSparseMatrix<CType>(ctx, chol(inputSparseMatrix<CType>(ctx)));
 		else
-		{
-			auto A = inputDenseMatrix<CType>();
-			assertThrow(A.rows() == A.cols(), "chol: Incompatible sizes.");
+			outputDenseMatrix<CType>(ctx, chol(inputDenseMatrix<CType>(ctx)));
+		break;
+	}
+	case str2int("toText"):
+	{
+		// the entries in column major order, one per line, as uint8; the text is formatted in
+		// the scratch arena and copied once into the output
+		auto A = inputDenseMatrix<CType>(ctx);
+		auto format = ctx.hasInput() ? textFormat(inputString(ctx)) : qd::text::decimal;
+		int digits = (int)inputScalar<double>(ctx, 0.0);
+		if (digits <= 0)
+			digits = qd::text::default_digits<CType>();
 
-			Eigen::LLT<Matrix<CType>> lltOfA(A); // compute the Cholesky decomposition of A
-			assertThrow(lltOfA.info() == Eigen::Success, "chol: solver failed.");
-			Matrix<CType> U = lltOfA.matrixU();
-			outputDenseMatrix<CType>(U);
-		}
+		size_t n = size_t(A.size());
+		char* text = scratchArray<char>(n * (qd::text::max_length<CType>(format, digits) + 1));
+		size_t length = qd::text::write_n(A.data(), n, text, format, digits);
+		outputArray<uint8_t>(ctx, (uint8_t*)text, 1, length);
+		break;
+	}
+	case str2int("fromText"):
+	{
+		size_t m = kAnySize, n = kAnySize;
+		auto text = (const char*)inputArray<uint8_t>(ctx, m, n);
+		auto end = text + m * n;
+		size_t rows = ctx.hasInput() ? (size_t)inputScalar<double>(ctx) : qd::text::count(text, end);
+		size_t cols = ctx.hasInput() ? (size_t)inputScalar<double>(ctx) : 1;
+
+		auto X = outputDenseMatrix<CType>(ctx, rows, cols);
+		const char* stop = nullptr;
+		size_t count = qd::text::read_n(text, end, X.data(), rows * cols, &stop);
+		assertThrow(count == rows * cols && stop == end, "fromText: the text should have " + std::to_string(rows * cols) +
+			" numbers; reading stopped after " + std::to_string(count) + ".");
+		break;
+	}
+	case str2int("writeFile"):
+	{
+		// writeFile(A, filename, chunkBytes, compress), see matrixFile.h for the format
+		auto write = [&](const auto& A) {
+			auto filename = inputString(ctx);
+			MatrixFileOptions options;
+			options.chunkBytes = (size_t)inputScalar<double>(ctx, double(options.chunkBytes));
+			options.compress = inputScalar<bool>(ctx, options.compress);
+			writeMatrixFile(filename, A, options);
+		};
+		if (isInputSparse(ctx, ctx.rhs_id))
+			write(inputSparseMatrix<CType>(ctx));
+		else
+			write(inputDenseMatrix<CType>(ctx));
+		break;
+	}
+	case str2int("readFile"):
+	{
+		// The file is memory-mapped and the chunks are decoded (or copied) straight into the
+		// output array, so there is no toMex pass. Lower precisions are converted to CType.
+		MatrixFile file(inputString(ctx));
+		auto& header = file.header();
+		if (!header.sparse)
+			file.readValues(outputDenseMatrix<CType>(ctx, header.rows, header.cols).data());
+		else if (file.inPlace() && header.scalarType == realTypeOf<CType>())
+			outputSparseMatrix<CType>(ctx, file.sparseMap<CType>());
+		else
+			outputSparseMatrix<CType>(ctx, file.readSparse<CType>());
+		break;
+	}
+	case str2int("selfCheck"):
+	{
+		// the names of the failing checks of qd/self_check.h, empty if all pass
+		outputString(ctx, qd::check_names(qd::self_check()).c_str());
 		break;
 	}
 	case str2int("eps"):
 	{
 		Matrix<CType> eps = Matrix<CType>::Constant(1, 1, std::numeric_limits<CType>::epsilon());
-		outputDenseMatrix<CType>(eps);
+		outputDenseMatrix<CType>(ctx, eps);
 		break;
 	}
 	default:
 		throw std::runtime_error("Unsupported command: " + cmd);
 	}
+	return 0;
 }
\ No newline at end of file
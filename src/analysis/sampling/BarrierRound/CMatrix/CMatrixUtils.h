@@ -1,62 +1,20 @@
 #pragma once
 
-#include <Eigen/Dense>
-#include <Eigen/Sparse>
-#include <Eigen/SparseCholesky>
-#include <Eigen/SparseLU>
-#include <Eigen/SparseQR>
-
-#include <stdexcept>
-#undef eigen_assert
-#define eigen_assert(x) \
-  if (!(x)) { throw (std::runtime_error("Eigen runtime error.")); }
-
+#include "CMatrixCore.h"
 #include "mexUtils.h"
 using namespace MexEnvironment;
 
 
-template<class T>
-using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
-
-template<class T>
-using Map = Eigen::Map<Matrix<T>, Eigen::Aligned32>;
-
-template<class T>
-using SparseMatrix = Eigen::SparseMatrix<T, Eigen::ColMajor, SignedIndex>;
-
-template<class T>
-using SparseMap = Eigen::Map<SparseMatrix<T>, Eigen::Aligned32>;
-
-template<typename T>
-struct DefaultNumTraits : Eigen::GenericNumTraits<T>
+bool isInputSparse(MexContext& ctx, int id)
 {
-	static inline T dummy_precision() { return 1000 * std::numeric_limits<T>::epsilon(); }
-	static inline T epsilon() { return std::numeric_limits<T>::epsilon(); }
-};
-
-template<typename T>
-bool isZero(T x, int eps_factor = 1)
-{
-	T eps = eps_factor * std::numeric_limits<T>::epsilon();
-	return x < eps&& x > -eps;
-}
-
-template<>
-bool isZero(bool x, int _)
-{
-	return !x;
-}
-
-bool isInputSparse(int id)
-{
-	const mxArray* pt = prhs[id];
+	const mxArray* pt = ctx.prhs[id];
 	return (mxIsSparse(pt) || mxIsCell(pt));
 }
 
 template<typename T>
-bool compatibleWith(uint64_t id)
+bool compatibleWith(MexContext& ctx, uint64_t id)
 {
-	const mxArray* pt = prhs[id];
+	const mxArray* pt = ctx.prhs[id];
 	if (!mxIsCell(pt))
 		return (mxGetClassID(pt) == MexType<T>()) || (mxGetClassID(pt) == MexType<uint8_t>() && mxGetM(pt) == sizeof(T));
 	else
@@ -75,12 +33,12 @@ void checkAlignment(const void* ptr)
 
 
 template<typename Tx>
-Map<Tx> inputDenseMatrix(size_t required_m = kAnySize, size_t required_n = kAnySize)
+Map<Tx> inputDenseMatrix(MexContext& ctx, size_t required_m = kAnySize, size_t required_n = kAnySize)
 {
-	const mxArray* pt = input();
+	const mxArray* pt = input(ctx);
 
 	assertThrow(!mxIsComplex(pt) && !mxIsSparse(pt),
-		"inputDenseMatrix: The " + to_string(rhs_id) + "-th parameter should be a real dense array.");
+		"inputDenseMatrix: The " + to_string(ctx.rhs_id) + "-th parameter should be a real dense array.");
 
 	auto n_dim = mxGetNumberOfDimensions(pt);
 	auto dims = mxGetDimensions(pt);
@@ -97,18 +55,18 @@ Map<Tx> inputDenseMatrix(size_t required_m = kAnySize, size_t required_n = kAnyS
 		navie_input = true;
 	}
 
-	checkInputSize(required_m, required_n, m, n);
+	checkInputSize(ctx, required_m, required_n, m, n);
 
 	void* x = mxGetData(pt);
 	checkAlignment(x);
 	if (navie_input || mxGetClassID(pt) == MexType<Tx>())
 		return Map<Tx>((Tx*)x, m, n);
 	else
-		throw std::runtime_error("inputDenseMatrix: The " + to_string(rhs_id) + "-th parameter should be of type " + typeid(Tx).name() + ".");
+		throw std::runtime_error("inputDenseMatrix: The " + to_string(ctx.rhs_id) + "-th parameter should be of type " + typeid(Tx).name() + ".");
 }
 
 template<typename Tx, typename Derived>
-void outputDenseMatrix(const Eigen::DenseBase<Derived>& A, bool native_output = false)
+void outputDenseMatrix(MexContext& ctx, const Eigen::DenseBase<Derived>& A, bool native_output = false)
 {
 	mxArray* pt;
 	auto m = A.rows(), n = A.cols();
@@ -128,13 +86,32 @@ void outputDenseMatrix(const Eigen::DenseBase<Derived>& A, bool native_output =
 		for (int i = 0; i < m; ++i)
 			Ax[i + j * m] = Tx(A(i, j));
 
-	output(pt);
+	output(ctx, pt);
+}
+
+// Create the output array and return a map to its data, so it can be computed in place
+template<typename Tx>
+Map<Tx> outputDenseMatrix(MexContext& ctx, size_t m, size_t n, bool native_output = false)
+{
+	mxArray* pt;
+	if ((std::is_same<Tx, double>::value || std::is_same<Tx, bool>::value) && native_output)
+		pt = mxCreateNumericMatrix(m, n, MexType<Tx>(), mxREAL);
+	else
+	{
+		mwSize dims[3] = { mwSize(sizeof(Tx)), mwSize(m), mwSize(n) };
+		pt = mxCreateNumericArray(3, dims, MexType<uint8_t>(), mxREAL);
+	}
+
+	void* x = mxGetData(pt);
+	checkAlignment(x);
+	output(ctx, pt);
+	return Map<Tx>((Tx*)x, m, n);
 }
 
 template<typename Tx>
-SparseMap<Tx> inputSparseMatrix(size_t required_m = kAnySize, size_t required_n = kAnySize)
+SparseMap<Tx> inputSparseMatrix(MexContext& ctx, size_t required_m = kAnySize, size_t required_n = kAnySize)
 {
-	const mxArray* pt = input();
+	const mxArray* pt = input(ctx);
 
 	const mxArray* pt_S, * pt_x;
 	if (mxIsCell(pt))
@@ -148,10 +125,10 @@ SparseMap<Tx> inputSparseMatrix(size_t required_m = kAnySize, size_t required_n
 		pt_x = pt;
 	}
 	else
-		throw std::runtime_error("inputSparseMatrix: The " + to_string(rhs_id) + "-th parameter should be sparse.");
+		throw std::runtime_error("inputSparseMatrix: The " + to_string(ctx.rhs_id) + "-th parameter should be sparse.");
 
 	size_t m = mxGetM(pt_S), n = mxGetN(pt_S), nzmax = mxGetNzmax(pt_S);
-	checkInputSize(required_m, required_n, m, n);
+	checkInputSize(ctx, required_m, required_n, m, n);
 
 	SignedIndex* ir = (SignedIndex*)mxGetIr(pt_S), * jc = (SignedIndex*)mxGetJc(pt_S);
 	void* x = mxGetData(pt_x);
@@ -159,19 +136,19 @@ SparseMap<Tx> inputSparseMatrix(size_t required_m = kAnySize, size_t required_n
 	if ((mxGetClassID(pt_x) == MexType<uint8_t>() && mxGetM(pt_x) == sizeof(Tx)) || mxGetClassID(pt_x) == MexType<Tx>())
 		return SparseMap<Tx>(m, n, nzmax, jc, ir, (Tx*)x);
 	else
-		throw std::runtime_error("inputSparseMatrix: The " + to_string(rhs_id) + "-th parameter should be of type " + typeid(Tx).name());
+		throw std::runtime_error("inputSparseMatrix: The " + to_string(ctx.rhs_id) + "-th parameter should be of type " + typeid(Tx).name());
 }
 
 // We do not optimize the performance of outputing sparse matrix
 template<typename Tx, typename Derived>
-void outputSparseMatrix(const Eigen::SparseCompressedBase<Derived>& A, bool  native_output = false)
+void outputSparseMatrix(MexContext& ctx, const Eigen::SparseCompressedBase<Derived>& A, bool  native_output = false)
 {
 	assertThrow(A.isCompressed(), "outputSparseMatrix: A should be compressed.");
 
 	if (A.IsRowMajor)
 	{
 		SparseMatrix<Tx> A_col_major(A.template cast<Tx>());
-		outputSparseMatrix<Tx>(A_col_major);
+		outputSparseMatrix<Tx>(ctx, A_col_major);
 		return;
 	}
 
@@ -219,7 +196,7 @@ void outputSparseMatrix(const Eigen::SparseCompressedBase<Derived>& A, bool  nat
 	for (int s = 0; s <= n; ++s)
 		Aj[s] = SignedIndex(j[s]);
 
-	output(pt);
+	output(ctx, pt);
 }
 
 constexpr unsigned int str2int(const char* str, int h = 0)
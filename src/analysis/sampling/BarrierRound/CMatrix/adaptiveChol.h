@@ -0,0 +1,1143 @@
+#pragma once
+// AdaptiveChol without mex: Cholesky factors of A W A' + offset I in float, double,
+// dd_real, td_real or qd_real, with serialization, shared factors and a matrix-free (PCG) mode.
+// cholMex.cpp is the MATLAB adapter; each AdaptiveChol object is independent, so
+// different objects can be used from different threads.
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "CMatrixCore.h"
+#include "arithmetic.h"
+#include "realTypes.h"
+#include "binaryIO.h"
+#include "profiler.h"
+#include "sparseProduct.h"
+
+// sum of squared column counts, the flops of computing the Cholesky factor L
+template<typename T, typename Ti>
+double choleskyFlops(const Eigen::SparseMatrix<T, Eigen::ColMajor, Ti>& L)
+{
+	double flops = 0.0;
+	auto Lj = L.outerIndexPtr();
+	for (Eigen::Index j = 0; j < L.cols(); ++j)
+		flops += double(Lj[j + 1] - Lj[j]) * double(Lj[j + 1] - Lj[j]);
+	return flops;
+}
+
+// SimplicialLLT that can write and read its symbolic analysis and numeric factor
+template<class T>
+struct LLT : Eigen::SimplicialLLT<SparseMatrix<T>, Eigen::Upper, Eigen::NaturalOrdering<Eigen::Index>>
+{
+	using StorageIndex = typename SparseMatrix<T>::StorageIndex;
+
+	int64_t factorNonZeros() const
+	{
+		return this->m_factorizationIsOk ? this->m_matrix.nonZeros() : -1;
+	}
+
+	double factorFlops() const
+	{
+		return this->m_factorizationIsOk ? choleskyFlops(this->m_matrix) : 0.0;
+	}
+
+	// the lower triangular factor; the ordering is natural, so there is no permutation
+	const SparseMatrix<T>& factor() const
+	{
+		return this->m_matrix;
+	}
+
+	void save(ByteWriter& out) const
+	{
+		assertThrow(this->m_factorizationIsOk && this->m_matrix.isCompressed(), "serialize: the factor is not available.");
+
+		int64_t n = this->m_matrix.cols(), nnz = this->m_matrix.nonZeros();
+		int64_t nP = this->m_P.size(), nPinv = this->m_Pinv.size();
+		out.write(n);
+		out.write(nnz);
+		out.write(nP);
+		out.write(nPinv);
+		out.write(this->m_shiftOffset);
+		out.write(this->m_shiftScale);
+
+		out.align();
+		out.write(this->m_parent.data(), n);
+		out.align();
+		out.write(this->m_nonZerosPerCol.data(), n);
+		out.align();
+		out.write(this->m_P.indices().data(), nP);
+		out.align();
+		out.write(this->m_Pinv.indices().data(), nPinv);
+		out.align();
+		out.write(this->m_matrix.outerIndexPtr(), n + 1);
+		out.align();
+		out.write(this->m_matrix.innerIndexPtr(), nnz);
+		out.align();
+		out.write(this->m_matrix.valuePtr(), nnz);
+		out.align();
+	}
+
+	// Pointers into a blob written by save, for using the factor in place
+	struct View
+	{
+		int64_t n, nnz, nP;
+		const StorageIndex* outer;
+		const StorageIndex* inner;
+		const T* values;
+	};
+
+	static View view(ByteReader& in)
+	{
+		View v;
+		v.n = in.read<int64_t>();
+		v.nnz = in.read<int64_t>();
+		v.nP = in.read<int64_t>();
+		auto nPinv = in.read<int64_t>();
+		in.read<T>();
+		in.read<T>();
+
+		in.align();
+		in.view<StorageIndex>(v.n);
+		in.align();
+		in.view<StorageIndex>(v.n);
+		in.align();
+		in.view<StorageIndex>(v.nP);
+		in.align();
+		in.view<StorageIndex>(nPinv);
+		in.align();
+		v.outer = in.view<StorageIndex>(v.n + 1);
+		in.align();
+		v.inner = in.view<StorageIndex>(v.nnz);
+		in.align();
+		v.values = in.view<T>(v.nnz);
+		return v;
+	}
+
+	void load(ByteReader& in)
+	{
+		// m_isInitialized is private to Eigen; analyzing an empty pattern sets it
+		this->analyzePattern(SparseMatrix<T>());
+
+		auto n = in.read<int64_t>(), nnz = in.read<int64_t>();
+		auto nP = in.read<int64_t>(), nPinv = in.read<int64_t>();
+		this->m_shiftOffset = in.read<T>();
+		this->m_shiftScale = in.read<T>();
+
+		this->m_parent.resize(n);
+		this->m_nonZerosPerCol.resize(n);
+		this->m_P.resize(nP);
+		this->m_Pinv.resize(nPinv);
+		this->m_matrix.resize(n, n);
+		this->m_matrix.resizeNonZeros(nnz);
+
+		in.align();
+		in.read(this->m_parent.data(), n);
+		in.align();
+		in.read(this->m_nonZerosPerCol.data(), n);
+		in.align();
+		in.read(this->m_P.indices().data(), nP);
+		in.align();
+		in.read(this->m_Pinv.indices().data(), nPinv);
+		in.align();
+		in.read(this->m_matrix.outerIndexPtr(), n + 1);
+		in.align();
+		in.read(this->m_matrix.innerIndexPtr(), nnz);
+		in.align();
+		in.read(this->m_matrix.valuePtr(), nnz);
+		in.align();
+
+		this->m_analysisIsOk = true;
+		this->m_factorizationIsOk = true;
+		this->m_info = Eigen::Success;
+	}
+};
+
+// Header of a serialized factor. It is followed by the LLT::save blob.
+struct FactorHeader
+{
+	static const uint32_t kMagic = 0x4c484341; // "ACHL"
+	static const uint32_t kVersion = 1;
+
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t cholType = 0;
+	uint32_t scalarSize = 0;
+	uint32_t indexSize = sizeof(SignedIndex);
+	uint32_t reserved = 0;
+	int64_t rows = 0, cols = 0, nnz = 0; // size of A
+
+	static FactorHeader read(ByteReader& in)
+	{
+		auto header = in.read<FactorHeader>();
+		assertThrow(header.magic == kMagic && header.version == kVersion, "deserialize: not an AdaptiveChol factor.");
+		in.align();
+		return header;
+	}
+};
+
+template<typename T>
+using ConstSparseMap = Eigen::Map<const SparseMatrix<T>>;
+
+using IncompleteChol = Eigen::IncompleteCholesky<double, Eigen::Lower, Eigen::AMDOrdering<SignedIndex>>;
+
+// 2 * sum_k nnz(X(:,k)) * nnz(Y(k,:)), the flops of the sparse product X * Y
+template<typename T>
+double productFlops(const SparseMatrix<T>& X, const SparseMatrix<T>& Y)
+{
+	std::vector<double> rowCount(Y.rows(), 0.0);
+	auto Yi = Y.innerIndexPtr();
+	for (Eigen::Index p = 0; p < Y.nonZeros(); ++p)
+		rowCount[Yi[p]] += 1.0;
+
+	double flops = 0.0;
+	auto Xj = X.outerIndexPtr();
+	for (Eigen::Index k = 0; k < X.cols(); ++k)
+		flops += 2.0 * double(Xj[k + 1] - Xj[k]) * rowCount[k];
+	return flops;
+}
+
+// Y = A X and Y = A' X with the multiply-adds of the arithmetic policy P; the entries of
+// the sparse A are converted to the type of X as they are used
+template<typename P, typename T, typename SparseType>
+Matrix<T> sparseTimes(const SparseType& A, const Matrix<T>& X)
+{
+	using Ta = typename SparseType::Scalar;
+	Matrix<T> Y = Matrix<T>::Zero(A.rows(), X.cols());
+	for (Eigen::Index j = 0; j < X.cols(); ++j)
+		for (Eigen::Index k = 0; k < A.outerSize(); ++k)
+			for (typename SparseType::InnerIterator it(A, k); it; ++it)
+				Y(it.row(), j) = P::add(Y(it.row(), j), P::mul(Eigen::internal::cast<Ta, T>(it.value()), X(k, j)));
+	return Y;
+}
+
+template<typename P, typename T, typename SparseType>
+Matrix<T> sparseTransposeTimes(const SparseType& A, const Matrix<T>& X)
+{
+	using Ta = typename SparseType::Scalar;
+	Matrix<T> Y(A.cols(), X.cols());
+	for (Eigen::Index j = 0; j < X.cols(); ++j)
+		for (Eigen::Index k = 0; k < A.outerSize(); ++k)
+		{
+			T sum = T(0.0);
+			for (typename SparseType::InnerIterator it(A, k); it; ++it)
+				sum = P::add(sum, P::mul(Eigen::internal::cast<Ta, T>(it.value()), X(it.row(), j)));
+			Y(k, j) = sum;
+		}
+	return Y;
+}
+
+// Eigen solvers are not copyable, so they are reset by reconstruction
+template<typename Solver>
+void resetSolver(Solver& solver)
+{
+	solver.~Solver();
+	new (&solver) Solver();
+}
+
+// Settings for solving H x = b by PCG instead of a Cholesky factor of H = A W A'
+struct MatrixFreeOptions
+{
+	bool enabled = false;
+	double tol = 1e-10;     // relative residual for stopping PCG
+	int maxIter = 500;
+	double dropTol = 0.0;   // drop H_ij if |H_ij| <= dropTol * sqrt(H_ii H_jj) before preconditioning
+};
+
+// precision of the random sketch of halfProj: 'factor' (that of the factor), 'double' or 'single'
+inline realType sketchType(const std::string& name)
+{
+	if (name == "factor")
+		return realType(0);
+	else if (name == "double")
+		return doubleType;
+	else if (name == "single")
+		return floatType;
+	throw std::runtime_error("The sketch precision should be 'factor', 'double' or 'single'.");
+}
+
+// the factor L and A' rounded to precision S for CholSolver::halfProjIn
+template<typename S>
+struct SketchFactor
+{
+	SparseMatrix<S> L;
+	SparseMatrix<S> At;
+	bool ready = false;
+};
+
+// First, how to include the matrix
+// Automatically choosen. Then, it creates a Chol Solver of that type.
+// Okay, maybe A has all type already. Call matrixType
+// Then, I have cholType
+// Both factorize and solve are template function to avoid too much backAndForth
+// solve have input on how many iterations.
+
+template <typename CType>
+struct CholSolver
+{
+	SparseMatrix<CType> A;
+	SparseMatrix<CType> At;
+	LLT<CType> L;
+	std::mt19937_64 gen;
+
+	bool analyzed = false;
+
+	// matrix-free mode: H is only applied as A (W (A' x)) + shift x and
+	// preconditioned by an incomplete Cholesky of a sparsified H in double
+	MatrixFreeOptions pcg;
+	SparseMatrix<CType> W;
+	CType shift = CType(0.0);
+	IncompleteChol precond;
+	bool precondOkay = false;
+	double pcgResidual = std::numeric_limits<double>::infinity();
+	int64_t pcgIterations = 0;
+
+	// factor used read-only in place, from a shared memory segment or a mapped file; used instead of L when set
+	std::unique_ptr<MappedBytes> shared;
+	std::unique_ptr<ConstSparseMap<CType>> sharedL;
+
+	// rounded copies of the factor for halfProjIn, made on first use after each factorization
+	std::tuple<SketchFactor<float>, SketchFactor<double>> sketches;
+
+	Profiler* profiler = nullptr;
+	realType type = realTypeOf<CType>();
+
+	// float results are returned in double since MATLAB has no sparse single
+	using OutType = std::conditional_t<std::is_same<CType, float>::value, double, CType>;
+
+	template<typename T>
+	void initialize(const T& A_, uint64_t uid)
+	{
+		A = A_.template cast<CType>();
+		gen.seed(uid);
+	}
+
+	template<typename T>
+	bool factorize(const T& W, double offset)
+	{
+		assertThrow(A.cols() == W.rows(), "factorize: dimension mismatch.");
+		detachShared();
+		dropSketches();
+
+		if (pcg.enabled)
+			return factorizeMatrixFree(W, offset);
+
+		SparseMatrix<CType> H;
+		{
+			ProfileScope scope(profiler, "AWAt", type);
+			if (!analyzed)
+				At = A.transpose();
+
+			SparseMatrix<CType> Wc = W.template cast<CType>();
+			SparseMatrix<CType> AW = sparseProduct(A, Wc);
+			H = sparseProduct(AW, At);
+			scope.flops = productFlops(AW, At);
+		}
+
+		L.setShift(CType(offset));
+
+		if (!analyzed)
+		{
+			ProfileScope scope(profiler, "analyzePattern", type);
+			L.analyzePattern(H);
+			analyzed = true;
+		}
+
+		{
+			ProfileScope scope(profiler, "factorize", type);
+			L.factorize(H);
+			scope.flops = L.factorFlops();
+			scope.nnzL = L.factorNonZeros();
+		}
+		return L.info() == Eigen::Success;
+	}
+
+	template<typename T>
+	bool factorizeMatrixFree(const T& W_, double offset)
+	{
+		if (At.rows() != A.cols())
+			At = A.transpose();
+
+		W = W_.template cast<CType>();
+		shift = CType(offset);
+
+		auto m = A.rows();
+		{
+			ProfileScope scope(profiler, "preconditioner", doubleType);
+			SparseMatrix<double> Ad = A.template cast<double>();
+			SparseMatrix<double> Wd = W_.template cast<double>();
+			SparseMatrix<double> AdW = sparseProduct(Ad, Wd);
+			SparseMatrix<double> Adt = Ad.transpose();
+			SparseMatrix<double> H = sparseProduct(AdW, Adt);
+			if (offset != 0.0)
+			{
+				SparseMatrix<double> I(m, m);
+				I.setIdentity();
+				H += offset * I;
+			}
+
+			if (pcg.dropTol > 0.0)
+			{
+				Eigen::VectorXd d = H.diagonal().cwiseAbs().cwiseSqrt();
+				double dropTol = pcg.dropTol;
+				H.prune([&](const Eigen::Index& i, const Eigen::Index& j, const double& v) {
+					return i == j || std::abs(v) > dropTol * d(i) * d(j);
+				});
+			}
+
+			precond.compute(H);
+			precondOkay = (precond.info() == Eigen::Success);
+			scope.flops = productFlops(AdW, Adt);
+			if (precondOkay)
+			{
+				scope.flops += choleskyFlops(precond.matrixL());
+				scope.nnzL = precond.matrixL().nonZeros();
+			}
+		}
+
+		// a trial solve tells the caller whether this precision is good enough
+		bool okay = false;
+		if (precondOkay)
+		{
+			std::bernoulli_distribution dist(0.5);
+			Matrix<CType> b(m, 1);
+			for (auto i = 0; i < m; ++i)
+				b(i, 0) = CType(double(dist(gen)) * 2.0 - 1.0);
+			pcgSolve(b);
+			okay = (pcgResidual <= pcg.tol);
+		}
+		return okay;
+	}
+
+	Matrix<CType> applyH(const Matrix<CType>& x)
+	{
+		Matrix<CType> Atx = At * x;
+		Matrix<CType> WAtx = W * Atx;
+		return A * WAtx + shift * x;
+	}
+
+	Matrix<CType> precondition(const Matrix<CType>& r)
+	{
+		Matrix<double> z = precond.solve(r.template cast<double>());
+		return z.template cast<CType>();
+	}
+
+	// solve H X = B column by column with preconditioned conjugate gradient
+	template<typename Derived>
+	Matrix<CType> pcgSolve(const Eigen::MatrixBase<Derived>& B)
+	{
+		assertThrow(precondOkay, "solve: Numerical Issue.");
+
+		ProfileScope scope(profiler, "pcg", type);
+		Matrix<CType> X = Matrix<CType>::Zero(B.rows(), B.cols());
+		pcgResidual = 0.0;
+		int64_t iterations = 0;
+		for (auto j = 0; j < B.cols(); ++j)
+		{
+			Matrix<CType> r = B.col(j), x = Matrix<CType>::Zero(B.rows(), 1);
+			CType bNorm = r.norm();
+			if (isZero(bNorm))
+				continue;
+
+			Matrix<CType> z = precondition(r), p = z, Hp;
+			CType rz = r.col(0).dot(z.col(0));
+			double residual = 1.0;
+			for (int iter = 0; iter < pcg.maxIter; ++iter)
+			{
+				++iterations;
+				Hp = applyH(p);
+				CType alpha = rz / p.col(0).dot(Hp.col(0));
+				x += alpha * p;
+				r -= alpha * Hp;
+
+				residual = double(r.norm() / bNorm);
+				if (!(residual > pcg.tol))
+					break;
+
+				z = precondition(r);
+				CType rzNew = r.col(0).dot(z.col(0));
+				p = z + (rzNew / rz) * p;
+				rz = rzNew;
+			}
+			X.col(j) = x;
+			pcgResidual = std::max(pcgResidual, residual);
+		}
+
+		pcgIterations = iterations;
+		scope.nnzL = precond.matrixL().nonZeros();
+		scope.flops = double(iterations) * (4.0 * A.nonZeros() + 4.0 * scope.nnzL + 10.0 * A.rows());
+		return X;
+	}
+
+	template<typename Derived>
+	Matrix<CType> solve(const Eigen::MatrixBase<Derived>& B)
+	{
+		if (pcg.enabled)
+			return pcgSolve(B);
+
+		assertThrow(factorOkay(), "solve: Numerical Issue.");
+		ProfileScope scope(profiler, "triangularSolve", type);
+		scope.nnzL = factorNonZeros();
+		scope.flops = 4.0 * scope.nnzL * B.cols();
+		if (!sharedL)
+			return L.solve(B);
+
+		Matrix<CType> X = B;
+		sharedL->template triangularView<Eigen::Lower>().solveInPlace(X);
+		sharedL->transpose().template triangularView<Eigen::Upper>().solveInPlace(X);
+		return X;
+	}
+
+	bool factorOkay() const
+	{
+		return sharedL || L.info() == Eigen::Success;
+	}
+
+	int64_t factorNonZeros() const
+	{
+		return sharedL ? sharedL->nonZeros() : L.factorNonZeros();
+	}
+
+	// use the factor saved in shm in place of L; At is still computed locally
+	void attachShared(std::unique_ptr<MappedBytes> shm, ByteReader& in)
+	{
+		auto view = LLT<CType>::view(in);
+		assertThrow(view.n == A.rows() && view.nP == 0, "attach: the factor does not belong to this matrix.");
+
+		resetSolver(L);
+		dropSketches();
+		analyzed = false;
+		sharedL.reset(new ConstSparseMap<CType>(view.n, view.n, view.nnz, view.outer, view.inner, view.values));
+		shared = std::move(shm);
+		if (At.rows() != A.cols())
+			At = A.transpose();
+	}
+
+	void detachShared()
+	{
+		sharedL.reset();
+		shared.reset();
+	}
+
+	// Matrix-free sketch: u = A' H^-1 A W^(1/2) g with Rademacher g, so E[u u'] = A' H^-1 A
+	Matrix<CType> halfProjMatrixFree(int k)
+	{
+		assertThrow(precondOkay, "factorize must be called before leverageScore.");
+
+		ProfileScope scope(profiler, "halfProj", type);
+		scope.flops = 4.0 * A.nonZeros() * k;
+		std::bernoulli_distribution dist(0.5);
+
+		auto n = A.cols();
+		Matrix<CType> w = W.diagonal();
+		Matrix<CType> g(n, k);
+		for (auto j = 0; j < k; ++j)
+		{
+			for (auto i = 0; i < n; ++i)
+			{
+				g(i, j) = CType(double(dist(gen))*2.0-1.0) * sqrt(w(i, 0));
+			}
+		}
+
+		Matrix<CType> y = A * g;
+		Matrix<CType> u = At * pcgSolve(y);
+
+		return u;
+	}
+
+	Matrix<CType> halfProj(int k)
+	{
+		if (pcg.enabled)
+			return halfProjMatrixFree(k);
+
+		assertThrow(factorOkay(), "factorize must be called before leverageScore.");
+
+		ProfileScope scope(profiler, "halfProj", type);
+		scope.nnzL = factorNonZeros();
+		scope.flops = 2.0 * (scope.nnzL + A.nonZeros()) * k;
+		std::bernoulli_distribution dist(0.5);
+
+		auto n = A.rows();
+		Matrix<CType> z(n, k);
+		for (auto j = 0; j < k; ++j)
+		{
+			for (auto i = 0; i < n; ++i)
+			{
+				z(i, j) = CType(double(dist(gen))*2.0-1.0);
+			}
+		}
+
+		if (sharedL)
+			sharedL->transpose().template triangularView<Eigen::Upper>().solveInPlace(z);
+		else
+			L.matrixU().solveInPlace(z);
+		Matrix<CType> u = At * z;
+
+		return u;
+	}
+
+	// halfProj with L and A' rounded to a lower precision S. The sum of the leverage scores
+	// needs the full precision (see cholAccuracy in AdaptiveChol.m), but a JL sketch with k
+	// columns is only accurate to about 1/sqrt(k): reading L in double instead of dd_real
+	// halves the bytes of the triangular solve, and in float quarters them.
+	template<typename S>
+	Matrix<S> halfProjIn(int k)
+	{
+		if (pcg.enabled)
+			return halfProjMatrixFree(k).template cast<S>();
+
+		assertThrow(factorOkay(), "factorize must be called before leverageScore.");
+
+		auto& sketch = std::get<SketchFactor<S>>(sketches);
+		if (!sketch.ready)
+		{
+			ProfileScope scope(profiler, "sketchFactor", realTypeOf<S>());
+			if (sharedL)
+				sketch.L = sharedL->template cast<S>();
+			else
+				sketch.L = L.factor().template cast<S>();
+			sketch.At = At.template cast<S>();
+			sketch.ready = true;
+		}
+
+		ProfileScope scope(profiler, "halfProj", realTypeOf<S>());
+		scope.nnzL = sketch.L.nonZeros();
+		scope.flops = 2.0 * (scope.nnzL + A.nonZeros()) * k;
+		std::bernoulli_distribution dist(0.5);
+
+		auto n = A.rows();
+		Matrix<S> z(n, k);
+		for (auto j = 0; j < k; ++j)
+		{
+			for (auto i = 0; i < n; ++i)
+			{
+				z(i, j) = S(double(dist(gen))*2.0-1.0);
+			}
+		}
+
+		sketch.L.transpose().template triangularView<Eigen::Upper>().solveInPlace(z);
+		Matrix<S> u = sketch.At * z;
+
+		return u;
+	}
+
+	void dropSketches()
+	{
+		sketches = decltype(sketches)();
+	}
+
+	void releaseFactor()
+	{
+		detachShared();
+		dropSketches();
+		resetSolver(L);
+		resetSolver(precond);
+		At = SparseMatrix<CType>();
+		W = SparseMatrix<CType>();
+		precondOkay = false;
+		analyzed = false;
+	}
+
+	Matrix<CType> diagonal() const
+	{
+		assertThrow(!pcg.enabled, "diagonal: not available in matrix-free mode.");
+		assertThrow(factorOkay(), "diagonal: Numerical Issue.");
+		Matrix<CType> D;
+		if (sharedL)
+		{
+			// the diagonal is the first entry of each column of L
+			D.resize(sharedL->cols(), 1);
+			for (Eigen::Index j = 0; j < sharedL->cols(); ++j)
+				D(j, 0) = sharedL->valuePtr()[sharedL->outerIndexPtr()[j]];
+		}
+		else
+		{
+			SparseMatrix<CType> L_concrete = L.matrixL();
+			D = L_concrete.diagonal();
+		}
+		return D;
+	}
+};
+
+template <typename CType>
+using CholSolverPtr = std::unique_ptr<CholSolver<CType>>;
+
+// The cascade of CholSolvers of increasing precision behind one AdaptiveChol object.
+// Each CholSolver<T> (with its own copy of A, At and LLT) is only created when
+// precision T is first used. A is kept once in the precision it was given in.
+struct AdaptiveChol
+{
+	realType cholType = realType(0);
+	realType sourceType = realType(0);
+	uint64_t uid = 0;
+	std::vector<std::string> sharedNames; // segments published or attached by factorizeShared, every tier
+	MatrixFreeOptions pcg;
+	Profiler profiler;
+	CholSolverPtr<float> solver_f;
+	CholSolverPtr<double> solver_d;
+	CholSolverPtr<dd_real> solver_dd;
+	CholSolverPtr<td_real> solver_td;
+	CholSolverPtr<qd_real> solver_qd;
+
+	// factorizations running in the background, indexed by precisionRank
+	std::shared_future<bool> pending[5];
+
+	AdaptiveChol() = default;
+	~AdaptiveChol()
+	{
+		waitAll();
+		unlinkShared();
+	}
+
+	AdaptiveChol(const AdaptiveChol&) = delete;
+	AdaptiveChol& operator=(const AdaptiveChol&) = delete;
+
+	template<typename CType> CholSolverPtr<CType>& slot();
+
+	// A is given in precision T
+	template<typename T, typename AType>
+	void initialize(const AType& A, uint64_t uid_)
+	{
+		uid = uid_;
+		sourceType = realTypeOf<T>();
+		slot<T>().reset(new CholSolver<T>);
+		slot<T>()->initialize(A, uid);
+		slot<T>()->profiler = &profiler;
+	}
+
+	// get the solver of precision CType, casting A from the source precision on first use
+	template<typename CType>
+	CholSolver<CType>& get()
+	{
+		auto& solver = slot<CType>();
+		if (!solver)
+		{
+			solver.reset(new CholSolver<CType>);
+			if (sourceType == doubleType)
+				solver->initialize(solver_d->A, uid);
+			else if (sourceType == dd_realType)
+				solver->initialize(solver_dd->A, uid);
+			else if (sourceType == td_realType)
+				solver->initialize(solver_td->A, uid);
+			else if (sourceType == qd_realType)
+				solver->initialize(solver_qd->A, uid);
+			else
+				throw std::runtime_error("AdaptiveChol is not initialized.");
+			solver->pcg = pcg;
+			solver->profiler = &profiler;
+		}
+		return *solver;
+	}
+
+	// the solver of the last factorization
+	template<typename CType>
+	CholSolver<CType>& current()
+	{
+		assertThrow(cholType == realTypeOf<CType>() && slot<CType>(), "factorize must be called first.");
+		return *slot<CType>();
+	}
+
+	template<typename CType>
+	void setMatrixFree(const MatrixFreeOptions& options)
+	{
+		discard(realTypeOf<CType>()); // a background factorization still uses the solver
+		auto& solver = slot<CType>();
+		if (solver && solver->pcg.enabled != options.enabled)
+			solver->releaseFactor();
+		if (solver)
+			solver->pcg = options;
+	}
+
+	void setMatrixFree(const MatrixFreeOptions& options)
+	{
+		pcg = options;
+		setMatrixFree<float>(pcg);
+		setMatrixFree<double>(pcg);
+		setMatrixFree<dd_real>(pcg);
+		setMatrixFree<td_real>(pcg);
+		setMatrixFree<qd_real>(pcg);
+		cholType = realType(0);
+	}
+
+	// factorize A W A' + offset I in precision CType; W may be given in another precision,
+	// e.g. the float tier is factorized from a double W
+	template<typename CType, typename WType>
+	bool factorize(const WType& W, double offset)
+	{
+		discard(realTypeOf<CType>());
+		bool okay = get<CType>().factorize(W, offset);
+		cholType = realTypeOf<CType>();
+		return okay;
+	}
+
+	// Same as factorize, but on another thread: returns at once, and wait(CType) gives okay
+	// and makes the factor current. Factorizations of different precisions may run at the
+	// same time since each only uses its own solver. Until it is waited for, that solver must
+	// not be used; waitFor and waitAll block until the factorizations are done.
+	template<typename CType, typename WType>
+	void factorizeAsync(WType W, double offset)
+	{
+		discard(realTypeOf<CType>());
+		auto* solver = &get<CType>();
+		pending[precisionRank(realTypeOf<CType>())] = std::async(std::launch::async,
+			[solver, W = std::move(W), offset] {
+				qd::fpu_guard fpu;
+				return solver->factorize(W, offset);
+			}).share();
+	}
+
+	// okay of the background factorization of precision type, which becomes the current factor
+	bool wait(realType type)
+	{
+		int rank = precisionRank(type);
+		assertThrow(rank >= 0 && pending[rank].valid(), "wait: no factorization in progress for this precision.");
+
+		auto result = std::move(pending[rank]);
+		pending[rank] = std::shared_future<bool>();
+		bool okay = result.get();
+		cholType = type;
+		return okay;
+	}
+
+	// block until the background factorization of precision type (if any) is done; its result is kept for wait
+	void waitFor(realType type)
+	{
+		int rank = precisionRank(type);
+		if (rank >= 0 && pending[rank].valid())
+			pending[rank].wait();
+	}
+
+	void waitAll()
+	{
+		for (auto& future : pending)
+			if (future.valid())
+				future.wait();
+	}
+
+	// drop the result of a background factorization that is superseded
+	void discard(realType type)
+	{
+		waitFor(type);
+		pending[precisionRank(type)] = std::shared_future<bool>();
+	}
+
+	// name of the segment for the factor of A W A' + offset I in precision CType
+	template<typename CType, typename WType>
+	std::string sharedSegmentName(const CholSolver<CType>& solver, const WType& W, double offset)
+	{
+		auto hashSparse = [](const auto& X, uint64_t h) {
+			using Scalar = typename std::decay_t<decltype(X)>::Scalar;
+			using Index = typename std::decay_t<decltype(X)>::StorageIndex;
+			auto n = X.cols();
+			auto nnz = X.outerIndexPtr()[n];
+			h = hashBytes(X.outerIndexPtr(), (n + 1) * sizeof(Index), h);
+			h = hashBytes(X.innerIndexPtr(), nnz * sizeof(Index), h);
+			return hashBytes(X.valuePtr(), nnz * sizeof(Scalar), h);
+		};
+
+		realType type = realTypeOf<CType>();
+		int64_t dims[] = { solver.A.rows(), solver.A.cols() };
+		uint64_t h = hashBytes(&type, sizeof(type));
+		h = hashBytes(dims, sizeof(dims), h);
+		h = hashBytes(&offset, sizeof(offset), h);
+		h = hashSparse(solver.A, h);
+		h = hashSparse(W, h);
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "/AdaptiveChol_%016llx", (unsigned long long)h);
+		return name;
+	}
+
+	// Same as factorize, but the factor is shared between processes through POSIX shared
+	// memory: attach to it if another process already published it, otherwise factorize
+	// and publish it. Returns okay and sets whether the factor was attached.
+	template<typename CType, typename WType>
+	bool factorizeShared(const WType& W, double offset, bool& attached)
+	{
+		discard(realTypeOf<CType>());
+		auto& solver = get<CType>();
+		assertThrow(!solver.pcg.enabled, "factorizeShared: not available in matrix-free mode.");
+		assertThrow(solver.A.cols() == W.rows(), "factorize: dimension mismatch.");
+
+		std::string sharedName = sharedSegmentName(solver, W, offset);
+		attached = false;
+		{
+			ProfileScope scope(&profiler, "attach", realTypeOf<CType>());
+			if (auto shm = SharedMemory::open(sharedName))
+			{
+				ByteReader in(shm->data, shm->size);
+				auto header = FactorHeader::read(in);
+				assertThrow(header.cholType == realTypeOf<CType>() && header.scalarSize == sizeof(CType) &&
+					header.indexSize == sizeof(SignedIndex) && header.rows == solver.A.rows() &&
+					header.cols == solver.A.cols() && header.nnz == solver.A.nonZeros(),
+					"factorizeShared: the shared factor does not belong to this matrix.");
+				solver.attachShared(std::unique_ptr<MappedBytes>(new MappedBytes(std::move(shm))), in);
+				rememberShared(sharedName);
+				attached = true;
+			}
+		}
+
+		cholType = realTypeOf<CType>();
+		if (attached)
+			return true;
+
+		bool okay = solver.factorize(W, offset);
+		if (solver.factorOkay())
+		{
+			ByteWriter out;
+			serialize<CType>(out);
+			SharedMemory::publish(sharedName, out); // another process may have won the race
+			rememberShared(sharedName);
+		}
+		return okay;
+	}
+
+	void rememberShared(const std::string& name)
+	{
+		if (std::find(sharedNames.begin(), sharedNames.end(), name) == sharedNames.end())
+			sharedNames.push_back(name);
+	}
+
+	// remove the names of every segment of factorizeShared; processes that attached keep their mapping
+	void unlinkShared()
+	{
+		for (auto& name : sharedNames)
+			SharedMemory::unlink(name);
+		sharedNames.clear();
+	}
+
+	template<typename CType>
+	void serialize(ByteWriter& out)
+	{
+		auto& solver = current<CType>();
+		assertThrow(!solver.pcg.enabled, "serialize: not available in matrix-free mode.");
+		assertThrow(solver.factorOkay(), "serialize: Numerical Issue.");
+
+		// an attached segment already holds the serialized factor
+		if (solver.shared)
+		{
+			out.write(solver.shared->data, solver.shared->size);
+			return;
+		}
+
+		FactorHeader header;
+		header.cholType = cholType;
+		header.scalarSize = sizeof(CType);
+		header.rows = solver.A.rows();
+		header.cols = solver.A.cols();
+		header.nnz = solver.A.nonZeros();
+		out.write(header);
+		out.align();
+		solver.L.save(out);
+	}
+
+	void serialize(ByteWriter& out)
+	{
+		if (cholType == floatType)
+			serialize<float>(out);
+		else if (cholType == doubleType)
+			serialize<double>(out);
+		else if (cholType == dd_realType)
+			serialize<dd_real>(out);
+		else if (cholType == td_realType)
+			serialize<td_real>(out);
+		else if (cholType == qd_realType)
+			serialize<qd_real>(out);
+		else
+			throw std::runtime_error("factorize must be called before serialize.");
+	}
+
+	// load a copy of the factor, or use it in place if the bytes of in are given, e.g. a mapped file
+	template<typename CType>
+	void deserialize(const FactorHeader& header, ByteReader& in, std::unique_ptr<MappedBytes> bytes)
+	{
+		discard(realTypeOf<CType>());
+		auto& solver = get<CType>();
+		assertThrow(header.scalarSize == sizeof(CType) && header.indexSize == sizeof(SignedIndex), "deserialize: incompatible factor.");
+		assertThrow(!solver.pcg.enabled, "deserialize: not available in matrix-free mode.");
+		assertThrow(solver.A.rows() == header.rows && solver.A.cols() == header.cols && solver.A.nonZeros() == header.nnz,
+			"deserialize: the factor does not belong to this matrix.");
+
+		solver.detachShared();
+		if (bytes)
+			solver.attachShared(std::move(bytes), in);
+		else
+		{
+			solver.dropSketches();
+			solver.L.load(in);
+			solver.At = solver.A.transpose();
+			solver.analyzed = true;
+		}
+		cholType = realTypeOf<CType>();
+	}
+
+	// read a factor written by serialize; returns its precision. Without bytes the factor is
+	// copied out of in; with the bytes that in reads (e.g. a MappedFile), it is used in place
+	// and they stay mapped until the next factorization of that precision.
+	realType deserialize(ByteReader& in, std::unique_ptr<MappedBytes> bytes = nullptr)
+	{
+		auto header = FactorHeader::read(in);
+
+		if (header.cholType == floatType)
+			deserialize<float>(header, in, std::move(bytes));
+		else if (header.cholType == doubleType)
+			deserialize<double>(header, in, std::move(bytes));
+		else if (header.cholType == dd_realType)
+			deserialize<dd_real>(header, in, std::move(bytes));
+		else if (header.cholType == td_realType)
+			deserialize<td_real>(header, in, std::move(bytes));
+		else if (header.cholType == qd_realType)
+			deserialize<qd_real>(header, in, std::move(bytes));
+		else
+			throw std::runtime_error("deserialize: unsupported type.");
+
+		return cholType;
+	}
+
+	// Free solvers of higher precision than the last factorization.
+	// The source precision keeps its copy of A, but drops At and the factor.
+	template<typename CType>
+	void releaseIfHigher()
+	{
+		auto& solver = slot<CType>();
+		if (precisionRank(realTypeOf<CType>()) <= precisionRank(cholType))
+			return;
+
+		discard(realTypeOf<CType>()); // a background factorization still uses the solver
+		if (!solver)
+			return;
+		if (realTypeOf<CType>() == sourceType)
+			solver->releaseFactor();
+		else
+			solver.reset();
+	}
+
+	void release()
+	{
+		releaseIfHigher<float>();
+		releaseIfHigher<double>();
+		releaseIfHigher<dd_real>();
+		releaseIfHigher<td_real>();
+		releaseIfHigher<qd_real>();
+	}
+
+	template<typename T, typename T2>
+	void solveStep(Matrix<T> &X, T2 &B)
+	{
+		if (cholType == floatType)
+		{
+			auto& solver = current<float>();
+			assertThrow(solver.A.rows() == B.rows(), "solve: dimension mismatch.");
+			X = solver.solve(B.template cast<float>()).template cast<T>();
+		}
+		else if (cholType == doubleType)
+		{
+			auto& solver = current<double>();
+			assertThrow(solver.A.rows() == B.rows(), "solve: dimension mismatch.");
+			X = solver.solve(B.template cast<double>()).template cast<T>();
+		}
+		else if (cholType == dd_realType)
+		{
+			auto& solver = current<dd_real>();
+			assertThrow(solver.A.rows() == B.rows(), "solve: dimension mismatch.");
+			X = solver.solve(B.template cast<dd_real>()).template cast<T>();
+		}
+		else if (cholType == td_realType)
+		{
+			auto& solver = current<td_real>();
+			assertThrow(solver.A.rows() == B.rows(), "solve: dimension mismatch.");
+			X = solver.solve(B.template cast<td_real>()).template cast<T>();
+		}
+		else if (cholType == qd_realType)
+		{
+			auto& solver = current<qd_real>();
+			assertThrow(solver.A.rows() == B.rows(), "solve: dimension mismatch.");
+			X = solver.solve(B.template cast<qd_real>()).template cast<T>();
+		}
+		else
+			throw std::runtime_error("factorize must be called before solve.");
+	}
+
+	// R = B - A W A' X in T with the arithmetic of P
+	template<typename P, typename T, typename BType, typename AType, typename WType>
+	static Matrix<T> refinementResidual(const BType& B, const AType& A, const WType& W, const Matrix<T>& X, ProfileScope& scope)
+	{
+		Matrix<T> AWAtx = sparseTimes<P>(A, sparseTimes<P>(W, sparseTransposeTimes<P>(A, X)));
+		Matrix<T> R(B.rows(), B.cols());
+		for (Eigen::Index j = 0; j < R.cols(); ++j)
+			for (Eigen::Index i = 0; i < R.rows(); ++i)
+				R(i, j) = P::sub(T(B(i, j)), AWAtx(i, j));
+		scope.flops = (4.0 * A.nonZeros() + 2.0 * W.nonZeros()) * X.cols();
+		return R;
+	}
+
+	// solve A W A' X = B in precision T with step - 1 steps of iterative refinement; the
+	// residuals use the arithmetic of P, e.g. AccurateArithmetic to get the last bits of a
+	// dd_real solve without a qd_real factor
+	template<typename T, typename P = DefaultArithmetic, typename BType, typename WType>
+	Matrix<T> solve(const BType& B, const WType& W, int step)
+	{
+		Matrix<T> X;
+		solveStep(X, B);
+
+		Matrix<T> R, Hinv_R;
+		for (int i = 1; i < step; ++i)
+		{
+			{
+				ProfileScope scope(&profiler, "residual", realTypeOf<T>());
+				if (cholType == floatType)
+				{
+					// refine against A in the source precision, not the float copy in the float solver
+					if (sourceType == floatType)
+						R = refinementResidual<P>(B, solver_f->A, W, X, scope);
+					else if (sourceType == doubleType)
+						R = refinementResidual<P>(B, solver_d->A, W, X, scope);
+					else if (sourceType == dd_realType)
+						R = refinementResidual<P>(B, solver_dd->A, W, X, scope);
+					else if (sourceType == td_realType)
+						R = refinementResidual<P>(B, solver_td->A, W, X, scope);
+					else if (sourceType == qd_realType)
+						R = refinementResidual<P>(B, solver_qd->A, W, X, scope);
+				}
+				else if (cholType == doubleType)
+					R = refinementResidual<P>(B, current<double>().A, W, X, scope);
+				else if (cholType == dd_realType)
+					R = refinementResidual<P>(B, current<dd_real>().A, W, X, scope);
+				else if (cholType == td_realType)
+					R = refinementResidual<P>(B, current<td_real>().A, W, X, scope);
+				else if (cholType == qd_realType)
+					R = refinementResidual<P>(B, current<qd_real>().A, W, X, scope);
+			}
+			solveStep(Hinv_R, R);
+			X += Hinv_R;
+		}
+		return X;
+	}
+
+	// relative residual of the last PCG solve (matrix-free mode)
+	double residual()
+	{
+		if (cholType == floatType)
+			return current<float>().pcgResidual;
+		else if (cholType == doubleType)
+			return current<double>().pcgResidual;
+		else if (cholType == dd_realType)
+			return current<dd_real>().pcgResidual;
+		else if (cholType == td_realType)
+			return current<td_real>().pcgResidual;
+		else if (cholType == qd_realType)
+			return current<qd_real>().pcgResidual;
+		else
+			throw std::runtime_error("Unsupported type.");
+	}
+};
+
+template<> inline CholSolverPtr<float>& AdaptiveChol::slot<float>() { return solver_f; }
+template<> inline CholSolverPtr<double>& AdaptiveChol::slot<double>() { return solver_d; }
+template<> inline CholSolverPtr<dd_real>& AdaptiveChol::slot<dd_real>() { return solver_dd; }
+template<> inline CholSolverPtr<td_real>& AdaptiveChol::slot<td_real>() { return solver_td; }
+template<> inline CholSolverPtr<qd_real>& AdaptiveChol::slot<qd_real>() { return solver_qd; }
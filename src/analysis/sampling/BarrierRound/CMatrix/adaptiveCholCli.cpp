@@ -0,0 +1,183 @@
+// Leverage scores of W^(1/2) A' from the command line, without MATLAB. Same cascade as
+// AdaptiveChol.m: factorize A W A' + offset I in double, then dd_real, td_real and qd_real,
+// until the sum of the leverage scores is within tol of rank(A) = size(A, 1).
+// Build from the CMatrix folder:
+//
+//   QD="qd/util.cc qd/bits.cc qd/dd_real.cc qd/qd_real.cc qd/td_real.cc qd/fpu.cc"
+//   g++ -std=c++17 -O3 -march=native -pthread -I. -I<eigen> adaptiveCholCli.cpp $QD -lrt -o adaptiveChol
+//
+// For scores that are the same bits on every machine, build with -ffp-contract=off -DQD_DETERMINISTIC
+// in place of -march=native (see the deterministic option of compile.m).
+//
+// Usage: adaptiveChol A.mtx [-w w.txt] [--offset x] [--tol x] [--jl k] [--single]
+//   A.mtx  Matrix Market coordinate file of A (m x n, full row rank)
+//   w.txt  n weights, one per line (default all ones)
+//   --jl   number of random projections for the leverage scores (default 32)
+// The scores are printed on stdout, one per line; the precision used goes to stderr.
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "adaptiveChol.h"
+
+namespace
+{
+	SparseMatrix<double> readMatrixMarket(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		assertThrow(file, "Cannot open " + filename + ".");
+
+		std::string line;
+		std::getline(file, line);
+		assertThrow(line.rfind("%%MatrixMarket matrix coordinate", 0) == 0 && line.find("complex") == std::string::npos,
+			filename + " is not a real Matrix Market coordinate file.");
+		bool pattern = line.find("pattern") != std::string::npos;
+
+		while (std::getline(file, line) && (line.empty() || line[0] == '%'))
+			;
+
+		long m = 0, n = 0, nnz = 0;
+		std::istringstream(line) >> m >> n >> nnz;
+		assertThrow(m > 0 && n > 0 && nnz >= 0, "Incorrect size line in " + filename + ".");
+
+		std::vector<Eigen::Triplet<double, SignedIndex>> entries;
+		entries.reserve(nnz);
+		for (long k = 0; k < nnz; ++k)
+		{
+			long i, j;
+			double value = 1.0;
+			file >> i >> j;
+			if (!pattern)
+				file >> value;
+			assertThrow(file && i >= 1 && i <= m && j >= 1 && j <= n, "Incorrect entry in " + filename + ".");
+			entries.emplace_back(SignedIndex(i - 1), SignedIndex(j - 1), value);
+		}
+
+		SparseMatrix<double> A(m, n);
+		A.setFromTriplets(entries.begin(), entries.end());
+		A.makeCompressed();
+		return A;
+	}
+
+	std::vector<double> readVector(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		assertThrow(file, "Cannot open " + filename + ".");
+		std::vector<double> x;
+		double value;
+		while (file >> value)
+			x.push_back(value);
+		return x;
+	}
+
+	// ls_i = avg_j w_i tau_ij^2 with tau = A' L^-T zeta
+	template<typename CType>
+	std::vector<double> leverageScore(AdaptiveChol& chol, const std::vector<double>& w, int JLDim)
+	{
+		Matrix<CType> tau = chol.current<CType>().halfProj(JLDim);
+		std::vector<double> ls(tau.rows());
+		for (Eigen::Index i = 0; i < tau.rows(); ++i)
+		{
+			CType sum = CType(0.0);
+			for (Eigen::Index j = 0; j < tau.cols(); ++j)
+				sum += tau(i, j) * tau(i, j);
+			ls[i] = double(sum * CType(w[i]) / CType(JLDim));
+		}
+		return ls;
+	}
+
+	// factorize in CType and report the leverage scores if they are accurate enough
+	template<typename CType>
+	bool tryPrecision(AdaptiveChol& chol, const SparseMatrix<double>& W, const std::vector<double>& w,
+		double offset, double tol, int JLDim, std::vector<double>& ls)
+	{
+		if (!chol.factorize<CType>(W, offset))
+			return false;
+
+		auto trial = leverageScore<CType>(chol, w, 1);
+		double sum = 0.0;
+		for (double x : trial)
+			sum += x;
+		if (!(std::abs(sum - double(chol.get<double>().A.rows())) < tol))
+			return false;
+
+		ls = leverageScore<CType>(chol, w, JLDim);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	qd::fpu_guard fpu;
+	try
+	{
+		checkArithmetic();
+		std::string matrixFile, weightFile;
+		double offset = 0.0, tol = 1e-4;
+		int JLDim = 32;
+		bool single = false;
+		for (int k = 1; k < argc; ++k)
+		{
+			std::string arg = argv[k];
+			bool hasValue = k + 1 < argc;
+			if (arg == "-w" && hasValue)
+				weightFile = argv[++k];
+			else if (arg == "--offset" && hasValue)
+				offset = std::stod(argv[++k]);
+			else if (arg == "--tol" && hasValue)
+				tol = std::stod(argv[++k]);
+			else if (arg == "--jl" && hasValue)
+				JLDim = std::stoi(argv[++k]);
+			else if (arg == "--single")
+				single = true;
+			else if (matrixFile.empty() && arg[0] != '-')
+				matrixFile = arg;
+			else
+				throw std::runtime_error("Usage: " + std::string(argv[0]) +
+					" A.mtx [-w w.txt] [--offset x] [--tol x] [--jl k] [--single]");
+		}
+		assertThrow(!matrixFile.empty(), "A matrix file is required.");
+
+		auto A = readMatrixMarket(matrixFile);
+		std::vector<double> w(A.cols(), 1.0);
+		if (!weightFile.empty())
+			w = readVector(weightFile);
+		assertThrow(w.size() == size_t(A.cols()), "The number of weights should be size(A, 2).");
+
+		SparseMatrix<double> W(A.cols(), A.cols());
+		for (Eigen::Index i = 0; i < A.cols(); ++i)
+			W.insert(i, i) = w[i];
+		W.makeCompressed();
+
+		AdaptiveChol chol;
+		chol.initialize<double>(A, 1);
+
+		std::vector<double> ls;
+		const char* precision = nullptr;
+		if (single && tryPrecision<float>(chol, W, w, offset, tol, JLDim, ls))
+			precision = "single";
+		else if (tryPrecision<double>(chol, W, w, offset, tol, JLDim, ls))
+			precision = "double";
+		else if (tryPrecision<dd_real>(chol, W, w, offset, tol, JLDim, ls))
+			precision = "dd_real";
+		else if (tryPrecision<td_real>(chol, W, w, offset, tol, JLDim, ls))
+			precision = "td_real";
+		else if (tryPrecision<qd_real>(chol, W, w, offset, tol, JLDim, ls))
+			precision = "qd_real";
+		assertThrow(precision, "The factorization is not accurate enough in any precision.");
+
+		std::fprintf(stderr, "precision: %s\n", precision);
+		for (double x : ls)
+			std::printf("%.17g\n", x);
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+// Arithmetic policies: the variant of +, -, * and / that a kernel uses for the qd types.
+// qd_config.h picks the sloppy or the accurate algorithms of dd_real and qd_real for their
+// operators once for the whole build. The policies make both available in the same build, so
+// a command can stay on the fast variants and switch to the accurate ones where the last bits
+// matter, e.g. the residual of an iterative refinement.
+//
+// realTypes.h has the dd_real, td_real and qd_real versions of sloppyAdd etc. For float and double
+// every variant is the plain operator.
+#include <stdexcept>
+#include <string>
+
+template<typename T> T sloppyAdd(const T& x, const T& y) { return x + y; }
+template<typename T> T sloppyMul(const T& x, const T& y) { return x * y; }
+template<typename T> T sloppyDiv(const T& x, const T& y) { return x / y; }
+template<typename T> T accurateAdd(const T& x, const T& y) { return x + y; }
+template<typename T> T accurateMul(const T& x, const T& y) { return x * y; }
+template<typename T> T accurateDiv(const T& x, const T& y) { return x / y; }
+
+// the operators, as configured in qd_config.h; only this policy uses the packed arrays of qd/simd.h
+struct DefaultArithmetic
+{
+	const static bool Packed = true;
+	template<typename T> static T add(const T& x, const T& y) { return x + y; }
+	template<typename T> static T sub(const T& x, const T& y) { return x - y; }
+	template<typename T> static T mul(const T& x, const T& y) { return x * y; }
+	template<typename T> static T div(const T& x, const T& y) { return x / y; }
+};
+
+// Cray-style error bound for add, and the faster multiply and divide
+struct SloppyArithmetic
+{
+	const static bool Packed = false;
+	template<typename T> static T add(const T& x, const T& y) { return sloppyAdd(x, y); }
+	template<typename T> static T sub(const T& x, const T& y) { return sloppyAdd(x, T(-y)); }
+	template<typename T> static T mul(const T& x, const T& y) { return sloppyMul(x, y); }
+	template<typename T> static T div(const T& x, const T& y) { return sloppyDiv(x, y); }
+};
+
+// IEEE-style error bound for add, and the accurate multiply and divide
+struct AccurateArithmetic
+{
+	const static bool Packed = false;
+	template<typename T> static T add(const T& x, const T& y) { return accurateAdd(x, y); }
+	template<typename T> static T sub(const T& x, const T& y) { return accurateAdd(x, T(-y)); }
+	template<typename T> static T mul(const T& x, const T& y) { return accurateMul(x, y); }
+	template<typename T> static T div(const T& x, const T& y) { return accurateDiv(x, y); }
+};
+
+// the policy named by the optional arithmetic argument of the mex commands
+enum ArithmeticMode { kDefaultArithmetic, kSloppyArithmetic, kAccurateArithmetic };
+
+inline ArithmeticMode arithmeticMode(const std::string& name)
+{
+	if (name == "default")
+		return kDefaultArithmetic;
+	else if (name == "sloppy")
+		return kSloppyArithmetic;
+	else if (name == "accurate")
+		return kAccurateArithmetic;
+	throw std::runtime_error("The arithmetic should be 'default', 'sloppy' or 'accurate'.");
+}
@@ -0,0 +1,110 @@
+// Per-call latency and throughput of the CMatrix mex commands (ddouble, tdouble or qdouble) without MATLAB.
+// Build from the CMatrix folder, with ddouble replaced by tdouble or qdouble for the other versions:
+//
+//   QD="qd/util.cc qd/bits.cc qd/dd_real.cc qd/qd_real.cc qd/td_real.cc qd/fpu.cc"
+//   g++ -std=c++17 -O3 -march=native -pthread -Ibenchmark -I. -I../utils -I<eigen> benchmark/benchmarkCMatrix.cpp include/ddouble.cpp $QD -o benchmarkDdouble
+//   ./benchmarkDdouble [--min-time sec] [--min-calls n] [--sizes n1,n2,...] [--filter command]
+//
+// -Ibenchmark picks up the mex.h stub, and renames the main of the mex file
+// so that it links with this driver, which undefines the macro for its own main.
+#include "benchmarkUtils.h"
+
+using namespace Benchmark;
+
+namespace
+{
+	Options opts;
+	std::string typeName;
+
+	// convert a double array to the CMatrix type
+	mxArray* toMex(Arrays& arrays, mxArray* x)
+	{
+		arrays.add(x);
+		return arrays.add(callOutput({ str("toMex"), x }));
+	}
+
+	void bench(const std::string& command, const char* operands, size_t n, const std::vector<const mxArray*>& args, int nlhs = 1)
+	{
+		Arrays cmd;
+		std::vector<const mxArray*> all{ cmd.add(str(command.c_str())) };
+		all.insert(all.end(), args.begin(), args.end());
+		run(opts, "CMatrix", command, operands, typeName, n, nlhs, all);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		opts = parseOptions(argc, argv, { 1, 32, 256 });
+
+		{
+			Arrays arrays;
+			mxArray* one = toMex(arrays, scalar(1.0));
+			size_t bytes = mxGetM(one);
+			typeName = bytes == 16 ? "dd_real" : bytes == 24 ? "td_real" : bytes == 32 ? "qd_real" : std::to_string(bytes) + "byte";
+		}
+
+		printHeader();
+		for (size_t n : opts.sizes)
+		{
+			Arrays arrays;
+			mxArray* Xd = arrays.add(dense<double>(n, n, uniform(-1.0, 1.0, 1)));
+			mxArray* Sd = arrays.add(sparse<double>(n, n, randomColumns(n, 4, 0.0, 2)));
+			const mxArray* X = toMex(arrays, dense<double>(n, n, uniform(-1.0, 1.0, 1)));
+			const mxArray* Y = toMex(arrays, dense<double>(n, n, uniform(0.5, 2.0, 3)));
+			const mxArray* v = toMex(arrays, dense<double>(n, 1, uniform(-1.0, 1.0, 4)));
+			const mxArray* r = toMex(arrays, dense<double>(1, n, uniform(-1.0, 1.0, 5)));
+			const mxArray* c = toMex(arrays, scalar(1.0));
+			const mxArray* S = toMex(arrays, sparse<double>(n, n, randomColumns(n, 4, 0.0, 2)));
+			const mxArray* T = toMex(arrays, sparse<double>(n, n, randomColumns(n, 4, 0.0, 6)));
+
+			bench("toMex", "dense", n, { Xd });
+			bench("toMex", "sparse", n, { Sd });
+
+			for (const char* op : { "abs", "uminus", "logical", "double" })
+			{
+				bench(op, "dense", n, { X });
+				bench(op, "sparse", n, { S });
+			}
+			bench("sqrt", "dense", n, { Y });
+			bench("exp", "dense", n, { X });
+			bench("log", "dense", n, { Y });
+
+			for (const char* op : { "plus", "times", "rdivide", "lt", "max2" })
+			{
+				bench(op, "dense-dense", n, { X, Y });
+				bench(op, "dense-column", n, { X, v });
+				bench(op, "sparse-sparse", n, { S, T });
+				bench(op, "sparse-dense", n, { S, Y });
+				bench(op, "sparse-row", n, { S, r });
+			}
+			bench("rdivide", "dense-dense", n, { X, Y });
+			bench("rdivide", "sparse-dense", n, { S, Y });
+			bench("rdivide", "scalar-dense", n, { c, Y });
+
+			for (const char* op : { "sum", "max" })
+			{
+				bench(op, "dense", n, { X });
+				bench(op, "sparse", n, { S });
+			}
+
+			bench("transpose", "dense", n, { X });
+			bench("transpose", "sparse", n, { S });
+
+			bench("mtimes", "dense-dense", n, { X, Y });
+			bench("mtimes", "dense-column", n, { X, v });
+			bench("mtimes", "sparse-dense", n, { S, Y });
+			bench("mtimes", "dense-sparse", n, { X, S });
+			bench("mtimes", "sparse-sparse", n, { S, T });
+
+			bench("eps", "none", n, {});
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
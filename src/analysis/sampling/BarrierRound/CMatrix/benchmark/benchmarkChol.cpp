@@ -0,0 +1,89 @@
+// Per-call latency and throughput of the AdaptiveChol mex commands in each precision without MATLAB.
+// Build from the CMatrix folder:
+//
+//   QD="qd/util.cc qd/bits.cc qd/dd_real.cc qd/qd_real.cc qd/td_real.cc qd/fpu.cc"
+//   g++ -std=c++17 -O3 -march=native -pthread -Ibenchmark -I. -I../utils -I<eigen> benchmark/benchmarkChol.cpp cholMex.cpp $QD -lrt -o benchmarkChol
+//   ./benchmarkChol [--min-time sec] [--min-calls n] [--sizes n1,n2,...] [--filter command]
+//
+// The size is the number of rows of A, which has twice as many columns. The factorization is
+// of A W A' with a random positive diagonal W.
+#include <qd/dd_real.h>
+#include <qd/qd_real.h>
+#include <qd/td_real.h>
+#include "benchmarkUtils.h"
+
+using namespace Benchmark;
+
+namespace
+{
+	Options opts;
+
+	template<typename T>
+	void benchType(const char* typeName, uint64_t uid, size_t m, const char* precisionTag = nullptr)
+	{
+		// the float tier takes double inputs
+		using TIn = typename std::conditional<std::is_same<T, float>::value, double, T>::type;
+
+		Arrays arrays;
+		size_t n = 2 * m;
+		auto W = arrays.add(sparse<TIn>(n, n, [](size_t j) {
+			return std::vector<std::pair<size_t, double>>{ { j, 0.5 + (j % 7) / 4.0 } };
+		}));
+		auto b = arrays.add(dense<TIn>(m, 1, uniform(-1.0, 1.0, 3)));
+		auto id = arrays.add(handle(uid));
+		auto offset = arrays.add(scalar(0.0));
+
+		auto bench = [&](const char* command, const char* operands, int nlhs, std::vector<const mxArray*> args) {
+			Arrays cmd;
+			args.insert(args.begin(), { cmd.add(str(command)), id });
+			run(opts, "AdaptiveChol", command, operands, typeName, m, nlhs, args);
+		};
+
+		std::vector<const mxArray*> factorizeArgs{ W, offset };
+		if (precisionTag)
+			factorizeArgs.push_back(arrays.add(str(precisionTag)));
+		bench("factorize", "sparse", 1, factorizeArgs);
+
+		bench("solve", "steps=1", 1, { b, W, arrays.add(scalar(1)) });
+		bench("solve", "steps=3", 1, { b, W, arrays.add(scalar(3)) });
+		bench("diagonal", "none", 1, {});
+		bench("halfProj", "JLDim=8", 1, { arrays.add(scalar(8)) });
+		bench("halfProj", "JLDim=8 sketch=double", 1, { arrays.add(scalar(8)), arrays.add(str("double")) });
+		bench("halfProj", "JLDim=8 sketch=single", 1, { arrays.add(scalar(8)), arrays.add(str("single")) });
+		bench("residual", "none", 1, {});
+		bench("serialize", "none", 1, {});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		opts = parseOptions(argc, argv, { 100, 1000 });
+
+		printHeader();
+		for (size_t m : opts.sizes)
+		{
+			Arrays arrays;
+			auto A = arrays.add(sparse<double>(m, 2 * m, randomColumns(m, 3, 1.0, 1)));
+
+			mxArray* pt = callOutput({ arrays.add(str("new")), arrays.add(handle(1)), A });
+			uint64_t uid = *(uint64_t*)mxGetData(pt);
+			mxDestroyArray(pt);
+
+			benchType<float>("single", uid, m, "single");
+			benchType<double>("double", uid, m);
+			benchType<dd_real>("dd_real", uid, m);
+			benchType<td_real>("td_real", uid, m);
+			benchType<qd_real>("qd_real", uid, m);
+
+			call(0, { arrays.add(str("delete")), arrays.add(handle(uid)) });
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
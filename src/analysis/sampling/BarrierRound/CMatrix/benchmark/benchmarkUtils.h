@@ -0,0 +1,250 @@
+#pragma once
+// Timing loop, argument parsing and input generators shared by the mex benchmarks.
+// Results are printed as CSV on stdout, one row per (command, operands, type, size):
+//   tool,command,operands,type,size,calls,mean_ns,min_ns,calls_per_sec
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "mex.h"
+
+void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[]);
+
+namespace Benchmark
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct Options
+	{
+		double minTime = 0.2;       // seconds spent on each row
+		size_t minCalls = 3;
+		std::vector<size_t> sizes;
+		std::string filter;         // only run commands containing this string
+	};
+
+	// --min-time <sec> --min-calls <n> --sizes <n1,n2,...> --filter <command>
+	inline Options parseOptions(int argc, char** argv, std::vector<size_t> defaultSizes)
+	{
+		Options opts;
+		opts.sizes = defaultSizes;
+		for (int k = 1; k < argc; ++k)
+		{
+			std::string arg = argv[k];
+			bool hasValue = k + 1 < argc;
+			if (arg == "--min-time" && hasValue)
+				opts.minTime = std::stod(argv[++k]);
+			else if (arg == "--min-calls" && hasValue)
+				opts.minCalls = std::stoul(argv[++k]);
+			else if (arg == "--sizes" && hasValue)
+			{
+				opts.sizes.clear();
+				std::string list = argv[++k];
+				for (size_t pos = 0; pos < list.size();)
+				{
+					size_t next = list.find(',', pos);
+					if (next == std::string::npos) next = list.size();
+					opts.sizes.push_back(std::stoul(list.substr(pos, next - pos)));
+					pos = next + 1;
+				}
+			}
+			else if (arg == "--filter" && hasValue)
+				opts.filter = argv[++k];
+			else
+				throw std::runtime_error("Usage: " + std::string(argv[0]) +
+					" [--min-time sec] [--min-calls n] [--sizes n1,n2,...] [--filter command]");
+		}
+		return opts;
+	}
+
+	inline void printHeader()
+	{
+		std::printf("tool,command,operands,type,size,calls,mean_ns,min_ns,calls_per_sec\n");
+	}
+
+	// Calls the mex function and destroys its outputs
+	inline void call(int nlhs, const std::vector<const mxArray*>& args)
+	{
+		std::vector<mxArray*> out(std::max(nlhs, 1), nullptr);
+		mexFunction(nlhs, out.data(), (int)args.size(), (const mxArray**)args.data());
+		for (auto pt : out)
+			mxDestroyArray(pt);
+	}
+
+	// Calls the mex function and returns its first output
+	inline mxArray* callOutput(const std::vector<const mxArray*>& args)
+	{
+		mxArray* out = nullptr;
+		mexFunction(1, &out, (int)args.size(), (const mxArray**)args.data());
+		return out;
+	}
+
+	// Times individual calls of the mex function (after one warm up call) until both
+	// opts.minTime and opts.minCalls are reached, and prints a CSV row
+	inline void run(const Options& opts, const char* tool, const std::string& command, const char* operands,
+		const std::string& type, size_t size, int nlhs, const std::vector<const mxArray*>& args)
+	{
+		if (!opts.filter.empty() && command.find(opts.filter) == std::string::npos)
+			return;
+
+		call(nlhs, args);
+
+		size_t calls = 0;
+		double total = 0.0, best = 1e300;
+		while (total < opts.minTime || calls < opts.minCalls)
+		{
+			std::vector<mxArray*> out(std::max(nlhs, 1), nullptr);
+			auto start = Clock::now();
+			mexFunction(nlhs, out.data(), (int)args.size(), (const mxArray**)args.data());
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			for (auto pt : out)
+				mxDestroyArray(pt);
+
+			total += seconds;
+			best = std::min(best, seconds);
+			++calls;
+		}
+
+		std::printf("%s,%s,%s,%s,%zu,%zu,%.0f,%.0f,%.6g\n", tool, command.c_str(), operands, type.c_str(), size,
+			calls, 1e9 * total / calls, 1e9 * best, calls / total);
+		std::fflush(stdout);
+	}
+
+	/* ====== Inputs ====== */
+	// Owns the mxArrays of a benchmark case
+	struct Arrays
+	{
+		std::vector<mxArray*> arrays;
+
+		mxArray* add(mxArray* pt)
+		{
+			arrays.push_back(pt);
+			return pt;
+		}
+
+		~Arrays()
+		{
+			for (auto pt : arrays)
+				mxDestroyArray(pt);
+		}
+	};
+
+	inline mxArray* str(const char* str)
+	{
+		return mxCreateString(str);
+	}
+
+	inline mxArray* scalar(double value)
+	{
+		return mxCreateDoubleScalar(value);
+	}
+
+	inline mxArray* handle(uint64_t value)
+	{
+		mxArray* pt = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+		*(uint64_t*)mxGetData(pt) = value;
+		return pt;
+	}
+
+	// Dense m x n array in the mex representation of T: a native double array, or
+	// a uint8 array of size sizeof(T) x m x n
+	template<typename T>
+	mxArray* dense(size_t m, size_t n, const std::function<double(size_t, size_t)>& f)
+	{
+		mxArray* pt;
+		if (std::is_same<T, double>::value)
+			pt = mxCreateDoubleMatrix(m, n, mxREAL);
+		else
+		{
+			mwSize dims[3] = { sizeof(T), m, n };
+			pt = mxCreateNumericArray(3, dims, mxUINT8_CLASS, mxREAL);
+		}
+
+		T* x = (T*)mxGetData(pt);
+		for (size_t j = 0; j < n; ++j)
+			for (size_t i = 0; i < m; ++i)
+				x[i + j * m] = T(f(i, j));
+		return pt;
+	}
+
+	// Sparse m x n array in the mex representation of T: a native sparse double array, or
+	// a cell of the sparsity pattern and a sizeof(T) x nnz uint8 array of values.
+	// Column j holds the rows and values given by f(j).
+	template<typename T>
+	mxArray* sparse(size_t m, size_t n, const std::function<std::vector<std::pair<size_t, double>>(size_t)>& f)
+	{
+		std::vector<std::vector<std::pair<size_t, double>>> columns(n);
+		size_t nnz = 0;
+		for (size_t j = 0; j < n; ++j)
+		{
+			columns[j] = f(j);
+			std::sort(columns[j].begin(), columns[j].end());
+			columns[j].erase(std::unique(columns[j].begin(), columns[j].end(),
+				[](const auto& a, const auto& b) { return a.first == b.first; }), columns[j].end());
+			nnz += columns[j].size();
+		}
+
+		mxArray* pt, * pt_S, * pt_x;
+		if (std::is_same<T, double>::value)
+		{
+			pt = mxCreateSparse(m, n, nnz, mxREAL);
+			pt_S = pt_x = pt;
+		}
+		else
+		{
+			pt = mxCreateCellMatrix(2, 1);
+			pt_S = mxCreateSparseLogicalMatrix(m, n, nnz);
+			pt_x = mxCreateNumericMatrix(sizeof(T), nnz, mxUINT8_CLASS, mxREAL);
+			mxSetCell(pt, 0, pt_S);
+			mxSetCell(pt, 1, pt_x);
+		}
+
+		mwIndex* ir = mxGetIr(pt_S), * jc = mxGetJc(pt_S);
+		T* x = (T*)mxGetData(pt_x);
+		size_t s = 0;
+		for (size_t j = 0; j < n; ++j)
+		{
+			jc[j] = s;
+			for (auto& entry : columns[j])
+			{
+				ir[s] = entry.first;
+				if (pt_S != pt_x) ((bool*)mxGetData(pt_S))[s] = true;
+				x[s++] = T(entry.second);
+			}
+		}
+		jc[n] = s;
+		return pt;
+	}
+
+	// Uniform random entries in [lo, hi), reproducible across runs
+	inline std::function<double(size_t, size_t)> uniform(double lo, double hi, unsigned seed = 1)
+	{
+		auto rng = std::make_shared<std::mt19937>(seed);
+		return [rng, lo, hi](size_t, size_t) { return std::uniform_real_distribution<double>(lo, hi)(*rng); };
+	}
+
+	// Columns with nnzPerCol random rows and values in [-1, 1), plus the diagonal
+	// (when it exists) set to diag
+	inline std::function<std::vector<std::pair<size_t, double>>(size_t)> randomColumns(size_t m, size_t nnzPerCol,
+		double diag = 0.0, unsigned seed = 1)
+	{
+		auto rng = std::make_shared<std::mt19937>(seed);
+		return [rng, m, nnzPerCol, diag](size_t j) {
+			std::uniform_int_distribution<size_t> row(0, m - 1);
+			std::uniform_real_distribution<double> value(-1.0, 1.0);
+			std::vector<std::pair<size_t, double>> col;
+			if (diag != 0.0 && j < m)
+				col.push_back({ j, diag });
+			for (size_t k = 0; k < nnzPerCol; ++k)
+			{
+				size_t i = row(*rng);
+				if (diag == 0.0 || i != j)
+					col.push_back({ i, value(*rng) });
+			}
+			return col;
+		};
+	}
+}
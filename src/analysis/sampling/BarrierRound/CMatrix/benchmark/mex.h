@@ -0,0 +1,225 @@
+#pragma once
+// Stand-in for MATLAB's mex.h so that the mex sources can be compiled and benchmarked
+// without MATLAB. Only the part of the API used by CMatrix and AdaptiveChol is provided.
+// Numeric data is 32 byte aligned (as MATLAB does), and mexErrMsgTxt throws MexError.
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef size_t mwSize;
+typedef size_t mwIndex;
+
+enum mxClassID
+{
+	mxUNKNOWN_CLASS, mxCELL_CLASS, mxSTRUCT_CLASS, mxLOGICAL_CLASS, mxCHAR_CLASS, mxVOID_CLASS,
+	mxDOUBLE_CLASS, mxSINGLE_CLASS, mxINT8_CLASS, mxUINT8_CLASS, mxINT16_CLASS, mxUINT16_CLASS,
+	mxINT32_CLASS, mxUINT32_CLASS, mxINT64_CLASS, mxUINT64_CLASS
+};
+
+enum mxComplexity { mxREAL, mxCOMPLEX };
+
+struct mxArray
+{
+	mxClassID classID = mxUNKNOWN_CLASS;
+	std::vector<mwSize> dims;
+	bool sparse = false;
+	void* data = nullptr;
+	mwIndex* ir = nullptr;
+	mwIndex* jc = nullptr;
+	mwSize nzmax = 0;
+	std::vector<mxArray*> cells; // cell elements, or struct fields (element-major)
+	std::vector<std::string> fields;
+};
+
+struct MexError : std::runtime_error
+{
+	using std::runtime_error::runtime_error;
+};
+
+namespace MexStub
+{
+	inline size_t elementSize(mxClassID id)
+	{
+		switch (id)
+		{
+		case mxLOGICAL_CLASS: case mxINT8_CLASS: case mxUINT8_CLASS: return 1;
+		case mxCHAR_CLASS: case mxINT16_CLASS: case mxUINT16_CLASS: return 2;
+		case mxSINGLE_CLASS: case mxINT32_CLASS: case mxUINT32_CLASS: return 4;
+		default: return 8;
+		}
+	}
+
+	inline void* alignedCalloc(size_t bytes)
+	{
+		size_t size = (bytes / 32 + 1) * 32;
+		void* ptr = std::aligned_alloc(32, size);
+		if (!ptr) throw MexError("Out of memory.");
+		std::memset(ptr, 0, size);
+		return ptr;
+	}
+
+	inline mxArray* newArray(mxClassID id, mwSize m, mwSize n)
+	{
+		mxArray* pt = new mxArray;
+		pt->classID = id;
+		pt->dims = { m, n };
+		return pt;
+	}
+}
+
+inline mxArray* mxCreateNumericArray(mwSize ndim, const mwSize* dims, mxClassID id, mxComplexity)
+{
+	mxArray* pt = new mxArray;
+	pt->classID = id;
+	pt->dims.assign(dims, dims + ndim);
+	while (pt->dims.size() < 2) pt->dims.push_back(1);
+	while (pt->dims.size() > 2 && pt->dims.back() == 1) pt->dims.pop_back();
+
+	size_t numel = 1;
+	for (auto d : pt->dims) numel *= d;
+	pt->data = MexStub::alignedCalloc(numel * MexStub::elementSize(id));
+	return pt;
+}
+
+inline mxArray* mxCreateNumericMatrix(mwSize m, mwSize n, mxClassID id, mxComplexity flag)
+{
+	mwSize dims[2] = { m, n };
+	return mxCreateNumericArray(2, dims, id, flag);
+}
+
+inline mxArray* mxCreateDoubleMatrix(mwSize m, mwSize n, mxComplexity flag)
+{
+	return mxCreateNumericMatrix(m, n, mxDOUBLE_CLASS, flag);
+}
+
+inline mxArray* mxCreateDoubleScalar(double value)
+{
+	mxArray* pt = mxCreateDoubleMatrix(1, 1, mxREAL);
+	*(double*)pt->data = value;
+	return pt;
+}
+
+inline mxArray* mxCreateSparseOfClass(mwSize m, mwSize n, mwSize nzmax, mxClassID id)
+{
+	mxArray* pt = MexStub::newArray(id, m, n);
+	pt->sparse = true;
+	pt->nzmax = nzmax ? nzmax : 1;
+	pt->data = MexStub::alignedCalloc(pt->nzmax * MexStub::elementSize(id));
+	pt->ir = (mwIndex*)MexStub::alignedCalloc(pt->nzmax * sizeof(mwIndex));
+	pt->jc = (mwIndex*)MexStub::alignedCalloc((n + 1) * sizeof(mwIndex));
+	return pt;
+}
+
+inline mxArray* mxCreateSparse(mwSize m, mwSize n, mwSize nzmax, mxComplexity)
+{
+	return mxCreateSparseOfClass(m, n, nzmax, mxDOUBLE_CLASS);
+}
+
+inline mxArray* mxCreateSparseLogicalMatrix(mwSize m, mwSize n, mwSize nzmax)
+{
+	return mxCreateSparseOfClass(m, n, nzmax, mxLOGICAL_CLASS);
+}
+
+inline mxArray* mxCreateCellMatrix(mwSize m, mwSize n)
+{
+	mxArray* pt = MexStub::newArray(mxCELL_CLASS, m, n);
+	pt->cells.assign(m * n, nullptr);
+	return pt;
+}
+
+inline mxArray* mxCreateStructMatrix(mwSize m, mwSize n, int nfields, const char** fieldnames)
+{
+	mxArray* pt = MexStub::newArray(mxSTRUCT_CLASS, m, n);
+	pt->fields.assign(fieldnames, fieldnames + nfields);
+	pt->cells.assign(m * n * nfields, nullptr);
+	return pt;
+}
+
+inline mxArray* mxCreateString(const char* str)
+{
+	size_t len = std::strlen(str);
+	mxArray* pt = mxCreateNumericMatrix(1, len, mxCHAR_CLASS, mxREAL);
+	for (size_t i = 0; i < len; ++i)
+		((char16_t*)pt->data)[i] = (unsigned char)str[i];
+	return pt;
+}
+
+inline void mxDestroyArray(mxArray* pt)
+{
+	if (!pt) return;
+	for (auto child : pt->cells)
+		mxDestroyArray(child);
+	std::free(pt->data);
+	std::free(pt->ir);
+	std::free(pt->jc);
+	delete pt;
+}
+
+inline mwSize mxGetNumberOfDimensions(const mxArray* pt) { return pt->dims.size(); }
+inline const mwSize* mxGetDimensions(const mxArray* pt) { return pt->dims.data(); }
+inline size_t mxGetM(const mxArray* pt) { return pt->dims[0]; }
+inline size_t mxGetN(const mxArray* pt)
+{
+	size_t n = 1;
+	for (size_t k = 1; k < pt->dims.size(); ++k) n *= pt->dims[k];
+	return n;
+}
+inline size_t mxGetNumberOfElements(const mxArray* pt) { return mxGetM(pt) * mxGetN(pt); }
+inline mxClassID mxGetClassID(const mxArray* pt) { return pt->classID; }
+inline bool mxIsComplex(const mxArray*) { return false; }
+inline bool mxIsSparse(const mxArray* pt) { return pt->sparse; }
+inline bool mxIsCell(const mxArray* pt) { return pt->classID == mxCELL_CLASS; }
+inline bool mxIsChar(const mxArray* pt) { return pt->classID == mxCHAR_CLASS; }
+inline void* mxGetData(const mxArray* pt) { return pt->data; }
+inline double* mxGetPr(const mxArray* pt) { return (double*)pt->data; }
+inline mwIndex* mxGetIr(const mxArray* pt) { return pt->ir; }
+inline mwIndex* mxGetJc(const mxArray* pt) { return pt->jc; }
+inline mwSize mxGetNzmax(const mxArray* pt) { return pt->nzmax; }
+inline mxArray* mxGetCell(const mxArray* pt, mwIndex i) { return pt->cells[i]; }
+inline void mxSetCell(mxArray* pt, mwIndex i, mxArray* value) { pt->cells[i] = value; }
+
+inline void mxSetField(mxArray* pt, mwIndex i, const char* fieldname, mxArray* value)
+{
+	for (size_t k = 0; k < pt->fields.size(); ++k)
+		if (pt->fields[k] == fieldname)
+		{
+			pt->cells[i * pt->fields.size() + k] = value;
+			return;
+		}
+	throw MexError(std::string("mxSetField: unknown field ") + fieldname);
+}
+
+inline mxArray* mxGetField(const mxArray* pt, mwIndex i, const char* fieldname)
+{
+	for (size_t k = 0; k < pt->fields.size(); ++k)
+		if (pt->fields[k] == fieldname)
+			return pt->cells[i * pt->fields.size() + k];
+	return nullptr;
+}
+
+inline void* mxMalloc(size_t n) { return std::malloc(n); }
+inline void mxFree(void* ptr) { std::free(ptr); }
+
+inline char* mxArrayToString(const mxArray* pt)
+{
+	size_t len = mxGetNumberOfElements(pt);
+	char* str = (char*)mxMalloc(len + 1);
+	for (size_t i = 0; i < len; ++i)
+		str[i] = (char)((char16_t*)pt->data)[i];
+	str[len] = 0;
+	return str;
+}
+
+[[noreturn]] inline void mexErrMsgTxt(const char* msg)
+{
+	throw MexError(msg);
+}
+
+inline int mexAtExit(void (*exitFcn)())
+{
+	return std::atexit(exitFcn);
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Append-only byte buffer for binary blobs.
+// Arrays are padded to 32 bytes so that a mapped blob can be used in place.
+struct ByteWriter
+{
+	std::vector<uint8_t> bytes;
+
+	template<typename T>
+	void write(const T& value)
+	{
+		write(&value, 1);
+	}
+
+	template<typename T>
+	void write(const T* values, size_t n)
+	{
+		size_t pos = bytes.size();
+		bytes.resize(pos + n * sizeof(T));
+		if (n > 0)
+			std::memcpy(bytes.data() + pos, values, n * sizeof(T));
+	}
+
+	void align(size_t alignment = 32)
+	{
+		bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+	}
+
+	void writeFile(const std::string& filename) const
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if (!file)
+			throw std::runtime_error("Cannot open " + filename + " for writing.");
+		file.write((const char*)bytes.data(), bytes.size());
+		if (!file)
+			throw std::runtime_error("Cannot write to " + filename + ".");
+	}
+};
+
+// Sequential reader over a blob written by ByteWriter
+struct ByteReader
+{
+	const uint8_t* data;
+	size_t size;
+	size_t pos = 0;
+
+	ByteReader(const uint8_t* data_, size_t size_) : data(data_), size(size_) {}
+
+	// pointer to the next n values without copying them
+	template<typename T>
+	const T* view(size_t n)
+	{
+		if (n > (size - pos) / sizeof(T))
+			throw std::runtime_error("Binary blob is truncated.");
+		const T* out = (const T*)(data + pos);
+		pos += n * sizeof(T);
+		return out;
+	}
+
+	template<typename T>
+	T read()
+	{
+		T value;
+		read(&value, 1);
+		return value;
+	}
+
+	template<typename T>
+	void read(T* values, size_t n)
+	{
+		const T* src = view<T>(n);
+		if (n > 0)
+			std::memcpy(values, src, n * sizeof(T));
+	}
+
+	void align(size_t alignment = 32)
+	{
+		size_t next = (pos + alignment - 1) / alignment * alignment;
+		if (next > size)
+			throw std::runtime_error("Binary blob is truncated.");
+		pos = next;
+	}
+};
+
+// Read-only memory map of a whole file (a plain read on Windows)
+struct MappedFile
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+	explicit MappedFile(const std::string& filename)
+	{
+#if defined(_WIN32)
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+			throw std::runtime_error("Cannot open " + filename + ".");
+		buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		data = buffer.data();
+		size = buffer.size();
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("Cannot open " + filename + ".");
+
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			throw std::runtime_error("Cannot stat " + filename + ".");
+		}
+		size = (size_t)st.st_size;
+
+		if (size > 0)
+		{
+			void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			if (ptr == MAP_FAILED)
+			{
+				close(fd);
+				throw std::runtime_error("Cannot map " + filename + ".");
+			}
+			data = (const uint8_t*)ptr;
+		}
+		close(fd);
+#endif
+	}
+
+	~MappedFile()
+	{
+#if !defined(_WIN32)
+		if (data)
+			munmap((void*)data, size);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+#if defined(_WIN32)
+private:
+	std::vector<uint8_t> buffer;
+#endif
+};
+
+// Bytes used in place, e.g. a MappedFile or a SharedMemory segment, which stay mapped
+// as long as this object lives
+struct MappedBytes
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+	template<typename Mapping>
+	explicit MappedBytes(std::unique_ptr<Mapping> mapping)
+		: data(mapping->data), size(mapping->size), owner(std::move(mapping))
+	{
+	}
+
+private:
+	std::shared_ptr<void> owner;
+};
+
+// FNV-1a hash of a byte range, chained through seed
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	uint64_t h = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// A blob published in a named POSIX shared memory segment (e.g. /dev/shm on Linux).
+// The segment starts with a Header whose ready flag is set only after the blob is
+// complete, so a reader never sees a partially written blob. Segments stay alive
+// until unlink is called, even after every process has detached.
+struct SharedMemory
+{
+	struct Header
+	{
+		static const uint64_t kMagic = 0x4d48534c42524443; // "CDRBLSHM"
+		uint64_t magic;
+		std::atomic<uint64_t> ready;
+		uint64_t size;
+		uint8_t reserved[40];
+	};
+	static_assert(sizeof(Header) == 64, "the blob must start 64-byte aligned");
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+	// attach to a published blob read-only, or return nullptr if there is none (yet)
+	static std::unique_ptr<SharedMemory> open(const std::string& name)
+	{
+#if defined(_WIN32)
+		throw std::runtime_error("Shared memory is only supported on POSIX systems.");
+#else
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0)
+			return nullptr;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header))
+		{
+			close(fd);
+			return nullptr;
+		}
+
+		size_t mappedSize = (size_t)st.st_size;
+		void* ptr = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (ptr == MAP_FAILED)
+			return nullptr;
+
+		const Header* header = (const Header*)ptr;
+		if (header->magic != Header::kMagic || header->ready.load(std::memory_order_acquire) != 1 ||
+			header->size > mappedSize - sizeof(Header))
+		{
+			munmap(ptr, mappedSize);
+			return nullptr;
+		}
+
+		std::unique_ptr<SharedMemory> shm(new SharedMemory);
+		shm->base = ptr;
+		shm->mappedSize = mappedSize;
+		shm->data = (const uint8_t*)ptr + sizeof(Header);
+		shm->size = header->size;
+		return shm;
+#endif
+	}
+
+	// copy the blob into a new segment; returns false if the segment already exists
+	static bool publish(const std::string& name, const ByteWriter& blob)
+	{
+#if defined(_WIN32)
+		throw std::runtime_error("Shared memory is only supported on POSIX systems.");
+#else
+		int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0)
+		{
+			if (errno == EEXIST)
+				return false;
+			throw std::runtime_error("Cannot create shared memory " + name + ".");
+		}
+
+		size_t mappedSize = sizeof(Header) + blob.bytes.size();
+		void* ptr = MAP_FAILED;
+		if (ftruncate(fd, (off_t)mappedSize) == 0)
+			ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (ptr == MAP_FAILED)
+		{
+			shm_unlink(name.c_str());
+			throw std::runtime_error("Cannot allocate shared memory " + name + ".");
+		}
+
+		Header* header = new (ptr) Header;
+		header->magic = Header::kMagic;
+		header->size = blob.bytes.size();
+		std::memcpy((uint8_t*)ptr + sizeof(Header), blob.bytes.data(), blob.bytes.size());
+		header->ready.store(1, std::memory_order_release);
+		munmap(ptr, mappedSize);
+		return true;
+#endif
+	}
+
+	// remove the name; processes already attached keep their mapping
+	static void unlink(const std::string& name)
+	{
+#if !defined(_WIN32)
+		shm_unlink(name.c_str());
+#endif
+	}
+
+	~SharedMemory()
+	{
+#if !defined(_WIN32)
+		if (base)
+			munmap(base, mappedSize);
+#endif
+	}
+
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+
+private:
+	SharedMemory() = default;
+	void* base = nullptr;
+	size_t mappedSize = 0;
+};
@@ -1,58 +1,144 @@
 #pragma once
-#include "CMatrixUtils.h"
+#include "CMatrixCore.h"
+#include "parallel.h"
+#include "scratchAllocator.h"
 
 enum EntryType { kSetSet, kNullSet, kSetNull, kNullNull };
 
+template <typename T>
+std::tuple<T, T> computeBinaryOperatorOuputSize(T Am, T An, T Bm, T Bn)
+{
+	T m = Am, n = An;
+	if (Bm != 1) m = Bm;
+	if (Bn != 1) n = Bn;
+	if ((Am != 1 && Am != m) || (Bm != 1 && Bm != m) ||
+		(An != 1 && An != n) || (Bn != 1 && Bn != n))
+		throw std::invalid_argument("Incompatiable input sizes: "
+			"" + std::to_string(Am) + " x " + std::to_string(An) + " and "
+			"" + std::to_string(Bm) + " x " + std::to_string(Bn) + ".");
+	return { m, n };
+}
+
+
+// Column j of a sparse operand broadcast to m rows with stride 0 instead of being expanded:
+// a single column is reused for every j, and the entry of a single row fills all m rows.
+template <typename Tx>
+struct BroadcastColumn
+{
+	using Ti = typename SparseMap<Tx>::StorageIndex;
+
+	const Ti* rows;
+	const Tx* values;
+	Ti p, end, i, m;
+	bool full;
+
+	BroadcastColumn(const SparseMap<Tx>& X, Ti m_, Ti j)
+		: rows(X.innerIndexPtr()), values(X.valuePtr()), i(0), m(m_)
+	{
+		Ti jX = (X.cols() == 1) ? 0 : j;
+		p = X.outerIndexPtr()[jX];
+		end = X.outerIndexPtr()[jX + 1];
+		full = (X.rows() == 1 && m != 1);
+		if (full && p == end)
+			i = m;
+	}
+
+	// number of entries left in the column
+	Ti size() const { return full ? m - i : end - p; }
+	Ti row() const { return full ? i : ((p < end) ? rows[p] : m); }
+	Tx value() const { return values[p]; }
+	void next() { if (full) ++i; else ++p; }
+};
+
 // Assume f(0, 0) = 0
-template <typename O, typename Tx = CType>
-SparseMatrix<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
+// A and B may be rows, columns or scalars that broadcast against each other.
+// The result lives in the scratch arena until the end of the mex call
+template <typename O, typename Tx>
+SparseMap<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
 binaryOperator(SparseMap<Tx> A, SparseMap<Tx> B)
 {
 	assertThrow(isZero(O::f(1, 1, Tx(0.0), Tx(0.0), kNullNull)), "binaryOperator(Sparse,Sparse): f(0,0) must be 0");
 
-	auto m = A.rows(), n = A.cols(), Bm = B.rows(), Bn = B.cols();
-	auto Annz = A.nonZeros(), Bnnz = B.nonZeros();
-
-	auto Ai = A.innerIndexPtr(), Bi = B.innerIndexPtr();
-	auto Aj = A.outerIndexPtr(), Bj = B.outerIndexPtr();
-	auto Ax = A.valuePtr(), Bx = B.valuePtr();
-
-	assertThrow(m == Bm && n == Bn, "binaryOperator(Sparse,Sparse): mismatch dimensions");
 	using OutputType = decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet));
 	using Ti = typename SparseMap<Tx>::StorageIndex;
+	auto [m, n] = computeBinaryOperatorOuputSize<Ti>(A.rows(), A.cols(), B.rows(), B.cols());
+
+	// f(x, 0) = 0 or f(0, x) = 0 for all x, e.g. times and and, as for the dense-sparse and sparse-dense
+	// kernels: a row or scalar broadcast down the column only meets the entries of the other operand,
+	// instead of giving m entries per column with zeros
+	Tx Tzero = Tx(0.0);
+	const bool zeroA = O::DenseSparseToSparse, zeroB = O::SparseDenseToSparse;
+
+	Ti maxNnz = 0;
+	for (Ti j = 0; j < n; ++j)
+	{
+		BroadcastColumn<Tx> a(A, m, j), b(B, m, j);
+		if (a.full && zeroA)
+			maxNnz += b.size();
+		else if (b.full && zeroB)
+			maxNnz += a.size();
+		else
+			maxNnz += a.size() + b.size();
+	}
 
-	auto Cx = new OutputType[Annz + Bnnz];
-	auto Cj = new Ti[n + 1];
-	auto Ci = new Ti[Annz + Bnnz];
+	auto Cx = scratchArray<OutputType>(maxNnz);
+	auto Cj = scratchArray<Ti>(n + 1);
+	auto Ci = scratchArray<Ti>(maxNnz);
 
 	// Compute C
-	Tx Tzero = Tx(0.0);
 	Ti nnz = 0;
-	for (int j = 0; j < n; ++j)
+	for (Ti j = 0; j < n; ++j)
 	{
 		Cj[j] = nnz;				/* column j of C starts here */
 
-		Ti p1 = Aj[j], p2 = Bj[j];
-		Ti end1 = Aj[j + 1], end2 = Bj[j + 1];
+		BroadcastColumn<Tx> a(A, m, j), b(B, m, j);
+		if (a.full && zeroA)
+		{
+			// the entry of A in column j, if any, read with stride 0 at the rows of B
+			bool set = a.size() > 0;
+			for (; b.row() < m && (set || !zeroB); b.next())
+			{
+				Ti i = b.row();
+				Cx[nnz] = set ? O::f(i, j, a.value(), b.value(), kSetSet) : O::f(i, j, Tzero, b.value(), kNullSet);
+				Ci[nnz++] = i;
+			}
+			continue;
+		}
+		if (b.full && zeroB)
+		{
+			bool set = b.size() > 0;
+			for (; a.row() < m && (set || !zeroA); a.next())
+			{
+				Ti i = a.row();
+				Cx[nnz] = set ? O::f(i, j, a.value(), b.value(), kSetSet) : O::f(i, j, a.value(), Tzero, kSetNull);
+				Ci[nnz++] = i;
+			}
+			continue;
+		}
+
 		while (true)
 		{
-			Ti i1 = (p1 < end1) ? Ai[p1] : m;
-			Ti i2 = (p2 < end2) ? Bi[p2] : m;
+			Ti i1 = a.row();
+			Ti i2 = b.row();
 
 			if (i1 < i2)
 			{
-				Cx[nnz] = O::f(i1, j, Ax[p1++], Tzero, kSetNull);
+				Cx[nnz] = O::f(i1, j, a.value(), Tzero, kSetNull);
 				Ci[nnz++] = i1;
+				a.next();
 			}
 			else if (i2 < i1)
 			{
-				Cx[nnz] = O::f(i2, j, Tzero, Bx[p2++], kNullSet);
+				Cx[nnz] = O::f(i2, j, Tzero, b.value(), kNullSet);
 				Ci[nnz++] = i2;
+				b.next();
 			}
 			else if (i1 < m)
 			{
-				Cx[nnz] = O::f(i1, j, Ax[p1++], Bx[p2++], kSetSet);
+				Cx[nnz] = O::f(i1, j, a.value(), b.value(), kSetSet);
 				Ci[nnz++] = i1;
+				a.next();
+				b.next();
 			}
 			else
 				break;
@@ -60,106 +146,163 @@ binaryOperator(SparseMap<Tx> A, SparseMap<Tx> B)
 	}
 	Cj[n] = nnz;
 
-	SparseMatrix<OutputType> out(SparseMap<OutputType>(m, n, nnz, Cj, Ci, Cx));
-
-	delete[] Cx; delete[] Ci; delete[] Cj;
-	return out;
-}
-
-template <typename T>
-std::tuple<T, T> computeBinaryOperatorOuputSize(T Am, T An, T Bm, T Bn)
-{
-	T m = Am, n = An;
-	if (Bm != 1) m = Bm;
-	if (Bn != 1) n = Bn;
-	if ((Am != 1 && Am != m) || (Bm != 1 && Bm != m) ||
-		(An != 1 && An != n) || (Bn != 1 && Bn != n))
-		throw std::invalid_argument("Incompatiable input sizes: "
-			"" + to_string(Am) + " x " + to_string(An) + " and "
-			"" + to_string(Bm) + " x " + to_string(Bn) + ".");
-	return { m, n };
+	return SparseMap<OutputType>(m, n, nnz, Cj, Ci, Cx);
 }
 
-
-// Assume f(0, 0) = 0
-// Assume f(0, 1) = 0
-template <typename O, typename Tx = CType>
-SparseMatrix<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
-binaryOperator(SparseMap<Tx> A, Map<Tx> B)
+// C = f(X, D) or f(D, X) on the pattern of the sparse X broadcast to m x n
+template <typename O, bool SparseFirst, typename Tx>
+SparseMap<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
+broadcastSparseDense(SparseMap<Tx> X, Map<Tx> D)
 {
-	assertThrow(isZero(O::f(1, 1, Tx(0.0), Tx(1.0), kNullSet)), "binaryOperator(Sparse,Dense): f(0,1) must be 0");
-
-	auto Am = A.rows(), An = A.cols(), Annz = A.nonZeros(), Bm = B.rows(), Bn = B.cols();
-	auto Ax = A.valuePtr();
-
 	using OutputType = decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet));
 	using Ti = typename SparseMap<Tx>::StorageIndex;
-	auto [m, n] = computeBinaryOperatorOuputSize(Am, An, Bm, Bn);
-
-	SparseMatrix<OutputType> C(A.template cast<OutputType>());
-	auto Ci = C.innerIndexPtr(), Cj = C.outerIndexPtr();
-	auto Cx = C.valuePtr();
+	auto Xm = X.rows(), Xn = X.cols(), Dm = D.rows(), Dn = D.cols();
+	auto [m, n] = computeBinaryOperatorOuputSize<Ti>(Xm, Xn, Dm, Dn);
 
 	// Compute the increment of the indices
-	Ti iStepB = (Bm == 1) ? 0 : 1, jStepB = (Bn == 1) ? 0 : 1;
+	Ti iStepD = (Dm == 1) ? 0 : 1, jStepD = (Dn == 1) ? 0 : 1;
 
-	// Compute C
+	// Same size as C: reuse the pattern of X
+	if (Xm == m && Xn == n)
+	{
+		auto Ci = X.innerIndexPtr(), Cj = X.outerIndexPtr();
+		auto Xx = X.valuePtr();
+		auto Cx = scratchArray<OutputType>(X.nonZeros());
+		for (Ti j = 0; j < n; ++j)
+		{
+			for (Ti p = Cj[j]; p < Cj[j + 1]; ++p)
+			{
+				Ti i = Ci[p];
+				Tx d = D(i * iStepD, j * jStepD);
+				Cx[p] = SparseFirst ? O::f(i, j, Xx[p], d, kSetSet) : O::f(i, j, d, Xx[p], kSetSet);
+			}
+		}
+		return SparseMap<OutputType>(m, n, X.nonZeros(), Cj, Ci, Cx);
+	}
+
+	Ti nnz = 0;
+	for (Ti j = 0; j < n; ++j)
+		nnz += BroadcastColumn<Tx>(X, m, j).size();
+
+	auto Cx = scratchArray<OutputType>(nnz);
+	auto Cj = scratchArray<Ti>(n + 1);
+	auto Ci = scratchArray<Ti>(nnz);
+
+	nnz = 0;
 	for (Ti j = 0; j < n; ++j)
 	{
-		for (Ti p = Cj[j]; p < Cj[j + 1]; ++p)
+		Cj[j] = nnz;
+		for (BroadcastColumn<Tx> x(X, m, j); x.row() < m; x.next())
 		{
-			Ti i = Ci[p];
-			Cx[p] = O::f(i, j, Ax[p], B(i * iStepB, j * jStepB), kSetSet);
+			Ti i = x.row();
+			Tx d = D(i * iStepD, j * jStepD);
+			Cx[nnz] = SparseFirst ? O::f(i, j, x.value(), d, kSetSet) : O::f(i, j, d, x.value(), kSetSet);
+			Ci[nnz++] = i;
 		}
 	}
-	return C;
+	Cj[n] = nnz;
+	return SparseMap<OutputType>(m, n, nnz, Cj, Ci, Cx);
 }
 
+// Assume f(0, 0) = 0
+// Assume f(0, 1) = 0
+// The result has the (broadcast) pattern of A and its values in the scratch arena
+template <typename O, typename Tx>
+SparseMap<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
+binaryOperator(SparseMap<Tx> A, Map<Tx> B)
+{
+	assertThrow(isZero(O::f(1, 1, Tx(0.0), Tx(1.0), kNullSet)), "binaryOperator(Sparse,Dense): f(0,1) must be 0");
+	return broadcastSparseDense<O, true>(A, B);
+}
 
 // Assume f(0, 0) = 0
 // Assume f(1, 0) = 0
-template <typename O, typename Tx = CType>
-SparseMatrix<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
+// The result has the (broadcast) pattern of B and its values in the scratch arena
+template <typename O, typename Tx>
+SparseMap<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
 binaryOperator(Map<Tx> A, SparseMap<Tx> B)
 {
 	assertThrow(isZero(O::f(1, 1, Tx(1.0), Tx(0.0), kSetNull)), "binaryOperator(Dense,Sparse): f(1,0) must be 0");
+	return broadcastSparseDense<O, false>(B, A);
+}
 
-	auto Am = A.rows(), An = A.cols(), Bnnz = A.nonZeros(), Bm = B.rows(), Bn = B.cols();
-	auto Bx = B.valuePtr();
-
-	using OutputType = decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet));
+// Dense C = f(X, D) or f(D, X) without densifying the sparse X (broadcast to m x n):
+// C = f(0, D) in one pass over D, then the entries of X are written over it.
+template <typename O, bool SparseFirst, typename Tx>
+void scatterSparseDense(SparseMap<Tx> X, Map<Tx> D, Map<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))> C)
+{
 	using Ti = typename SparseMap<Tx>::StorageIndex;
-	auto [m, n] = computeBinaryOperatorOuputSize(Am, An, Bm, Bn);
-
-	SparseMatrix<OutputType> C(B.template cast<OutputType>());
-	auto Ci = C.innerIndexPtr(), Cj = C.outerIndexPtr();
-	auto Cx = C.valuePtr();
+	auto Dm = D.rows(), Dn = D.cols();
+	auto [m, n] = computeBinaryOperatorOuputSize<Ti>(X.rows(), X.cols(), Dm, Dn);
+	assertThrow(C.rows() == m && C.cols() == n, "binaryOperator: mismatch output dimensions");
 
 	// Compute the increment of the indices
-	Ti iStepA = (Am == 1) ? 0 : 1, jStepA = (An == 1) ? 0 : 1;
+	Ti iStepD = (Dm == 1) ? 0 : 1, jStepD = (Dn == 1) ? 0 : 1;
 
-	// Compute C
+	Tx Tzero = Tx(0.0);
 	for (Ti j = 0; j < n; ++j)
 	{
-		for (Ti p = Cj[j]; p < Cj[j + 1]; ++p)
+		for (Ti i = 0; i < m; ++i)
+		{
+			Tx d = D(i * iStepD, j * jStepD);
+			C(i, j) = SparseFirst ? O::f(i, j, Tzero, d, kNullSet) : O::f(i, j, d, Tzero, kSetNull);
+		}
+
+		for (BroadcastColumn<Tx> x(X, m, j); x.row() < m; x.next())
 		{
-			Ti i = Ci[p];
-			Cx[p] = O::f(i, j, A(i * iStepA, j * jStepA), Bx[p], kSetSet);
+			Ti i = x.row();
+			Tx d = D(i * iStepD, j * jStepD);
+			C(i, j) = SparseFirst ? O::f(i, j, x.value(), d, kSetSet) : O::f(i, j, d, x.value(), kSetSet);
 		}
 	}
-	return C;
 }
 
-template <typename O, typename Tx = CType>
-Matrix<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))>
-binaryOperator(Map<Tx> A, Map<Tx> B)
+template <typename O, typename Tx>
+void binaryOperator(SparseMap<Tx> A, Map<Tx> B, Map<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))> C)
+{
+	scatterSparseDense<O, true>(A, B, C);
+}
+
+template <typename O, typename Tx>
+void binaryOperator(Map<Tx> A, SparseMap<Tx> B, Map<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))> C)
+{
+	scatterSparseDense<O, false>(B, A, C);
+}
+
+// C must have the size given by computeBinaryOperatorOuputSize, e.g. the output array
+template <typename O, typename Tx>
+void binaryOperator(Map<Tx> A, Map<Tx> B, Map<decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet))> C)
 {
 	auto Am = A.rows(), An = A.cols(), Bm = B.rows(), Bn = B.cols();
 
-	using OutputType = decltype(O::f(1, 1, Tx(1.0), Tx(1.0), kSetSet));
 	using Ti = typename Map<Tx>::Index;
 	auto [m, n] = computeBinaryOperatorOuputSize(Am, An, Bm, Bn);
-	Matrix<OutputType> C(m, n);
+	assertThrow(C.rows() == m && C.cols() == n, "binaryOperator(Dense,Dense): mismatch output dimensions");
+
+	// Same sizes: the whole arrays at once with the batched version of f, in chunks over the threads
+	if constexpr (O::Batched)
+	{
+		if (Am == Bm && An == Bn)
+		{
+			parallelFor<size_t>(0, size_t(m * n), 4096, [&](size_t first, size_t last) {
+				O::f_n(A.data() + first, B.data() + first, C.data() + first, last - first);
+			});
+			return;
+		}
+	}
+
+	// A scalar first operand, e.g. 1 ./ B
+	if constexpr (O::BatchedScalar)
+	{
+		if (Am == 1 && An == 1 && Bm == m && Bn == n)
+		{
+			Tx a = A(0, 0);
+			parallelFor<size_t>(0, size_t(m * n), 4096, [&](size_t first, size_t last) {
+				O::f_n(a, B.data() + first, C.data() + first, last - first);
+			});
+			return;
+		}
+	}
 
 	// Compute the increment of the indices
 	Ti iStepA = (Am == 1) ? 0 : 1, jStepA = (An == 1) ? 0 : 1;
@@ -173,5 +316,4 @@ binaryOperator(Map<Tx> A, Map<Tx> B)
 			C(i, j) = O::f(i, j, A(i * iStepA, j * jStepA), B(i * iStepB, j * jStepB), kSetSet);
 		}
 	}
-	return C;
 }
@@ -1,266 +1,376 @@
-#include <random>
-
-#include <qd/dd_real.h>
-#include <qd/qd_real.h>
+#include <cstring>
+#include <memory>
 
 #include "CMatrixUtils.h"
+#include "adaptiveChol.h"
 
-namespace Eigen
-{
-	template<> struct NumTraits<dd_real> : DefaultNumTraits<dd_real> {};
-	template<> struct NumTraits<qd_real> : DefaultNumTraits<qd_real> {};
-}
-
-enum realType : uint32_t
-{
-	doubleType = 1,
-	dd_realType = 2,
-	qd_realType = 3
-};
-
-template<class T>
-using LLT = Eigen::SimplicialLLT<SparseMatrix<T>, Eigen::Upper, Eigen::NaturalOrdering<Eigen::Index>>;
-
-// First, how to include the matrix
-// Automatically choosen. Then, it creates a Chol Solver of that type.
-// Okay, maybe A has all type already. Call matrixType
-// Then, I have cholType
-// Both factorize and solve are template function to avoid too much backAndForth
-// solve have input on how many iterations.
-
-template <typename CType>
-struct CholSolver
+// The mex interface of AdaptiveChol: reads the inputs of each command and writes its outputs.
+// The numerical work is in adaptiveChol.h.
+struct CholSolvers : AdaptiveChol
 {
-	SparseMatrix<CType> A;
-	SparseMatrix<CType> At;
-	LLT<CType> L;
-	std::mt19937_64 gen;
-
-	bool analyzed = false;
-
 	template<typename T>
-	void initialize(T A_, uint64_t uid)
+	void initialize(MexContext& ctx, uint64_t uid_)
 	{
-		A = A_.template cast<CType>();
-		gen.seed(uid);
+		AdaptiveChol::initialize<T>(inputSparseMatrix<T>(ctx), uid_);
 	}
 
-	template<typename T>
-	void factorize(T W)
+	// W is given in TW, e.g. the float tier is factorized from a double W
+	template<typename CType, typename TW = CType>
+	void factorize(MexContext& ctx)
 	{
-		assertThrow(A.cols() == W.rows(), "factorize: dimension mismatch.");
-
-		if (!analyzed)
-			At = A.transpose();
-
-		SparseMatrix<CType> AW = A * W.template cast<CType>();
-		SparseMatrix<CType> H = AW * At;
-
-		double offset = inputScalar<double>();
-		L.setShift(CType(offset));
-
-		if (!analyzed)
-		{
-			L.analyzePattern(H);
-			analyzed = true;
-		}
-
-		L.factorize(H);
-		outputScalar<bool>(L.info() == Eigen::Success);
+		auto W = inputSparseMatrix<TW>(ctx);
+		double offset = inputScalar<double>(ctx);
+		inputPrecisionTag(ctx);
+		outputScalar<bool>(ctx, AdaptiveChol::factorize<CType>(W, offset));
 	}
 
-	void halfProj(int k)
+	// outputs okay and whether the factor was attached
+	template<typename CType, typename TW = CType>
+	void factorizeShared(MexContext& ctx)
 	{
-		assertThrow(L.info() == Eigen::Success, "factorize must be called before leverageScore.");
-
-		std::bernoulli_distribution dist(0.5);
+		auto W = inputSparseMatrix<TW>(ctx);
+		double offset = inputScalar<double>(ctx);
+		inputPrecisionTag(ctx);
+		bool attached = false;
+		outputScalar<bool>(ctx, AdaptiveChol::factorizeShared<CType>(W, offset, attached));
+		outputScalar<bool>(ctx, attached);
+	}
 
-		auto n = L.rows();
-		Matrix<CType> z(n, k);
-		for (auto j = 0; j < k; ++j)
-		{
-			for (auto i = 0; i < n; ++i)
-			{
-				z(i, j) = CType(double(dist(gen))*2.0-1.0);
-			}
-		}
+	// W is copied since the factorization outlives the mex call
+	template<typename CType, typename TW = CType>
+	void factorizeAsync(MexContext& ctx)
+	{
+		SparseMatrix<TW> W = inputSparseMatrix<TW>(ctx);
+		double offset = inputScalar<double>(ctx);
+		inputPrecisionTag(ctx);
+		AdaptiveChol::factorizeAsync<CType>(std::move(W), offset);
+	}
 
-		L.matrixU().solveInPlace(z);
-		Matrix<CType> u = At * z;
+	// consume the optional 'single' after (W, offset), see floatRequested
+	void inputPrecisionTag(MexContext& ctx)
+	{
+		if (ctx.hasInput())
+			assertThrow(inputString(ctx) == "single", "factorize: the precision should be 'single'.");
+	}
 
-		outputDenseMatrix<CType>(u, true);
+	// the optional last input names the arithmetic of the refinement residuals, see arithmetic.h
+	template<typename T>
+	void solve(MexContext& ctx)
+	{
+		auto B = inputDenseMatrix<T>(ctx);
+		auto W = inputSparseMatrix<T>(ctx);
+		int step = (int)inputScalar<double>(ctx);
+		auto arithmetic = ctx.hasInput() ? arithmeticMode(inputString(ctx)) : kDefaultArithmetic;
+		if (arithmetic == kAccurateArithmetic)
+			outputDenseMatrix<T>(ctx, AdaptiveChol::solve<T, AccurateArithmetic>(B, W, step), true);
+		else if (arithmetic == kSloppyArithmetic)
+			outputDenseMatrix<T>(ctx, AdaptiveChol::solve<T, SloppyArithmetic>(B, W, step), true);
+		else
+			outputDenseMatrix<T>(ctx, AdaptiveChol::solve<T>(B, W, step), true);
 	}
 
-	void outputDiagonal()
+	template<typename CType>
+	void outputDiagonal(MexContext& ctx)
 	{
-		assertThrow(L.info() == Eigen::Success, "diagonal: Numerical Issue.");
-		SparseMatrix<CType> L_concrete = L.matrixL();
-		Matrix<CType> D = L_concrete.diagonal();
-		outputDenseMatrix<CType>(D, true);
+		outputDenseMatrix<typename CholSolver<CType>::OutType>(ctx, current<CType>().diagonal(), true);
 	}
-};
 
-struct CholSolvers
-{
-	realType cholType;
-	CholSolver<double> solver_d;
-	CholSolver<dd_real> solver_dd;
-	CholSolver<qd_real> solver_qd;
+	// a sketch in a lower precision than the factor comes back in double
+	template<typename CType>
+	void outputHalfProj(MexContext& ctx, int JLDim, realType sketch)
+	{
+		auto& solver = current<CType>();
+		bool lower = sketch && precisionRank(sketch) < precisionRank(cholType);
+		if (lower && sketch == doubleType)
+			outputDenseMatrix<double>(ctx, solver.template halfProjIn<double>(JLDim), true);
+		else if (lower && sketch == floatType)
+			outputDenseMatrix<double>(ctx, solver.template halfProjIn<float>(JLDim).template cast<double>(), true);
+		else
+			outputDenseMatrix<typename CholSolver<CType>::OutType>(ctx, solver.halfProj(JLDim), true);
+	}
 
-	template<typename T>
-	void initialize(uint64_t uid)
+	void setMatrixFree(MexContext& ctx)
 	{
-		auto A = inputSparseMatrix<T>();
-		solver_d.initialize(A, uid);
-		solver_dd.initialize(A, uid);
-		solver_qd.initialize(A, uid);
+		MatrixFreeOptions options = pcg;
+		options.enabled = inputScalar<bool>(ctx);
+		options.tol = inputScalar<double>(ctx, options.tol);
+		options.maxIter = (int)inputScalar<double>(ctx, options.maxIter);
+		options.dropTol = inputScalar<double>(ctx, options.dropTol);
+		AdaptiveChol::setMatrixFree(options);
 	}
 
-	template<typename T, typename T2>
-	void solveStep(Matrix<T> &X, T2 &B)
+	void serialize(MexContext& ctx)
 	{
-		if (cholType == doubleType)
+		ByteWriter out;
+		AdaptiveChol::serialize(out);
+
+		if (ctx.hasInput())
+			out.writeFile(inputString(ctx));
+		else
 		{
-			assertThrow(solver_d.L.info() == Eigen::Success, "solve: Numerical Issue.");
-			assertThrow(solver_d.A.rows() == B.rows(), "solve: dimension mismatch.");
-			X = solver_d.L.solve(B.template cast<double>()).template cast<T>();
+			uint8_t* blob = outputArray<uint8_t>(ctx, out.bytes.size());
+			std::memcpy(blob, out.bytes.data(), out.bytes.size());
 		}
-		else if (cholType == dd_realType)
+	}
+
+	// read a factor from a uint8 blob, which is copied, or use it in place from a memory-mapped
+	// file if a filename is given; the file stays mapped until the next factorization
+	void deserialize(MexContext& ctx)
+	{
+		if (mxIsChar(ctx.prhs[ctx.rhs_id]))
 		{
-			assertThrow(solver_dd.L.info() == Eigen::Success, "solve: Numerical Issue.");
-			assertThrow(solver_dd.A.rows() == B.rows(), "solve: dimension mismatch.");
-			X = solver_dd.L.solve(B.template cast<dd_real>()).template cast<T>();
+			std::unique_ptr<MappedBytes> file(new MappedBytes(std::unique_ptr<MappedFile>(new MappedFile(inputString(ctx)))));
+			ByteReader in(file->data, file->size);
+			outputScalar<double>(ctx, AdaptiveChol::deserialize(in, std::move(file)));
 		}
-		else if (cholType == qd_realType)
+		else
 		{
-			assertThrow(solver_qd.L.info() == Eigen::Success, "solve: Numerical Issue.");
-			assertThrow(solver_qd.A.rows() == B.rows(), "solve: dimension mismatch.");
-			X = solver_qd.L.solve(B.template cast<qd_real>()).template cast<T>();
+			size_t m = kAnySize, n = kAnySize;
+			const uint8_t* data = inputArray<uint8_t>(ctx, m, n);
+			ByteReader in(data, m * n);
+			outputScalar<double>(ctx, AdaptiveChol::deserialize(in));
 		}
 	}
 
-	template<typename T>
-	void solve()
+	// profile(): return the records as a struct of columns
+	// profile('on'|'off'|'reset'): enable, disable or clear the records
+	void profile(MexContext& ctx)
 	{
-		auto B = inputDenseMatrix<T>();
-		auto W = inputSparseMatrix<T>();
-		int step = (int)inputScalar<double>();
-		Matrix<T> X;
-		solveStep(X, B);
+		if (ctx.hasInput())
+		{
+			auto action = inputString(ctx);
+			if (action == "on")
+				profiler.enabled = true;
+			else if (action == "off")
+				profiler.enabled = false;
+			else if (action == "reset")
+				profiler.reset();
+			else
+				throw std::runtime_error("profile: unknown action " + action + ".");
+			return;
+		}
 
-		Matrix<T> R, Atx, WAtx, Hinv_R;
-		for (int i = 1; i < step; ++i)
+		auto& records = profiler.records;
+		size_t n = records.size();
+		const char* fields[] = { "phase", "type", "seconds", "flops", "nnzL" };
+		mxArray* pt = mxCreateStructMatrix(1, 1, 5, fields);
+		mxArray* phase = mxCreateCellMatrix(n, 1);
+		mxArray* type = mxCreateDoubleMatrix(n, 1, mxREAL);
+		mxArray* seconds = mxCreateDoubleMatrix(n, 1, mxREAL);
+		mxArray* flops = mxCreateDoubleMatrix(n, 1, mxREAL);
+		mxArray* nnzL = mxCreateDoubleMatrix(n, 1, mxREAL);
+		for (size_t k = 0; k < n; ++k)
 		{
-			if (cholType == doubleType)
-			{
-				Atx = solver_d.At.cast<T>() * X;
-				WAtx = W * Atx;
-				R = B - solver_d.A.cast<T>() * WAtx;
-			}
-			else if (cholType == dd_realType)
-			{
-				Atx = solver_dd.At.cast<T>() * X;
-				WAtx = W * Atx;
-				R = B - solver_dd.A.cast<T>() * WAtx;
-			}
-			else if (cholType == qd_realType)
-			{
-				Atx = solver_qd.At.cast<T>() * X;
-				WAtx = W * Atx;
-				R = B - solver_qd.A.cast<T>() * WAtx;
-			}
-			solveStep(Hinv_R, R);
-			X += Hinv_R;
+			mxSetCell(phase, k, mxCreateString(records[k].phase.c_str()));
+			mxGetPr(type)[k] = records[k].type;
+			mxGetPr(seconds)[k] = records[k].seconds;
+			mxGetPr(flops)[k] = records[k].flops;
+			mxGetPr(nnzL)[k] = double(records[k].nnzL);
 		}
-		outputDenseMatrix<T>(X, true);
+		mxSetField(pt, 0, "phase", phase);
+		mxSetField(pt, 0, "type", type);
+		mxSetField(pt, 0, "seconds", seconds);
+		mxSetField(pt, 0, "flops", flops);
+		mxSetField(pt, 0, "nnzL", nnzL);
+		output(ctx, pt);
 	}
 };
 
-int main()
+// factorize(W, offset, 'single') asks for the float tier; W stays double since MATLAB has no sparse single
+bool floatRequested(MexContext& ctx)
 {
-	auto cmd = inputString();
+	return ctx.rhs_id + 2 < ctx.nrhs && mxIsChar(ctx.prhs[ctx.rhs_id + 2]);
+}
+
+int mexMain(MexContext& ctx)
+{
+	qd::fpu_guard fpu;
+	checkArithmetic();
+	auto cmd = inputString(ctx);
 	auto cmdHash = str2int(cmd.c_str());
 
-	uint64_t uid = inputScalar<uint64_t>();
+	uint64_t uid = inputScalar<uint64_t>(ctx);
 	if (cmdHash == str2int("new"))
 	{
 		CholSolvers* solver = new CholSolvers;
 
-		if (compatibleWith<double>(rhs_id))
-			solver->initialize<double>(uid);
-		else if (compatibleWith<dd_real>(rhs_id))
-			solver->initialize<dd_real>(uid);
-		else if (compatibleWith<qd_real>(rhs_id))
-			solver->initialize<qd_real>(uid);
+		if (compatibleWith<double>(ctx, ctx.rhs_id))
+			solver->initialize<double>(ctx, uid);
+		else if (compatibleWith<dd_real>(ctx, ctx.rhs_id))
+			solver->initialize<dd_real>(ctx, uid);
+		else if (compatibleWith<td_real>(ctx, ctx.rhs_id))
+			solver->initialize<td_real>(ctx, uid);
+		else if (compatibleWith<qd_real>(ctx, ctx.rhs_id))
+			solver->initialize<qd_real>(ctx, uid);
 		else
 			throw std::runtime_error("Unsupported type.");
 
-		outputScalar<uint64_t>((uint64_t)solver);
+		outputScalar<uint64_t>(ctx, (uint64_t)solver);
 	}
 	else
 	{
 		CholSolvers* solver = (CholSolvers*)uid;
+
+		// A factorization started by factorizeAsync runs until wait. Commands on the current
+		// factor only wait for that precision, so MATLAB can use a double factor while the
+		// ddouble one is still computed; the other commands wait for all of them.
+		switch (cmdHash)
+		{
+		case str2int("factorizeAsync"):
+		case str2int("wait"):
+		case str2int("delete"):
+			break;
+		case str2int("solve"):
+		case str2int("diagonal"):
+		case str2int("halfProj"):
+		case str2int("residual"):
+		case str2int("serialize"):
+			solver->waitFor(solver->cholType);
+			break;
+		default:
+			solver->waitAll();
+		}
+
 		switch (cmdHash)
 		{
 		case str2int("solve"):
 		{
-			if (compatibleWith<double>(rhs_id))
-				solver->solve<double>();
-			else if (compatibleWith<dd_real>(rhs_id))
-				solver->solve<dd_real>();
-			else if (compatibleWith<qd_real>(rhs_id))
-				solver->solve<qd_real>();
+			if (compatibleWith<double>(ctx, ctx.rhs_id))
+				solver->solve<double>(ctx);
+			else if (compatibleWith<dd_real>(ctx, ctx.rhs_id))
+				solver->solve<dd_real>(ctx);
+			else if (compatibleWith<td_real>(ctx, ctx.rhs_id))
+				solver->solve<td_real>(ctx);
+			else if (compatibleWith<qd_real>(ctx, ctx.rhs_id))
+				solver->solve<qd_real>(ctx);
 			else
 				throw std::runtime_error("Unsupported type.");
 			break;
 		}
 		case str2int("factorize"):
 		{
-			if (compatibleWith<double>(rhs_id))
-			{
-				solver->solver_d.factorize(inputSparseMatrix<double>());
-				solver->cholType = doubleType;
-			}
-			else if (compatibleWith<dd_real>(rhs_id))
-			{
-				solver->solver_dd.factorize(inputSparseMatrix<dd_real>());
-				solver->cholType = dd_realType;
-			}
-			else if (compatibleWith<qd_real>(rhs_id))
-			{
-				solver->solver_qd.factorize(inputSparseMatrix<qd_real>());
-				solver->cholType = qd_realType;
-			}
+			if (floatRequested(ctx))
+				solver->factorize<float, double>(ctx);
+			else if (compatibleWith<double>(ctx, ctx.rhs_id))
+				solver->factorize<double>(ctx);
+			else if (compatibleWith<dd_real>(ctx, ctx.rhs_id))
+				solver->factorize<dd_real>(ctx);
+			else if (compatibleWith<td_real>(ctx, ctx.rhs_id))
+				solver->factorize<td_real>(ctx);
+			else if (compatibleWith<qd_real>(ctx, ctx.rhs_id))
+				solver->factorize<qd_real>(ctx);
+			else
+				throw std::runtime_error("Unsupported type.");
+			break;
+		}
+		case str2int("factorizeShared"):
+		{
+			if (floatRequested(ctx))
+				solver->factorizeShared<float, double>(ctx);
+			else if (compatibleWith<double>(ctx, ctx.rhs_id))
+				solver->factorizeShared<double>(ctx);
+			else if (compatibleWith<dd_real>(ctx, ctx.rhs_id))
+				solver->factorizeShared<dd_real>(ctx);
+			else if (compatibleWith<td_real>(ctx, ctx.rhs_id))
+				solver->factorizeShared<td_real>(ctx);
+			else if (compatibleWith<qd_real>(ctx, ctx.rhs_id))
+				solver->factorizeShared<qd_real>(ctx);
 			else
 				throw std::runtime_error("Unsupported type.");
 			break;
 		}
+		case str2int("factorizeAsync"):
+		{
+			if (floatRequested(ctx))
+				solver->factorizeAsync<float, double>(ctx);
+			else if (compatibleWith<double>(ctx, ctx.rhs_id))
+				solver->factorizeAsync<double>(ctx);
+			else if (compatibleWith<dd_real>(ctx, ctx.rhs_id))
+				solver->factorizeAsync<dd_real>(ctx);
+			else if (compatibleWith<td_real>(ctx, ctx.rhs_id))
+				solver->factorizeAsync<td_real>(ctx);
+			else if (compatibleWith<qd_real>(ctx, ctx.rhs_id))
+				solver->factorizeAsync<qd_real>(ctx);
+			else
+				throw std::runtime_error("Unsupported type.");
+			break;
+		}
+		case str2int("wait"):
+		{
+			auto type = realType(inputScalar<double>(ctx));
+			outputScalar<bool>(ctx, solver->wait(type));
+			break;
+		}
+		case str2int("unlinkShared"):
+		{
+			solver->unlinkShared();
+			break;
+		}
 		case str2int("diagonal"):
 		{
-			if (solver->cholType == doubleType)
-				solver->solver_d.outputDiagonal();
+			if (solver->cholType == floatType)
+				solver->outputDiagonal<float>(ctx);
+			else if (solver->cholType == doubleType)
+				solver->outputDiagonal<double>(ctx);
 			else if (solver->cholType == dd_realType)
-				solver->solver_dd.outputDiagonal();
+				solver->outputDiagonal<dd_real>(ctx);
+			else if (solver->cholType == td_realType)
+				solver->outputDiagonal<td_real>(ctx);
 			else if (solver->cholType == qd_realType)
-				solver->solver_qd.outputDiagonal();
+				solver->outputDiagonal<qd_real>(ctx);
 			else
 				throw std::runtime_error("Unsupported type.");
 			break;
 		}
 		case str2int("halfProj"):
 		{
-			int JLDim = (int)inputScalar<double>();
+			int JLDim = (int)inputScalar<double>(ctx);
+			realType sketch = ctx.hasInput() ? sketchType(inputString(ctx)) : realType(0);
          
-			if (solver->cholType == doubleType)
-				solver->solver_d.halfProj(JLDim);
+			if (solver->cholType == floatType)
+				solver->outputHalfProj<float>(ctx, JLDim, sketch);
+			else if (solver->cholType == doubleType)
+				solver->outputHalfProj<double>(ctx, JLDim, sketch);
 			else if (solver->cholType == dd_realType)
-				solver->solver_dd.halfProj(JLDim);
+				solver->outputHalfProj<dd_real>(ctx, JLDim, sketch);
+			else if (solver->cholType == td_realType)
+				solver->outputHalfProj<td_real>(ctx, JLDim, sketch);
 			else if (solver->cholType == qd_realType)
-				solver->solver_qd.halfProj(JLDim);
+				solver->outputHalfProj<qd_real>(ctx, JLDim, sketch);
 			else
 				throw std::runtime_error("Unsupported type.");
 			break;
 		}
+		case str2int("matrixFree"):
+		{
+			solver->setMatrixFree(ctx);
+			break;
+		}
+		case str2int("residual"):
+		{
+			outputScalar<double>(ctx, solver->residual());
+			break;
+		}
+		case str2int("serialize"):
+		{
+			solver->serialize(ctx);
+			break;
+		}
+		case str2int("deserialize"):
+		{
+			solver->deserialize(ctx);
+			break;
+		}
+		case str2int("profile"):
+		{
+			solver->profile(ctx);
+			break;
+		}
+		case str2int("release"):
+		{
+			solver->release();
+			break;
+		}
 		case str2int("delete"):
 		{
 			delete solver;
@@ -270,4 +380,5 @@ int main()
 			throw std::runtime_error("Unsupported command: " + cmd);
 		}
 	}
+	return 0;
 }
\ No newline at end of file
@@ -1,17 +1,29 @@
+function compileCMatrix(opts)
+%compileCMatrix(opts)
+%compile the ddouble, tdouble and qdouble mex files and AdaptiveChol
+%
+%Input:
+% opts - options of compile, e.g. struct('deterministic', true) for results
+%        that are the same bits on every machine (see utils/compile.m)
+
+if nargin < 1, opts = struct; end
 configCMatrix
 
 %% setup source files
 [path,~,~] = fileparts(mfilename('fullpath'));
 qdpath = fullfile(path, 'qd');
-source = {fullfile(qdpath, 'util.cc'), fullfile(qdpath, 'bits.cc'), fullfile(qdpath, 'dd_real.cc'), fullfile(qdpath, 'dd_const.cc'), fullfile(qdpath, 'qd_real.cc'), fullfile(qdpath, 'qd_const.cc')};
+source = {fullfile(qdpath, 'util.cc'), fullfile(qdpath, 'bits.cc'), fullfile(qdpath, 'dd_real.cc'), fullfile(qdpath, 'qd_real.cc'), fullfile(qdpath, 'td_real.cc'), fullfile(qdpath, 'fpu.cc')};
 global EIGEN_PATH
 include = {path, EIGEN_PATH};
 
 %% compile ddouble
-compileEachCMatrix('ddouble', source, include);
+compileEachCMatrix('ddouble', source, include, opts);
 
 %% compile qdouble
-compileEachCMatrix('qdouble', source, include);
+compileEachCMatrix('qdouble', source, include, opts);
+
+%% compile tdouble
+compileEachCMatrix('tdouble', source, include, opts);
 
 %% compile AdaptiveChol 
 [path,~,~] = fileparts(mfilename('fullpath'));
@@ -23,9 +35,10 @@ else
 end
 
 fprintf('compiling AdaptiveChol...\n');
-compile(mexFile, [{fullfile(path, 'cholMex.cpp')} source], include);
+compile(mexFile, [{fullfile(path, 'cholMex.cpp')} source], include, opts);
+end
 
-function compileEachCMatrix(name, source, include)
+function compileEachCMatrix(name, source, include, opts)
 [path, ~, ~] = fileparts(mfilename('fullpath'));
 
 % copy CMatrix.m file
@@ -45,5 +58,5 @@ end
 mexFile = fullfile(path, 'include', mexFile);
 
 fprintf('compiling %s...\n', name);
-compile(mexFile, [{fullfile(path, 'include', [name, '.cpp'])} source], include);
+compile(mexFile, [{fullfile(path, 'include', [name, '.cpp'])} source], include, opts);
 end
\ No newline at end of file
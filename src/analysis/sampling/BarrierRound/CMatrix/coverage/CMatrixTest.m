@@ -1,6 +1,6 @@
 classdef CMatrixTest < matlab.unittest.TestCase
    properties (TestParameter)
-      type = {@ddouble}
+      type = {@ddouble, @tdouble}
       lhsSize = {[0, 0], [1, 1], [30, 20], [30, 1], [1 20]}
       rhsSize = {[0, 0], [1, 1], [30, 20], [30, 1], [1 20]}
       lhsMode = struct('dense', 0, 'sparse', 1);
@@ -63,6 +63,12 @@ classdef CMatrixTest < matlab.unittest.TestCase
          testCase.verifyEqual(double(A2 .* B2), A1 .* B1, 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(A2 ./ B2), A1 ./ B1, 'AbsTol', Ceps*1e4, 'RelTol', Ceps*1e4)
          testCase.verifyEqual(double(A2 .\ B2), A1 .\ B1, 'AbsTol', Ceps*1e4, 'RelTol', Ceps*1e4)
+         for arithmetic = {'sloppy', 'accurate'}
+            testCase.verifyEqual(double(plus(A2, B2, arithmetic{1})), A1 + B1, 'AbsTol', Ceps*1e4)
+            testCase.verifyEqual(double(minus(A2, B2, arithmetic{1})), A1 - B1, 'AbsTol', Ceps*1e4)
+            testCase.verifyEqual(double(times(A2, B2, arithmetic{1})), A1 .* B1, 'AbsTol', Ceps*1e4)
+            testCase.verifyEqual(double(rdivide(A2, B2, arithmetic{1})), A1 ./ B1, 'AbsTol', Ceps*1e4, 'RelTol', Ceps*1e4)
+         end
          
          % max, min
          testCase.verifyEqual(double(max(A2,B2)), max(A1,B1), 'AbsTol', Ceps*1e4)
@@ -124,13 +130,15 @@ classdef CMatrixTest < matlab.unittest.TestCase
             testCase.verifyEqual(issymmetric(A2), issymmetric(A1))
          end
          
-         % uminus, uplus, abs, transpose, ctranspose, sqrt, all, any, nnz, diag
+         % uminus, uplus, abs, transpose, ctranspose, sqrt, exp, log, all, any, nnz, diag
          testCase.verifyEqual(double(-A2), -A1, 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(+A2), +A1, 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(abs(A2)), abs(A1), 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(transpose(A2)), transpose(A1), 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(ctranspose(A2)), ctranspose(A1), 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(double(sqrt(abs(A2)+1)), sqrt(abs(A1)+1), 'AbsTol', Ceps*1e4)
+         testCase.verifyEqual(double(exp(A2)), full(exp(A1)), 'RelTol', Ceps*1e4)
+         testCase.verifyEqual(double(log(abs(A2)+1)), full(log(abs(A1)+1)), 'AbsTol', Ceps*1e4)
          testCase.verifyEqual(all(A2), all(A1))
          testCase.verifyEqual(all(A2,1), all(A1,1))
          testCase.verifyEqual(all(A2,2), all(A1,2))
@@ -286,6 +294,30 @@ classdef CMatrixTest < matlab.unittest.TestCase
          b = randn(30,1);
          x = A\b;
          testCase.verifyLessThan(double(norm(A*x-b)), Ceps*1e4)
+         
+         % toText, fromText
+         A = type(randn(4,3)) / 3;
+         B = A.fromText(A.toText('hex'), [4 3]);
+         testCase.verifyEqual(nnz(A - B), 0)
+         B = A.fromText(A.toText('decimal'), [4 3]);
+         testCase.verifyLessThan(double(sum(abs(A - B), 'all')), Ceps*100)
+         testCase.verifyEqual(size(A.fromText('1 2 3')), [3 1])
+         
+         % writeFile, readFile
+         f = [tempname '.cmtx'];
+         A.writeFile(f);
+         testCase.verifyEqual(nnz(A - A.readFile(f)), 0)
+         S = type(sprandn(50, 40, 0.1));
+         S.writeFile(f, 256, true);
+         T = S.readFile(f);
+         testCase.verifyTrue(issparse(T))
+         testCase.verifyEqual(nnz(S - T), 0)
+         delete(f);
+         
+         % selfCheck: contraction and packed only make the results depend
+         % on the machine, the other checks make them wrong
+         failed = A.selfCheck();
+         testCase.verifyEmpty(regexp(failed, 'two_sum|two_prod|arithmetic|rounding|denormals', 'once'))
       end
       
       function cholTests(testCase)
@@ -311,6 +343,49 @@ classdef CMatrixTest < matlab.unittest.TestCase
          ls = o.leverageScore(100);
          testCase.verifyTrue(all(ls<1.5));
          
+         o.releaseFactors = true;
+         o.factorize(diag(sparse(w)));
+         testCase.verifyEqual(double(z), o.solve(x), 'AbsTol', eps*1e4)
+         
+         o.profile('on');
+         o.factorize(diag(sparse(w)));
+         r = o.profile();
+         testCase.verifyTrue(any(strcmp(r.phase, 'factorize')));
+         testCase.verifyTrue(all(r.seconds >= 0));
+         o.profile('reset');
+         testCase.verifyEmpty(o.profile().phase);
+         
+         o2 = AdaptiveChol.loadobj(o.saveobj());
+         testCase.verifyEqual(double(z), o2.solve(x), 'AbsTol', eps*1e4)
+         
+         o2.singlePrecision = true;
+         o2.factorize(diag(sparse(w)));
+         testCase.verifyLessThan(norm(double(z) - o2.solve(x, [], 5)) / norm(z), 1e-8)
+         
+         o4 = AdaptiveChol(A);
+         o4.overlapFactorize = true;
+         o4.factorize(diag(sparse(w)));
+         testCase.verifyEqual(double(z), o4.solve(x), 'AbsTol', eps*1e4)
+         o4.factorize(diag(sparse(w)));
+         testCase.verifyEqual(double(d), o4.diagonal(), 'AbsTol', eps*1e4)
+         
+         if isunix
+            o.sharedFactor = true;
+            o.factorize(diag(sparse(w)));
+            o3 = AdaptiveChol(A);
+            o3.sharedFactor = true;
+            o3.factorize(diag(sparse(w)));
+            testCase.verifyEqual(double(z), o3.solve(x), 'AbsTol', eps*1e4)
+            o.unlinkShared();
+         end
+         
+         o = AdaptiveChol(A);
+         o.useMatrixFree(true, struct('tol', 1e-12, 'maxIter', 2000));
+         o.factorize(diag(sparse(w)));
+         testCase.verifyLessThan(norm(double(z) - o.solve(x)) / norm(z), 1e-6)
+         ls = o.leverageScore(100);
+         testCase.verifyTrue(all(ls<1.5));
+         
          try
             o.factorize(diag(sparse(rand(12,1))));
          end
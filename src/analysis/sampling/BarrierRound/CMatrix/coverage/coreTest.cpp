@@ -0,0 +1,1138 @@
+// Tests of the kernels and AdaptiveChol through the C++ interface, without MATLAB.
+// Build and run from the CMatrix folder:
+//
+//   QD="qd/util.cc qd/bits.cc qd/dd_real.cc qd/qd_real.cc qd/td_real.cc qd/fpu.cc"
+//   g++ -std=c++17 -O2 -pthread -I. -I<eigen> coverage/coreTest.cpp $QD -lrt -o coreTest && ./coreTest
+//
+// With -ffp-contract=off -DQD_DETERMINISTIC (the deterministic build of compile.m), testSelfCheck also
+// fails if the results of the qd types depend on the processor.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "realTypes.h"
+#include "binaryOperator.h"
+#include "unaryOperator.h"
+#include "operators.h"
+#include "denseProduct.h"
+#include "sparseProduct.h"
+#include "linearSolve.h"
+#include "adaptiveChol.h"
+#include "matrixFile.h"
+#include <qd/fpu.h>
+#include <qd/poly.h>
+#include <qd/self_check.h>
+#include <qd/text.h>
+
+namespace
+{
+	int failures = 0, checks = 0;
+
+#define CHECK(cond) \
+	do { ++checks; if (!(cond)) { std::printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+	std::mt19937 rng(1);
+
+	Matrix<double> randomDense(Eigen::Index m, Eigen::Index n, double density = 1.0)
+	{
+		std::uniform_real_distribution<double> value(-1.0, 1.0), coin(0.0, 1.0);
+		Matrix<double> X(m, n);
+		for (Eigen::Index j = 0; j < n; ++j)
+			for (Eigen::Index i = 0; i < m; ++i)
+				X(i, j) = coin(rng) < density ? value(rng) : 0.0;
+		return X;
+	}
+
+	// the kernels take 32 byte aligned maps, as given by the scratch arena
+	template<typename T>
+	Map<T> dense(const Matrix<double>& X)
+	{
+		Map<T> Y = scratchMatrix<T>(X.rows(), X.cols());
+		for (Eigen::Index k = 0; k < X.size(); ++k)
+			Y.data()[k] = T(X.data()[k]);
+		return Y;
+	}
+
+	template<typename T>
+	struct Sparse
+	{
+		SparseMatrix<T> X;
+
+		Sparse(const Matrix<double>& D) : X(D.sparseView().template cast<T>()) { X.makeCompressed(); }
+
+		SparseMap<T> map()
+		{
+			return SparseMap<T>(X.rows(), X.cols(), X.nonZeros(), X.outerIndexPtr(), X.innerIndexPtr(), X.valuePtr());
+		}
+	};
+
+	double to_double(double x) { return x; }
+	double to_double(float x) { return x; }
+	double to_double(bool x) { return x; }
+
+	template<typename Derived>
+	double maxError(const Eigen::MatrixBase<Derived>& X, const Matrix<double>& ref)
+	{
+		if (X.rows() != ref.rows() || X.cols() != ref.cols())
+			return INFINITY;
+		double err = 0.0;
+		for (Eigen::Index j = 0; j < ref.cols(); ++j)
+			for (Eigen::Index i = 0; i < ref.rows(); ++i)
+				err = std::max(err, std::abs(to_double(X(i, j)) - ref(i, j)) / (1.0 + std::abs(ref(i, j))));
+		return err;
+	}
+
+	// The reference in qd_real, so that the extended types are checked to their own precision
+	Matrix<qd_real> exact(const Matrix<double>& X)
+	{
+		return X.cast<qd_real>();
+	}
+
+	template<typename Derived>
+	double exactError(const Eigen::MatrixBase<Derived>& X, const Matrix<qd_real>& ref)
+	{
+		if (X.rows() != ref.rows() || X.cols() != ref.cols())
+			return INFINITY;
+		double err = 0.0;
+		for (Eigen::Index j = 0; j < ref.cols(); ++j)
+			for (Eigen::Index i = 0; i < ref.rows(); ++i)
+				err = std::max(err, to_double(abs(qd_real(X(i, j)) - ref(i, j)) / (1.0 + abs(ref(i, j)))));
+		return err;
+	}
+
+	// tol is a small multiple of the epsilon of T
+	template<typename T>
+	void testOperators(double tol)
+	{
+		ScratchScope scratch;
+		Matrix<double> A = randomDense(9, 7, 0.4), B = randomDense(9, 7, 0.5), col = randomDense(9, 1);
+
+		// plus of every sparse/dense combination, with a broadcast column
+		Matrix<qd_real> ref = exact(A) + exact(B);
+		{
+			auto Ad = dense<T>(A), Bd = dense<T>(B);
+			auto C = dense<T>(Matrix<double>::Zero(9, 7));
+			binaryOperator<plusFunc<T>>(Ad, Bd, C);
+			CHECK(exactError(C, ref) < tol);
+		}
+		{
+			Sparse<T> As(A), Bs(B);
+			Matrix<T> C = binaryOperator<plusFunc<T>>(As.map(), Bs.map()).toDense();
+			CHECK(exactError(C, ref) < tol);
+		}
+		{
+			Sparse<T> As(A);
+			auto Bd = dense<T>(B);
+			auto C = dense<T>(Matrix<double>::Zero(9, 7));
+			binaryOperator<plusFunc<T>>(As.map(), Bd, C);
+			CHECK(exactError(C, ref) < tol);
+		}
+		{
+			Sparse<T> As(A), cs(col);
+			Matrix<T> C = binaryOperator<timesFunc<T>>(As.map(), cs.map()).toDense();
+			CHECK(exactError(C, (exact(A).array().colwise() * exact(col).col(0).array()).matrix()) < tol);
+		}
+
+		// unary and reduction
+		{
+			Sparse<T> As(A);
+			Matrix<T> C = unaryOperator<uminusFunc<T>>(As.map()).toDense();
+			CHECK(exactError(C, -exact(A)) < tol);
+
+			auto Ad = dense<T>(A);
+			auto L = dense<bool>(Matrix<double>::Zero(9, 7));
+			unaryOperator<logicalFunc<T>>(Ad, L);
+			CHECK(maxError(L, (A.array() != 0.0).cast<double>().matrix()) == 0.0);
+
+			auto E = dense<T>(Matrix<double>::Zero(9, 7));
+			unaryOperator<expFunc<T>>(Ad, E);
+			CHECK(exactError(E, exact(A).unaryExpr([](const qd_real& x) { return exp(x); })) < tol);
+			Matrix<T> Es = unaryOperator<logFunc<T>>(Sparse<T>(A.cwiseAbs()).map()).toDense();
+			Matrix<qd_real> logRef = exact(A).unaryExpr([](const qd_real& x) { return x == 0.0 ? qd_real(0.0) : log(abs(x)); });
+			CHECK(exactError(Es, logRef) < tol);
+
+			auto S = dense<T>(Matrix<double>::Zero(1, 7));
+			reductionOperator<sumFunc<T>>(As.map(), S);
+			CHECK(exactError(S, exact(A).colwise().sum()) < tol);
+		}
+
+		// products
+		{
+			Matrix<double> X = randomDense(23, 31, 0.3), Y = randomDense(31, 17, 0.3);
+			Matrix<qd_real> XY = exact(X) * exact(Y);
+			auto Xd = dense<T>(X), Yd = dense<T>(Y);
+			Sparse<T> Xs(X), Ys(Y);
+			auto C = dense<T>(Matrix<double>::Zero(23, 17));
+			denseProduct<T>(Xd, Yd, C);
+			CHECK(exactError(C, XY) < tol);
+			sparseDenseProduct<T>(Xs.map(), Yd, C);
+			CHECK(exactError(C, XY) < tol);
+			denseSparseProduct<T>(Xd, Ys.map(), C);
+			CHECK(exactError(C, XY) < tol);
+			Matrix<T> Cs = sparseProduct(Xs.map(), Ys.map()).toDense();
+			CHECK(exactError(Cs, XY) < tol);
+		}
+
+		// solves
+		{
+			Matrix<double> M = randomDense(8, 8);
+			M = M * M.transpose() + 8.0 * Matrix<double>::Identity(8, 8);
+			Matrix<double> b = randomDense(8, 2);
+			auto Md = dense<T>(M), bd = dense<T>(b);
+			Sparse<T> Ms(M);
+			Matrix<qd_real> x = exact(M).ldlt().solve(exact(b));
+			CHECK(exactError(mldivide(Md, bd), x) < 100 * tol);
+			CHECK(exactError(mldivide(Ms.map(), bd), x) < 100 * tol);
+
+			Matrix<T> U = chol(Md);
+			Matrix<T> UtU = U.transpose() * U;
+			CHECK(exactError(UtU, exact(M)) < 100 * tol);
+		}
+	}
+
+	// A sparse row or scalar broadcast against a sparse matrix: times and and only keep the entries where
+	// both are set, with no explicit zeros, and plus keeps the union
+	template<typename T>
+	void testSparseBroadcast(double tol)
+	{
+		ScratchScope scratch;
+		Matrix<double> A = randomDense(9, 7, 0.4), row = randomDense(1, 7, 0.5), zero = Matrix<double>::Zero(1, 7);
+		row(0, 0) = 0.5; row(0, 1) = 0.0;
+		Matrix<double> R = row.replicate(9, 1);
+		Sparse<T> As(A), rs(row), zs(zero), ss(Matrix<double>::Constant(1, 1, 3.0));
+
+		auto setCount = [](const Matrix<double>& X) { return Eigen::Index((X.array() != 0.0).count()); };
+		auto explicitZeros = [](const auto& C) {
+			Eigen::Index k = 0;
+			for (Eigen::Index p = 0; p < C.nonZeros(); ++p)
+				k += isZero(C.valuePtr()[p]);
+			return k;
+		};
+
+		auto C = binaryOperator<timesFunc<T>>(As.map(), rs.map());
+		CHECK(C.nonZeros() == setCount(A.cwiseProduct(R)) && explicitZeros(C) == 0);
+		CHECK(exactError(Matrix<T>(C.toDense()), exact(A).cwiseProduct(exact(R))) < tol);
+		C = binaryOperator<timesFunc<T>>(rs.map(), As.map());
+		CHECK(C.nonZeros() == setCount(A.cwiseProduct(R)) && explicitZeros(C) == 0);
+		CHECK(exactError(Matrix<T>(C.toDense()), exact(R).cwiseProduct(exact(A))) < tol);
+		C = binaryOperator<timesFunc<T>>(As.map(), ss.map());
+		CHECK(C.nonZeros() == setCount(A) && exactError(Matrix<T>(C.toDense()), Matrix<qd_real>(exact(A) * 3.0)) < tol);
+		C = binaryOperator<timesFunc<T>>(zs.map(), As.map());
+		CHECK(C.nonZeros() == 0 && C.rows() == 9 && C.cols() == 7);
+
+		auto L = binaryOperator<andFunc<T>>(rs.map(), As.map());
+		CHECK(L.nonZeros() == setCount(A.cwiseProduct(R)) && explicitZeros(L) == 0);
+
+		C = binaryOperator<plusFunc<T>>(As.map(), rs.map());
+		CHECK(C.nonZeros() == setCount((A.array() != 0.0 || R.array() != 0.0).cast<double>().matrix()));
+		CHECK(exactError(Matrix<T>(C.toDense()), exact(A) + exact(R)) < tol);
+
+		// the union of an empty matrix, a single column and an all-zero pattern
+		Sparse<T> es(Matrix<double>::Zero(0, 7)), Zs(Matrix<double>::Zero(9, 7));
+		C = binaryOperator<plusFunc<T>>(es.map(), rs.map());
+		CHECK(C.rows() == 0 && C.cols() == 7 && C.nonZeros() == 0);
+		Matrix<double> a = randomDense(9, 1, 0.5), b = randomDense(9, 1, 0.5);
+		Sparse<T> as(a), bs(b);
+		C = binaryOperator<minusFunc<T>>(as.map(), bs.map());
+		CHECK(exactError(Matrix<T>(C.toDense()), exact(a) - exact(b)) < tol);
+		C = binaryOperator<plusFunc<T>>(Zs.map(), As.map());
+		CHECK(C.nonZeros() == As.X.nonZeros() && exactError(Matrix<T>(C.toDense()), exact(A)) < tol);
+		C = binaryOperator<plusFunc<T>>(Zs.map(), zs.map());
+		CHECK(C.nonZeros() == 0);
+
+		// broadcastSparseDense: a sparse row against a dense matrix, a sparse matrix against a dense row
+		auto Dd = dense<T>(randomDense(9, 7)), rd = dense<T>(row);
+		Matrix<double> D = Matrix<T>(Dd).unaryExpr([](const T& x) { return to_double(x); });
+		C = binaryOperator<timesFunc<T>>(rs.map(), Dd);
+		CHECK(C.nonZeros() == setCount(R) && exactError(Matrix<T>(C.toDense()), exact(R).cwiseProduct(exact(D))) < tol);
+		C = binaryOperator<timesFunc<T>>(Dd, As.map());
+		CHECK(C.nonZeros() == As.X.nonZeros() && exactError(Matrix<T>(C.toDense()), exact(D).cwiseProduct(exact(A))) < tol);
+		C = binaryOperator<timesFunc<T>>(As.map(), rd);
+		CHECK(exactError(Matrix<T>(C.toDense()), exact(A).cwiseProduct(exact(R))) < tol);
+		C = binaryOperator<timesFunc<T>>(zs.map(), Dd);
+		CHECK(C.nonZeros() == 0 && C.rows() == 9);
+		C = binaryOperator<timesFunc<T>>(es.map(), dense<T>(Matrix<double>::Zero(0, 7)));
+		CHECK(C.rows() == 0 && C.nonZeros() == 0);
+	}
+
+	// Dense results of a sparse and a dense operand in either order, without densifying the sparse one
+	template<typename T>
+	void testScatterSparseDense(double tol)
+	{
+		ScratchScope scratch;
+		Matrix<double> A = randomDense(9, 7, 0.4), D = randomDense(9, 7), row = randomDense(1, 7, 0.5);
+		Matrix<double> col = randomDense(9, 1, 0.5), Drow = randomDense(1, 7), zero = Matrix<double>::Zero(9, 7);
+		Sparse<T> As(A), rs(row), cs(col), Zs(zero);
+		auto Dd = dense<T>(D), Drd = dense<T>(Drow);
+		auto C = dense<T>(zero);
+
+		binaryOperator<minusFunc<T>>(As.map(), Dd, C);
+		CHECK(exactError(C, exact(A) - exact(D)) < tol);
+		binaryOperator<minusFunc<T>>(Dd, As.map(), C);
+		CHECK(exactError(C, exact(D) - exact(A)) < tol);
+		binaryOperator<minusFunc<T>>(rs.map(), Dd, C);
+		CHECK(exactError(C, exact(row.replicate(9, 1)) - exact(D)) < tol);
+		binaryOperator<minusFunc<T>>(Dd, cs.map(), C);
+		CHECK(exactError(C, exact(D) - exact(col.replicate(1, 7))) < tol);
+		binaryOperator<plusFunc<T>>(As.map(), Drd, C);
+		CHECK(exactError(C, exact(A) + exact(Drow.replicate(9, 1))) < tol);
+		binaryOperator<plusFunc<T>>(Zs.map(), Dd, C);
+		CHECK(exactError(C, exact(D)) < tol);
+
+		auto c = dense<T>(Matrix<double>::Zero(9, 1));
+		binaryOperator<minusFunc<T>>(cs.map(), dense<T>(D.col(0)), c);
+		CHECK(exactError(c, exact(col) - exact(D.col(0))) < tol);
+
+		Sparse<T> es(Matrix<double>::Zero(0, 7));
+		auto e = dense<T>(Matrix<double>::Zero(0, 7));
+		binaryOperator<plusFunc<T>>(es.map(), dense<T>(Matrix<double>::Zero(0, 7)), e);
+		CHECK(e.rows() == 0 && e.cols() == 7);
+	}
+
+	// sparseDenseProduct with a narrow B, which sums partial products over chunks of the columns of A,
+	// and its edge cases: a single column, an all-zero pattern and empty matrices. C starts with
+	// garbage, which the product must overwrite.
+	template<typename T>
+	void testNarrowProduct(double tol)
+	{
+		ScratchScope scratch;
+		auto product = [](const Matrix<double>& X, const Matrix<double>& Y) {
+			Sparse<T> Xs(X);
+			auto Yd = dense<T>(Y);
+			auto C = dense<T>(Matrix<double>::Ones(X.rows(), Y.cols()));
+			sparseDenseProduct<T>(Xs.map(), Yd, C);
+			return Matrix<T>(C);
+		};
+
+		Matrix<double> X = randomDense(200, 2000, 0.05);
+		for (Eigen::Index n : { 1, 3 })
+		{
+			Matrix<double> Y = randomDense(2000, n);
+			CHECK(exactError(product(X, Y), Matrix<qd_real>(Sparse<qd_real>(X).X * exact(Y))) < tol);
+		}
+
+		Matrix<double> x = randomDense(200, 1), y = randomDense(1, 3);
+		CHECK(exactError(product(x, y), exact(x) * exact(y)) < tol);
+		CHECK(exactError(product(Matrix<double>::Zero(200, 2000), randomDense(2000, 2)), exact(Matrix<double>::Zero(200, 2))) == 0.0);
+		CHECK(exactError(product(Matrix<double>::Zero(200, 0), Matrix<double>::Zero(0, 3)), exact(Matrix<double>::Zero(200, 3))) == 0.0);
+		CHECK(product(Matrix<double>::Zero(0, 2000), randomDense(2000, 1)).size() == 0);
+	}
+
+	// The Gustavson product over many columns, which splits them across threads, and its edge cases:
+	// an outer product of single columns, an all-zero pattern and empty matrices
+	template<typename T>
+	void testSparseProduct(double tol)
+	{
+		auto sorted = [](const SparseMatrix<T>& C) {
+			for (Eigen::Index j = 0; j < C.outerSize(); ++j)
+				if (!std::is_sorted(C.innerIndexPtr() + C.outerIndexPtr()[j], C.innerIndexPtr() + C.outerIndexPtr()[j + 1]))
+					return false;
+			return true;
+		};
+
+		Matrix<double> X = randomDense(150, 400, 0.05), Y = randomDense(400, 300, 0.05);
+		Sparse<T> Xs(X), Ys(Y);
+		SparseMatrix<T> C = sparseProduct(Xs.X, Ys.X);
+		SparseMatrix<qd_real> ref = Sparse<qd_real>(X).X * Sparse<qd_real>(Y).X;
+		CHECK(C.nonZeros() == ref.nonZeros() && sorted(C));
+		CHECK(exactError(Matrix<T>(C), Matrix<qd_real>(ref)) < tol);
+
+		Matrix<double> x = randomDense(9, 1, 0.5), y = randomDense(1, 7, 0.5);
+		C = sparseProduct(Sparse<T>(x).X, Sparse<T>(y).X);
+		CHECK(C.nonZeros() == Sparse<T>(x).X.nonZeros() * Sparse<T>(y).X.nonZeros() && sorted(C));
+		CHECK(exactError(Matrix<T>(C), exact(x) * exact(y)) < tol);
+
+		C = sparseProduct(Sparse<T>(Matrix<double>::Zero(150, 400)).X, Ys.X);
+		CHECK(C.rows() == 150 && C.cols() == 300 && C.nonZeros() == 0);
+		C = sparseProduct(Sparse<T>(Matrix<double>::Zero(9, 0)).X, Sparse<T>(Matrix<double>::Zero(0, 7)).X);
+		CHECK(C.rows() == 9 && C.cols() == 7 && C.nonZeros() == 0);
+		C = sparseProduct(Sparse<T>(Matrix<double>::Zero(0, 400)).X, Ys.X);
+		CHECK(C.rows() == 0 && C.cols() == 300 && C.nonZeros() == 0);
+	}
+
+	// The scratch arena: 32 byte aligned, disjoint allocations, a second block when the first is full,
+	// merged into one for the next round, and rewound by ScratchScope
+	void testScratchArena()
+	{
+		ScratchArena arena;
+		std::vector<std::pair<uint8_t*, size_t>> blocks;
+		bool aligned = true, disjoint = true;
+		for (size_t bytes : { size_t(1), size_t(0), size_t(100), size_t(3) << 19, size_t(40), size_t(1) << 20 })
+		{
+			auto p = (uint8_t*)arena.allocate(bytes);
+			aligned = aligned && (uintptr_t(p) % ScratchArena::kAlignment) == 0;
+			for (auto& b : blocks)
+				disjoint = disjoint && (p + bytes <= b.first || b.first + b.second <= p);
+			blocks.emplace_back(p, bytes);
+		}
+		CHECK(aligned && disjoint);
+		size_t used = arena.used, capacity = arena.capacity();
+		CHECK(used == 32 + 0 + 128 + (size_t(3) << 19) + 64 + (size_t(1) << 20));
+		CHECK(capacity > ScratchArena::kMinBlock);
+
+		arena.reset();
+		CHECK(arena.used == 0 && arena.capacity() == capacity);
+		uint8_t* first = (uint8_t*)arena.allocate(used);
+		CHECK(arena.capacity() == capacity && uintptr_t(first) % ScratchArena::kAlignment == 0);
+		arena.release();
+		CHECK(arena.capacity() == 0);
+
+		size_t before = scratchArena().used;
+		{
+			ScratchScope scratch;
+			auto X = scratchMatrix<qd_real>(0, 7);
+			auto Y = scratchMatrix<dd_real>(5, 3);
+			CHECK(X.size() == 0 && (void*)X.data() != (void*)Y.data() && uintptr_t(Y.data()) % ScratchArena::kAlignment == 0);
+			CHECK(scratchArena().used > before);
+		}
+		CHECK(scratchArena().used == 0);
+	}
+
+	// A with full row rank: an identity block and random columns
+	SparseMatrix<double> randomA(Eigen::Index m, Eigen::Index n)
+	{
+		Matrix<double> A = randomDense(m, n, 0.2);
+		A.leftCols(m) += Matrix<double>::Identity(m, m) * 4.0;
+		return A.sparseView();
+	}
+
+	SparseMatrix<double> randomW(Eigen::Index n)
+	{
+		SparseMatrix<double> W(n, n);
+		std::uniform_real_distribution<double> value(0.5, 2.0);
+		for (Eigen::Index i = 0; i < n; ++i)
+			W.insert(i, i) = value(rng);
+		W.makeCompressed();
+		return W;
+	}
+
+	template<typename CType>
+	void testAdaptiveChol(double tol)
+	{
+		auto A = randomA(30, 70);
+		auto W = randomW(70);
+		Matrix<double> H = Matrix<double>(A) * Matrix<double>(W) * Matrix<double>(A).transpose();
+		Matrix<double> b = randomDense(30, 1);
+		Matrix<double> x = H.ldlt().solve(b);
+
+		AdaptiveChol chol;
+		chol.initialize<double>(A, 1);
+		CHECK(chol.factorize<CType>(W, 0.0));
+		CHECK(chol.cholType == realTypeOf<CType>());
+
+		Matrix<double> y = chol.solve<double>(b, W, 3);
+		CHECK(maxError(y, x) < 1e-10);
+
+		Matrix<CType> d = chol.current<CType>().diagonal();
+		Matrix<double> Lref = H.llt().matrixL();
+		CHECK(maxError(d, Lref.diagonal()) < tol);
+
+		// E[sum of leverage scores] = rank = 30
+		Matrix<CType> u = chol.current<CType>().halfProj(200);
+		CHECK(u.rows() == 70 && u.cols() == 200);
+		double trace = 0.0;
+		for (Eigen::Index j = 0; j < u.cols(); ++j)
+			for (Eigen::Index i = 0; i < u.rows(); ++i)
+				trace += to_double(u(i, j) * u(i, j)) * W.coeff(i, i);
+		CHECK(std::abs(trace / u.cols() - 30.0) < 5.0);
+
+		// the same sketch with the factor rounded to double and float, also after a refactorization
+		auto& solver = chol.current<CType>();
+		for (int pass = 0; pass < 2 && realTypeOf<CType>() != floatType; ++pass)
+		{
+			solver.gen.seed(3);
+			Matrix<CType> full = solver.halfProj(8);
+			solver.gen.seed(3);
+			Matrix<double> sketch = solver.template halfProjIn<double>(8);
+			solver.gen.seed(3);
+			Matrix<double> sketchSingle = solver.template halfProjIn<float>(8).template cast<double>();
+			CHECK(maxError(full, sketch) < 1e-8);
+			CHECK(maxError(full, sketchSingle) < 1e-3);
+			CHECK(chol.factorize<CType>(SparseMatrix<double>((pass + 2.0) * W), 0.0));
+		}
+		CHECK(chol.factorize<CType>(W, 0.0));
+
+		// a serialized factor solves the same system in another object
+		ByteWriter out;
+		chol.serialize(out);
+		AdaptiveChol copy;
+		copy.initialize<double>(A, 2);
+		ByteReader in(out.bytes.data(), out.bytes.size());
+		CHECK(copy.deserialize(in) == realTypeOf<CType>());
+		CHECK(maxError(copy.solve<double>(b, W, 3), x) < 1e-10);
+
+		// and in place from a mapped file, which serializes back to the same bytes
+		std::string filename = "coreTestFactor.bin";
+		out.writeFile(filename);
+		{
+			AdaptiveChol mapped;
+			mapped.initialize<double>(A, 3);
+			std::unique_ptr<MappedBytes> file(new MappedBytes(std::unique_ptr<MappedFile>(new MappedFile(filename))));
+			ByteReader fileIn(file->data, file->size);
+			CHECK(mapped.deserialize(fileIn, std::move(file)) == realTypeOf<CType>());
+			CHECK(mapped.current<CType>().shared != nullptr);
+			CHECK(maxError(mapped.solve<double>(b, W, 3), x) < 1e-10);
+			ByteWriter again;
+			mapped.serialize(again);
+			CHECK(again.bytes == out.bytes);
+		}
+		std::remove(filename.c_str());
+	}
+
+	// The float tier of a dd_real A refines against that A, without a double solver
+	void testFloatRefinement()
+	{
+		auto A = randomA(30, 70);
+		auto W = randomW(70);
+		SparseMatrix<dd_real> Add = A.cast<dd_real>();
+		Matrix<double> b = randomDense(30, 1);
+		Matrix<qd_real> H = Matrix<qd_real>(A.cast<qd_real>()) * Matrix<qd_real>(W.cast<qd_real>()) * Matrix<qd_real>(A.cast<qd_real>()).transpose();
+		Matrix<qd_real> x = H.ldlt().solve(exact(b));
+
+		AdaptiveChol chol;
+		chol.initialize<dd_real>(Add, 1);
+		CHECK(chol.factorize<float>(W, 0.0));
+		Matrix<dd_real> y = chol.solve<dd_real>(b, W, 8);
+		CHECK(exactError(y, x) < 1e-20);
+		CHECK(!chol.solver_d);
+	}
+
+	// Every tier of factorizeShared publishes a segment, another object attaches to them, and
+	// unlinkShared or the destructor removes all of them
+	void testSharedFactor()
+	{
+		auto A = randomA(30, 70);
+		auto W = randomW(70);
+		std::vector<std::string> names;
+		{
+			AdaptiveChol chol, other;
+			chol.initialize<double>(A, 1);
+			other.initialize<double>(A, 2);
+			bool attached = true;
+			CHECK(chol.factorizeShared<double>(W, 0.25, attached) && !attached);
+			CHECK(chol.factorizeShared<dd_real>(W, 0.25, attached) && !attached);
+			CHECK(chol.factorizeShared<double>(W, 0.5, attached) && !attached);
+			names = chol.sharedNames;
+			CHECK(names.size() == 3 && SharedMemory::open(names[0]) && SharedMemory::open(names[1]));
+			CHECK(other.factorizeShared<dd_real>(W, 0.25, attached) && attached);
+			chol.unlinkShared();
+			CHECK(chol.sharedNames.empty() && !SharedMemory::open(names[0]) && !SharedMemory::open(names[2]));
+			CHECK(other.factorizeShared<double>(W, 0.25, attached) && !attached);
+		}
+		CHECK(!SharedMemory::open(names[0]) && !SharedMemory::open(names[1]));
+	}
+
+	// the packed dd_real and qd_real arrays of qd/simd.h against the scalar operators;
+	// 1003 elements run through full packets and the scalar tail
+	template<typename T>
+	void testPacked()
+	{
+		std::uniform_real_distribution<double> value(-1.0, 1.0);
+		std::uniform_int_distribution<int> scale(-30, 30);
+		size_t n = 1003;
+		std::vector<T> a(n), b(n), c(n);
+		for (size_t k = 0; k < n; ++k)
+		{
+			a[k] = (T(value(rng)) + T(value(rng)) * 1e-20) * std::ldexp(1.0, scale(rng));
+			b[k] = T(value(rng)) + T(value(rng)) * 1e-19;
+		}
+		a[0] = 0.0; a[1] = -1.0; b[2] = std::ldexp(1.0, -60); a[3] = b[3];
+
+		auto mismatches = [&](auto ref) {
+			int bad = 0;
+			for (size_t k = 0; k < n; ++k)
+			{
+				T r = ref(a[k], b[k]);
+				bool nan = std::isnan(to_double(r)) && std::isnan(to_double(c[k]));
+				bad += !(nan || abs(c[k] - r) <= 8.0 * std::numeric_limits<T>::epsilon() * abs(r));
+			}
+			return bad;
+		};
+
+		plusArray(a.data(), b.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return x + y; }) == 0);
+		minusArray(a.data(), b.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return x - y; }) == 0);
+		timesArray(a.data(), b.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return x * y; }) == 0);
+		rdivideArray(a.data(), b.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return x / y; }) == 0);
+		sqrtArray(a.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return sqrt(x); }) == 0);
+		CHECK(c[0] == 0.0 && std::isnan(to_double(c[1])));
+		rdivideArray(T(1.0), b.data(), c.data(), n);
+		CHECK(mismatches([](T x, T y) { return 1.0 / y; }) == 0);
+
+		// in place, as the dense binary operators may be called with C = A
+		std::vector<T> x = a;
+		timesArray(x.data(), b.data(), x.data(), n);
+		timesArray(a.data(), b.data(), c.data(), n);
+		CHECK(x == c);
+
+		ScratchScope scratch;
+		Matrix<double> A = randomDense(37, 5), B = randomDense(37, 5);
+		auto Ad = dense<T>(A), Bd = dense<T>(B);
+		auto C = dense<T>(Matrix<double>::Zero(37, 5));
+		binaryOperator<rdivideFunc<T>>(Ad, Bd, C);
+		CHECK(maxError(C, A.cwiseQuotient(B)) < 1e-14);
+		auto one = dense<T>(Matrix<double>::Ones(1, 1));
+		binaryOperator<rdivideFunc<T>>(one, Bd, C);
+		CHECK(maxError(C, B.cwiseInverse()) < 1e-14);
+	}
+
+	// td_real against qd_real, relative to the td epsilon
+	void testTriple()
+	{
+		auto tdError = [](const td_real& x, const qd_real& y) {
+			return to_double(abs(qd_real(x) - y) / abs(y)) / td_real::_eps;
+		};
+
+		std::uniform_real_distribution<double> value(0.5, 2.0);
+		double err = 0.0;
+		for (int k = 0; k < 100; ++k)
+		{
+			qd_real a = qd_real(value(rng)) / 3.0, b = qd_real(value(rng)) / 7.0;
+			td_real x(a), y(b);
+			qd_real p(x), q(y);
+			err = std::max(err, tdError(x + y, p + q));
+			err = std::max(err, tdError(x * y, p * q));
+			err = std::max(err, tdError(x / y, p / q));
+			err = std::max(err, tdError(sqrt(x), sqrt(p)));
+			err = std::max(err, tdError(exp(x), exp(p)));
+			err = std::max(err, tdError(log(x), log(p)));
+		}
+		CHECK(err < 4.0);
+
+		td_real third = td_real(1.0) / 3.0;
+		CHECK(dd_real(third) == dd_real(1.0) / 3.0);
+		CHECK(td_real(dd_real(1.0) / 3.0) != third);
+		CHECK(abs(accurateMul(third, td_real(3.0)) - 1.0) < 2 * td_real::_eps);
+	}
+
+	// qd/text.h: hex reads back the same bits, decimal within a few units in the last place
+	template<typename T>
+	void testText()
+	{
+		std::uniform_real_distribution<double> value(-1.0, 1.0);
+		std::uniform_int_distribution<int> scale(-1000, 1000);
+		size_t n = 500;
+		std::vector<T> a(n), b(n);
+		for (size_t k = 0; k < n; ++k)
+			a[k] = T(value(rng)) / 3.0 * std::ldexp(1.0, scale(rng));
+		a[0] = 0.0; a[1] = 1.0; a[2] = T(std::numeric_limits<double>::infinity());
+
+		using namespace qd::text;
+		int digits = default_digits<T>();
+		std::vector<char> text(n * (max_length<T>(hex, digits) + 1));
+		size_t length = write_n(a.data(), n, text.data(), hex, digits);
+		CHECK(read_n(text.data(), text.data() + length, b.data(), n) == n);
+		bool same = true;
+		for (size_t k = 0; k < n; ++k)
+			same = same && std::memcmp(&a[k], &b[k], sizeof(T)) == 0;
+		CHECK(same);
+
+		length = write_n(a.data(), n, text.data(), decimal, digits, ',');
+		CHECK(read_n(text.data(), text.data() + length, b.data(), n) == n);
+		double err = 0.0;
+		for (size_t k = 3; k < n; ++k)
+			err = std::max(err, to_double(abs((b[k] - a[k]) / a[k])) / std::numeric_limits<T>::epsilon());
+		CHECK(err < 4.0 && b[0] == 0.0 && b[1] == 1.0 && std::isinf(to_double(b[2])));
+
+		char s[128];
+		CHECK(std::string(s, write_decimal(T(-1.0) / 8.0, s, digits)) == "-1.25e-01");
+		CHECK(std::string(s, write_decimal(T(9.9996), s, 4)) == "1e+01");
+		CHECK(std::string(s, write_hex(T(0.75), s)) == "0x1.8p-1");
+
+		const char* list = " 1.5e3, -2.25;\n0x1p-3  NaN ";
+		T c[4];
+		const char* stop = nullptr;
+		CHECK(read_n(list, list + std::strlen(list), c, 4, &stop) == 4 && stop == list + std::strlen(list));
+		CHECK(c[0] == 1500.0 && c[1] == -2.25 && c[2] == 0.125 && std::isnan(to_double(c[3])));
+		const char* bad = "1.5x 2";
+		CHECK(read_n(bad, bad + 6, c, 2) == 0 && count(list, list + std::strlen(list)) == 4);
+	}
+
+	// qd/poly.h: Horner and Estrin agree, and the dd_real functions built on them against qd_real
+	void testPoly()
+	{
+		static_assert(qd_real::_log2.x[0] == dd_real::_log2.x[0] && td_real::_eps > qd_real::_eps,
+			"the constants are constexpr");
+
+		qd_real x = qd_real(1.0) / 17.0;
+		qd_real h = qd::poly::horner<12>(x, qd::poly::exp_series), e = qd::poly::estrin<12>(x, qd::poly::exp_series);
+		CHECK(to_double(abs(h - e)) < 4 * qd_real::_eps);
+		CHECK(abs(x * h - (exp(x) - 1.0)) < 1e-12 && qd::poly::horner<1>(x, qd::poly::cos_series) == 1.0);
+
+		std::uniform_real_distribution<double> value(-3.0, 3.0);
+		double err = 0.0;
+		for (int k = 0; k < 200; ++k)
+		{
+			double a = value(rng);
+			dd_real d = dd_real(a) / 3.0;
+			qd_real q = qd_real(a) / 3.0;
+			err = std::max(err, to_double(abs(qd_real(sin(d)) - sin(q))));
+			err = std::max(err, to_double(abs(qd_real(cos(d)) - cos(q))));
+			err = std::max(err, to_double(abs(qd_real(exp(d)) - exp(q)) / exp(q)));
+			err = std::max(err, to_double(abs(sqr(sin(q)) + sqr(cos(q)) - 1.0)) * dd_real::_eps / qd_real::_eps);
+		}
+		CHECK(err < 4 * dd_real::_eps);
+	}
+
+	// the Newton division, sqrt and rsqrt of qd_real against the long division, and packed
+	void testNewton()
+	{
+		std::uniform_real_distribution<double> value(0.5, 2.0);
+		std::uniform_int_distribution<int> scale(-100, 100);
+		double err = 0.0;
+		for (int k = 0; k < 200; ++k)
+		{
+			qd_real a = qd_real(value(rng)) / 3.0 * std::ldexp(1.0, scale(rng));
+			qd_real b = qd_real(value(rng)) / 7.0;
+			qd_real q = qd_real::accurate_div(a, b), s = sqrt(a), r = rsqrt(a);
+			err = std::max(err, to_double(abs(qd_real::sloppy_div(a, b) - q) / q));
+			err = std::max(err, to_double(abs(qd_real::accurate_mul(s, s) - a) / a));
+			err = std::max(err, to_double(abs(qd_real::accurate_mul(qd_real::accurate_mul(r, r), a) - 1.0)));
+		}
+		CHECK(err < 4 * qd_real::_eps);
+		CHECK(isinf(rsqrt(qd_real(0.0))) && sqrt(qd_real(4.0)) == 2.0 && rsqrt(qd_real(0.25)) == 2.0);
+
+		// a * dd_real, which the division uses for the remainder
+		qd_real p = qd_real(1.0) / 3.0;
+		dd_real d = dd_real(1.0) / 7.0;
+		CHECK(to_double(abs(p * d - p * qd_real(d))) < 4 * qd_real::_eps);
+
+		std::vector<qd_real> x(37), y(37);
+		for (size_t i = 0; i < x.size(); ++i)
+			x[i] = qd_real(value(rng)) / 3.0;
+		x[0] = 0.0;
+		qd::simd::qd_rsqrt_n(x.data(), y.data(), x.size());
+		bool same = isinf(y[0]);
+		for (size_t i = 1; i < x.size(); ++i)
+			same = same && abs(y[i] - rsqrt(x[i])) <= 8 * qd_real::_eps * y[i];
+		CHECK(same);
+
+		// Near the ends of the exponent range, against accurate_div and sqrt of the same numbers scaled
+		// into the middle of the range; the reciprocal of a subnormal divisor is Inf
+		CHECK(qd_real::sloppy_div(qd_real(3e-310), qd_real(1e-310)) == qd_real::accurate_div(qd_real(3e-310), qd_real(1e-310)));
+		CHECK(qd_real::sloppy_div(qd_real(std::ldexp(3.0, -1060)), qd_real(std::ldexp(1.0, -1060))) == 3.0);
+		std::vector<qd_real> a, b;
+		for (int e : { -1010, -960, 960, 1010 })
+			for (int k = 0; k < 4; ++k)
+			{
+				a.push_back(ldexp(qd_real(value(rng)) / 3.0, e + 2 * k));
+				b.push_back(ldexp(qd_real(value(rng)) / 7.0, e));
+			}
+		a.push_back(qd_real(1e-310));
+		b.push_back(qd_real(3e-310));
+		err = 0.0;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			int e = -2 * (std::ilogb(a[i][0]) / 2);
+			qd_real q = qd_real::accurate_div(ldexp(a[i], e), ldexp(b[i], e));
+			qd_real s = ldexp(sqrt(ldexp(a[i], e)), -e / 2), r = ldexp(rsqrt(ldexp(a[i], e)), e / 2);
+			err = std::max(err, to_double(abs(a[i] / b[i] - q) / q));
+			err = std::max(err, to_double(abs(sqrt(a[i]) - s) / s));
+			err = std::max(err, to_double(abs(rsqrt(a[i]) - r) / r));
+		}
+		CHECK(err < 4 * qd_real::_eps);
+
+		// The packed operations scale the same lanes, and give the same bits in the deterministic build
+		std::vector<qd_real> q(a.size()), s(a.size()), r(a.size());
+		qd::simd::qd_div_n(a.data(), b.data(), q.data(), a.size());
+		qd::simd::qd_sqrt_n(a.data(), s.data(), a.size());
+		qd::simd::qd_rsqrt_n(a.data(), r.data(), a.size());
+		auto bits = [](const qd_real& x, const qd_real& y) { return std::memcmp(&x, &y, sizeof(qd_real)) == 0; };
+		same = true;
+#ifdef QD_DETERMINISTIC
+		for (size_t i = 0; i < a.size(); ++i)
+			same = same && bits(q[i], a[i] / b[i]) && bits(s[i], sqrt(a[i])) && bits(r[i], rsqrt(a[i]));
+#else
+		// contracted into FMAs, the packed operations may differ from the scalar ones in the last bits
+		for (size_t i = 0; i < a.size(); ++i)
+			same = same && abs(q[i] - a[i] / b[i]) <= 8 * qd_real::_eps * abs(q[i]) && abs(s[i] - sqrt(a[i])) <= 8 * qd_real::_eps * s[i] &&
+				abs(r[i] - rsqrt(a[i])) <= 8 * qd_real::_eps * r[i];
+#endif
+		CHECK(same);
+
+		// Zero, subnormal, Inf and NaN divisors give the IEEE quotient of the leading components,
+		// in the packets and in the tail
+		const double inf = std::numeric_limits<double>::infinity(), nan = std::numeric_limits<double>::quiet_NaN();
+		std::vector<qd_real> num = { 1.0, -1.0, 0.0, 1.0, 1.0, -1.0, 1.0, 1e300, 1.0, inf, nan, 1.0, 1.0, -1.0, 0.0, 1.0, 1.0 };
+		std::vector<qd_real> den = { 0.0, 0.0, 0.0, -0.0, 4.9e-324, 1e-310, inf, 1e-300, nan, 2.0, 2.0, 0.0, 1e-310, -0.0, 0.0, 4.9e-324, -inf };
+		std::vector<qd_real> z(num.size());
+		qd::simd::qd_div_n(num.data(), den.data(), z.data(), num.size());
+		same = true;
+		for (size_t i = 0; i < num.size(); ++i)
+		{
+			double e = num[i][0] / den[i][0];
+			qd_real w = num[i] / den[i];
+			same = same && (bits(w, qd_real(e)) && bits(z[i], qd_real(e)));
+		}
+		CHECK(same);
+		CHECK(isinf(1.0 / qd_real(0.0)) && 1.0 / qd_real(-0.0) < 0.0 && isnan(qd_real(0.0) / qd_real(0.0)));
+		CHECK(isinf(qd_real(1.0) / qd_real(4.9e-324)) && isinf(1.0 / qd_real(1e-310)));
+	}
+
+	// The kernels give the same bits for any number of threads, so the deterministic build gives the same
+	// bits on any node: the products of every kind and an elementwise operator
+	template<typename T>
+	void testThreadIndependence()
+	{
+		Matrix<double> X = randomDense(120, 900, 0.05), D = randomDense(120, 900);
+		Matrix<double> x = randomDense(900, 1), Y = randomDense(900, 3), Z = randomDense(900, 40, 0.3);
+		int saved = maxThreads();
+		std::vector<std::vector<T>> runs;
+		for (int threads : { 1, 5 })
+		{
+			setMaxThreads(threads);
+			ScratchScope scratch;
+			Sparse<T> Xs(X), Zs(Z);
+			auto Dd = dense<T>(D), xd = dense<T>(x), Yd = dense<T>(Y), Zd = dense<T>(Z);
+			auto c = dense<T>(Matrix<double>::Zero(120, 1));
+			auto C = dense<T>(Matrix<double>::Zero(120, 3));
+			auto W = dense<T>(Matrix<double>::Zero(120, 40));
+			auto E = dense<T>(Matrix<double>::Zero(120, 900));
+			std::vector<T> out;
+			auto keep = [&](const auto& M) { out.insert(out.end(), M.data(), M.data() + M.size()); };
+			sparseDenseProduct<T>(Xs.map(), Yd, C);
+			keep(C);
+			sparseDenseProduct<T>(Xs.map(), Zd, W);
+			keep(W);
+			denseProduct<T>(Dd, xd, c);
+			keep(c);
+			denseProduct<T>(Dd, Zd, W);
+			keep(W);
+			denseSparseProduct<T>(Dd, Zs.map(), W);
+			keep(W);
+			keep(Matrix<T>(sparseProduct(Xs.map(), Zs.map()).toDense()));
+			binaryOperator<timesFunc<T>>(Dd, Dd, E);
+			keep(E);
+			runs.push_back(out);
+		}
+		setMaxThreads(saved);
+		CHECK(runs[0].size() == runs[1].size() &&
+			std::memcmp(runs[0].data(), runs[1].data(), runs[0].size() * sizeof(T)) == 0);
+	}
+
+	// qd/self_check.h and qd::fpu_guard: fails if this test is built with -ffast-math
+	void testSelfCheck()
+	{
+		unsigned failed = qd::self_check();
+		CHECK((failed & qd::check_exact) == 0);
+#ifdef QD_DETERMINISTIC
+		CHECK(failed == 0);
+#endif
+		CHECK(qd::check_names(qd::check_two_sum | qd::check_packed) == "two_sum, packed");
+		checkArithmetic();
+
+#if defined(__SSE2__) || defined(_M_X64)
+		// flush-to-zero and denormals-are-zero, as left by a library built with -ffast-math: the guard
+		// clears them and restores them on exit
+		unsigned csr = _mm_getcsr(), ftz = csr | 0x8040;
+		_mm_setcsr(ftz);
+		CHECK(qd::self_check() & qd::check_denormals);
+		{
+			qd::fpu_guard fpu;
+			CHECK((qd::self_check() & qd::check_exact) == 0);
+		}
+		CHECK(_mm_getcsr() == ftz);
+		_mm_setcsr(csr);
+#endif
+	}
+
+	struct alignas(64) CacheLine { uint8_t bytes[64]; };
+
+	// a copy of blob on a 64-byte boundary, as a mapped file is; std::vector<uint8_t> only promises 16 bytes,
+	// which is not enough for the maps of MatrixFile
+	std::vector<CacheLine> alignedCopy(const ByteWriter& blob)
+	{
+		std::vector<CacheLine> lines((blob.bytes.size() + 63) / 64);
+		std::memcpy(lines.data(), blob.bytes.data(), blob.bytes.size());
+		return lines;
+	}
+
+	// matrixFile.h: raw chunks in place, compressed chunks, lower precisions and corruption
+	void testMatrixFile()
+	{
+		Matrix<double> D = randomDense(37, 29, 0.3);
+		Matrix<qd_real> Q = D.unaryExpr([](double x) { return qd_real(x) / 3.0; });
+		MatrixFileOptions options;
+		options.chunkBytes = 37 * 4 * sizeof(qd_real);
+
+		auto blob = matrixFileBlob(Q, options);
+		auto rawLines = alignedCopy(blob);
+		MatrixFile raw(rawLines.data()->bytes, blob.bytes.size());
+		CHECK(raw.header().chunks == 8 && raw.inPlace());
+		CHECK((raw.denseMap<qd_real>().array() == Q.array()).all());
+		raw.verify();
+
+		// values converted from double have zero trailing components and compress
+		Matrix<dd_real> E = D.cast<dd_real>();
+		options.compress = true;
+		auto packed = matrixFileBlob(E, options);
+		MatrixFile small(packed.bytes.data(), packed.bytes.size());
+		CHECK(!small.inPlace() && packed.bytes.size() < E.size() * sizeof(dd_real) / 2);
+		CHECK((small.readDense<dd_real>().array() == E.array()).all());
+		CHECK((small.readDense<qd_real>().array() == D.cast<qd_real>().array()).all());
+
+		auto plain = matrixFileBlob(D);
+		CHECK((MatrixFile(plain.bytes.data(), plain.bytes.size()).readDense<td_real>().array() == D.cast<td_real>().array()).all());
+		bool threw = false;
+		try { raw.readDense<dd_real>(); } catch (const std::exception&) { threw = true; }
+		CHECK(threw);
+
+		SparseMatrix<dd_real> S = E.sparseView();
+		S.makeCompressed();
+		for (bool compress : { false, true })
+		{
+			options.compress = compress;
+			options.chunkBytes = 64;
+			auto sblob = matrixFileBlob(S, options);
+			auto lines = alignedCopy(sblob);
+			MatrixFile file(lines.data()->bytes, sblob.bytes.size());
+			SparseMatrix<dd_real> T = file.readSparse<dd_real>();
+			CHECK(file.inPlace() != compress && file.header().nnz == S.nonZeros());
+			CHECK(Matrix<dd_real>(T) == Matrix<dd_real>(S));
+			if (!compress)
+				CHECK(Matrix<dd_real>(file.sparseMap<dd_real>()) == Matrix<dd_real>(S));
+		}
+
+		// a flipped byte is caught by the hashes
+		blob.bytes[blob.bytes.size() - 40] ^= 1;
+		packed.bytes[packed.bytes.size() - 40] ^= 1;
+		threw = false;
+		try { MatrixFile(blob.bytes.data(), blob.bytes.size()).verify(); } catch (const std::exception&) { threw = true; }
+		CHECK(threw);
+		threw = false;
+		try { MatrixFile(packed.bytes.data(), packed.bytes.size()).readDense<dd_real>(); } catch (const std::exception&) { threw = true; }
+		CHECK(threw);
+
+		// through a memory-mapped file
+		std::string filename = "coreTestMatrix.cmtx";
+		writeMatrixFile(filename, S);
+		{
+			MatrixFile file(filename);
+			CHECK(Matrix<dd_real>(file.sparseMap<dd_real>()) == Matrix<dd_real>(S));
+		}
+		std::remove(filename.c_str());
+	}
+
+	// the sloppy and accurate policies of arithmetic.h against the qd library, and in the kernels
+	void testArithmetic()
+	{
+		dd_real x = dd_real(1.0) + 1e-20, y = dd_real(-1.0) + 3e-21;
+		CHECK(AccurateArithmetic::add(x, y) == dd_real::ieee_add(x, y));
+		CHECK(SloppyArithmetic::add(x, y) == dd_real::sloppy_add(x, y));
+		CHECK(AccurateArithmetic::sub(x, y) == dd_real::ieee_add(x, -y));
+		CHECK(AccurateArithmetic::div(x, y) == dd_real::accurate_div(x, y));
+
+		qd_real p = qd_real(2.0) / 3.0, q = qd_real(1.0) / 7.0;
+		CHECK(AccurateArithmetic::add(p, q) == qd_real::ieee_add(p, q));
+		CHECK(AccurateArithmetic::mul(p, q) == qd_real::accurate_mul(p, q));
+		CHECK(SloppyArithmetic::mul(p, q) == qd_real::sloppy_mul(p, q));
+		CHECK(AccurateArithmetic::div(p, q) == qd_real::accurate_div(p, q));
+		CHECK(AccurateArithmetic::add(1.5, 2.0) == 3.5);
+
+		bool threw = false;
+		try { arithmeticMode("exact"); } catch (const std::exception&) { threw = true; }
+		CHECK(threw && arithmeticMode("accurate") == kAccurateArithmetic);
+
+		ScratchScope scratch;
+		Matrix<double> A = randomDense(37, 5), B = randomDense(37, 5);
+		auto Aq = dense<qd_real>(A), Bq = dense<qd_real>(B);
+		auto C = dense<qd_real>(Matrix<double>::Zero(37, 5));
+		binaryOperator<minusFunc<qd_real, AccurateArithmetic>>(Aq, Bq, C);
+		CHECK(maxError(C, A - B) < 1e-15);
+		binaryOperator<rdivideFunc<qd_real, SloppyArithmetic>>(Aq, Bq, C);
+		CHECK(maxError(C, A.cwiseQuotient(B)) < 1e-14);
+
+		// accurate residuals in the refinement of a dd_real solve
+		auto As = randomA(30, 70);
+		auto W = randomW(70);
+		Matrix<double> H = Matrix<double>(As) * Matrix<double>(W) * Matrix<double>(As).transpose();
+		Matrix<double> b = randomDense(30, 1);
+		AdaptiveChol chol;
+		chol.initialize<double>(As, 1);
+		CHECK(chol.factorize<dd_real>(W, 0.0));
+		CHECK(maxError(chol.solve<double, AccurateArithmetic>(b, W, 3), H.ldlt().solve(b)) < 1e-10);
+		CHECK(maxError(chol.solve<double, SloppyArithmetic>(b, W, 3), H.ldlt().solve(b)) < 1e-10);
+	}
+
+	// double and dd_real factorizations of the same object in the background
+	void testAsync()
+	{
+		auto A = randomA(30, 70);
+		auto W = randomW(70);
+		Matrix<double> H = Matrix<double>(A) * Matrix<double>(W) * Matrix<double>(A).transpose();
+		Matrix<double> b = randomDense(30, 1);
+		Matrix<double> x = H.ldlt().solve(b);
+
+		AdaptiveChol chol;
+		chol.initialize<double>(A, 1);
+		chol.profiler.enabled = true;
+		chol.factorizeAsync<double>(W, 0.0);
+		chol.factorizeAsync<dd_real>(SparseMatrix<dd_real>(W.cast<dd_real>()), 0.0);
+
+		CHECK(chol.wait(doubleType));
+		CHECK(chol.cholType == doubleType);
+		CHECK(maxError(chol.solve<double>(b, W, 2), x) < 1e-10);
+
+		CHECK(chol.wait(dd_realType));
+		CHECK(chol.cholType == dd_realType);
+		CHECK(maxError(chol.solve<double>(b, W, 2), x) < 1e-10);
+		CHECK(chol.profiler.records.size() >= 6);
+
+		bool threw = false;
+		try { chol.wait(dd_realType); } catch (const std::exception&) { threw = true; }
+		CHECK(threw);
+
+		// release and setMatrixFree wait for a pending factorization before freeing its solver
+		chol.factorizeAsync<qd_real>(W, 0.0);
+		chol.release();
+		CHECK(!chol.solver_qd);
+		threw = false;
+		try { chol.wait(qd_realType); } catch (const std::exception&) { threw = true; }
+		CHECK(threw);
+		chol.factorizeAsync<double>(W, 0.0);
+		MatrixFreeOptions options;
+		options.enabled = true;
+		chol.setMatrixFree(options);
+		CHECK(chol.solver_d && chol.solver_d->pcg.enabled);
+
+		// a pending factorization is finished before the object goes away
+		chol.factorizeAsync<qd_real>(W, 0.0);
+	}
+
+	// sparseDenseProduct with a narrow B sums partial products of column chunks of A: the same bits for
+	// any number of threads
+	void testThreadCount()
+	{
+		ScratchScope scratch;
+		Matrix<double> X = randomDense(300, 3000, 0.05), Y = randomDense(3000, 2);
+		Sparse<dd_real> Xs(X);
+		auto Yd = dense<dd_real>(Y);
+		int saved = maxThreads();
+
+		std::vector<Matrix<dd_real>> results;
+		for (int threads : { 1, 2, 3, 8 })
+		{
+			setMaxThreads(threads);
+			auto C = dense<dd_real>(Matrix<double>::Zero(300, 2));
+			sparseDenseProduct<dd_real>(Xs.map(), Yd, C);
+			results.push_back(C);
+		}
+		setMaxThreads(saved);
+
+		for (size_t r = 1; r < results.size(); ++r)
+			CHECK(std::memcmp(results[r].data(), results[0].data(), results[0].size() * sizeof(dd_real)) == 0);
+
+		double err = 0.0;
+		for (Eigen::Index j = 0; j < 2; ++j)
+			for (Eigen::Index i = 0; i < 300; ++i)
+			{
+				qd_real sum = 0.0;
+				for (Eigen::Index k = 0; k < 3000; ++k)
+					sum += qd_real(X(i, k)) * Y(k, j);
+				err = std::max(err, to_double(abs(qd_real(results[0](i, j)) - sum)));
+			}
+		CHECK(err < 1e-28);
+	}
+
+	// independent objects and scratch arenas in concurrent threads
+	void testThreads()
+	{
+		auto A = randomA(40, 90);
+		auto W = randomW(90);
+		Matrix<double> b = randomDense(40, 1);
+		Matrix<double> H = Matrix<double>(A) * Matrix<double>(W) * Matrix<double>(A).transpose();
+		Matrix<double> x = H.ldlt().solve(b);
+		Matrix<double> P = randomDense(50, 40, 0.3), Q = randomDense(50, 40, 0.3);
+
+		std::vector<double> errors(4, INFINITY);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+			threads.emplace_back([&, t] {
+				for (int rep = 0; rep < 5; ++rep)
+				{
+					AdaptiveChol chol;
+					chol.initialize<double>(A, t);
+					chol.factorize<dd_real>(W, 0.0);
+					double err = maxError(chol.solve<double>(b, W, 2), x);
+
+					ScratchScope scratch;
+					Sparse<double> Ps(P), Qs(Q);
+					Matrix<double> C = binaryOperator<plusFunc<double>>(Ps.map(), Qs.map()).toDense();
+					err = std::max(err, maxError(C, P + Q));
+					errors[t] = (rep == 0) ? err : std::max(errors[t], err);
+				}
+			});
+		for (auto& thread : threads)
+			thread.join();
+
+		for (double err : errors)
+			CHECK(err < 1e-10);
+	}
+}
+
+int main()
+{
+	try
+	{
+		testOperators<double>(1e-14);
+		testOperators<dd_real>(1e-30);
+		testOperators<td_real>(1e-45);
+		testOperators<qd_real>(1e-60);
+		testSparseBroadcast<double>(1e-14);
+		testSparseBroadcast<dd_real>(1e-30);
+		testSparseBroadcast<qd_real>(1e-60);
+		testScatterSparseDense<double>(1e-14);
+		testScatterSparseDense<dd_real>(1e-30);
+		testScatterSparseDense<qd_real>(1e-60);
+		testNarrowProduct<double>(1e-13);
+		testNarrowProduct<dd_real>(1e-29);
+		testNarrowProduct<qd_real>(1e-59);
+		testSparseProduct<double>(1e-14);
+		testSparseProduct<dd_real>(1e-30);
+		testSparseProduct<qd_real>(1e-60);
+		testScratchArena();
+		testPacked<dd_real>();
+		testPacked<qd_real>();
+		testTriple();
+		testText<dd_real>();
+		testText<td_real>();
+		testText<qd_real>();
+		testPoly();
+		testNewton();
+		testMatrixFile();
+		testSelfCheck();
+		testThreadIndependence<dd_real>();
+		testThreadIndependence<qd_real>();
+		testArithmetic();
+		testAdaptiveChol<float>(1e-5);
+		testAdaptiveChol<double>(1e-12);
+		testAdaptiveChol<dd_real>(1e-12);
+		testAdaptiveChol<td_real>(1e-12);
+		testAdaptiveChol<qd_real>(1e-12);
+		testFloatRefinement();
+#if !defined(_WIN32)
+		testSharedFactor();
+#endif
+		testAsync();
+		testThreadCount();
+		testThreads();
+	}
+	catch (const std::exception& e)
+	{
+		std::printf("FAIL exception: %s\n", e.what());
+		++failures;
+	}
+
+	std::printf("%s (%d failures, %d checks)\n", failures ? "FAILED" : "OK", failures, checks);
+	return failures ? 1 : 0;
+}
@@ -6,6 +6,6 @@ import matlab.unittest.plugins.TestReportPlugin
 clc;
 suite = TestSuite.fromFile('coverage/CMatrixTest.m');
 runner = TestRunner.withTextOutput;
-runner.addPlugin(CodeCoveragePlugin.forFile({'include/ddouble.m', 'include/AdaptiveChol.m'}))
+runner.addPlugin(CodeCoveragePlugin.forFile({'include/ddouble.m', 'include/tdouble.m', 'include/AdaptiveChol.m'}))
 result = runner.run(suite);
 
@@ -0,0 +1,271 @@
+#pragma once
+#include <type_traits>
+#include <vector>
+
+#include <qd/dd_real.h>
+
+#include "CMatrixCore.h"
+#include "parallel.h"
+
+// Products with a dense output for the multiword types (dd_real, qd_real). Eigen
+// has no packet math for them and falls back to its scalar kernels, so here the
+// kernels are blocked for the cache, tiled for registers and split across threads.
+// They write into a caller-provided column-major C, e.g. the output mxArray.
+// Arithmetic types still use Eigen's products.
+template<typename T>
+struct GemmBlocking
+{
+	static const int MR = sizeof(T) > 16 ? 2 : 4;  // rows of the register tile
+	static const int NR = 4;                       // columns of the register tile
+	static const int KC = 128;                     // depth of a cache block
+	static const int MC = 64;                      // rows of a cache block
+};
+
+// acc += a * b
+template<typename T>
+inline void multiplyAdd(T& acc, const T& a, const T& b)
+{
+	acc += a * b;
+}
+
+// dd_real product and sloppy sum fused, with a single renormalization at the end
+template<>
+inline void multiplyAdd(dd_real& acc, const dd_real& a, const dd_real& b)
+{
+	double p1, p2, s, e;
+	p1 = qd::two_prod(a.x[0], b.x[0], p2);
+	p2 += (a.x[0] * b.x[1] + a.x[1] * b.x[0]);
+	s = qd::two_sum(acc.x[0], p1, e);
+	e += acc.x[1] + p2;
+	acc.x[0] = qd::quick_two_sum(s, e, acc.x[1]);
+}
+
+// C(i:i+mr, j:j+nr) += A(i:i+mr, k0:k1) * B(k0:k1, j:j+nr) with mr <= MR and nr <= NR
+template<typename T, int MR, int NR, bool Full>
+inline void gemmTile(Eigen::Index mr, Eigen::Index nr, Eigen::Index k0, Eigen::Index k1,
+	const T* A, Eigen::Index lda, const T* B, Eigen::Index ldb, T* C, Eigen::Index ldc)
+{
+	const Eigen::Index rows = Full ? MR : mr, cols = Full ? NR : nr;
+
+	T acc[MR][NR];
+	for (Eigen::Index c = 0; c < cols; ++c)
+		for (Eigen::Index r = 0; r < rows; ++r)
+			acc[r][c] = C[r + c * ldc];
+
+	for (Eigen::Index p = k0; p < k1; ++p)
+	{
+		T a[MR], b[NR];
+		for (Eigen::Index r = 0; r < rows; ++r)
+			a[r] = A[r + p * lda];
+		for (Eigen::Index c = 0; c < cols; ++c)
+			b[c] = B[p + c * ldb];
+		for (Eigen::Index c = 0; c < cols; ++c)
+			for (Eigen::Index r = 0; r < rows; ++r)
+				multiplyAdd(acc[r][c], a[r], b[c]);
+	}
+
+	for (Eigen::Index c = 0; c < cols; ++c)
+		for (Eigen::Index r = 0; r < rows; ++r)
+			C[r + c * ldc] = acc[r][c];
+}
+
+// C = A * B for column-major A (m x k), B (k x n) and C (m x n)
+template<typename T>
+void gemm(Eigen::Index m, Eigen::Index n, Eigen::Index k,
+	const T* A, Eigen::Index lda, const T* B, Eigen::Index ldb, T* C, Eigen::Index ldc)
+{
+	using Index = Eigen::Index;
+	using Blocking = GemmBlocking<T>;
+	const int MR = Blocking::MR, NR = Blocking::NR;
+
+	// enough panels per thread that each one does a few thousand multiply-adds
+	Index panels = (n + NR - 1) / NR;
+	Index grain = std::max<Index>(1, 4096 / std::max<Index>(1, m * k));
+	parallelFor<Index>(0, panels, grain, [&](Index first, Index last) {
+		for (Index j = first * NR; j < std::min<Index>(last * NR, n); ++j)
+			for (Index i = 0; i < m; ++i)
+				C[i + j * ldc] = T(0.0);
+
+		for (Index k0 = 0; k0 < k; k0 += Blocking::KC)
+		{
+			Index k1 = std::min<Index>(k0 + Blocking::KC, k);
+			for (Index i0 = 0; i0 < m; i0 += Blocking::MC)
+			{
+				Index i1 = std::min<Index>(i0 + Blocking::MC, m);
+				for (Index panel = first; panel < last; ++panel)
+				{
+					Index j = panel * NR, nr = std::min<Index>(NR, n - j);
+					for (Index i = i0; i < i1; i += MR)
+					{
+						Index mr = std::min<Index>(MR, i1 - i);
+						if (mr == MR && nr == NR)
+							gemmTile<T, MR, NR, true>(mr, nr, k0, k1, A + i, lda, B + j * ldb, ldb, C + i + j * ldc, ldc);
+						else
+							gemmTile<T, MR, NR, false>(mr, nr, k0, k1, A + i, lda, B + j * ldb, ldb, C + i + j * ldc, ldc);
+					}
+				}
+			}
+		}
+	});
+}
+
+// y = A * x for column-major A (m x k), with the rows of y split across threads
+template<typename T>
+void gemv(Eigen::Index m, Eigen::Index k, const T* A, Eigen::Index lda, const T* x, T* y)
+{
+	using Index = Eigen::Index;
+	const Index MC = 256, KC = GemmBlocking<T>::KC;
+
+	Index grain = std::max<Index>(MC, 4096 / std::max<Index>(1, k));
+	parallelFor<Index>(0, m, grain, [&](Index first, Index last) {
+		for (Index i = first; i < last; ++i)
+			y[i] = T(0.0);
+
+		for (Index i0 = first; i0 < last; i0 += MC)
+		{
+			Index i1 = std::min<Index>(i0 + MC, last);
+			for (Index k0 = 0; k0 < k; k0 += KC)
+			{
+				Index k1 = std::min<Index>(k0 + KC, k);
+				for (Index p = k0; p < k1; ++p)
+				{
+					const T xp = x[p];
+					const T* Ap = A + p * lda;
+					for (Index i = i0; i < i1; ++i)
+						multiplyAdd(y[i], Ap[i], xp);
+				}
+			}
+		}
+	});
+}
+
+// C = A * B for dense A and B
+template<typename T>
+void denseProduct(Eigen::Ref<const Matrix<T>> A, Eigen::Ref<const Matrix<T>> B, Map<T> C)
+{
+	if (std::is_arithmetic<T>::value)
+		C.noalias() = A * B;
+	else if (B.cols() == 1)
+		gemv<T>(A.rows(), A.cols(), A.data(), A.outerStride(), B.data(), C.data());
+	else
+		gemm<T>(A.rows(), B.cols(), A.cols(), A.data(), A.outerStride(), B.data(), B.outerStride(), C.data(), C.rows());
+}
+
+// C = A * B for dense A and sparse B: C(:, j) = sum_p A(:, Bi[p]) * Bx[p], with columns split across threads
+template<typename T>
+void denseSparseProduct(Eigen::Ref<const Matrix<T>> A, const SparseMap<T>& B, Map<T> C)
+{
+	if (std::is_arithmetic<T>::value)
+	{
+		C.noalias() = A * B;
+		return;
+	}
+
+	using Index = Eigen::Index;
+	Index m = A.rows(), n = B.cols(), lda = A.outerStride();
+	auto Bi = B.innerIndexPtr(), Bj = B.outerIndexPtr();
+	auto Bx = B.valuePtr();
+
+	Index grain = std::max<Index>(1, 4096 * n / std::max<Index>(1, m * B.nonZeros()));
+	parallelFor<Index>(0, n, grain, [&](Index first, Index last) {
+		for (Index j = first; j < last; ++j)
+		{
+			T* Cj = C.data() + j * m;
+			for (Index i = 0; i < m; ++i)
+				Cj[i] = T(0.0);
+			for (auto p = Bj[j]; p < Bj[j + 1]; ++p)
+			{
+				const T* Ak = A.data() + Bi[p] * lda;
+				const T b = Bx[p];
+				for (Index i = 0; i < m; ++i)
+					multiplyAdd(Cj[i], Ak[i], b);
+			}
+		}
+	});
+}
+
+// C(:, j0:j1) = A * B(:, j0:j1) for sparse A (CSC) by streaming A once per block of NR columns
+template<typename T>
+void sparseDenseColumns(const SparseMap<T>& A, Eigen::Ref<const Matrix<T>> B, T* C, Eigen::Index ldc,
+	Eigen::Index k0, Eigen::Index k1, Eigen::Index j0, Eigen::Index j1)
+{
+	using Index = Eigen::Index;
+	const int NR = GemmBlocking<T>::NR;
+	auto Ai = A.innerIndexPtr(), Aj = A.outerIndexPtr();
+	auto Ax = A.valuePtr();
+
+	for (Index jb = j0; jb < j1; jb += NR)
+	{
+		Index nr = std::min<Index>(NR, j1 - jb);
+		for (Index kk = k0; kk < k1; ++kk)
+		{
+			T b[NR];
+			bool zero = true;
+			for (Index c = 0; c < nr; ++c)
+			{
+				b[c] = B(kk, jb + c);
+				zero = zero && b[c] == 0.0;
+			}
+			if (zero)
+				continue;
+
+			for (auto p = Aj[kk]; p < Aj[kk + 1]; ++p)
+			{
+				T* Ci = C + Ai[p] + jb * ldc;
+				const T a = Ax[p];
+				for (Index c = 0; c < nr; ++c)
+					multiplyAdd(Ci[c * ldc], a, b[c]);
+			}
+		}
+	}
+}
+
+// C = A * B for sparse A and dense B. Wide B is split by column blocks across threads.
+// Narrow B (e.g. A * x) is split by the columns of A into partial sums that are added up
+// afterwards in chunk order. The number of chunks only depends on the size of the problem,
+// so the result is the same for any number of threads.
+template<typename T>
+void sparseDenseProduct(const SparseMap<T>& A, Eigen::Ref<const Matrix<T>> B, Map<T> C)
+{
+	if (std::is_arithmetic<T>::value)
+	{
+		C.noalias() = A * B;
+		return;
+	}
+
+	using Index = Eigen::Index;
+	const int NR = GemmBlocking<T>::NR;
+	const Index maxChunks = 16;
+	Index m = A.rows(), k = A.cols(), n = B.cols();
+	double work = double(A.nonZeros()) * double(n);
+	Index chunks = std::min<Index>(maxChunks, std::min<Index>(k, Index(work / 16384.0)) + 1);
+
+	if (chunks <= 1 || n >= chunks * NR)
+	{
+		C.setZero();
+		Index blocks = (n + NR - 1) / NR;
+		parallelFor<Index>(0, blocks, std::max<Index>(1, blocks / chunks), [&](Index first, Index last) {
+			sparseDenseColumns<T>(A, B, C.data(), m, 0, k, first * NR, std::min<Index>(last * NR, n));
+		});
+		return;
+	}
+
+	std::vector<Matrix<T>> partial(chunks);
+	parallelFor<Index>(0, chunks, 1, [&](Index first, Index last) {
+		for (Index t = first; t < last; ++t)
+		{
+			partial[t] = Matrix<T>::Zero(m, n);
+			sparseDenseColumns<T>(A, B, partial[t].data(), m, k * t / chunks, k * (t + 1) / chunks, 0, n);
+		}
+	});
+	parallelFor<Index>(0, m, 1024, [&](Index first, Index last) {
+		for (Index j = 0; j < n; ++j)
+			for (Index i = first; i < last; ++i)
+			{
+				T sum = partial[0](i, j);
+				for (Index t = 1; t < chunks; ++t)
+					sum += partial[t](i, j);
+				C(i, j) = sum;
+			}
+	});
+}
@@ -18,20 +18,51 @@ classdef AdaptiveChol < handle
       A
       w = NaN
       cholTol = 1e-4
+      releaseFactors = false % free higher precision factors once a lower one is accurate
+      sharedFactor = false % share factors between processes on this host (see factorize)
+      singlePrecision = false % try a single precision factor (refined in double) before double
+      tripleDouble = true % try a tdouble factor between ddouble and qdouble
+      overlapFactorize = false % factorize in ddouble in the background while double is checked (see factorize)
+      accurateResidual = false % refinement residuals of solve in the accurate qd arithmetic
+      sketchPrecision = 'factor' % precision of the random sketch of leverageScore: 'factor', 'double' or 'single'
+      
+      % solve by PCG without forming the Cholesky factor (see useMatrixFree)
+      matrixFree = false
+      pcgOptions = struct('tol', 1e-10, 'maxIter', 500, 'dropTol', 0.0)
       
       % private
       uid
-      lastChol = 0; % 1 = double, 2 = ddouble, 3 = qdouble
+      lastChol = 0; % 1 = double, 2 = ddouble, 3 = qdouble, 4 = single, 5 = tdouble
    end
    
    methods (Static)
       function o = loadobj(s)
-         s.uid = AdaptiveChol.mex('new', uint64(randi(2^32-1,'uint32')), s.A);
-         if ~any(isnan(s.w))
-            w = s.w; s.w = NaN;
-            s.factorize(w);
+         if isstruct(s)
+            o = AdaptiveChol(s.A, s.cholTol);
+            o.releaseFactors = s.releaseFactors;
+            if s.matrixFree
+               o.useMatrixFree(true, s.pcgOptions);
+            end
+            if ~isempty(s.factor)
+               % restore the saved factor instead of factorizing again
+               o.lastChol = AdaptiveChol.mex('deserialize', o.uid, s.factor);
+               o.w = s.w;
+               return
+            end
+         else
+            o = s;
+            A = o.A;
+            if isobject(A), A = A.x; end
+            o.uid = AdaptiveChol.mex('new', uint64(randi(2^32-1,'uint32')), A);
+            if o.matrixFree
+               o.useMatrixFree(true, o.pcgOptions);
+            end
+         end
+         w = s.w;
+         if ~any(isnan(w))
+            o.w = NaN;
+            o.factorize(w);
          end
-         o = s;
       end
    end
    
@@ -45,9 +76,28 @@ classdef AdaptiveChol < handle
          o.uid = AdaptiveChol.mex('new', uint64(randi(2^32-1,'uint32')), A);
       end
       
-      function b = saveobj(a)
-         b = a;
-         b.uid = [];
+      function s = saveobj(o)
+         s = struct('A', {o.A}, 'w', {o.w}, 'cholTol', o.cholTol, ...
+            'releaseFactors', o.releaseFactors, 'matrixFree', o.matrixFree, ...
+            'pcgOptions', o.pcgOptions, 'factor', []);
+         if o.lastChol && ~o.matrixFree
+            s.factor = AdaptiveChol.mex('serialize', o.uid);
+         end
+      end
+      
+      function saveFactor(o, filename)
+         % write the current factor to a file, e.g. for parfor workers
+         assert(logical(o.lastChol), 'factorize must be called before saveFactor.');
+         AdaptiveChol.mex('serialize', o.uid, filename);
+      end
+      
+      function loadFactor(o, filename, w)
+         % load a factor written by saveFactor instead of calling
+         % factorize(w). The file is memory-mapped and used in place until
+         % the next factorize, so it must not be overwritten until then.
+         if isvector(w), w = diag(sparse(w)); end
+         o.lastChol = AdaptiveChol.mex('deserialize', o.uid, filename);
+         o.w = w;
       end
       
       function delete(o)
@@ -57,21 +107,85 @@ classdef AdaptiveChol < handle
       end
       
       function err = factorize(o, w, offset)
+         % If sharedFactor is true (POSIX only), each factor is published in
+         % shared memory under a hash of (A, w, offset), and other processes
+         % such as parfor workers attach to it instead of factorizing. Every
+         % tier of every factorize publishes its own segment; call
+         % unlinkShared once no process will ask for them again, or delete
+         % the object, which unlinks them too.
          if nargin <= 2, offset = 0.0; end
          if isvector(w), w = diag(sparse(w)); end
          
          o.w = w;
          err = +Inf;
+         cmd = 'factorize';
+         if o.sharedFactor, cmd = 'factorizeShared'; end
          
-         okay = AdaptiveChol.mex('factorize', o.uid, double(w), offset);
+         if o.overlapFactorize && ~o.sharedFactor
+            err = o.factorizeOverlapped(w, offset);
+            return
+         end
+         
+         if o.singlePrecision
+            okay = AdaptiveChol.mex(cmd, o.uid, double(w), offset, 'single');
+            o.lastChol = 4;
+            if okay, err = o.cholAccuracy(); end
+            if err < o.cholTol, o.release(); return; end
+         end
+         
+         okay = AdaptiveChol.mex(cmd, o.uid, double(w), offset);
          o.lastChol = 1;
          if okay, err = o.cholAccuracy(); end
-         if err < o.cholTol, return; end
+         if err < o.cholTol, o.release(); return; end
          
-         okay = AdaptiveChol.mex('factorize', o.uid, ddouble.toMex(w), offset);
+         okay = AdaptiveChol.mex(cmd, o.uid, ddouble.toMex(w), offset);
          o.lastChol = 2;
          if okay, err = o.cholAccuracy(); end
-         if err < o.cholTol, return; end
+         if err < o.cholTol, o.release(); return; end
+         
+         if o.tripleDouble
+            okay = AdaptiveChol.mex(cmd, o.uid, tdouble.toMex(w), offset);
+            o.lastChol = 5;
+            if okay, err = o.cholAccuracy(); end
+            if err < o.cholTol, o.release(); return; end
+         end
+         
+         okay = AdaptiveChol.mex(cmd, o.uid, qdouble.toMex(w), offset);
+         o.lastChol = 3;
+         if okay
+            err = o.cholAccuracy();
+         else
+            err = +Inf;
+         end
+      end
+      
+      function err = factorizeOverlapped(o, w, offset)
+         % Same cascade as factorize, but the double and ddouble factors are
+         % computed at the same time on other threads. If the double factor
+         % is accurate, the ddouble one finishes in the background and is
+         % only waited for by the next factorize (or release).
+         err = +Inf;
+         if o.singlePrecision
+            AdaptiveChol.mex('factorizeAsync', o.uid, double(w), offset, 'single');
+         end
+         AdaptiveChol.mex('factorizeAsync', o.uid, double(w), offset);
+         AdaptiveChol.mex('factorizeAsync', o.uid, ddouble.toMex(w), offset);
+         
+         levels = [1 2];
+         if o.singlePrecision, levels = [4 levels]; end
+         for lastChol = levels
+            okay = AdaptiveChol.mex('wait', o.uid, lastChol);
+            o.lastChol = lastChol;
+            if okay, err = o.cholAccuracy(); end
+            if err < o.cholTol, o.release(); return; end
+         end
+         
+         if o.tripleDouble
+            okay = AdaptiveChol.mex('factorize', o.uid, tdouble.toMex(w), offset);
+            o.lastChol = 5;
+            if okay, err = o.cholAccuracy(); end
+            if err < o.cholTol, o.release(); return; end
+         end
          
          okay = AdaptiveChol.mex('factorize', o.uid, qdouble.toMex(w), offset);
          o.lastChol = 3;
@@ -82,16 +196,69 @@ classdef AdaptiveChol < handle
          end
       end
       
-      function ls = leverageScore(o, JLDim)
+      function unlinkShared(o)
+         % remove the shared memory names of every factor this object
+         % published or attached to, of all tiers and factorize calls;
+         % processes that attached keep using their mapping
+         AdaptiveChol.mex('unlinkShared', o.uid);
+      end
+      
+      function useMatrixFree(o, enable, opts)
+         % useMatrixFree(enable, opts)
+         % Solve H x = b by PCG with H = A W A' applied as A(W(A'x)) and
+         % preconditioned by an incomplete Cholesky of a sparsified H.
+         % opts.tol - relative residual of PCG
+         % opts.maxIter - maximum number of PCG iterations
+         % opts.dropTol - drop H_ij if |H_ij| <= dropTol * sqrt(H_ii H_jj)
+         if nargin <= 1, enable = true; end
+         if nargin <= 2, opts = struct; end
+         
+         o.matrixFree = logical(enable);
+         o.pcgOptions = setField(o.pcgOptions, opts);
+         AdaptiveChol.mex('matrixFree', o.uid, o.matrixFree, ...
+            o.pcgOptions.tol, o.pcgOptions.maxIter, o.pcgOptions.dropTol);
+         o.lastChol = 0;
+      end
+      
+      function r = profile(o, action)
+         % profile(action) with action = 'on', 'off' or 'reset' controls the
+         % timing of the C++ phases (AWAt, analyzePattern, factorize,
+         % halfProj, triangularSolve, residual, preconditioner, pcg).
+         % r = profile() returns a struct with one row per timed phase in
+         % r.phase, r.type (1 = double, 2 = ddouble, 3 = qdouble, 4 = single, 5 = tdouble), r.seconds,
+         % r.flops (estimated) and r.nnzL (-1 if unknown).
+         if nargin == 2
+            AdaptiveChol.mex('profile', o.uid, action);
+         else
+            r = AdaptiveChol.mex('profile', o.uid);
+         end
+      end
+      
+      function release(o)
+         % free the solvers with higher precision than lastChol
+         if o.releaseFactors
+            AdaptiveChol.mex('release', o.uid);
+         end
+      end
+      
+      function ls = leverageScore(o, JLDim, sketch)
          % Warning: This compute (W A' (AWA')^-1 A)_ii
          % This is not exactly leverageScore unless W is diagonal.
+         % sketch (default sketchPrecision) rounds the factor to 'double'
+         % or 'single' for the projection if it has a higher precision;
+         % then tau is a double matrix.
+         if nargin < 3, sketch = o.sketchPrecision; end
          
          % tau = A' L^{-1} zeta
-         tau = AdaptiveChol.mex('halfProj', o.uid, JLDim);
-         if (o.lastChol == 2)
-            tau = ddouble(tau);
-         elseif (o.lastChol == 3)
-            tau = qdouble(tau);
+         tau = AdaptiveChol.mex('halfProj', o.uid, JLDim, sketch);
+         if strcmp(sketch, 'factor')
+            if (o.lastChol == 2)
+               tau = ddouble(tau);
+            elseif (o.lastChol == 3)
+               tau = qdouble(tau);
+            elseif (o.lastChol == 5)
+               tau = tdouble(tau);
+            end
          end
          
          % ls = avg_j (W tau_j)_i (tau_j)_i
@@ -99,11 +266,17 @@ classdef AdaptiveChol < handle
       end
       
       function err = cholAccuracy(o)
-         err = abs(sum(o.leverageScore(1)) - size(o.A, 1));
+         if o.matrixFree
+            % relative residual of the trial PCG solve in factorize
+            err = AdaptiveChol.mex('residual', o.uid);
+         else
+            err = abs(sum(o.leverageScore(1, 'factor')) - size(o.A, 1));
+         end
       end
       
       function r = diagonal(o)
          assert(o.lastChol, 'factorize must be called before diagonal.');
+         assert(~o.matrixFree, 'diagonal is not available in matrix-free mode.');
          
          r = AdaptiveChol.mex('diagonal', o.uid);
          
@@ -111,6 +284,8 @@ classdef AdaptiveChol < handle
             r = ddouble(r);
          elseif (o.lastChol == 3)
             r = qdouble(r);
+         elseif (o.lastChol == 5)
+            r = tdouble(r);
          end
       end
       
@@ -125,12 +300,18 @@ classdef AdaptiveChol < handle
          if isobject(b), b = b.x; end
          if isobject(w), w = w.x; end
          
-         y = AdaptiveChol.mex('solve', o.uid, b, w, iter);
+         if o.accurateResidual
+            y = AdaptiveChol.mex('solve', o.uid, b, w, iter, 'accurate');
+         else
+            y = AdaptiveChol.mex('solve', o.uid, b, w, iter);
+         end
          
          if (strcmp(className, 'ddouble')) %#ok<*STISA>
             y = ddouble(y);
          elseif (strcmp(className, 'qdouble'))
             y = qdouble(y);
+         elseif (strcmp(className, 'tdouble'))
+            y = tdouble(y);
          end
       end
       
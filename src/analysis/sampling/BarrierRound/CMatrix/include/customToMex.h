@@ -2,32 +2,38 @@
 
 #define CUSTOM_TOMEX
 
-void customToMex()
+void customToMex(MexContext& ctx)
 {
-	if (isInputSparse(1))
+	if (isInputSparse(ctx, 1))
 	{
-		if (compatibleWith<double>(1))
-			outputSparseMatrix<CType>(inputSparseMatrix<double>());
-		else if (compatibleWith<dd_real>(1))
-			outputSparseMatrix<CType>(inputSparseMatrix<dd_real>());
-		else if (compatibleWith<qd_real>(1))
-			outputSparseMatrix<CType>(inputSparseMatrix<qd_real>());
+		if (compatibleWith<double>(ctx, 1))
+			outputSparseMatrix<CType>(ctx, inputSparseMatrix<double>(ctx));
+		else if (compatibleWith<dd_real>(ctx, 1))
+			outputSparseMatrix<CType>(ctx, inputSparseMatrix<dd_real>(ctx));
+		else if (compatibleWith<td_real>(ctx, 1))
+			outputSparseMatrix<CType>(ctx, inputSparseMatrix<td_real>(ctx));
+		else if (compatibleWith<qd_real>(ctx, 1))
+			outputSparseMatrix<CType>(ctx, inputSparseMatrix<qd_real>(ctx));
 		else
 			throw std::runtime_error("Unsupported type for toMex.");
 	}
 	else
 	{
-		if (compatibleWith<double>(1))
+		if (compatibleWith<double>(ctx, 1))
 		{
-			outputDenseMatrix<CType>(inputDenseMatrix<double>());
+			outputDenseMatrix<CType>(ctx, inputDenseMatrix<double>(ctx));
 		}
-		else if (compatibleWith<dd_real>(1))
+		else if (compatibleWith<dd_real>(ctx, 1))
 		{
-			outputDenseMatrix<CType>(inputDenseMatrix<dd_real>());
+			outputDenseMatrix<CType>(ctx, inputDenseMatrix<dd_real>(ctx));
 		}
-		else if (compatibleWith<qd_real>(1))
+		else if (compatibleWith<td_real>(ctx, 1))
 		{
-			outputDenseMatrix<CType>(inputDenseMatrix<qd_real>());
+			outputDenseMatrix<CType>(ctx, inputDenseMatrix<td_real>(ctx));
+		}
+		else if (compatibleWith<qd_real>(ctx, 1))
+		{
+			outputDenseMatrix<CType>(ctx, inputDenseMatrix<qd_real>(ctx));
 		}
 		else
 			throw std::runtime_error("Unsupported type for toMex.");
@@ -3,11 +3,7 @@
 using CType = dd_real;
 
 #include "CMatrixUtils.h"
-
-namespace Eigen
-{
-	template<> struct NumTraits<CType> : DefaultNumTraits<CType> {};
-}
+#include "realTypes.h"
 
 #include "customToMex.h"
 #include "CMatrixMex.h"
\ No newline at end of file
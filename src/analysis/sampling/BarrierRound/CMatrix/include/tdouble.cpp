@@ -0,0 +1,10 @@
+#include <qd/dd_real.h>
+#include <qd/qd_real.h>
+#include <qd/td_real.h>
+using CType = td_real;
+
+#include "CMatrixUtils.h"
+#include "realTypes.h"
+
+#include "customToMex.h"
+#include "CMatrixMex.h"
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include "CMatrixCore.h"
+
+// A \ B: triangular solve, LDLT or LU if A is square, otherwise least squares by QR
+template<typename T>
+Matrix<T> mldivide(SparseMap<T> A, Map<T> B)
+{
+	Matrix<T> C;
+	assertThrow(A.rows() == B.rows(), "mldivide: Incompatible sizes.");
+
+	bool solved = false;
+	if (A.cols() == B.rows())
+	{
+		auto A_lower = A.template triangularView<Eigen::Lower>();
+		if (!solved && A.isApprox(A_lower))
+		{
+			C = A_lower.solve(B);
+			solved = true;
+		}
+
+		auto A_upper = A.template triangularView<Eigen::Upper>();
+		if (!solved && A.isApprox(A_upper))
+		{
+			C = A_upper.solve(B);
+			solved = true;
+		}
+
+		if (!solved && A.isApprox(A.transpose()))
+		{
+			Eigen::SimplicialLDLT<SparseMatrix<T>> solver(A);
+			if (solver.info() == Eigen::Success)
+			{
+				C = solver.solve(B);
+				solved = true;
+			}
+		}
+
+		if (!solved)
+		{
+			Eigen::SparseLU<SparseMatrix<T>> solver(A);
+			if (solver.info() == Eigen::Success)
+			{
+				C = solver.solve(B);
+				solved = true;
+			}
+		}
+	}
+
+	if (!solved)
+	{
+		Eigen::SparseQR<SparseMatrix<T>, Eigen::COLAMDOrdering<Eigen::Index>> solver(A);
+		assertThrow(solver.info() == Eigen::Success, "mldivide: solver failed.");
+		C = solver.solve(B);
+	}
+
+	return C;
+}
+
+template<typename T>
+Matrix<T> mldivide(Map<T> A, Map<T> B)
+{
+	Matrix<T> C;
+	assertThrow(A.rows() == B.rows(), "mldivide: Incompatible sizes.");
+
+	bool solved = false;
+
+	if (A.cols() == B.rows())
+	{
+		if (A.isLowerTriangular())
+		{
+			C = A.template triangularView<Eigen::Lower>().solve(B);
+			solved = true;
+		}
+		else if (A.isUpperTriangular())
+		{
+			C = A.template triangularView<Eigen::Upper>().solve(B);
+			solved = true;
+		}
+		else if (A.isUnitary())
+		{
+			auto solver = A.ldlt();
+			if (solver.info() == Eigen::Success)
+			{
+				C = solver.solve(B);
+				solved = true;
+			}
+		}
+
+		if (!solved)
+			C = A.fullPivLu().solve(B);
+	}
+	else
+	{
+		auto solver = A.colPivHouseholderQr();
+		assertThrow(solver.info() == Eigen::Success, "mldivide: solver failed.");
+		C = solver.solve(B);
+	}
+
+	return C;
+}
+
+// upper triangular U with U' U = A
+template<typename T>
+SparseMatrix<T> chol(SparseMap<T> A)
+{
+	assertThrow(A.rows() == A.cols(), "chol: Incompatible sizes.");
+
+	Eigen::SimplicialLLT<SparseMatrix<T>, Eigen::Upper, Eigen::NaturalOrdering<Eigen::Index>> lltOfA(A); // compute the Cholesky decomposition of A
+	assertThrow(lltOfA.info() == Eigen::Success, "chol: solver failed.");
+	return lltOfA.matrixU();
+}
+
+template<typename T>
+Matrix<T> chol(Map<T> A)
+{
+	assertThrow(A.rows() == A.cols(), "chol: Incompatible sizes.");
+
+	Eigen::LLT<Matrix<T>> lltOfA(A); // compute the Cholesky decomposition of A
+	assertThrow(lltOfA.info() == Eigen::Success, "chol: solver failed.");
+	return lltOfA.matrixU();
+}
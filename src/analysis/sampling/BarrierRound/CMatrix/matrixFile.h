@@ -0,0 +1,475 @@
+#pragma once
+// Binary files of dense and sparse (CSC) matrices of double, dd_real, td_real and qd_real,
+// for caching CMatrix data on disk (CMatrix.writeFile and CMatrix.readFile).
+//
+// The columns are stored in chunks. A raw chunk is stored as is, so a memory-mapped file
+// whose chunks are all raw is used in place through Eigen maps; a compressed chunk is
+// decoded on its own, straight into the destination.
+//
+// Layout (little endian; every section starts at a multiple of 32 bytes):
+//   MatrixFileHeader           magic "CMTX", version, scalar type and sizes
+//   int64 outer[cols + 1]      sparse only: the column pointers
+//   MatrixFileChunk[chunks]    the columns of each chunk and where its data is
+//   values                     the values of the chunks, in column order
+//   indices                    sparse only: the int64 row indices of the chunks
+// The raw chunks of a section follow each other without padding, so when every chunk is
+// raw, the values (and the row indices) are one column major array.
+//
+// The compression (codec 1) transposes the bytes of a chunk so that byte k of every scalar
+// comes together, then collapses the runs of zero bytes: a control byte c < 128 is followed
+// by c + 1 literal bytes, and c >= 128 stands for c - 126 zero bytes. This suits what is
+// common here, dd/qd values converted from double (zero trailing components) and row
+// indices (zero high bytes); full-precision values do not shrink and are kept raw.
+// Each chunk carries the FNV-1a hashes of its raw bytes, checked when it is decoded.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CMatrixCore.h"
+#include "realTypes.h"
+#include "binaryIO.h"
+
+struct MatrixFileHeader
+{
+	static const uint32_t kMagic = 0x58544d43; // "CMTX"
+	static const uint32_t kVersion = 1;
+
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t scalarType = 0; // realType
+	uint32_t scalarSize = 0;
+	uint32_t indexSize = sizeof(int64_t);
+	uint32_t sparse = 0;
+	int64_t rows = 0, cols = 0;
+	int64_t nnz = 0; // rows * cols if dense
+	int64_t chunks = 0;
+	uint8_t reserved[8] = {};
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "the header is 64 bytes");
+
+// Columns [first, first + cols) with the entries [start, start + count) in column major
+// order. The offsets are from the start of the file and the sizes are as stored.
+struct MatrixFileChunk
+{
+	enum Codec : uint32_t { kRaw = 0, kZeroRuns = 1 };
+
+	int64_t first, cols;
+	int64_t start, count;
+	uint64_t valueOffset, valueBytes;
+	uint64_t indexOffset, indexBytes;
+	uint32_t valueCodec, indexCodec;
+	uint64_t valueHash, indexHash; // hashBytes of the raw bytes
+};
+static_assert(sizeof(MatrixFileChunk) == 88, "the chunk table has no padding");
+
+struct MatrixFileOptions
+{
+	size_t chunkBytes = size_t(1) << 20; // about this many bytes of values and indices per chunk
+	bool compress = false;
+};
+
+namespace matrixFile
+{
+	template<typename T> inline const char* typeName();
+	template<> inline const char* typeName<double>() { return "double"; }
+	template<> inline const char* typeName<dd_real>() { return "dd_real"; }
+	template<> inline const char* typeName<td_real>() { return "td_real"; }
+	template<> inline const char* typeName<qd_real>() { return "qd_real"; }
+
+	// the codec of the header comment; width is the size of a scalar
+	inline void encode(const uint8_t* raw, size_t n, size_t width, std::vector<uint8_t>& out)
+	{
+		std::vector<uint8_t> planes(n);
+		size_t count = n / width;
+		for (size_t k = 0; k < width; ++k)
+			for (size_t i = 0; i < count; ++i)
+				planes[k * count + i] = raw[i * width + k];
+
+		out.clear();
+		size_t i = 0;
+		while (i < n)
+		{
+			size_t zeros = 0;
+			while (i + zeros < n && zeros < 128 && planes[i + zeros] == 0)
+				++zeros;
+			if (zeros >= 2)
+			{
+				out.push_back(uint8_t(126 + zeros));
+				i += zeros;
+				continue;
+			}
+
+			// literals up to the next run of two zeros
+			size_t len = 1;
+			while (i + len < n && len < 128 && !(planes[i + len] == 0 && i + len + 1 < n && planes[i + len + 1] == 0))
+				++len;
+			out.push_back(uint8_t(len - 1));
+			out.insert(out.end(), planes.begin() + i, planes.begin() + i + len);
+			i += len;
+		}
+	}
+
+	inline void decode(const uint8_t* in, size_t size, size_t width, uint8_t* raw, size_t n)
+	{
+		std::vector<uint8_t> planes(n);
+		size_t pos = 0, i = 0;
+		while (pos < size)
+		{
+			size_t c = in[pos++];
+			if (c >= 128)
+			{
+				size_t len = c - 126;
+				assertThrow(i + len <= n, "readMatrixFile: a compressed chunk is corrupt.");
+				std::fill(planes.begin() + i, planes.begin() + i + len, uint8_t(0));
+				i += len;
+			}
+			else
+			{
+				size_t len = c + 1;
+				assertThrow(i + len <= n && pos + len <= size, "readMatrixFile: a compressed chunk is corrupt.");
+				std::memcpy(planes.data() + i, in + pos, len);
+				i += len;
+				pos += len;
+			}
+		}
+		assertThrow(i == n, "readMatrixFile: a compressed chunk is corrupt.");
+
+		size_t count = n / width;
+		for (size_t k = 0; k < width; ++k)
+			for (size_t i = 0; i < count; ++i)
+				raw[i * width + k] = planes[k * count + i];
+	}
+
+	// appends one stream of a chunk, compressed if asked and if it gets smaller
+	inline uint32_t writeStream(ByteWriter& out, const void* raw, size_t bytes, size_t width, bool compress, std::vector<uint8_t>& buffer)
+	{
+		if (compress && bytes > 0)
+		{
+			encode((const uint8_t*)raw, bytes, width, buffer);
+			if (buffer.size() < bytes)
+			{
+				out.write(buffer.data(), buffer.size());
+				return MatrixFileChunk::kZeroRuns;
+			}
+		}
+		out.write((const uint8_t*)raw, bytes);
+		return MatrixFileChunk::kRaw;
+	}
+
+	// the chunks [first column, count of entries) for about chunkBytes each
+	inline std::vector<MatrixFileChunk> splitColumns(int64_t cols, const SignedIndex* outer, int64_t rows, size_t entryBytes, size_t chunkBytes)
+	{
+		std::vector<MatrixFileChunk> chunks;
+		int64_t j = 0;
+		while (j < cols)
+		{
+			MatrixFileChunk chunk = {};
+			chunk.first = j;
+			chunk.start = outer ? int64_t(outer[j]) : j * rows;
+			size_t bytes = 0;
+			do
+			{
+				bytes += entryBytes * size_t(outer ? outer[j + 1] - outer[j] : rows);
+				++j;
+			} while (j < cols && bytes < chunkBytes);
+			chunk.cols = j - chunk.first;
+			chunk.count = (outer ? int64_t(outer[j]) : j * rows) - chunk.start;
+			chunks.push_back(chunk);
+		}
+		return chunks;
+	}
+
+	template<typename T, typename Index>
+	ByteWriter write(int64_t rows, int64_t cols, const Index* outer, const Index* inner, const T* values, const MatrixFileOptions& options)
+	{
+		MatrixFileHeader header;
+		header.scalarType = realTypeOf<T>();
+		header.scalarSize = sizeof(T);
+		header.sparse = outer != nullptr;
+		header.rows = rows;
+		header.cols = cols;
+
+		std::vector<SignedIndex> outer64;
+		if (outer)
+			outer64.assign(outer, outer + cols + 1);
+		header.nnz = outer ? int64_t(outer64[cols]) : rows * cols;
+
+		size_t entryBytes = sizeof(T) + (outer ? sizeof(int64_t) : 0);
+		auto chunks = splitColumns(cols, outer ? outer64.data() : nullptr, rows, entryBytes, std::max<size_t>(options.chunkBytes, 1));
+		header.chunks = int64_t(chunks.size());
+
+		ByteWriter out;
+		out.write(header);
+		out.align();
+		if (outer)
+		{
+			out.write(outer64.data(), outer64.size());
+			out.align();
+		}
+		size_t table = out.bytes.size();
+		out.bytes.resize(table + chunks.size() * sizeof(MatrixFileChunk), 0);
+		out.align();
+
+		std::vector<uint8_t> buffer;
+		std::vector<int64_t> rowIndex;
+		for (auto& chunk : chunks)
+		{
+			const T* x = values + chunk.start;
+			chunk.valueOffset = out.bytes.size();
+			chunk.valueCodec = writeStream(out, x, chunk.count * sizeof(T), sizeof(T), options.compress, buffer);
+			chunk.valueBytes = out.bytes.size() - chunk.valueOffset;
+			chunk.valueHash = hashBytes(x, chunk.count * sizeof(T));
+		}
+		out.align();
+
+		if (outer)
+		{
+			for (auto& chunk : chunks)
+			{
+				rowIndex.assign(inner + chunk.start, inner + chunk.start + chunk.count);
+				chunk.indexOffset = out.bytes.size();
+				chunk.indexCodec = writeStream(out, rowIndex.data(), rowIndex.size() * sizeof(int64_t), sizeof(int64_t), options.compress, buffer);
+				chunk.indexBytes = out.bytes.size() - chunk.indexOffset;
+				chunk.indexHash = hashBytes(rowIndex.data(), rowIndex.size() * sizeof(int64_t));
+			}
+			out.align();
+		}
+
+		if (!chunks.empty())
+			std::memcpy(out.bytes.data() + table, chunks.data(), chunks.size() * sizeof(MatrixFileChunk));
+		return out;
+	}
+}
+
+// Write A to a matrix file, or to a blob with the same content
+template<typename Derived>
+ByteWriter matrixFileBlob(const Eigen::DenseBase<Derived>& A, const MatrixFileOptions& options = MatrixFileOptions())
+{
+	const auto& X = A.derived();
+	assertThrow(X.innerStride() == 1 && X.outerStride() == X.rows(), "writeMatrixFile: A should be a contiguous column major matrix.");
+	return matrixFile::write<typename Derived::Scalar, SignedIndex>(X.rows(), X.cols(), nullptr, nullptr, X.data(), options);
+}
+
+template<typename Derived>
+ByteWriter matrixFileBlob(const Eigen::SparseCompressedBase<Derived>& A, const MatrixFileOptions& options = MatrixFileOptions())
+{
+	assertThrow(A.isCompressed() && !A.IsRowMajor, "writeMatrixFile: A should be a compressed column major sparse matrix.");
+	return matrixFile::write(A.rows(), A.cols(), A.outerIndexPtr(), A.innerIndexPtr(), A.valuePtr(), options);
+}
+
+template<typename M>
+void writeMatrixFile(const std::string& filename, const M& A, const MatrixFileOptions& options = MatrixFileOptions())
+{
+	matrixFileBlob(A, options).writeFile(filename);
+}
+
+// A matrix file, memory-mapped, or a blob in memory that outlives it
+class MatrixFile
+{
+public:
+	explicit MatrixFile(const std::string& filename)
+		: file(new MappedFile(filename))
+	{
+		parse(file->data, file->size);
+	}
+
+	MatrixFile(const uint8_t* data, size_t size)
+	{
+		parse(data, size);
+	}
+
+	const MatrixFileHeader& header() const { return *head; }
+	const std::vector<MatrixFileChunk>& chunks() const { return table; }
+
+	// every chunk is raw, so the matrix can be used in place
+	bool inPlace() const
+	{
+		for (auto& chunk : table)
+			if (chunk.valueCodec != MatrixFileChunk::kRaw || chunk.indexCodec != MatrixFileChunk::kRaw)
+				return false;
+		return true;
+	}
+
+	// The matrix in place, without a copy; it has to be stored raw as a T
+	template<typename T>
+	Eigen::Map<const Matrix<T>, Eigen::Aligned32> denseMap() const
+	{
+		checkInPlace<T>(false);
+		return Eigen::Map<const Matrix<T>, Eigen::Aligned32>((const T*)values, head->rows, head->cols);
+	}
+
+	template<typename T>
+	Eigen::Map<const SparseMatrix<T>> sparseMap() const
+	{
+		checkInPlace<T>(true);
+		return Eigen::Map<const SparseMatrix<T>>(head->rows, head->cols, head->nnz, outer, (const SignedIndex*)indices, (const T*)values);
+	}
+
+	// Decode the values into x (nnz of them), converting them to T if they are stored in a
+	// lower precision
+	template<typename T>
+	void readValues(T* x) const
+	{
+		switch (head->scalarType)
+		{
+		case doubleType: readValuesAs<double>(x); break;
+		case dd_realType: readValuesAs<dd_real>(x); break;
+		case td_realType: readValuesAs<td_real>(x); break;
+		case qd_realType: readValuesAs<qd_real>(x); break;
+		default: throw std::runtime_error("readMatrixFile: unknown scalar type " + std::to_string(head->scalarType) + ".");
+		}
+	}
+
+	template<typename T>
+	Matrix<T> readDense() const
+	{
+		assertThrow(!head->sparse, "readMatrixFile: the matrix is sparse.");
+		Matrix<T> X(head->rows, head->cols);
+		readValues(X.data());
+		return X;
+	}
+
+	template<typename T>
+	SparseMatrix<T> readSparse() const
+	{
+		assertThrow(head->sparse, "readMatrixFile: the matrix is dense.");
+		SparseMatrix<T> X(head->rows, head->cols);
+		X.resizeNonZeros(head->nnz);
+		std::copy(outer, outer + head->cols + 1, X.outerIndexPtr());
+
+		std::vector<uint8_t> raw;
+		for (auto& chunk : table)
+		{
+			auto src = (const int64_t*)stream(chunk.indexOffset, chunk.indexBytes, chunk.indexCodec, chunk.indexHash,
+				chunk.count * sizeof(int64_t), sizeof(int64_t), raw);
+			std::copy(src, src + chunk.count, X.innerIndexPtr() + chunk.start);
+		}
+		readValues(X.valuePtr());
+		return X;
+	}
+
+	// Check the hashes of the raw chunks too; the reads only check the compressed ones
+	void verify() const
+	{
+		std::vector<uint8_t> raw;
+		for (auto& chunk : table)
+		{
+			size_t bytes = chunk.count * head->scalarSize;
+			auto x = stream(chunk.valueOffset, chunk.valueBytes, chunk.valueCodec, chunk.valueHash, bytes, head->scalarSize, raw);
+			assertThrow(hashBytes(x, bytes) == chunk.valueHash, "readMatrixFile: a chunk does not match its hash.");
+			if (head->sparse)
+			{
+				bytes = chunk.count * sizeof(int64_t);
+				auto i = stream(chunk.indexOffset, chunk.indexBytes, chunk.indexCodec, chunk.indexHash, bytes, sizeof(int64_t), raw);
+				assertThrow(hashBytes(i, bytes) == chunk.indexHash, "readMatrixFile: a chunk does not match its hash.");
+			}
+		}
+	}
+
+private:
+	std::unique_ptr<MappedFile> file;
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	const MatrixFileHeader* head = nullptr;
+	const SignedIndex* outer = nullptr;
+	std::vector<MatrixFileChunk> table;
+	const uint8_t* values = nullptr; // the start of the values and indices sections
+	const uint8_t* indices = nullptr;
+
+	void parse(const uint8_t* data_, size_t size_)
+	{
+		static_assert(sizeof(SignedIndex) == sizeof(int64_t), "the row indices are stored as int64");
+		data = data_;
+		size = size_;
+
+		ByteReader in(data, size);
+		head = in.view<MatrixFileHeader>(1);
+		assertThrow(head->magic == MatrixFileHeader::kMagic && head->version == MatrixFileHeader::kVersion,
+			"readMatrixFile: not a matrix file.");
+		assertThrow(head->rows >= 0 && head->cols >= 0 && head->chunks >= 0 && head->indexSize == sizeof(int64_t) &&
+			head->nnz >= 0 && (head->sparse || head->nnz == head->rows * head->cols), "readMatrixFile: the header is corrupt.");
+		in.align();
+
+		if (head->sparse)
+		{
+			outer = in.view<SignedIndex>(head->cols + 1);
+			assertThrow(outer[0] == 0 && outer[head->cols] == head->nnz, "readMatrixFile: the column pointers are corrupt.");
+			for (int64_t j = 0; j < head->cols; ++j)
+				assertThrow(outer[j] <= outer[j + 1], "readMatrixFile: the column pointers are corrupt.");
+			in.align();
+		}
+
+		auto chunks = in.view<MatrixFileChunk>(head->chunks);
+		table.assign(chunks, chunks + head->chunks);
+		in.align();
+
+		int64_t column = 0, entry = 0;
+		for (auto& chunk : table)
+		{
+			assertThrow(chunk.first == column && chunk.start == entry && chunk.cols > 0 && chunk.count >= 0 &&
+				chunk.valueOffset <= size && chunk.valueBytes <= size - chunk.valueOffset &&
+				chunk.indexOffset <= size && chunk.indexBytes <= size - chunk.indexOffset,
+				"readMatrixFile: the chunk table is corrupt.");
+			column += chunk.cols;
+			entry += chunk.count;
+		}
+		assertThrow(column == head->cols && entry == head->nnz, "readMatrixFile: the chunk table is corrupt.");
+
+		values = table.empty() ? data + in.pos : data + table[0].valueOffset;
+		indices = table.empty() || !head->sparse ? nullptr : data + table[0].indexOffset;
+	}
+
+	template<typename T>
+	void checkInPlace(bool sparse) const
+	{
+		assertThrow(bool(head->sparse) == sparse, std::string("readMatrixFile: the matrix is ") + (head->sparse ? "sparse." : "dense."));
+		assertThrow(head->scalarType == realTypeOf<T>() && head->scalarSize == sizeof(T),
+			std::string("readMatrixFile: the matrix is not stored as ") + matrixFile::typeName<T>() + ".");
+		assertThrow(inPlace(), "readMatrixFile: the matrix is compressed; use readDense or readSparse.");
+		assertThrow(reinterpret_cast<std::uintptr_t>(values) % 32 == 0, "readMatrixFile: the data is not 32 byte aligned.");
+	}
+
+	// the raw bytes of a stream: in place if raw, else decoded into buffer and checked
+	const uint8_t* stream(uint64_t offset, uint64_t stored, uint32_t codec, uint64_t hash, size_t bytes, size_t width,
+		std::vector<uint8_t>& buffer) const
+	{
+		if (codec == MatrixFileChunk::kRaw)
+		{
+			assertThrow(stored == bytes, "readMatrixFile: a raw chunk has the wrong size.");
+			return data + offset;
+		}
+		assertThrow(codec == MatrixFileChunk::kZeroRuns, "readMatrixFile: unknown codec " + std::to_string(codec) + ".");
+		buffer.resize(bytes);
+		matrixFile::decode(data + offset, stored, width, buffer.data(), bytes);
+		assertThrow(hashBytes(buffer.data(), bytes) == hash, "readMatrixFile: a compressed chunk does not match its hash.");
+		return buffer.data();
+	}
+
+	template<typename S, typename T>
+	void readValuesAs(T* x) const
+	{
+		if constexpr (std::numeric_limits<S>::digits > std::numeric_limits<T>::digits)
+			throw std::runtime_error(std::string("readMatrixFile: the matrix is stored as ") + matrixFile::typeName<S>() +
+				", which does not fit in " + matrixFile::typeName<T>() + ".");
+		else
+		{
+			assertThrow(head->scalarSize == sizeof(S), "readMatrixFile: the header is corrupt.");
+			std::vector<uint8_t> raw;
+			for (auto& chunk : table)
+			{
+				size_t bytes = chunk.count * sizeof(S);
+				auto src = stream(chunk.valueOffset, chunk.valueBytes, chunk.valueCodec, chunk.valueHash, bytes, sizeof(S), raw);
+				if constexpr (std::is_same<S, T>::value)
+					std::memcpy(x + chunk.start, src, bytes);
+				else
+				{
+					const S* s = (const S*)src;
+					for (int64_t k = 0; k < chunk.count; ++k)
+						x[chunk.start + k] = T(s[k]);
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,357 @@
+#pragma once
+// Element-wise functions of the CMatrix operators, used by the unaryOperator,
+// binaryOperator and reductionOperator kernels.
+#include <algorithm>
+#include <cmath>
+
+#include "CMatrixCore.h"
+#include "arithmetic.h"
+#include "binaryOperator.h"
+
+struct UnaryOperatorConfig
+{
+	const static bool NativeOutput = false;
+	const static bool KeepsZero = true; // f(0) = 0, so a sparse input gives a sparse output
+	const static bool Batched = false;  // f_n(x, y, n) computes y[i] = f(x[i]) for a whole array
+};
+
+// y[i] = exp(x[i]) and y[i] = log(x[i]) for i < n; dd_real and qd_real have batched
+// versions in realTypes.h
+template<typename T>
+void expArray(const T* x, T* y, size_t n)
+{
+	using std::exp;
+	for (size_t i = 0; i < n; ++i)
+		y[i] = exp(x[i]);
+}
+
+template<typename T>
+void logArray(const T* x, T* y, size_t n)
+{
+	using std::log;
+	for (size_t i = 0; i < n; ++i)
+		y[i] = log(x[i]);
+}
+
+template<typename T>
+void sqrtArray(const T* x, T* y, size_t n)
+{
+	using std::sqrt;
+	for (size_t i = 0; i < n; ++i)
+		y[i] = sqrt(x[i]);
+}
+
+template<typename T>
+struct absFunc : UnaryOperatorConfig
+{
+	static T f(size_t i, size_t j, T x)
+	{
+		using std::abs;
+		return abs(x);
+	}
+};
+
+template<typename T>
+struct sqrtFunc : UnaryOperatorConfig
+{
+	const static bool Batched = true;
+	static T f(size_t i, size_t j, T x)
+	{
+		using std::sqrt;
+		return sqrt(x);
+	}
+	static void f_n(const T* x, T* y, size_t n)
+	{
+		sqrtArray(x, y, n);
+	}
+};
+
+template<typename T>
+struct expFunc : UnaryOperatorConfig
+{
+	const static bool KeepsZero = false;
+	const static bool Batched = true;
+	static T f(size_t i, size_t j, T x)
+	{
+		using std::exp;
+		return exp(x);
+	}
+	static void f_n(const T* x, T* y, size_t n)
+	{
+		expArray(x, y, n);
+	}
+};
+
+// log(0) = -Inf, and log(x) is NaN for x < 0 since the types are real
+template<typename T>
+struct logFunc : UnaryOperatorConfig
+{
+	const static bool KeepsZero = false;
+	const static bool Batched = true;
+	static T f(size_t i, size_t j, T x)
+	{
+		using std::log;
+		return log(x);
+	}
+	static void f_n(const T* x, T* y, size_t n)
+	{
+		logArray(x, y, n);
+	}
+};
+
+template<typename T>
+struct uminusFunc : UnaryOperatorConfig
+{
+	static T f(size_t i, size_t j, T x)
+	{
+		return -x;
+	}
+};
+
+template<typename T>
+struct notFunc : UnaryOperatorConfig
+{
+	static bool f(size_t i, size_t j, T x)
+	{
+		return isZero(x);
+	}
+};
+
+template<typename T>
+struct doubleFunc : UnaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static double f(size_t i, size_t j, T x)
+	{
+		return double(x);
+	}
+};
+
+template<typename T>
+struct logicalFunc : UnaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static bool f(size_t i, size_t j, T x)
+	{
+		return !isZero(x);
+	}
+};
+
+struct BinaryOperatorConfig
+{
+	const static bool NativeOutput = false;
+	const static bool DenseDenseToSparse = false;
+	const static bool SparseDenseToSparse = false;
+	const static bool DenseSparseToSparse = false;
+	const static bool SparseSparseToSparse = true;
+	const static bool Batched = false; // f_n(x1, x2, y, n) computes y[i] = f(x1[i], x2[i]) for whole arrays
+	const static bool BatchedScalar = false; // f_n(x1, x2, y, n) with a scalar x1 computes y[i] = f(x1, x2[i])
+};
+
+// y[i] = x1[i] op x2[i] for i < n; dd_real and qd_real have packed versions in realTypes.h
+template<typename T>
+void plusArray(const T* x1, const T* x2, T* y, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		y[i] = x1[i] + x2[i];
+}
+
+template<typename T>
+void minusArray(const T* x1, const T* x2, T* y, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		y[i] = x1[i] - x2[i];
+}
+
+template<typename T>
+void timesArray(const T* x1, const T* x2, T* y, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		y[i] = x1[i] * x2[i];
+}
+
+template<typename T>
+void rdivideArray(const T* x1, const T* x2, T* y, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		y[i] = x1[i] / x2[i];
+}
+
+// y[i] = x1 / x2[i], e.g. 1 ./ A; dd_real and qd_real use the packed reciprocal for x1 = 1
+template<typename T>
+void rdivideArray(T x1, const T* x2, T* y, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		y[i] = x1 / x2[i];
+}
+
+template<typename T>
+struct ltFunc : BinaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return (x1 < x2);
+	}
+};
+
+template<typename T>
+struct gtFunc : BinaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return (x1 > x2);
+	}
+};
+
+template<typename T>
+struct neFunc : BinaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return (x1 != x2);
+	}
+};
+
+template<typename T>
+struct orFunc : BinaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return ((!isZero(x1)) | (!isZero(x2)));
+	}
+};
+
+template<typename T>
+struct andFunc : BinaryOperatorConfig
+{
+	const static bool NativeOutput = true;
+	const static bool SparseDenseToSparse = true;
+	const static bool DenseSparseToSparse = true;
+	static bool f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return ((!isZero(x1)) & (!isZero(x2)));
+	}
+};
+
+template<typename T, typename P = DefaultArithmetic>
+struct plusFunc : BinaryOperatorConfig
+{
+	const static bool Batched = P::Packed;
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return P::add(x1, x2);
+	}
+	static void f_n(const T* x1, const T* x2, T* y, size_t n)
+	{
+		plusArray(x1, x2, y, n);
+	}
+};
+
+template<typename T, typename P = DefaultArithmetic>
+struct minusFunc : BinaryOperatorConfig
+{
+	const static bool Batched = P::Packed;
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return P::sub(x1, x2);
+	}
+	static void f_n(const T* x1, const T* x2, T* y, size_t n)
+	{
+		minusArray(x1, x2, y, n);
+	}
+};
+
+template<typename T, typename P = DefaultArithmetic>
+struct timesFunc : BinaryOperatorConfig
+{
+	const static bool Batched = P::Packed;
+	const static bool SparseDenseToSparse = true;
+	const static bool DenseSparseToSparse = true;
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return P::mul(x1, x2);
+	}
+	static void f_n(const T* x1, const T* x2, T* y, size_t n)
+	{
+		timesArray(x1, x2, y, n);
+	}
+};
+
+template<typename T, typename P = DefaultArithmetic>
+struct rdivideFunc : BinaryOperatorConfig
+{
+	const static bool Batched = P::Packed;
+	const static bool BatchedScalar = P::Packed;
+	const static bool SparseSparseToSparse = false;
+	const static bool SparseDenseToSparse = true;
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return P::div(x1, x2);
+	}
+	static void f_n(const T* x1, const T* x2, T* y, size_t n)
+	{
+		rdivideArray(x1, x2, y, n);
+	}
+	static void f_n(T x1, const T* x2, T* y, size_t n)
+	{
+		rdivideArray(x1, x2, y, n);
+	}
+};
+
+template<typename T>
+struct max2Func : BinaryOperatorConfig
+{
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return std::max(x1, x2);
+	}
+};
+
+template<typename T>
+struct min2Func : BinaryOperatorConfig
+{
+	static T f(size_t i, size_t j, T x1, T x2, EntryType type)
+	{
+		return std::min(x1, x2);
+	}
+};
+
+template<typename T>
+struct maxFunc
+{
+	static T f(T x, T y)
+	{
+		return std::max(x, y);
+	}
+};
+
+template<typename T>
+struct minFunc
+{
+	static T f(T x, T y)
+	{
+		return std::min(x, y);
+	}
+};
+
+template<typename T>
+struct prodFunc
+{
+	static T f(T x, T y)
+	{
+		return x * y;
+	}
+};
+
+template<typename T>
+struct sumFunc
+{
+	static T f(T x, T y)
+	{
+		return x + y;
+	}
+};
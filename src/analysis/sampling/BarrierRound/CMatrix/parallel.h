@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <qd/fpu.h>
+
+inline std::atomic<int>& threadLimit()
+{
+	static std::atomic<int> n([] {
+		const char* env = std::getenv("CMATRIX_NUM_THREADS");
+		int k = env ? std::atoi(env) : (int)std::thread::hardware_concurrency();
+		return std::max(k, 1);
+	}());
+	return n;
+}
+
+// Number of threads used by parallelFor: CMATRIX_NUM_THREADS if set, otherwise the number of cores
+inline int maxThreads()
+{
+	return threadLimit().load(std::memory_order_relaxed);
+}
+
+// Override CMATRIX_NUM_THREADS for the rest of the process, e.g. to check that a result does not
+// depend on the number of threads
+inline void setMaxThreads(int k)
+{
+	threadLimit().store(std::max(k, 1), std::memory_order_relaxed);
+}
+
+// Call f(first, last) on contiguous chunks of [begin, end) of at least grain indices, one chunk per thread.
+// f must not call the MATLAB API. The first exception thrown by f is rethrown here. Each chunk runs under a
+// qd::fpu_guard, since a new thread does not always start with the floating point modes of its parent.
+template<typename Index, typename F>
+void parallelFor(Index begin, Index end, Index grain, F&& f)
+{
+	Index n = end - begin;
+	if (n <= 0)
+		return;
+
+	Index chunks = std::min<Index>(Index(maxThreads()), (n + grain - 1) / std::max<Index>(grain, 1));
+	if (chunks <= 1)
+	{
+		f(begin, end);
+		return;
+	}
+
+	std::exception_ptr error;
+	std::mutex errorLock;
+	auto run = [&](Index t) {
+		qd::fpu_guard fpu;
+		try
+		{
+			f(begin + n * t / chunks, begin + n * (t + 1) / chunks);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(errorLock);
+			if (!error)
+				error = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(chunks - 1);
+	for (Index t = 1; t < chunks; ++t)
+		threads.emplace_back(run, t);
+	run(0);
+	for (auto& thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
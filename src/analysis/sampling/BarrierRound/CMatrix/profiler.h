@@ -0,0 +1,68 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A timed phase of a command, e.g. the numeric factorization in "factorize"
+struct ProfileRecord
+{
+	std::string phase;
+	uint32_t type;   // precision of the phase (realType)
+	double seconds;
+	double flops;    // estimated number of scalar operations
+	int64_t nnzL;    // nonzeros of the factor, or -1 if unknown
+};
+
+// Opt-in collection of ProfileRecords. Records may be added from background factorizations,
+// so they are added and cleared under lock.
+struct Profiler
+{
+	bool enabled = false;
+	std::vector<ProfileRecord> records;
+	std::mutex lock;
+
+	void add(ProfileRecord record)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		records.push_back(std::move(record));
+	}
+
+	void reset()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		records.clear();
+	}
+};
+
+// Times its own lifetime and adds a record to the profiler (if enabled) on destruction.
+// The caller fills in flops and nnzL when they are known.
+struct ProfileScope
+{
+	using Clock = std::chrono::steady_clock;
+
+	Profiler* profiler;
+	const char* phase;
+	uint32_t type;
+	double flops = 0.0;
+	int64_t nnzL = -1;
+	Clock::time_point start;
+
+	ProfileScope(Profiler* profiler_, const char* phase_, uint32_t type_)
+		: profiler(profiler_), phase(phase_), type(type_), start(Clock::now())
+	{
+	}
+
+	~ProfileScope()
+	{
+		if (profiler && profiler->enabled)
+		{
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			profiler->add({ phase, type, seconds, flops, nnzL });
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
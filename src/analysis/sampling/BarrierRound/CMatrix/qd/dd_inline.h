@@ -15,6 +15,7 @@
 
 #include <cmath>
 #include "inline.h"
+#include "poly.h"
 
 #ifndef QD_INLINE
 #define inline
@@ -618,4 +619,81 @@ inline dd_real dd_real::rand() {
   return ddrand();
 }
 
+/*********** Exponential and Logarithm ************/
+/* Exponential.  Computes exp(x) in double-double precision. */
+inline dd_real exp(const dd_real &a) {
+  /* Strategy:  We first reduce the size of x by noting that
+     
+          exp(kr + m * log(2)) = 2^m * exp(r)^k
+
+     where m and k are integers.  By choosing m appropriately
+     we can make |kr| <= log(2) / 2 = 0.347.  Then exp(r) is 
+     evaluated using the familiar Taylor series.  Reducing the 
+     argument substantially speeds up the convergence.  With
+     |r| <= 6.8e-4 the terms up to r^8/8! are enough, and they
+     are summed by Horner's rule without a stopping test.   */  
+
+  const double k = 512.0;
+  const double inv_k = 1.0 / k;
+
+  if (a.x[0] <= -709.0)
+    return 0.0;
+
+  if (a.x[0] >=  709.0)
+    return dd_real::_inf;
+
+  if (a.is_zero())
+    return 1.0;
+
+  if (a.is_one())
+    return dd_real::_e;
+
+  double m = std::floor(a.x[0] / dd_real::_log2.x[0] + 0.5);
+  dd_real r = mul_pwr2(a - dd_real::_log2 * m, inv_k);
+
+  /* s = exp(r) - 1 */
+  dd_real s = r * qd::poly::horner<8>(r, qd::poly::exp_series);
+
+  /* exp(r)^512 - 1 by squaring (1 + s)^2 - 1 = 2 s + s^2 nine times */
+  for (int i = 0; i < 9; ++i)
+    s = mul_pwr2(s, 2.0) + sqr(s);
+  s += 1.0;
+
+  return ldexp(s, static_cast<int>(m));
+}
+
+/* Logarithm.  Computes log(x) in double-double precision.
+   This is a natural logarithm (i.e., base e).            */
+inline dd_real log(const dd_real &a) {
+  /* Strategy.  The Taylor series for log converges much more
+     slowly than that of exp, due to the lack of the factorial
+     term in the denominator.  Hence this routine instead tries
+     to determine the root of the function
+
+         f(x) = exp(x) - a
+
+     using Newton iteration.  The iteration is given by
+
+         x' = x - f(x)/f'(x) 
+            = x - (1 - a * exp(-x))
+            = x + a * exp(-x) - 1.
+           
+     Only one iteration is needed, since Newton's iteration
+     approximately doubles the number of digits per iteration. */
+
+  if (a.is_one()) {
+    return 0.0;
+  }
+
+  if (a.x[0] <= 0.0) {
+    dd_real::error("(dd_real::log): Non-positive argument.");
+    return dd_real::_nan;
+  }
+
+  dd_real x = std::log(a.x[0]);   /* Initial approximation */
+
+  x = x + a * exp(-x) - 1.0;
+  return x;
+}
+
 #endif /* _QD_DD_INLINE_H */
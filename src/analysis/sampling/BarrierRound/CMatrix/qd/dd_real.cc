@@ -166,183 +166,191 @@ dd_real pow(const dd_real &a, const dd_real &b) {
   return exp(b * log(a));
 }
 
-static const int n_inv_fact = 15;
-static const double inv_fact[n_inv_fact][2] = {
-  { 1.66666666666666657e-01,  9.25185853854297066e-18},
-  { 4.16666666666666644e-02,  2.31296463463574266e-18},
-  { 8.33333333333333322e-03,  1.15648231731787138e-19},
-  { 1.38888888888888894e-03, -5.30054395437357706e-20},
-  { 1.98412698412698413e-04,  1.72095582934207053e-22},
-  { 2.48015873015873016e-05,  2.15119478667758816e-23},
-  { 2.75573192239858925e-06, -1.85839327404647208e-22},
-  { 2.75573192239858883e-07,  2.37677146222502973e-23},
-  { 2.50521083854417202e-08, -1.44881407093591197e-24},
-  { 2.08767569878681002e-09, -1.20734505911325997e-25},
-  { 1.60590438368216133e-10,  1.25852945887520981e-26},
-  { 1.14707455977297245e-11,  2.06555127528307454e-28},
-  { 7.64716373181981641e-13,  7.03872877733453001e-30},
-  { 4.77947733238738525e-14,  4.39920548583408126e-31},
-  { 2.81145725434552060e-15,  1.65088427308614326e-31}
-};
-
-/* Exponential.  Computes exp(x) in double-double precision. */
-dd_real exp(const dd_real &a) {
-  /* Strategy:  We first reduce the size of x by noting that
-     
-          exp(kr + m * log(2)) = 2^m * exp(r)^k
-
-     where m and k are integers.  By choosing m appropriately
-     we can make |kr| <= log(2) / 2 = 0.347.  Then exp(r) is 
-     evaluated using the familiar Taylor series.  Reducing the 
-     argument substantially speeds up the convergence.       */  
-
-  const double k = 512.0;
-  const double inv_k = 1.0 / k;
-
-  if (a.x[0] <= -709.0)
-    return 0.0;
-
-  if (a.x[0] >=  709.0)
-    return dd_real::_inf;
-
-  if (a.is_zero())
-    return 1.0;
-
-  if (a.is_one())
-    return dd_real::_e;
-
-  double m = std::floor(a.x[0] / dd_real::_log2.x[0] + 0.5);
-  dd_real r = mul_pwr2(a - dd_real::_log2 * m, inv_k);
-  dd_real s, t, p;
-
-  p = sqr(r);
-  s = r + mul_pwr2(p, 0.5);
-  p *= r;
-  t = p * dd_real(inv_fact[0][0], inv_fact[0][1]);
-  int i = 0;
-  do {
-    s += t;
-    p *= r;
-    ++i;
-    t = p * dd_real(inv_fact[i][0], inv_fact[i][1]);
-  } while (std::abs(to_double(t)) > inv_k * dd_real::_eps && i < 5);
-
-  s += t;
-
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s = mul_pwr2(s, 2.0) + sqr(s);
-  s += 1.0;
-
-  return ldexp(s, static_cast<int>(m));
+dd_real log10(const dd_real &a) {
+  return log(a) / dd_real::_log10;
 }
 
-/* Logarithm.  Computes log(x) in double-double precision.
-   This is a natural logarithm (i.e., base e).            */
-dd_real log(const dd_real &a) {
-  /* Strategy.  The Taylor series for log converges much more
-     slowly than that of exp, due to the lack of the factorial
-     term in the denominator.  Hence this routine instead tries
-     to determine the root of the function
-
-         f(x) = exp(x) - a
+/* Batched exponential and logarithm:  b[i] = exp(a[i]) (resp. log(a[i]))
+   for 0 <= i < n, where b may be the same array as a.  Elements are
+   processed in blocks.  A block is split into arrays of high and low
+   words, the argument reduction is done for the whole block, and the
+   Taylor series is evaluated with a fixed number of terms, so that each
+   step is a loop without branches that the compiler can evaluate several
+   elements at a time with SIMD instructions.  The results agree with exp
+   and log up to the last few bits.                                     */
+namespace {
+
+const int batch_size = 256;
+
+/* (ch, cl) = (ah, al) + (bh, bl), same as sloppy_add */
+inline void add_lanes(double ah, double al, double bh, double bl,
+                      double &ch, double &cl) {
+  double s, e;
+  s = qd::two_sum(ah, bh, e);
+  e += (al + bl);
+  ch = qd::quick_two_sum(s, e, cl);
+}
 
-     using Newton iteration.  The iteration is given by
+/* (ch, cl) = (ah, al) * (bh, bl), same as the sloppy operator* */
+inline void mul_lanes(double ah, double al, double bh, double bl,
+                      double &ch, double &cl) {
+  double p, e;
+  p = qd::two_prod(ah, bh, e);
+  e += (ah * bl + al * bh);
+  ch = qd::quick_two_sum(p, e, cl);
+}
 
-         x' = x - f(x)/f'(x) 
-            = x - (1 - a * exp(-x))
-            = x + a * exp(-x) - 1.
-           
-     Only one iteration is needed, since Newton's iteration
-     approximately doubles the number of digits per iteration. */
+/* (h[i], l[i]) = exp((h[i], l[i])) for i < n <= batch_size */
+void exp_lanes(double *h, double *l, int n) {
+  const double inv_k = 1.0 / 512.0;
+  const double log2_hi = dd_real::_log2.x[0], log2_lo = dd_real::_log2.x[1];
+  double m[batch_size], x[batch_size];
+  double rh[batch_size], rl[batch_size];
+  double ph[batch_size], pl[batch_size];
+  double th[batch_size], tl[batch_size];
+
+  /* exp(a) = 2^m exp(r)^512 with a = m log(2) + 512 r and |512 r| <= log(2) / 2.
+     Non-finite lanes and lanes out of range are reduced from 0 and fixed below. */
+  for (int i = 0; i < n; ++i) {
+    x[i] = h[i];
+    bool in_range = std::abs(h[i]) < 709.0;
+    double ah = in_range ? h[i] : 0.0, al = in_range ? l[i] : 0.0;
+    m[i] = std::floor(ah / log2_hi + 0.5);
+    double p, e;
+    p = qd::two_prod(log2_hi, m[i], e);
+    e += log2_lo * m[i];
+    p = qd::quick_two_sum(p, e, e);
+    add_lanes(ah, al, -p, -e, rh[i], rl[i]);
+    rh[i] *= inv_k;
+    rl[i] *= inv_k;
+  }
+
+  /* s = r (1 + r/2! + ... + r^7/8!) by Horner's rule, as in exp */
+  const qd::poly::table<12> &c = qd::poly::exp_series;
+  for (int i = 0; i < n; ++i) {
+    ph[i] = c.c[7][0];
+    pl[i] = c.c[7][1];
+  }
+  for (int k = 6; k >= 0; --k) {
+    const double ch = c.c[k][0], cl = c.c[k][1];
+    for (int i = 0; i < n; ++i) {
+      mul_lanes(ph[i], pl[i], rh[i], rl[i], th[i], tl[i]);
+      add_lanes(th[i], tl[i], ch, cl, ph[i], pl[i]);
+    }
+  }
+  for (int i = 0; i < n; ++i)
+    mul_lanes(ph[i], pl[i], rh[i], rl[i], h[i], l[i]);
 
-  if (a.is_one()) {
-    return 0.0;
+  /* exp(r)^512 - 1 by squaring (1 + s)^2 - 1 = 2 s + s^2 nine times */
+  for (int k = 0; k < 9; ++k) {
+    for (int i = 0; i < n; ++i) {
+      mul_lanes(h[i], l[i], h[i], l[i], th[i], tl[i]);
+      add_lanes(2.0 * h[i], 2.0 * l[i], th[i], tl[i], h[i], l[i]);
+    }
   }
+  for (int i = 0; i < n; ++i)
+    add_lanes(h[i], l[i], 1.0, 0.0, h[i], l[i]);
 
-  if (a.x[0] <= 0.0) {
-    dd_real::error("(dd_real::log): Non-positive argument.");
-    return dd_real::_nan;
+  for (int i = 0; i < n; ++i) {
+    if (x[i] <= -709.0) {
+      h[i] = 0.0; l[i] = 0.0;
+    } else if (x[i] >= 709.0) {
+      h[i] = dd_real::_inf.x[0]; l[i] = 0.0;
+    } else if (QD_ISNAN(x[i])) {
+      h[i] = dd_real::_nan.x[0]; l[i] = dd_real::_nan.x[1];
+    } else {
+      int e = static_cast<int>(m[i]);
+      h[i] = std::ldexp(h[i], e);
+      l[i] = std::ldexp(l[i], e);
+    }
   }
+}
 
-  dd_real x = std::log(a.x[0]);   /* Initial approximation */
+}
 
-  x = x + a * exp(-x) - 1.0;
-  return x;
+void dd_exp_n(const dd_real *a, dd_real *b, size_t n) {
+  double h[batch_size], l[batch_size];
+  for (size_t first = 0; first < n; first += batch_size) {
+    int len = static_cast<int>(std::min<size_t>(batch_size, n - first));
+    for (int i = 0; i < len; ++i) {
+      h[i] = a[first + i].x[0];
+      l[i] = a[first + i].x[1];
+    }
+    exp_lanes(h, l, len);
+    for (int i = 0; i < len; ++i)
+      b[first + i] = dd_real(h[i], l[i]);
+  }
 }
 
-dd_real log10(const dd_real &a) {
-  return log(a) / dd_real::_log10;
+/* One Newton step x' = x + a exp(-x) - 1 from x = log(a.hi), as in log.
+   log(0) is -Inf and the log of a negative number is NaN. */
+void dd_log_n(const dd_real *a, dd_real *b, size_t n) {
+  double x[batch_size], h[batch_size], l[batch_size];
+  for (size_t first = 0; first < n; first += batch_size) {
+    int len = static_cast<int>(std::min<size_t>(batch_size, n - first));
+    const dd_real *ab = a + first;
+    for (int i = 0; i < len; ++i) {
+      x[i] = std::log(ab[i].x[0]);
+      h[i] = -x[i];
+      l[i] = 0.0;
+    }
+    exp_lanes(h, l, len);
+    for (int i = 0; i < len; ++i) {
+      mul_lanes(ab[i].x[0], ab[i].x[1], h[i], l[i], h[i], l[i]);
+      add_lanes(h[i], l[i], x[i], 0.0, h[i], l[i]);
+      add_lanes(h[i], l[i], -1.0, 0.0, h[i], l[i]);
+    }
+    for (int i = 0; i < len; ++i) {
+      double ah = ab[i].x[0];
+      if (ah == 1.0 && ab[i].x[1] == 0.0)
+        b[first + i] = 0.0;
+      else if (ah == 0.0)
+        b[first + i] = -dd_real::_inf;
+      else if (!(ah > 0.0))
+        b[first + i] = dd_real::_nan;
+      else if (QD_ISINF(ah))
+        b[first + i] = dd_real::_inf;
+      else
+        b[first + i] = dd_real(h[i], l[i]);
+    }
+  }
 }
 
-static const dd_real _pi16 = dd_real(1.963495408493620697e-01,
-                                     7.654042494670957545e-18);
+static constexpr dd_real _pi16 = dd_real(1.963495408493620697e-01,
+                                         7.654042494670957545e-18);
 
 /* Table of sin(k * pi/16) and cos(k * pi/16). */
-static const double sin_table [4][2] = {
+static constexpr double sin_table [4][2] = {
   {1.950903220161282758e-01, -7.991079068461731263e-18},
   {3.826834323650897818e-01, -1.005077269646158761e-17},
   {5.555702330196021776e-01,  4.709410940561676821e-17},
   {7.071067811865475727e-01, -4.833646656726456726e-17}
 };
 
-static const double cos_table [4][2] = {
+static constexpr double cos_table [4][2] = {
   {9.807852804032304306e-01, 1.854693999782500573e-17},
   {9.238795325112867385e-01, 1.764504708433667706e-17},
   {8.314696123025452357e-01, 1.407385698472802389e-18},
   {7.071067811865475727e-01, -4.833646656726456726e-17}
 };
 
-/* Computes sin(a) using Taylor series.
-   Assumes |a| <= pi/32.                           */
+/* Computes sin(a) and cos(a) using Taylor series.
+   Assumes |a| <= pi/32, where the terms up to a^17/17!
+   (resp. a^16/16!) are enough.                    */
 static dd_real sin_taylor(const dd_real &a) {
-  const double thresh = 0.5 * std::abs(to_double(a)) * dd_real::_eps;
-  dd_real r, s, t, x;
-
   if (a.is_zero()) {
     return 0.0;
   }
 
-  int i = 0;
-  x = -sqr(a);
-  s = a;
-  r = a;
-  do {
-    r *= x;
-    t = r * dd_real(inv_fact[i][0], inv_fact[i][1]);
-    s += t;
-    i += 2;
-  } while (i < n_inv_fact && std::abs(to_double(t)) > thresh);
-
-  return s;
+  return a * qd::poly::estrin<9>(sqr(a), qd::poly::sin_series);
 }
 
 static dd_real cos_taylor(const dd_real &a) {
-  const double thresh = 0.5 * dd_real::_eps;
-  dd_real r, s, t, x;
-
   if (a.is_zero()) {
     return 1.0;
   }
 
-  x = -sqr(a);
-  r = x;
-  s = 1.0 + mul_pwr2(r, 0.5);
-  int i = 1;
-  do {
-    r *= x;
-    t = r * dd_real(inv_fact[i][0], inv_fact[i][1]);
-    s += t;
-    i += 2;
-  } while (i < n_inv_fact && std::abs(to_double(t)) > thresh);
-
-  return s;
+  return qd::poly::estrin<9>(sqr(a), qd::poly::cos_series);
 }
 
 static void sincos_taylor(const dd_real &a, 
@@ -62,13 +62,10 @@
 struct QD_API dd_real {
   double x[2];
 
-  dd_real(double hi, double lo) { x[0] = hi; x[1] = lo; }
-  dd_real() {x[0] = 0.0; x[1] = 0.0; }
-  dd_real(double h) { x[0] = h; x[1] = 0.0; }
-  dd_real(int h) {
-    x[0] = (static_cast<double>(h));
-    x[1] = 0.0;
-  }
+  constexpr dd_real(double hi, double lo) : x{hi, lo} {}
+  constexpr dd_real() : x{0.0, 0.0} {}
+  constexpr dd_real(double h) : x{h, 0.0} {}
+  constexpr dd_real(int h) : x{static_cast<double>(h), 0.0} {}
   
   inline dd_real(std::ptrdiff_t h) // for Eigen use
   {
@@ -76,9 +73,7 @@ struct QD_API dd_real {
   }
 
   dd_real (const char *s);
-  explicit dd_real (const double *d) {
-    x[0] = d[0]; x[1] = d[1];
-  }
+  explicit constexpr dd_real (const double *d) : x{d[0], d[1]} {}
 
   static void error(const char *msg);
 
@@ -96,11 +91,11 @@ struct QD_API dd_real {
   static const dd_real _nan;
   static const dd_real _inf;
 
-  static const double _eps;
-  static const double _min_normalized;
+  static constexpr double _eps = 4.93038065763132e-32;  // 2^-104
+  static constexpr double _min_normalized = 2.0041683600089728e-292;  // = 2^(-1022 + 53)
   static const dd_real _max;
   static const dd_real _safe_max;
-  static const int _ndigits;
+  static constexpr int _ndigits = 31;
 
   bool isnan() const { return QD_ISNAN(x[0]) || QD_ISNAN(x[1]); }
   bool isfinite() const { return QD_ISFINITE(x[0]); }
@@ -263,6 +258,10 @@ QD_API dd_real ldexp(const dd_real &a, int exp);
 QD_API dd_real log(const dd_real &a);
 QD_API dd_real log10(const dd_real &a);
 
+/* b[i] = exp(a[i]) and b[i] = log(a[i]) for i < n; b may be a */
+QD_API void dd_exp_n(const dd_real *a, dd_real *b, size_t n);
+QD_API void dd_log_n(const dd_real *a, dd_real *b, size_t n);
+
 QD_API dd_real sin(const dd_real &a);
 QD_API dd_real cos(const dd_real &a);
 QD_API dd_real tan(const dd_real &a);
@@ -290,6 +289,34 @@ QD_API dd_real fmod(const dd_real &a, const dd_real &b);
 
 QD_API std::ostream& operator<<(std::ostream &s, const dd_real &a);
 QD_API std::istream& operator>>(std::istream &s, dd_real &a);
+
+/* The constants are constexpr, so that the compiler folds them into the
+   code using them instead of loading globals initialized at run time. */
+inline constexpr dd_real dd_real::_2pi = dd_real(6.283185307179586232e+00,
+                                                 2.449293598294706414e-16);
+inline constexpr dd_real dd_real::_pi = dd_real(3.141592653589793116e+00,
+                                                1.224646799147353207e-16);
+inline constexpr dd_real dd_real::_pi2 = dd_real(1.570796326794896558e+00,
+                                                 6.123233995736766036e-17);
+inline constexpr dd_real dd_real::_pi4 = dd_real(7.853981633974482790e-01,
+                                                 3.061616997868383018e-17);
+inline constexpr dd_real dd_real::_3pi4 = dd_real(2.356194490192344837e+00,
+                                                  9.1848509936051484375e-17);
+inline constexpr dd_real dd_real::_e = dd_real(2.718281828459045091e+00,
+                                               1.445646891729250158e-16);
+inline constexpr dd_real dd_real::_log2 = dd_real(6.931471805599452862e-01,
+                                                  2.319046813846299558e-17);
+inline constexpr dd_real dd_real::_log10 = dd_real(2.302585092994045901e+00,
+                                                   -2.170756223382249351e-16);
+inline constexpr dd_real dd_real::_nan = dd_real(
+    std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+inline constexpr dd_real dd_real::_inf = dd_real(
+    std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+inline constexpr dd_real dd_real::_max =
+    dd_real(1.79769313486231570815e+308, 9.97920154767359795037e+291);
+inline constexpr dd_real dd_real::_safe_max =
+    dd_real(1.7976931080746007281e+308, 9.97920154767359795037e+291);
+
 #ifdef QD_INLINE
 #include "dd_inline.h"
 #endif
@@ -8,7 +8,8 @@
  * Copyright (c) 2000-2001
  *
  * Contains functions to set and restore the round-to-double flag in the
- * control word of a x86 FPU.
+ * control word of a x86 FPU, and the rounding and denormal modes of the
+ * SSE unit.
  */
 
 #include "qd_config.h"
@@ -42,25 +43,33 @@
 #endif
 #endif /* X86 */
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define QD_SSE_CSR 1
+
+/* MXCSR bits that change double results: the rounding mode (13-14),
+   flush-to-zero (15) and denormals-are-zero (6).  Shared objects linked
+   with -ffast-math set the last two when they are loaded, for the whole
+   process. */
+static const unsigned int sse_mask = 0xE040;
+#endif
+
 extern "C" {
 
 void fpu_fix_start(unsigned int *old_cw) {
+  unsigned int saved = 0;
 #ifdef X86
 #ifdef _WIN32
 #ifdef __BORLANDC__
   /* Win 32 Borland C */
   unsigned short cw = _control87(0, 0);
   _control87(0x0200, 0x0300);
-  if (old_cw) {
-    *old_cw = cw;
-  }
+  saved = cw;
 #else
   /* Win 32 MSVC */
   unsigned int cw = _control87(0, 0);
   _control87(0x00010000, 0x00030000);
-  if (old_cw) {
-    *old_cw = cw;
-  }
+  saved = cw;
 #endif
 #else
   /* Linux */
@@ -70,38 +79,49 @@ void fpu_fix_start(unsigned int *old_cw) {
   new_cw = (cw & ~_FPU_EXTENDED) | _FPU_DOUBLE;
   _FPU_SETCW(new_cw);
   
-  if (old_cw) {
-    *old_cw = cw;
-  }
+  saved = cw;
 #endif
 #endif
+
+#ifdef QD_SSE_CSR
+  /* SSE: round to nearest, keep the denormals.  The register only uses
+     the low 16 bits, which go into the high half of the saved word. */
+  unsigned int csr = _mm_getcsr();
+  _mm_setcsr(csr & ~sse_mask);
+  saved |= csr << 16;
+#endif
+
+  if (old_cw) {
+    *old_cw = saved;
+  }
 }
 
 void fpu_fix_end(unsigned int *old_cw) {
+  if (!old_cw) {
+    return;
+  }
+
 #ifdef X86
 #ifdef _WIN32
 
 #ifdef __BORLANDC__
   /* Win 32 Borland C */
-  if (old_cw) {
-    unsigned short cw = (unsigned short) *old_cw;
-    _control87(cw, 0xFFFF);
-  }
+  unsigned short cw = (unsigned short) *old_cw;
+  _control87(cw, 0xFFFF);
 #else
   /* Win 32 MSVC */
-  if (old_cw) {
-    _control87(*old_cw, 0xFFFFFFFF);
-  }
+  _control87(*old_cw, 0xFFFFFFFF);
 #endif
 
 #else
   /* Linux */
-  if (old_cw) {
-    int cw;
-    cw = *old_cw;
-    _FPU_SETCW(cw);
-  }
+  volatile unsigned short cw = (unsigned short) (*old_cw & 0xFFFF);
+  _FPU_SETCW(cw);
+#endif
 #endif
+
+#ifdef QD_SSE_CSR
+  _mm_setcsr(*old_cw >> 16);
 #endif
 }
 
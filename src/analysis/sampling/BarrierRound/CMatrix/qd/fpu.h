@@ -23,7 +23,9 @@ extern "C" {
 
 /*
  * Set the round-to-double flag, and save the old control word in old_cw.
- * If old_cw is NULL, the old control word is not saved.
+ * If old_cw is NULL, the old control word is not saved.  With SSE, also
+ * set round to nearest and clear flush-to-zero and denormals-are-zero;
+ * the old SSE control register is saved in the high 16 bits of old_cw.
  */
 QD_API void fpu_fix_start(unsigned int *old_cw);
 
@@ -33,6 +35,24 @@ QD_API void fpu_fix_start(unsigned int *old_cw);
 QD_API void fpu_fix_end(unsigned int *old_cw);
 
 #ifdef __cplusplus
+}
+
+namespace qd {
+
+/* fpu_fix_start for the lifetime of the object, fpu_fix_end on exit.
+   The modes belong to the thread, so every thread running dd_real or
+   qd_real code needs its own guard. */
+class fpu_guard {
+public:
+  fpu_guard() { fpu_fix_start(&old_cw); }
+  ~fpu_guard() { fpu_fix_end(&old_cw); }
+  fpu_guard(const fpu_guard &) = delete;
+  fpu_guard &operator=(const fpu_guard &) = delete;
+
+private:
+  unsigned int old_cw;
+};
+
 }
 #endif
 
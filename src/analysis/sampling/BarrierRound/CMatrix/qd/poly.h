@@ -0,0 +1,154 @@
+/*
+ * include/poly.h
+ *
+ * Polynomial evaluation for the elementary functions of dd_real,
+ * td_real and qd_real.  The coefficients are constexpr tables of
+ * quad-double values (four components, leading first); the smaller
+ * types read the leading components through their T(const double *)
+ * constructor.  horner and estrin are expanded at compile time for a
+ * fixed number of terms, so the evaluation inlines into the caller as
+ * straight-line code without a data-dependent stopping test.
+ */
+#ifndef _QD_POLY_H
+#define _QD_POLY_H
+
+#include <cstddef>
+
+namespace qd {
+namespace poly {
+
+/* The coefficients c[0], ..., c[N-1] of a polynomial. */
+template <std::size_t N>
+struct table {
+  double c[N][4];
+};
+
+/* 1/k! for k = 0, ..., 17 */
+constexpr table<18> inv_fact = {{
+  { 1.0, 0.0, 0.0, 0.0},
+  { 1.0, 0.0, 0.0, 0.0},
+  { 0.5, 0.0, 0.0, 0.0},
+  { 1.66666666666666657e-01,  9.25185853854297066e-18,
+    5.13581318503262866e-34,  2.85094902409834186e-50},
+  { 4.16666666666666644e-02,  2.31296463463574266e-18,
+    1.28395329625815716e-34,  7.12737256024585466e-51},
+  { 8.33333333333333322e-03,  1.15648231731787138e-19,
+    1.60494162032269652e-36,  2.22730392507682967e-53},
+  { 1.38888888888888894e-03, -5.30054395437357706e-20,
+   -1.73868675534958776e-36, -1.63335621172300840e-52},
+  { 1.98412698412698413e-04,  1.72095582934207053e-22,
+    1.49269123913941271e-40,  1.29470326746002471e-58},
+  { 2.48015873015873016e-05,  2.15119478667758816e-23,
+    1.86586404892426588e-41,  1.61837908432503088e-59},
+  { 2.75573192239858925e-06, -1.85839327404647208e-22,
+    8.49175460488199287e-39, -5.72661640789429621e-55},
+  { 2.75573192239858883e-07,  2.37677146222502973e-23,
+   -3.26318890334088294e-40,  1.61435111860404415e-56},
+  { 2.50521083854417202e-08, -1.44881407093591197e-24,
+    2.04267351467144546e-41, -8.49632672007163175e-58},
+  { 2.08767569878681002e-09, -1.20734505911325997e-25,
+    1.70222792889287100e-42,  1.41609532150396700e-58},
+  { 1.60590438368216133e-10,  1.25852945887520981e-26,
+   -5.31334602762985031e-43,  3.54021472597605528e-59},
+  { 1.14707455977297245e-11,  2.06555127528307454e-28,
+    6.88907923246664603e-45,  5.72920002655109095e-61},
+  { 7.64716373181981641e-13,  7.03872877733453001e-30,
+   -7.82753927716258345e-48,  1.92138649443790242e-64},
+  { 4.77947733238738525e-14,  4.39920548583408126e-31,
+   -4.89221204822661465e-49,  1.20086655902368901e-65},
+  { 2.81145725434552060e-15,  1.65088427308614326e-31,
+   -2.87777179307447918e-50,  4.27110689256293549e-67}
+}};
+
+/* c[j] = (+-1)^j / (first + j * step)!, the signs alternating if
+   alternate is set. */
+template <std::size_t N>
+constexpr table<N> taylor(std::size_t first, std::size_t step,
+                          bool alternate) {
+  table<N> t{};
+  for (std::size_t j = 0; j < N; ++j)
+    for (int i = 0; i < 4; ++i) {
+      double c = inv_fact.c[first + j * step][i];
+      t.c[j][i] = (alternate && j % 2 == 1) ? -c : c;
+    }
+  return t;
+}
+
+/* exp(r) - 1 = r * (1 + r/2! + r^2/3! + ...) */
+constexpr table<12> exp_series = taylor<12>(1, 1, false);
+
+/* sin(a) = a * (1 - a^2/3! + a^4/5! - ...), in x = a^2 */
+constexpr table<9> sin_series = taylor<9>(1, 2, true);
+
+/* cos(a) = 1 - a^2/2! + a^4/4! - ..., in x = a^2 */
+constexpr table<9> cos_series = taylor<9>(0, 2, true);
+
+namespace detail {
+
+/* the largest power of two below n, for n >= 2 */
+constexpr std::size_t split(std::size_t n) {
+  std::size_t h = 1;
+  while (2 * h < n)
+    h *= 2;
+  return h;
+}
+
+constexpr int log2(std::size_t h) {
+  int k = 0;
+  while (h > 1) {
+    h /= 2;
+    ++k;
+  }
+  return k;
+}
+
+/* c[I] + c[I+1] x + ... + c[N-1] x^(N-1-I) */
+template <std::size_t I, std::size_t N, typename T, std::size_t M>
+inline T horner(const T &x, const table<M> &c) {
+  if constexpr (I + 1 == N)
+    return T(c.c[I]);
+  else
+    return T(c.c[I]) + x * horner<I + 1, N>(x, c);
+}
+
+/* c[I] + c[I+1] x + ... + c[I+N-1] x^(N-1) with pw[k] = x^(2^k) */
+template <std::size_t I, std::size_t N, typename T, std::size_t M>
+inline T estrin(const T *pw, const table<M> &c) {
+  if constexpr (N == 1) {
+    return T(c.c[I]);
+  } else {
+    constexpr std::size_t h = split(N);
+    return estrin<I, h>(pw, c) + pw[log2(h)] * estrin<I + h, N - h>(pw, c);
+  }
+}
+
+}
+
+/* c[0] + c[1] x + ... + c[N-1] x^(N-1) by Horner's rule:  N-1
+   multiplications and additions, each depending on the previous one. */
+template <std::size_t N, typename T, std::size_t M>
+inline T horner(const T &x, const table<M> &c) {
+  static_assert(N >= 1 && N <= M, "horner: not enough coefficients");
+  return detail::horner<0, N>(x, c);
+}
+
+/* The same polynomial by Estrin's scheme:  the halves are evaluated
+   independently and joined with x^(2^k), so the chain of dependent
+   operations is about 2 log2(N) long instead of 2 N.  The multiword
+   operations are long and latency bound, so the independent halves
+   overlap in the pipeline. */
+template <std::size_t N, typename T, std::size_t M>
+inline T estrin(const T &x, const table<M> &c) {
+  static_assert(N >= 1 && N <= M, "estrin: not enough coefficients");
+  constexpr int levels = N > 1 ? detail::log2(detail::split(N)) : 0;
+  T pw[levels + 1];
+  pw[0] = x;
+  for (int k = 1; k <= levels; ++k)
+    pw[k] = pw[k - 1] * pw[k - 1];
+  return detail::estrin<0, N>(pw, c);
+}
+
+}
+}
+
+#endif /* _QD_POLY_H */
@@ -31,6 +31,14 @@
 /* #undef QD_FMS */
 #endif
 
+/* QD_DETERMINISTIC is defined by the deterministic build of compile.m,
+   which promises results that are the same bits on every machine: no
+   contraction into fused multiply-adds and none of the -ffast-math
+   rewrites that break the error-free transformations. */
+#if defined(QD_DETERMINISTIC) && defined(__FAST_MATH__)
+#error "QD_DETERMINISTIC cannot be combined with -ffast-math"
+#endif
+
 /* Set the following to 1 to define commonly used function
    to be inlined.  This should be set to 1 unless the compiler 
    does not support the "inline" keyword, or if building for 
@@ -73,6 +81,15 @@
 #define QD_SLOPPY_DIV 1
 #endif
 
+/* Define X86 on 32-bit x86, where double arithmetic may go through the
+   x87 unit and fpu_fix_start has to set its precision to double.  On
+   x86-64 the doubles use SSE2 and only its control register is set. */
+#ifndef X86
+#if defined(__i386__) || defined(_M_IX86)
+#define X86 1
+#endif
+#endif
+
 /* Define this macro to be the isfinite(x) function. */
 #ifndef QD_ISFINITE
 #define QD_ISFINITE(x) std::isfinite(x)
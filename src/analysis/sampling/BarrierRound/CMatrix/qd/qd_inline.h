@@ -20,44 +20,6 @@
 #define inline
 #endif
 
-/********** Constructors **********/
-inline qd_real::qd_real(double x0, double x1, double x2, double x3) {
-  x[0] = x0;
-  x[1] = x1;
-  x[2] = x2;
-  x[3] = x3;
-}
-
-inline qd_real::qd_real(const double *xx) {
-  x[0] = xx[0];
-  x[1] = xx[1];
-  x[2] = xx[2];
-  x[3] = xx[3];
-}
-
-inline qd_real::qd_real(double x0) {
-  x[0] = x0;
-  x[1] = x[2] = x[3] = 0.0;
-}
-
-inline qd_real::qd_real() {
-	x[0] = 0.0; 
-	x[1] = 0.0; 
-	x[2] = 0.0; 
-	x[3] = 0.0; 
-}
-
-inline qd_real::qd_real(const dd_real &a) {
-  x[0] = a._hi();
-  x[1] = a._lo();
-  x[2] = x[3] = 0.0;
-}
-
-inline qd_real::qd_real(int i) {
-  x[0] = static_cast<double>(i);
-  x[1] = x[2] = x[3] = 0.0;
-}
-
 /********** Accessors **********/
 inline double qd_real::operator[](int i) const {
   return x[i];
@@ -545,7 +507,7 @@ inline qd_real operator*(const qd_real &a, const dd_real &b) {
   s2 = t0 + t1 + p4;
   p2 = s0;
 
-  p3 = a[2] * b._hi() + a[3] * b._lo() + q3 + q4;
+  p3 = a[2] * b._lo() + a[3] * b._hi() + q3 + q4;
   qd::three_sum2(p3, q0, s1);
   p4 = q0 + s2;
 
@@ -21,6 +21,7 @@
 #include "qd_config.h"
 #include "qd_real.h"
 #include "util.h"
+#include "poly.h"
 
 #include "bits.h"
 
@@ -644,6 +645,54 @@ void qd_real::dump(const string &name, std::ostream &os) const {
   os.flags(old_flags);
 }
 
+/* Starting values of the precision-doubling Newton iterations:  the
+   double estimate and one Newton step in double-double arithmetic,
+   which is accurate to about 2^-104. */
+
+/* 1/b:  y' = y + y (1 - b y) */
+static dd_real inv_dd(const qd_real &b) {
+  double y = 1.0 / b[0];
+  dd_real e = dd_real(1.0) - dd_real(b[0], b[1]) * y;
+  return dd_real::add(y, e.x[0] * y);
+}
+
+/* 1/sqrt(a):  y' = y + y (1 - a y^2) / 2 */
+static dd_real rsqrt_dd(const qd_real &a) {
+  double y = 1.0 / std::sqrt(a[0]);
+  dd_real e = dd_real(1.0) - dd_real(a[0], a[1]) * dd_real::sqr(y);
+  return dd_real::add(y, e.x[0] * (y * 0.5));
+}
+
+/* The low parts of 1/b and 1/b^2 underflow, and 1.0 / b[0] itself is
+   Inf for a subnormal b, near the ends of the exponent range.  Outside
+   [2^-900, 2^900] the argument is scaled by 2^-600 or 2^600, which is
+   exact, and the result scaled back; 1 inside the range and for Inf.
+   Zero is left to the callers, which return before scaling it. */
+static double newton_scale(double b) {
+  if ((b > 0x1p900 || b < -0x1p900) && !QD_ISINF(b))
+    return 0x1p-600;
+  if (b < 0x1p-900 && b > -0x1p-900)
+    return 0x1p600;
+  return 1.0;
+}
+
+/* a / b by Karp and Markstein's division, for b[0] inside the range of
+   newton_scale. */
+static qd_real newton_div(const qd_real &a, const qd_real &b) {
+  dd_real y = inv_dd(b);
+  dd_real q0 = dd_real(a[0], a[1]) * y;
+  qd_real r = a - b * q0;
+
+  dd_real q1 = dd_real(r[0], r[1]) * y;
+  r -= b * q1;
+
+  double c0 = q0._hi(), c1 = q0._lo(), c2 = q1._hi(), c3 = q1._lo();
+  double c4 = r[0] * y._hi();
+
+  ::renorm(c0, c1, c2, c3, c4);
+  return qd_real(c0, c1, c2, c3);
+}
+
 /* Divisions */
 /* quad-double / double-double */
 qd_real qd_real::sloppy_div(const qd_real &a, const dd_real &b) {
@@ -691,24 +740,29 @@ qd_real qd_real::accurate_div(const qd_real &a, const dd_real &b) {
 
 /* quad-double / quad-double */
 qd_real qd_real::sloppy_div(const qd_real &a, const qd_real &b) {
-  double q0, q1, q2, q3;
-
-  qd_real r;
-
-  q0 = a[0] / b[0];
-  r = a - (b * q0);
-
-  q1 = r[0] / b[0];
-  r -= (b * q1);
-
-  q2 = r[0] / b[0];
-  r -= (b * q2);
-
-  q3 = r[0] / b[0];
-
-  ::renorm(q0, q1, q2, q3);
-
-  return qd_real(q0, q1, q2, q3);
+  /* Strategy:  Karp and Markstein's division.  With y = 1/b to double-
+     double precision (inv_dd), q0 = a y is the quotient to about 2^-104
+     and each correction
+
+       q' = q + y (a - b q)
+
+     adds as many bits again.  Only the remainder needs quad-double
+     arithmetic; the corrections are small enough for double-double
+     and double.  This replaces the four sequential double divisions
+     of the long division in accurate_div by multiplications.
+
+     A zero, Inf or NaN divisor, and a quotient that overflows, give the
+     double quotient a[0] / b[0]: +-Inf or NaN as IEEE division, where
+     the corrections would compute Inf - Inf. */
+  if (b[0] == 0.0 || !QD_ISFINITE(b[0]))
+    return qd_real(a[0] / b[0]);
+
+  double k = newton_scale(b[0]);
+  qd_real q = (k == 1.0) ? newton_div(a, b)
+                         : newton_div(mul_pwr2(a, k), mul_pwr2(b, k));
+  if (!QD_ISFINITE(q[0]))
+    return qd_real(a[0] / b[0]);
+  return q;
 }
 
 qd_real qd_real::accurate_div(const qd_real &a, const qd_real &b) {
@@ -736,18 +790,14 @@ qd_real qd_real::accurate_div(const qd_real &a, const qd_real &b) {
 }
 
 QD_API qd_real sqrt(const qd_real &a) {
-  /* Strategy:  
+  /* Strategy:  Karp's trick.  With y = 1/sqrt(a) to double-double
+     precision (rsqrt_dd), s0 = a y is sqrt(a) to about 2^-104 and each
+     Newton step
 
-     Perform the following Newton iteration:
+       s' = s + y (a - s^2) / 2
 
-       x' = x + (1 - a * x^2) * x / 2;
-       
-     which converges to 1/sqrt(a), starting with the
-     double precision approximation to 1/sqrt(a).
-     Since Newton's iteration more or less doubles the
-     number of correct digits, we only need to perform it 
-     twice.
-  */
+     adds as many bits again.  As for the division, only the residual
+     a - s^2 needs quad-double arithmetic. */
 
   if (a.is_zero())
     return 0.0;
@@ -757,15 +807,55 @@ QD_API qd_real sqrt(const qd_real &a) {
     return qd_real::_nan;
   }
 
-  qd_real r = (1.0 / std::sqrt(a[0]));
-  qd_real h = mul_pwr2(a, 0.5);
+  /* sqrt(a) = sqrt(a k) / sqrt(k) */
+  double k = newton_scale(a[0]);
+  if (k != 1.0)
+    return mul_pwr2(sqrt(mul_pwr2(a, k)), 1.0 / std::sqrt(k));
 
-  r += ((0.5 - h * sqr(r)) * r);
-  r += ((0.5 - h * sqr(r)) * r);
-  r += ((0.5 - h * sqr(r)) * r);
+  dd_real y = rsqrt_dd(a);
+  dd_real h = mul_pwr2(y, 0.5);
+  dd_real s0 = dd_real(a[0], a[1]) * y;
+  qd_real r = a - qd_real(s0) * s0;
 
-  r *= a;
-  return r;
+  /* a - (s0 + s1)^2 = r - (2 s0 + s1) s1 */
+  dd_real s1 = dd_real(r[0], r[1]) * h;
+  r -= (qd_real(mul_pwr2(s0, 2.0)) + s1) * s1;
+
+  double c0 = s0._hi(), c1 = s0._lo(), c2 = s1._hi(), c3 = s1._lo();
+  double c4 = r[0] * h._hi();
+
+  ::renorm(c0, c1, c2, c3, c4);
+  return qd_real(c0, c1, c2, c3);
+}
+
+/* 1/sqrt(a) by the same Newton steps y' = y + y (1 - a y^2) / 2 from
+   the double-double rsqrt_dd. */
+QD_API qd_real rsqrt(const qd_real &a) {
+  if (a.is_zero())
+    return qd_real::_inf;
+
+  if (a.is_negative()) {
+    qd_real::error("(qd_real::rsqrt): Negative argument.");
+    return qd_real::_nan;
+  }
+
+  /* 1/sqrt(a) = sqrt(k) / sqrt(a k) */
+  double k = newton_scale(a[0]);
+  if (k != 1.0)
+    return mul_pwr2(rsqrt(mul_pwr2(a, k)), std::sqrt(k));
+
+  dd_real y0 = rsqrt_dd(a);
+  qd_real e = 1.0 - a * (qd_real(y0) * y0);
+
+  /* 1 - a (y0 + y1)^2 = e - a (2 y0 + y1) y1 */
+  dd_real y1 = dd_real(e[0], e[1]) * mul_pwr2(y0, 0.5);
+  e -= a * ((qd_real(mul_pwr2(y0, 2.0)) + y1) * y1);
+
+  double c0 = y0._hi(), c1 = y0._lo(), c2 = y1._hi(), c3 = y1._lo();
+  double c4 = e[0] * (y0._hi() * 0.5);
+
+  ::renorm(c0, c1, c2, c3, c4);
+  return qd_real(c0, c1, c2, c3);
 }
 
 
@@ -819,40 +909,6 @@ qd_real nroot(const qd_real &a, int n) {
 	return 1.0 / x;
 }
 
-static const int n_inv_fact = 15;
-static const qd_real inv_fact[n_inv_fact] = {
-  qd_real( 1.66666666666666657e-01,  9.25185853854297066e-18,
-           5.13581318503262866e-34,  2.85094902409834186e-50),
-  qd_real( 4.16666666666666644e-02,  2.31296463463574266e-18,
-           1.28395329625815716e-34,  7.12737256024585466e-51),
-  qd_real( 8.33333333333333322e-03,  1.15648231731787138e-19,
-           1.60494162032269652e-36,  2.22730392507682967e-53),
-  qd_real( 1.38888888888888894e-03, -5.30054395437357706e-20,
-          -1.73868675534958776e-36, -1.63335621172300840e-52),
-  qd_real( 1.98412698412698413e-04,  1.72095582934207053e-22,
-           1.49269123913941271e-40,  1.29470326746002471e-58),
-  qd_real( 2.48015873015873016e-05,  2.15119478667758816e-23,
-           1.86586404892426588e-41,  1.61837908432503088e-59),
-  qd_real( 2.75573192239858925e-06, -1.85839327404647208e-22,
-           8.49175460488199287e-39, -5.72661640789429621e-55),
-  qd_real( 2.75573192239858883e-07,  2.37677146222502973e-23,
-          -3.26318890334088294e-40,  1.61435111860404415e-56),
-  qd_real( 2.50521083854417202e-08, -1.44881407093591197e-24,
-           2.04267351467144546e-41, -8.49632672007163175e-58),
-  qd_real( 2.08767569878681002e-09, -1.20734505911325997e-25,
-           1.70222792889287100e-42,  1.41609532150396700e-58),
-  qd_real( 1.60590438368216133e-10,  1.25852945887520981e-26,
-          -5.31334602762985031e-43,  3.54021472597605528e-59),
-  qd_real( 1.14707455977297245e-11,  2.06555127528307454e-28,
-           6.88907923246664603e-45,  5.72920002655109095e-61),
-  qd_real( 7.64716373181981641e-13,  7.03872877733453001e-30,
-          -7.82753927716258345e-48,  1.92138649443790242e-64),
-  qd_real( 4.77947733238738525e-14,  4.39920548583408126e-31,
-          -4.89221204822661465e-49,  1.20086655902368901e-65),
-  qd_real( 2.81145725434552060e-15,  1.65088427308614326e-31,
-          -2.87777179307447918e-50,  4.27110689256293549e-67)
-};
-
 qd_real exp(const qd_real &a) {
   /* Strategy:  We first reduce the size of x by noting that
      
@@ -861,7 +917,9 @@ qd_real exp(const qd_real &a) {
      where m and k are integers.  By choosing m appropriately
      we can make |kr| <= log(2) / 2 = 0.347.  Then exp(r) is 
      evaluated using the familiar Taylor series.  Reducing the 
-     argument substantially speeds up the convergence.       */  
+     argument substantially speeds up the convergence.  With
+     |r| <= 5.3e-6 the terms up to r^11/11! are enough, and they
+     are summed by Horner's rule without a stopping test.    */  
 
   const double k = ldexp(1.0, 16);
   const double inv_k = 1.0 / k;
@@ -880,17 +938,9 @@ qd_real exp(const qd_real &a) {
 
   double m = std::floor(a.x[0] / qd_real::_log2.x[0] + 0.5);
   qd_real r = mul_pwr2(a - qd_real::_log2 * m, inv_k);
-  qd_real s, p, t;
-  double thresh = inv_k * qd_real::_eps;
 
-  p = sqr(r);
-  s = r + mul_pwr2(p, 0.5);
-  int i = 0;
-  do {
-    p *= r;
-    t = p * inv_fact[i++];
-    s += t;
-  } while (std::abs(to_double(t)) > thresh && i < 9);
+  /* s = exp(r) - 1 */
+  qd_real s = r * qd::poly::horner<11>(r, qd::poly::exp_series);
 
   s = mul_pwr2(s, 2.0) + sqr(s);
   s = mul_pwr2(s, 2.0) + sqr(s);
@@ -957,12 +1007,109 @@ qd_real log10(const qd_real &a) {
   return log(a) / qd_real::_log10;
 }
 
-static const qd_real _pi1024 = qd_real(
+/* Batched exponential and logarithm:  b[i] = exp(a[i]) (resp. log(a[i]))
+   for 0 <= i < n, where b may be the same array as a.  Elements are
+   processed in blocks: each step of exp (argument reduction, the Taylor
+   terms, the squarings) is done for the whole block before the next one,
+   with a fixed number of terms, so that the independent operations of
+   different elements overlap instead of waiting on each other.  Unlike
+   the double-double version there are no SIMD lanes, since quad-double
+   renormalization branches on the data.                                */
+namespace {
+
+const int batch_size = 64;
+
+/* y[i] = exp(x[i]) for i < n <= batch_size; y may be x */
+void exp_block(const qd_real *x, qd_real *y, int n) {
+  const double inv_k = ldexp(1.0, -16);
+  qd_real r[batch_size], s[batch_size];
+  double m[batch_size], a[batch_size];
+
+  /* exp(a) = 2^m exp(r)^65536 with a = m log(2) + 65536 r.
+     Lanes out of range (or NaN) are reduced from 0 and fixed below. */
+  for (int i = 0; i < n; ++i) {
+    a[i] = x[i][0];
+    bool in_range = std::abs(a[i]) < 709.0;
+    m[i] = in_range ? std::floor(a[i] / qd_real::_log2.x[0] + 0.5) : 0.0;
+    r[i] = in_range ? mul_pwr2(x[i] - qd_real::_log2 * m[i], inv_k) : qd_real(0.0);
+  }
+
+  /* s = r (1 + r/2! + ... + r^10/11!) by Horner's rule, as in exp */
+  const qd::poly::table<12> &c = qd::poly::exp_series;
+  for (int i = 0; i < n; ++i)
+    s[i] = qd_real(c.c[10]);
+  for (int k = 9; k >= 0; --k) {
+    const qd_real ck(c.c[k]);
+    for (int i = 0; i < n; ++i)
+      s[i] = s[i] * r[i] + ck;
+  }
+  for (int i = 0; i < n; ++i)
+    s[i] *= r[i];
+
+  /* (1 + s)^2 - 1 = 2 s + s^2, sixteen times */
+  for (int k = 0; k < 16; ++k)
+    for (int i = 0; i < n; ++i)
+      s[i] = mul_pwr2(s[i], 2.0) + sqr(s[i]);
+
+  for (int i = 0; i < n; ++i) {
+    if (a[i] <= -709.0)
+      y[i] = 0.0;
+    else if (a[i] >= 709.0)
+      y[i] = qd_real::_inf;
+    else if (QD_ISNAN(a[i]))
+      y[i] = qd_real::_nan;
+    else
+      y[i] = ldexp(s[i] + 1.0, static_cast<int>(m[i]));
+  }
+}
+
+}
+
+void qd_exp_n(const qd_real *a, qd_real *b, size_t n) {
+  for (size_t first = 0; first < n; first += batch_size)
+    exp_block(a + first, b + first, static_cast<int>(std::min<size_t>(batch_size, n - first)));
+}
+
+/* Three Newton steps x' = x + a exp(-x) - 1 from x = log(a[0]), as in log.
+   log(0) is -Inf and the log of a negative number is NaN. */
+void qd_log_n(const qd_real *a, qd_real *b, size_t n) {
+  qd_real x[batch_size], e[batch_size];
+  for (size_t first = 0; first < n; first += batch_size) {
+    int len = static_cast<int>(std::min<size_t>(batch_size, n - first));
+    const qd_real *ab = a + first;
+    for (int i = 0; i < len; ++i)
+      x[i] = std::log(ab[i][0]);
+
+    for (int step = 0; step < 3; ++step) {
+      for (int i = 0; i < len; ++i)
+        e[i] = -x[i];
+      exp_block(e, e, len);
+      for (int i = 0; i < len; ++i)
+        x[i] = x[i] + ab[i] * e[i] - 1.0;
+    }
+
+    for (int i = 0; i < len; ++i) {
+      double ah = ab[i][0];
+      if (ab[i].is_one())
+        b[first + i] = 0.0;
+      else if (ah == 0.0)
+        b[first + i] = -qd_real::_inf;
+      else if (!(ah > 0.0))
+        b[first + i] = qd_real::_nan;
+      else if (QD_ISINF(ah))
+        b[first + i] = qd_real::_inf;
+      else
+        b[first + i] = x[i];
+    }
+  }
+}
+
+static constexpr qd_real _pi1024 = qd_real(
     3.067961575771282340e-03, 1.195944139792337116e-19,
    -2.924579892303066080e-36, 1.086381075061880158e-52);
 
 /* Table of sin(k * pi/1024) and cos(k * pi/1024). */
-static const qd_real sin_table [] = {
+static constexpr qd_real sin_table [] = {
   qd_real( 3.0679567629659761e-03, 1.2690279085455925e-19,
        5.2879464245328389e-36, -1.7820334081955298e-52),
   qd_real( 6.1358846491544753e-03, 9.0545257482474933e-20,
@@ -1477,7 +1624,7 @@ static const qd_real sin_table [] = {
        2.0693376543497068e-33, 2.4677734957341755e-50)
 };
 
-static const qd_real cos_table [] = {
+static constexpr qd_real cos_table [] = {
   qd_real( 9.9999529380957619e-01, -1.9668064285322189e-17,
        -6.3053955095883481e-34, 5.3266110855726731e-52),
   qd_real( 9.9998117528260111e-01, 3.3568103522895585e-17,
@@ -1993,75 +2140,34 @@ static const qd_real cos_table [] = {
 };
 
 /* Computes sin(a) and cos(a) using Taylor series.
-   Assumes |a| <= pi/2048.                           */
-static void sincos_taylor(const qd_real &a, 
-                          qd_real &sin_a, qd_real &cos_a) {
-  const double thresh = 0.5 * qd_real::_eps * std::abs(to_double(a));
-  qd_real p, s, t, x;
-
-  if (a.is_zero()) {
-    sin_a = 0.0;
-    cos_a = 1.0;
-    return;
-  }
-
-  x = -sqr(a);
-  s = a;
-  p = a;
-  int i = 0;
-  do {
-    p *= x;
-    t = p * inv_fact[i];
-    s += t;
-    i += 2;
-  } while (i < n_inv_fact && std::abs(to_double(t)) > thresh);
-
-  sin_a = s;
-  cos_a = sqrt(1.0 - sqr(s));
-}
-
+   Assumes |a| <= pi/2048, where the terms up to a^17/17!
+   (resp. a^16/16!) are enough.                      */
 static qd_real sin_taylor(const qd_real &a) {
-  const double thresh = 0.5 * qd_real::_eps * std::abs(to_double(a));
-  qd_real p, s, t, x;
-
   if (a.is_zero()) {
     return 0.0;
   }
 
-  x = -sqr(a);
-  s = a;
-  p = a;
-  int i = 0;
-  do {
-    p *= x;
-    t = p * inv_fact[i];
-    s += t;
-    i += 2;
-  } while (i < n_inv_fact && std::abs(to_double(t)) > thresh);
-
-  return s;
+  return a * qd::poly::estrin<9>(sqr(a), qd::poly::sin_series);
 }
 
 static qd_real cos_taylor(const qd_real &a) {
-  const double thresh = 0.5 * qd_real::_eps;
-  qd_real p, s, t, x;
-
   if (a.is_zero()) {
     return 1.0;
   }
 
-  x = -sqr(a);
-  s = 1.0 + mul_pwr2(x, 0.5);
-  p = x;
-  int i = 1;
-  do {
-    p *= x;
-    t = p * inv_fact[i];
-    s += t;
-    i += 2;
-  } while (i < n_inv_fact && std::abs(to_double(t)) > thresh);
+  return qd::poly::estrin<9>(sqr(a), qd::poly::cos_series);
+}
 
-  return s;
+static void sincos_taylor(const qd_real &a, 
+                          qd_real &sin_a, qd_real &cos_a) {
+  if (a.is_zero()) {
+    sin_a = 0.0;
+    cos_a = 1.0;
+    return;
+  }
+
+  sin_a = sin_taylor(a);
+  cos_a = sqrt(1.0 - sqr(sin_a));
 }
 
 qd_real sin(const qd_real &a) {
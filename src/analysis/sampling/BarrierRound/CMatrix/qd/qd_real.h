@@ -42,8 +42,10 @@ struct QD_API qd_real {
   void quick_accum(double d, double &e);
   void quick_prod_accum(double a, double b, double &e);
 
-  qd_real(double x0, double x1, double x2, double x3);
-  explicit qd_real(const double *xx);
+  constexpr qd_real(double x0, double x1, double x2, double x3)
+      : x{x0, x1, x2, x3} {}
+  explicit constexpr qd_real(const double *xx)
+      : x{xx[0], xx[1], xx[2], xx[3]} {}
 
   static const qd_real _2pi;
   static const qd_real _pi;
@@ -56,17 +58,17 @@ struct QD_API qd_real {
   static const qd_real _nan;
   static const qd_real _inf;
 
-  static const double _eps;
-  static const double _min_normalized;
+  static constexpr double _eps = 1.21543267145725e-63; // = 2^-209
+  static constexpr double _min_normalized = 1.6259745436952323e-260; // = 2^(-1022 + 3*53)
   static const qd_real _max;
   static const qd_real _safe_max;
-  static const int _ndigits;
+  static constexpr int _ndigits = 62;
 
-  qd_real();
+  constexpr qd_real() : x{0.0, 0.0, 0.0, 0.0} {}
   qd_real(const char *s);
-  qd_real(const dd_real &dd);
-  qd_real(double d);
-  qd_real(int i);
+  constexpr qd_real(const dd_real &dd) : x{dd.x[0], dd.x[1], 0.0, 0.0} {}
+  constexpr qd_real(double d) : x{d, 0.0, 0.0, 0.0} {}
+  constexpr qd_real(int i) : x{static_cast<double>(i), 0.0, 0.0, 0.0} {}
   
   inline qd_real(std::ptrdiff_t h) // for Eigen use
   {
@@ -199,6 +201,7 @@ QD_API qd_real operator/(double a, const qd_real &b);
 
 QD_API qd_real sqr(const qd_real &a);
 QD_API qd_real sqrt(const qd_real &a);
+QD_API qd_real rsqrt(const qd_real &a);  /* 1 / sqrt(a) */
 QD_API qd_real pow(const qd_real &a, int n);
 QD_API qd_real pow(const qd_real &a, const qd_real &b);
 QD_API qd_real npwr(const qd_real &a, int n);
@@ -274,6 +277,10 @@ QD_API qd_real exp(const qd_real &a);
 QD_API qd_real log(const qd_real &a);
 QD_API qd_real log10(const qd_real &a);
 
+/* b[i] = exp(a[i]) and b[i] = log(a[i]) for i < n; b may be a */
+QD_API void qd_exp_n(const qd_real *a, qd_real *b, size_t n);
+QD_API void qd_log_n(const qd_real *a, qd_real *b, size_t n);
+
 QD_API qd_real sinh(const qd_real &a);
 QD_API qd_real cosh(const qd_real &a);
 QD_API qd_real tanh(const qd_real &a);
@@ -294,6 +301,51 @@ QD_API qd_real fmod(const qd_real &a, const qd_real &b);
 
 QD_API std::ostream &operator<<(std::ostream &s, const qd_real &a);
 QD_API std::istream &operator>>(std::istream &s, qd_real &a);
+
+/* constexpr constants, as for dd_real */
+inline constexpr qd_real qd_real::_2pi = qd_real(6.283185307179586232e+00,
+                                                 2.449293598294706414e-16,
+                                                 -5.989539619436679332e-33,
+                                                 2.224908441726730563e-49);
+inline constexpr qd_real qd_real::_pi = qd_real(3.141592653589793116e+00,
+                                                1.224646799147353207e-16,
+                                                -2.994769809718339666e-33,
+                                                1.112454220863365282e-49);
+inline constexpr qd_real qd_real::_pi2 = qd_real(1.570796326794896558e+00,
+                                                 6.123233995736766036e-17,
+                                                 -1.497384904859169833e-33,
+                                                 5.562271104316826408e-50);
+inline constexpr qd_real qd_real::_pi4 = qd_real(7.853981633974482790e-01,
+                                                 3.061616997868383018e-17,
+                                                 -7.486924524295849165e-34,
+                                                 2.781135552158413204e-50);
+inline constexpr qd_real qd_real::_3pi4 = qd_real(2.356194490192344837e+00,
+                                                  9.1848509936051484375e-17,
+                                                  3.9168984647504003225e-33,
+                                                 -2.5867981632704860386e-49);
+inline constexpr qd_real qd_real::_e = qd_real(2.718281828459045091e+00,
+                                               1.445646891729250158e-16,
+                                               -2.127717108038176765e-33,
+                                               1.515630159841218954e-49);
+inline constexpr qd_real qd_real::_log2 = qd_real(6.931471805599452862e-01,
+                                                  2.319046813846299558e-17,
+                                                  5.707708438416212066e-34,
+                                                  -3.582432210601811423e-50);
+inline constexpr qd_real qd_real::_log10 = qd_real(2.302585092994045901e+00,
+                                                   -2.170756223382249351e-16,
+                                                   -9.984262454465776570e-33,
+                                                   -4.023357454450206379e-49);
+inline constexpr qd_real qd_real::_nan = qd_real(
+    dd_real::_nan.x[0], dd_real::_nan.x[0], dd_real::_nan.x[0], dd_real::_nan.x[0]);
+inline constexpr qd_real qd_real::_inf = qd_real(
+    dd_real::_inf.x[0], dd_real::_inf.x[0], dd_real::_inf.x[0], dd_real::_inf.x[0]);
+inline constexpr qd_real qd_real::_max = qd_real(
+    1.79769313486231570815e+308, 9.97920154767359795037e+291, 
+    5.53956966280111259858e+275, 3.07507889307840487279e+259);
+inline constexpr qd_real qd_real::_safe_max = qd_real(
+    1.7976931080746007281e+308,  9.97920154767359795037e+291, 
+    5.53956966280111259858e+275, 3.07507889307840487279e+259);
+
 #ifdef QD_INLINE
 #include "qd_inline.h"
 #endif
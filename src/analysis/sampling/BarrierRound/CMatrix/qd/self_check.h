@@ -0,0 +1,175 @@
+/*
+ * include/self_check.h
+ *
+ * Run-time check that the compiler flags and the floating point modes
+ * keep the error-free transformations of inline.h exact and the results
+ * of dd_real and qd_real reproducible.  -ffast-math lets the compiler
+ * simplify (a + b) - a to b, which turns two_sum into a plain sum; a
+ * flush-to-zero or directed rounding mode left by another library breaks
+ * the same identities at run time; and contracting a * b + c into a fused
+ * multiply-add (the default of g++ and clang++ on processors with FMA)
+ * changes the last bits of the results from one machine to the next.
+ *
+ * Everything is inline and the inputs are read through volatiles, so the
+ * checks run with the flags of the program that includes this header and
+ * cannot be folded by the compiler.
+ */
+#ifndef _QD_SELF_CHECK_H
+#define _QD_SELF_CHECK_H
+
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include "qd_config.h"
+#include "inline.h"
+#include "dd_real.h"
+#include "qd_real.h"
+#include "simd.h"
+
+namespace qd {
+
+/* The bits of self_check() */
+enum check_flag : unsigned {
+  check_two_sum     = 1u << 0, /* two_sum / quick_two_sum drop the error */
+  check_two_prod    = 1u << 1, /* two_prod drops the error */
+  check_arithmetic  = 1u << 2, /* dd_real / qd_real lose precision */
+  check_rounding    = 1u << 3, /* not round-to-nearest double precision */
+  check_denormals   = 1u << 4, /* denormals flushed to zero (FTZ / DAZ) */
+  check_contraction = 1u << 5, /* a * b + c is fused into an FMA */
+  check_packed      = 1u << 6  /* simd.h differs from the operators */
+};
+
+/* Failures that make the results wrong, and failures that only make them
+   depend on the machine. */
+const unsigned check_exact = check_two_sum | check_two_prod |
+    check_arithmetic | check_rounding | check_denormals;
+const unsigned check_reproducible = check_contraction | check_packed;
+
+namespace detail {
+
+inline double opaque(double x) {
+  volatile double v = x;
+  return v;
+}
+
+inline bool same_bits(const void *a, const void *b, std::size_t bytes) {
+  return std::memcmp(a, b, bytes) == 0;
+}
+
+}
+
+/* The check_flag bits of the checks that fail in the calling thread, or
+   zero if all pass. */
+inline unsigned self_check() {
+  using detail::opaque;
+  unsigned failed = 0;
+  const double one = opaque(1.0);
+  const double tiny = opaque(std::ldexp(1.0, -60));
+  const double half_ulp = opaque(std::ldexp(1.0, -53));
+  double s, e;
+
+  /* 1 + 2^-60 = 1 with error 2^-60 */
+  s = two_sum(one, tiny, e);
+  if (s != 1.0 || e != tiny)
+    failed |= check_two_sum;
+  s = quick_two_sum(one, tiny, e);
+  if (s != 1.0 || e != tiny)
+    failed |= check_two_sum;
+
+  /* (1 + 2^-30) (1 - 2^-30) = 1 with error -2^-60 */
+  const double u = opaque(1.0 + std::ldexp(1.0, -30));
+  const double v = opaque(1.0 - std::ldexp(1.0, -30));
+  s = two_prod(u, v, e);
+  if (s != 1.0 || e != -tiny)
+    failed |= check_two_prod;
+
+  /* sqrt(2)^2 - 2 is within a few ulps of zero */
+  dd_real r2 = sqrt(dd_real(opaque(2.0)));
+  qd_real r4 = sqrt(qd_real(opaque(2.0)));
+  if (std::abs(to_double(sqr(r2) - 2.0)) > 16.0 * dd_real::_eps ||
+      std::abs(to_double(sqr(r4) - 2.0)) > 16.0 * qd_real::_eps)
+    failed |= check_arithmetic;
+
+  /* 1 + 3/4 ulp, 1 + 1/4 ulp and -1 - 1/4 ulp round to nearest only; the
+     extended precision of the x87 keeps 2^-60 in (1 + 2^-60) - 1. */
+  if (one + 1.5 * half_ulp != 1.0 + 2.0 * half_ulp ||
+      one + 0.5 * half_ulp != 1.0 || -one - 0.5 * half_ulp != -1.0 ||
+      (one + tiny) - one != 0.0)
+    failed |= check_rounding;
+
+  const double dmin = opaque(DBL_MIN);
+  const double denormal = opaque(std::ldexp(1.0, -1070));
+  if (dmin * 0.5 == 0.0 || denormal + denormal == 0.0)
+    failed |= check_denormals;
+
+  /* fl(fl(x y) - 1) = 0, but fma(x, y, -1) = -2^-60.  Fresh copies of u
+     and v, so the product of two_prod above is not reused. */
+  const double x = opaque(u), y = opaque(v), minus_one = opaque(-1.0);
+  if (x * y + minus_one != 0.0)
+    failed |= check_contraction;
+
+  /* The packed operations of the processor against the operators, on more
+     elements than the widest packet so both the packets and the tail run. */
+  const std::size_t n = 11;
+  dd_real da[n], db[n], dc[n], dr[n];
+  qd_real qa[n], qb[n], qc[n], qr[n];
+  for (std::size_t i = 0; i < n; i++) {
+    da[i] = dd_real(opaque(i + 1.0)) / 7.0;
+    db[i] = sqrt(dd_real(opaque(i + 2.0)));
+    qa[i] = qd_real(opaque(i + 1.0)) / 7.0;
+    qb[i] = sqrt(qd_real(opaque(i + 2.0)));
+  }
+  bool packed = true;
+  auto same = [&](const void *a, const void *b, std::size_t bytes) {
+    packed = packed && detail::same_bits(a, b, bytes);
+  };
+  simd::dd_add_n(da, db, dc, n);
+  for (std::size_t i = 0; i < n; i++) dr[i] = da[i] + db[i];
+  same(dc, dr, sizeof(dr));
+  simd::dd_mul_n(da, db, dc, n);
+  for (std::size_t i = 0; i < n; i++) dr[i] = da[i] * db[i];
+  same(dc, dr, sizeof(dr));
+  simd::dd_div_n(da, db, dc, n);
+  for (std::size_t i = 0; i < n; i++) dr[i] = da[i] / db[i];
+  same(dc, dr, sizeof(dr));
+  simd::dd_sqrt_n(da, dc, n);
+  for (std::size_t i = 0; i < n; i++) dr[i] = sqrt(da[i]);
+  same(dc, dr, sizeof(dr));
+  simd::qd_add_n(qa, qb, qc, n);
+  for (std::size_t i = 0; i < n; i++) qr[i] = qa[i] + qb[i];
+  same(qc, qr, sizeof(qr));
+  simd::qd_mul_n(qa, qb, qc, n);
+  for (std::size_t i = 0; i < n; i++) qr[i] = qa[i] * qb[i];
+  same(qc, qr, sizeof(qr));
+  simd::qd_div_n(qa, qb, qc, n);
+  for (std::size_t i = 0; i < n; i++) qr[i] = qa[i] / qb[i];
+  same(qc, qr, sizeof(qr));
+  simd::qd_sqrt_n(qa, qc, n);
+  for (std::size_t i = 0; i < n; i++) qr[i] = sqrt(qa[i]);
+  same(qc, qr, sizeof(qr));
+  if (!packed)
+    failed |= check_packed;
+
+  return failed;
+}
+
+/* The names of the check_flag bits set in failed, separated by commas */
+inline std::string check_names(unsigned failed) {
+  static const char *names[] = {"two_sum", "two_prod", "arithmetic",
+                                "rounding", "denormals", "contraction",
+                                "packed"};
+  std::string s;
+  for (int k = 0; k < 7; k++)
+    if (failed & (1u << k)) {
+      if (!s.empty())
+        s += ", ";
+      s += names[k];
+    }
+  return s;
+}
+
+}
+
+#endif /* _QD_SELF_CHECK_H */
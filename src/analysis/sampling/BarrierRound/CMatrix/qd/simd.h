@@ -0,0 +1,423 @@
+/*
+ * include/simd.h
+ *
+ * Packed double-double and quad-double arithmetic on arrays.  The operations
+ * in simd_inline.h are compiled for plain doubles and, on x86, for AVX2 + FMA
+ * (4 lanes) and AVX-512 (8 lanes); the array functions at the bottom pick the
+ * widest one the processor supports the first time they are called.  The
+ * operations are those of the scalar dd_real / qd_real operators with the
+ * default configuration (sloppy qd add, mul and div).  Compiled with
+ * -ffp-contract=off (the deterministic build, QD_DETERMINISTIC) the results
+ * are the same bits; otherwise the compiler may contract a * b + c into an
+ * FMA in one and not the other, and the last bits differ.
+ *
+ * Everything is inline, so a program that includes this header needs no
+ * extra source file or compiler flag: the AVX code is compiled with target
+ * attributes and only run after the cpuid check.
+ */
+#ifndef _QD_SIMD_H
+#define _QD_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include "qd_config.h"
+#include "dd_real.h"
+#include "qd_real.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define QD_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+namespace qd {
+namespace simd {
+
+enum isa { isa_scalar = 0, isa_avx2 = 1, isa_avx512 = 2 };
+
+/*********** One lane ************/
+namespace scalar {
+
+typedef double vec;
+typedef bool mask;
+const std::size_t width = 1;
+
+inline vec sqrt(vec a) { return std::sqrt(a); }
+inline vec fms(vec a, vec b, vec c) { return QD_FMS(a, b, c); }
+inline vec select(mask m, vec a, vec b) { return m ? a : b; }
+inline mask is_inf(vec a) { return QD_ISINF(a); }
+inline mask andnot(mask a, mask b) { return a && !b; }
+inline mask true_mask() { return true; }
+inline mask false_mask() { return false; }
+
+inline void load_dd(const double *p, vec &hi, vec &lo) { hi = p[0]; lo = p[1]; }
+inline void store_dd(double *p, vec hi, vec lo) { p[0] = hi; p[1] = lo; }
+inline void load_qd(const double *p, vec *x) { for (int i = 0; i < 4; i++) x[i] = p[i]; }
+inline void store_qd(double *p, const vec *x) { for (int i = 0; i < 4; i++) p[i] = x[i]; }
+
+#include "simd_inline.h"
+
+}
+
+#ifdef QD_SIMD_X86
+
+/* The lanes of the packets follow the order of the unpack instructions, not
+   the order of the elements; load_* and store_* undo each other.  */
+
+/*********** AVX2 + FMA ************/
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace avx2 {
+
+struct vec {
+  __m256d v;
+  vec() {}
+  vec(__m256d v_) : v(v_) {}
+  explicit vec(double d) : v(_mm256_set1_pd(d)) {}
+};
+
+struct mask {
+  __m256d m;
+  mask() {}
+  mask(__m256d m_) : m(m_) {}
+};
+
+const std::size_t width = 4;
+
+inline vec operator+(vec a, vec b) { return _mm256_add_pd(a.v, b.v); }
+inline vec operator-(vec a, vec b) { return _mm256_sub_pd(a.v, b.v); }
+inline vec operator*(vec a, vec b) { return _mm256_mul_pd(a.v, b.v); }
+inline vec operator/(vec a, vec b) { return _mm256_div_pd(a.v, b.v); }
+inline vec operator-(vec a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+inline vec sqrt(vec a) { return _mm256_sqrt_pd(a.v); }
+inline vec fms(vec a, vec b, vec c) { return _mm256_fmsub_pd(a.v, b.v, c.v); }
+
+inline mask operator==(vec a, vec b) { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+inline mask operator!=(vec a, vec b) { return _mm256_cmp_pd(a.v, b.v, _CMP_NEQ_UQ); }
+inline mask operator<(vec a, vec b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline mask operator&(mask a, mask b) { return _mm256_and_pd(a.m, b.m); }
+inline mask operator|(mask a, mask b) { return _mm256_or_pd(a.m, b.m); }
+inline mask andnot(mask a, mask b) { return _mm256_andnot_pd(b.m, a.m); }
+inline mask true_mask() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1)); }
+inline mask false_mask() { return _mm256_setzero_pd(); }
+inline vec select(mask m, vec a, vec b) { return _mm256_blendv_pd(b.v, a.v, m.m); }
+inline mask is_inf(vec a) {
+  return _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v),
+                       _mm256_set1_pd(std::numeric_limits<double>::infinity()), _CMP_EQ_OQ);
+}
+
+inline void load_dd(const double *p, vec &hi, vec &lo) {
+  __m256d v0 = _mm256_loadu_pd(p), v1 = _mm256_loadu_pd(p + 4);
+  hi = _mm256_unpacklo_pd(v0, v1);
+  lo = _mm256_unpackhi_pd(v0, v1);
+}
+
+inline void store_dd(double *p, vec hi, vec lo) {
+  _mm256_storeu_pd(p, _mm256_unpacklo_pd(hi.v, lo.v));
+  _mm256_storeu_pd(p + 4, _mm256_unpackhi_pd(hi.v, lo.v));
+}
+
+/* 4 x 4 transpose, its own inverse */
+inline void transpose(const __m256d *r, vec *x) {
+  __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]), t1 = _mm256_unpackhi_pd(r[0], r[1]);
+  __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]), t3 = _mm256_unpackhi_pd(r[2], r[3]);
+  x[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+  x[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+  x[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+  x[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+inline void load_qd(const double *p, vec *x) {
+  __m256d r[4];
+  for (int i = 0; i < 4; i++)
+    r[i] = _mm256_loadu_pd(p + 4 * i);
+  transpose(r, x);
+}
+
+inline void store_qd(double *p, const vec *x) {
+  __m256d r[4];
+  vec y[4];
+  for (int i = 0; i < 4; i++)
+    r[i] = x[i].v;
+  transpose(r, y);
+  for (int i = 0; i < 4; i++)
+    _mm256_storeu_pd(p + 4 * i, y[i].v);
+}
+
+#include "simd_inline.h"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+/*********** AVX-512 ************/
+/* The unpack, gather and sqrt intrinsics of GCC pass _mm512_undefined_pd()
+   as the unused source of their masked builtins, which -Wuninitialized and
+   -Wmaybe-uninitialized report once they are inlined. */
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace avx512 {
+
+struct vec {
+  __m512d v;
+  vec() {}
+  vec(__m512d v_) : v(v_) {}
+  explicit vec(double d) : v(_mm512_set1_pd(d)) {}
+};
+
+struct mask {
+  __mmask8 m;
+  mask() {}
+  mask(__mmask8 m_) : m(m_) {}
+};
+
+const std::size_t width = 8;
+
+inline vec operator+(vec a, vec b) { return _mm512_add_pd(a.v, b.v); }
+inline vec operator-(vec a, vec b) { return _mm512_sub_pd(a.v, b.v); }
+inline vec operator*(vec a, vec b) { return _mm512_mul_pd(a.v, b.v); }
+inline vec operator/(vec a, vec b) { return _mm512_div_pd(a.v, b.v); }
+inline vec operator-(vec a) {
+  return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v),
+                                              _mm512_set1_epi64((long long) 0x8000000000000000ULL)));
+}
+inline vec sqrt(vec a) { return _mm512_sqrt_pd(a.v); }
+inline vec fms(vec a, vec b, vec c) { return _mm512_fmsub_pd(a.v, b.v, c.v); }
+
+inline mask operator==(vec a, vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ); }
+inline mask operator!=(vec a, vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_NEQ_UQ); }
+inline mask operator<(vec a, vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+inline mask operator&(mask a, mask b) { return (__mmask8) (a.m & b.m); }
+inline mask operator|(mask a, mask b) { return (__mmask8) (a.m | b.m); }
+inline mask andnot(mask a, mask b) { return (__mmask8) (a.m & ~b.m); }
+inline mask true_mask() { return (__mmask8) 0xFF; }
+inline mask false_mask() { return (__mmask8) 0; }
+inline vec select(mask m, vec a, vec b) { return _mm512_mask_blend_pd(m.m, b.v, a.v); }
+inline mask is_inf(vec a) {
+  return _mm512_cmp_pd_mask(_mm512_abs_pd(a.v),
+                            _mm512_set1_pd(std::numeric_limits<double>::infinity()), _CMP_EQ_OQ);
+}
+
+inline void load_dd(const double *p, vec &hi, vec &lo) {
+  __m512d v0 = _mm512_loadu_pd(p), v1 = _mm512_loadu_pd(p + 8);
+  hi = _mm512_unpacklo_pd(v0, v1);
+  lo = _mm512_unpackhi_pd(v0, v1);
+}
+
+inline void store_dd(double *p, vec hi, vec lo) {
+  _mm512_storeu_pd(p, _mm512_unpacklo_pd(hi.v, lo.v));
+  _mm512_storeu_pd(p + 8, _mm512_unpackhi_pd(hi.v, lo.v));
+}
+
+/* component k of element i is p[4 * i + k] */
+inline void load_qd(const double *p, vec *x) {
+  const __m512i index = _mm512_set_epi64(28, 24, 20, 16, 12, 8, 4, 0);
+  for (int k = 0; k < 4; k++)
+    x[k] = _mm512_i64gather_pd(index, p + k, 8);
+}
+
+inline void store_qd(double *p, const vec *x) {
+  const __m512i index = _mm512_set_epi64(28, 24, 20, 16, 12, 8, 4, 0);
+  for (int k = 0; k < 4; k++)
+    _mm512_i64scatter_pd(p + k, index, x[k].v, 8);
+}
+
+#include "simd_inline.h"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif /* QD_SIMD_X86 */
+
+/*********** Dispatch ************/
+/* The widest instruction set that is compiled in and that both the processor
+   and the operating system support. */
+inline isa detect_isa() {
+#if !defined(QD_SIMD_X86)
+  return isa_scalar;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return isa_scalar;
+  __cpuid(info, 1);
+  bool fma = (info[2] & (1 << 12)) != 0, osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave)
+    return isa_scalar;
+  unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  bool avx2 = (info[1] & (1 << 5)) != 0, avx512f = (info[1] & (1 << 16)) != 0;
+  if (avx512f && (xcr0 & 0xE6) == 0xE6)
+    return isa_avx512;
+  if (avx2 && fma && (xcr0 & 0x6) == 0x6)
+    return isa_avx2;
+  return isa_scalar;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return isa_avx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return isa_avx2;
+  return isa_scalar;
+#endif
+}
+
+inline isa active_isa() {
+  static const isa value = detect_isa();
+  return value;
+}
+
+inline const char *isa_name(isa value) {
+  switch (value) {
+    case isa_avx512: return "avx512";
+    case isa_avx2:   return "avx2";
+    default:         return "scalar";
+  }
+}
+
+#ifdef QD_SIMD_X86
+#define QD_SIMD_DISPATCH(call)                                             \
+  switch (active_isa()) {                                                 \
+    case isa_avx512: avx512::call; break;                                 \
+    case isa_avx2:   avx2::call; break;                                   \
+    default:         scalar::call; break;                                 \
+  }
+#else
+#define QD_SIMD_DISPATCH(call) scalar::call;
+#endif
+
+/* c[i] = a[i] op b[i] and c[i] = sqrt(a[i]) for i < n; c may be a or b.  */
+inline void dd_add_n(const dd_real *a, const dd_real *b, dd_real *c, std::size_t n) {
+  QD_SIMD_DISPATCH(dd_add_n((const double *) a, (const double *) b, (double *) c, n))
+}
+
+inline void dd_sub_n(const dd_real *a, const dd_real *b, dd_real *c, std::size_t n) {
+  QD_SIMD_DISPATCH(dd_sub_n((const double *) a, (const double *) b, (double *) c, n))
+}
+
+inline void dd_mul_n(const dd_real *a, const dd_real *b, dd_real *c, std::size_t n) {
+  QD_SIMD_DISPATCH(dd_mul_n((const double *) a, (const double *) b, (double *) c, n))
+}
+
+inline void dd_div_n(const dd_real *a, const dd_real *b, dd_real *c, std::size_t n) {
+#ifdef QD_SLOPPY_DIV
+  QD_SIMD_DISPATCH(dd_div_n((const double *) a, (const double *) b, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = a[i] / b[i];
+#endif
+}
+
+inline void dd_inv_n(const dd_real *a, dd_real *c, std::size_t n) {
+#ifdef QD_SLOPPY_DIV
+  QD_SIMD_DISPATCH(dd_inv_n((const double *) a, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = inv(a[i]);
+#endif
+}
+
+inline void dd_sqrt_n(const dd_real *a, dd_real *c, std::size_t n) {
+  QD_SIMD_DISPATCH(dd_sqrt_n((const double *) a, (double *) c, n))
+}
+
+/* The packed qd add, mul and div are the sloppy versions; the accurate
+   ones of the other configurations are left to the scalar operators.
+   div, inv, sqrt and rsqrt are the Newton iterations of qd_real.cc. */
+inline void qd_add_n(const qd_real *a, const qd_real *b, qd_real *c, std::size_t n) {
+#ifndef QD_IEEE_ADD
+  QD_SIMD_DISPATCH(qd_add_n((const double *) a, (const double *) b, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = a[i] + b[i];
+#endif
+}
+
+inline void qd_sub_n(const qd_real *a, const qd_real *b, qd_real *c, std::size_t n) {
+#ifndef QD_IEEE_ADD
+  QD_SIMD_DISPATCH(qd_sub_n((const double *) a, (const double *) b, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = a[i] - b[i];
+#endif
+}
+
+inline void qd_mul_n(const qd_real *a, const qd_real *b, qd_real *c, std::size_t n) {
+#ifdef QD_SLOPPY_MUL
+  QD_SIMD_DISPATCH(qd_mul_n((const double *) a, (const double *) b, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = a[i] * b[i];
+#endif
+}
+
+inline void qd_div_n(const qd_real *a, const qd_real *b, qd_real *c, std::size_t n) {
+#if defined(QD_SLOPPY_DIV) && !defined(QD_IEEE_ADD)
+  QD_SIMD_DISPATCH(qd_div_n((const double *) a, (const double *) b, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = a[i] / b[i];
+#endif
+}
+
+/* c[i] = 1 / a[i] */
+inline void qd_inv_n(const qd_real *a, qd_real *c, std::size_t n) {
+#if defined(QD_SLOPPY_DIV) && !defined(QD_IEEE_ADD)
+  QD_SIMD_DISPATCH(qd_inv_n((const double *) a, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = inv(a[i]);
+#endif
+}
+
+inline void qd_sqrt_n(const qd_real *a, qd_real *c, std::size_t n) {
+#ifndef QD_IEEE_ADD
+  QD_SIMD_DISPATCH(qd_sqrt_n((const double *) a, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = sqrt(a[i]);
+#endif
+}
+
+/* c[i] = 1 / sqrt(a[i]) */
+inline void qd_rsqrt_n(const qd_real *a, qd_real *c, std::size_t n) {
+#if defined(QD_SLOPPY_MUL) && !defined(QD_IEEE_ADD)
+  QD_SIMD_DISPATCH(qd_rsqrt_n((const double *) a, (double *) c, n))
+#else
+  for (std::size_t i = 0; i < n; i++)
+    c[i] = rsqrt(a[i]);
+#endif
+}
+
+#undef QD_SIMD_DISPATCH
+
+}
+}
+
+#endif /* _QD_SIMD_H */
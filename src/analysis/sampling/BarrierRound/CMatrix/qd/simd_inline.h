@@ -0,0 +1,703 @@
+/*
+ * include/simd_inline.h
+ *
+ * Packed versions of the double-double and quad-double operations of
+ * inline.h, dd_inline.h and qd_inline.h.  Every lane of a vec goes through
+ * exactly the same floating point operations as the scalar code, so the
+ * results agree with dd_real and qd_real; the branches of the scalar code
+ * (renormalization, special values) become per-lane selects.
+ *
+ * This file has no include guard.  simd.h includes it once per instruction
+ * set, inside a namespace that defines
+ *
+ *   vec, mask           a packet of doubles and a per-lane condition,
+ *                       with the arithmetic and comparison operators
+ *   width               number of lanes in a vec
+ *   sqrt, fms, select   square root, fl(a * b - c) with one rounding,
+ *                       select(m, a, b) = m ? a : b lane by lane
+ *   is_inf, andnot, true_mask, false_mask
+ *   load_dd, store_dd   between width dd_real and (hi, lo) packets
+ *   load_qd, store_qd   between width qd_real and four packets
+ *
+ * and the array functions it defines hand the last n % width elements to
+ * the scalar instance.
+ */
+
+/*********** Basic Functions ************/
+/* Computes fl(a+b) and err(a+b).  Assumes |a| >= |b|. */
+inline vec quick_two_sum(vec a, vec b, vec &err) {
+  vec s = a + b;
+  err = b - (s - a);
+  return s;
+}
+
+/* Computes fl(a+b) and err(a+b).  */
+inline vec two_sum(vec a, vec b, vec &err) {
+  vec s = a + b;
+  vec bb = s - a;
+  err = (a - (s - bb)) + (b - bb);
+  return s;
+}
+
+/* Computes fl(a-b) and err(a-b).  */
+inline vec two_diff(vec a, vec b, vec &err) {
+  vec s = a - b;
+  vec bb = s - a;
+  err = (a - (s - bb)) - (b + bb);
+  return s;
+}
+
+/* Computes fl(a*b) and err(a*b). */
+inline vec two_prod(vec a, vec b, vec &err) {
+  vec p = a * b;
+  err = fms(a, b, p);
+  return p;
+}
+
+/* Computes fl(a*a) and err(a*a). */
+inline vec two_sqr(vec a, vec &err) {
+  vec p = a * a;
+  err = fms(a, a, p);
+  return p;
+}
+
+inline void three_sum(vec &a, vec &b, vec &c) {
+  vec t1, t2, t3;
+  t1 = two_sum(a, b, t2);
+  a  = two_sum(c, t1, t3);
+  b  = two_sum(t2, t3, c);
+}
+
+inline void three_sum2(vec &a, vec &b, vec &c) {
+  vec t1, t2, t3;
+  t1 = two_sum(a, b, t2);
+  a  = two_sum(c, t1, t3);
+  b = t2 + t3;
+}
+
+/* Renormalizes c[0..N-1] into four components, N = 4 or 5, like qd::renorm.
+   The scalar version walks a tree of "is this error zero" tests; here the
+   slot that receives the next nonzero error is tracked per lane in at[].  */
+template <int N>
+inline void renorm(vec (&c)[N]) {
+  vec orig[N], s[4], t, e, h;
+  mask at[4], nz;
+  int i, j;
+
+  for (j = 0; j < N; j++)
+    orig[j] = c[j];
+
+  t = c[N - 1];
+  for (j = N - 2; j >= 0; j--)
+    t = quick_two_sum(c[j], t, c[j + 1]);
+  c[0] = t;
+
+  for (i = 0; i < 4; i++)
+    s[i] = vec(0.0);
+  at[0] = true_mask();
+  at[1] = at[2] = at[3] = false_mask();
+
+  h = c[0];
+  for (j = 1; j < N - 1; j++) {
+    if (j == 1) {
+      t = h;
+      e = c[1];
+    } else {
+      t = quick_two_sum(h, c[j], e);
+    }
+    nz = (e != vec(0.0));
+    for (i = 0; i < 4; i++)
+      s[i] = select(at[i] & nz, t, s[i]);
+    h = select(nz, e, t);
+    for (i = 3; i > 0; i--)
+      at[i] = (at[i - 1] & nz) | andnot(at[i], nz);
+    at[0] = andnot(at[0], nz);
+  }
+
+  /* the last input always lands in the current slot and the next one */
+  t = quick_two_sum(h, c[N - 1], e);
+  for (i = 0; i < 3; i++) {
+    s[i] = select(at[i], t, s[i]);
+    s[i + 1] = select(at[i], e, s[i + 1]);
+  }
+  s[3] = select(at[3], h + c[N - 1], s[3]);
+
+  nz = is_inf(orig[0]);
+  for (i = 0; i < 4; i++)
+    c[i] = select(nz, orig[i], s[i]);
+}
+
+/*********** Double-Double ************/
+struct dd_pack {
+  vec hi, lo;
+};
+
+/* double-double + double-double */
+inline dd_pack dd_add(const dd_pack &a, const dd_pack &b) {
+  dd_pack r;
+#ifndef QD_IEEE_ADD
+  vec s, e;
+  s = two_sum(a.hi, b.hi, e);
+  e = e + (a.lo + b.lo);
+  r.hi = quick_two_sum(s, e, r.lo);
+#else
+  vec s1, s2, t1, t2;
+  s1 = two_sum(a.hi, b.hi, s2);
+  t1 = two_sum(a.lo, b.lo, t2);
+  s2 = s2 + t1;
+  s1 = quick_two_sum(s1, s2, s2);
+  s2 = s2 + t2;
+  r.hi = quick_two_sum(s1, s2, r.lo);
+#endif
+  return r;
+}
+
+/* double-double - double-double */
+inline dd_pack dd_sub(const dd_pack &a, const dd_pack &b) {
+  dd_pack r;
+#ifndef QD_IEEE_ADD
+  vec s, e;
+  s = two_diff(a.hi, b.hi, e);
+  e = e + a.lo;
+  e = e - b.lo;
+  r.hi = quick_two_sum(s, e, r.lo);
+#else
+  vec s1, s2, t1, t2;
+  s1 = two_diff(a.hi, b.hi, s2);
+  t1 = two_diff(a.lo, b.lo, t2);
+  s2 = s2 + t1;
+  s1 = quick_two_sum(s1, s2, s2);
+  s2 = s2 + t2;
+  r.hi = quick_two_sum(s1, s2, r.lo);
+#endif
+  return r;
+}
+
+/* double-double * double */
+inline dd_pack dd_mul(const dd_pack &a, vec b) {
+  dd_pack r;
+  vec p1, p2;
+  p1 = two_prod(a.hi, b, p2);
+  p2 = p2 + (a.lo * b);
+  r.hi = quick_two_sum(p1, p2, r.lo);
+  return r;
+}
+
+/* double-double * double-double */
+inline dd_pack dd_mul(const dd_pack &a, const dd_pack &b) {
+  dd_pack r;
+  vec p1, p2;
+  p1 = two_prod(a.hi, b.hi, p2);
+  p2 = p2 + (a.hi * b.lo + a.lo * b.hi);
+  r.hi = quick_two_sum(p1, p2, r.lo);
+  return r;
+}
+
+/* double-double / double-double, dd_real::sloppy_div */
+inline dd_pack dd_div(const dd_pack &a, const dd_pack &b) {
+  vec s1, s2, q1, q2;
+  dd_pack r;
+
+  q1 = a.hi / b.hi;  /* approximate quotient */
+
+  /* compute  this - q1 * dd */
+  r = dd_mul(b, q1);
+  s1 = two_diff(a.hi, r.hi, s2);
+  s2 = s2 - r.lo;
+  s2 = s2 + a.lo;
+
+  /* get next approximation */
+  q2 = (s1 + s2) / b.hi;
+
+  /* renormalize */
+  r.hi = quick_two_sum(q1, q2, r.lo);
+  return r;
+}
+
+/* 1 / b, inv(dd_real) */
+inline dd_pack dd_inv(const dd_pack &b) {
+  dd_pack one = {vec(1.0), vec(0.0)};
+  return dd_div(one, b);
+}
+
+/* sqrt(a) by Karp's trick, 0 for a = 0 and NaN for a < 0 */
+inline dd_pack dd_sqrt(const dd_pack &a) {
+  vec x, ax, e;
+  dd_pack r, sq;
+
+  x = vec(1.0) / sqrt(a.hi);
+  ax = a.hi * x;
+  sq.hi = two_sqr(ax, sq.lo);
+  r.hi = two_sum(ax, dd_sub(a, sq).hi * (x * vec(0.5)), r.lo);
+
+  e = vec(std::numeric_limits<double>::quiet_NaN());
+  r.hi = select(a.hi < vec(0.0), e, r.hi);
+  r.lo = select(a.hi < vec(0.0), e, r.lo);
+  r.hi = select(a.hi == vec(0.0), vec(0.0), r.hi);
+  r.lo = select(a.hi == vec(0.0), vec(0.0), r.lo);
+  return r;
+}
+
+/*********** Quad-Double ************/
+struct qd_pack {
+  vec x[4];
+};
+
+inline qd_pack qd_neg(const qd_pack &a) {
+  qd_pack r;
+  for (int i = 0; i < 4; i++)
+    r.x[i] = -a.x[i];
+  return r;
+}
+
+/* quad-double + double */
+inline qd_pack qd_add(const qd_pack &a, vec b) {
+  vec c[5], e;
+
+  c[0] = two_sum(a.x[0], b, e);
+  c[1] = two_sum(a.x[1], e, e);
+  c[2] = two_sum(a.x[2], e, e);
+  c[3] = two_sum(a.x[3], e, e);
+  c[4] = e;
+
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* quad-double + quad-double, qd_real::sloppy_add */
+inline qd_pack qd_add(const qd_pack &a, const qd_pack &b) {
+  vec s[4], t[4], c[5];
+  int i;
+
+  for (i = 0; i < 4; i++)
+    s[i] = two_sum(a.x[i], b.x[i], t[i]);
+
+  s[1] = two_sum(s[1], t[0], t[0]);
+  three_sum(s[2], t[0], t[1]);
+  three_sum2(s[3], t[0], t[2]);
+  t[0] = t[0] + t[1] + t[3];
+
+  c[0] = s[0]; c[1] = s[1]; c[2] = s[2]; c[3] = s[3]; c[4] = t[0];
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+inline qd_pack qd_sub(const qd_pack &a, const qd_pack &b) {
+  return qd_add(a, qd_neg(b));
+}
+
+/* quad-double + double-double */
+inline qd_pack qd_add(const qd_pack &a, const dd_pack &b) {
+  vec s0, s1, s2, s3;
+  vec t0, t1;
+  vec c[5];
+
+  s0 = two_sum(a.x[0], b.hi, t0);
+  s1 = two_sum(a.x[1], b.lo, t1);
+
+  s1 = two_sum(s1, t0, t0);
+
+  s2 = a.x[2];
+  three_sum(s2, t0, t1);
+
+  s3 = two_sum(t0, a.x[3], t0);
+  t0 = t0 + t1;
+
+  c[0] = s0; c[1] = s1; c[2] = s2; c[3] = s3; c[4] = t0;
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* quad-double * double */
+inline qd_pack qd_mul(const qd_pack &a, vec b) {
+  vec p0, p1, p2, p3;
+  vec q0, q1, q2;
+  vec c[5];
+
+  p0 = two_prod(a.x[0], b, q0);
+  p1 = two_prod(a.x[1], b, q1);
+  p2 = two_prod(a.x[2], b, q2);
+  p3 = a.x[3] * b;
+
+  c[0] = p0;
+  c[1] = two_sum(q0, p1, c[2]);
+  three_sum(c[2], q1, p2);
+  three_sum2(q1, q2, p3);
+  c[3] = q1;
+  c[4] = q2 + p2;
+
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* quad-double * double-double */
+inline qd_pack qd_mul(const qd_pack &a, const dd_pack &b) {
+  vec p0, p1, p2, p3, p4;
+  vec q0, q1, q2, q3, q4;
+  vec s0, s1, s2;
+  vec t0, t1;
+  vec c[5];
+
+  p0 = two_prod(a.x[0], b.hi, q0);
+  p1 = two_prod(a.x[0], b.lo, q1);
+  p2 = two_prod(a.x[1], b.hi, q2);
+  p3 = two_prod(a.x[1], b.lo, q3);
+  p4 = two_prod(a.x[2], b.hi, q4);
+
+  three_sum(p1, p2, q0);
+
+  /* Five-Three-Sum */
+  three_sum(p2, p3, p4);
+  q1 = two_sum(q1, q2, q2);
+  s0 = two_sum(p2, q1, t0);
+  s1 = two_sum(p3, q2, t1);
+  s1 = two_sum(s1, t0, t0);
+  s2 = t0 + t1 + p4;
+  p2 = s0;
+
+  p3 = a.x[2] * b.lo + a.x[3] * b.hi + q3 + q4;
+  three_sum2(p3, q0, s1);
+  p4 = q0 + s2;
+
+  c[0] = p0; c[1] = p1; c[2] = p2; c[3] = p3; c[4] = p4;
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* quad-double * quad-double, qd_real::sloppy_mul */
+inline qd_pack qd_mul(const qd_pack &a, const qd_pack &b) {
+  vec p0, p1, p2, p3, p4, p5;
+  vec q0, q1, q2, q3, q4, q5;
+  vec t0, t1;
+  vec s0, s1, s2;
+  vec c[5];
+
+  p0 = two_prod(a.x[0], b.x[0], q0);
+
+  p1 = two_prod(a.x[0], b.x[1], q1);
+  p2 = two_prod(a.x[1], b.x[0], q2);
+
+  p3 = two_prod(a.x[0], b.x[2], q3);
+  p4 = two_prod(a.x[1], b.x[1], q4);
+  p5 = two_prod(a.x[2], b.x[0], q5);
+
+  /* Start Accumulation */
+  three_sum(p1, p2, q0);
+
+  /* Six-Three Sum  of p2, q1, q2, p3, p4, p5. */
+  three_sum(p2, q1, q2);
+  three_sum(p3, p4, p5);
+  /* compute (s0, s1, s2) = (p2, q1, q2) + (p3, p4, p5). */
+  s0 = two_sum(p2, p3, t0);
+  s1 = two_sum(q1, p4, t1);
+  s2 = q2 + p5;
+  s1 = two_sum(s1, t0, t0);
+  s2 = s2 + (t0 + t1);
+
+  /* O(eps^3) order terms */
+  s1 = s1 + (a.x[0]*b.x[3] + a.x[1]*b.x[2] + a.x[2]*b.x[1] + a.x[3]*b.x[0] + q0 + q3 + q4 + q5);
+
+  c[0] = p0; c[1] = p1; c[2] = s0; c[3] = s1; c[4] = s2;
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* quad-double ^ 2 */
+inline qd_pack qd_sqr(const qd_pack &a) {
+  vec p0, p1, p2, p3, p4, p5;
+  vec q0, q1, q2, q3;
+  vec s0, s1;
+  vec t0, t1;
+  vec c[5];
+
+  p0 = two_sqr(a.x[0], q0);
+  p1 = two_prod(vec(2.0) * a.x[0], a.x[1], q1);
+  p2 = two_prod(vec(2.0) * a.x[0], a.x[2], q2);
+  p3 = two_sqr(a.x[1], q3);
+
+  p1 = two_sum(q0, p1, q0);
+
+  q0 = two_sum(q0, q1, q1);
+  p2 = two_sum(p2, p3, p3);
+
+  s0 = two_sum(q0, p2, t0);
+  s1 = two_sum(q1, p3, t1);
+
+  s1 = two_sum(s1, t0, t0);
+  t0 = t0 + t1;
+
+  s1 = quick_two_sum(s1, t0, t0);
+  p2 = quick_two_sum(s0, s1, t1);
+  p3 = quick_two_sum(t1, t0, q0);
+
+  p4 = vec(2.0) * a.x[0] * a.x[3];
+  p5 = vec(2.0) * a.x[1] * a.x[2];
+
+  p4 = two_sum(p4, p5, p5);
+  q2 = two_sum(q2, q3, q3);
+
+  t0 = two_sum(p4, q2, t1);
+  t1 = t1 + p5 + q3;
+
+  p3 = two_sum(p3, t0, p4);
+  p4 = p4 + q0 + t1;
+
+  c[0] = p0; c[1] = p1; c[2] = p2; c[3] = p3; c[4] = p4;
+  renorm(c);
+  qd_pack r = {{c[0], c[1], c[2], c[3]}};
+  return r;
+}
+
+/* (hi, lo) = (a, b) with one two_sum, dd_real::add */
+inline dd_pack dd_two_sum(vec a, vec b) {
+  dd_pack r;
+  r.hi = two_sum(a, b, r.lo);
+  return r;
+}
+
+/* the leading two components of a */
+inline dd_pack qd_hi(const qd_pack &a) {
+  dd_pack r = {a.x[0], a.x[1]};
+  return r;
+}
+
+inline qd_pack qd_from(const dd_pack &a) {
+  qd_pack r = {{a.hi, a.lo, vec(0.0), vec(0.0)}};
+  return r;
+}
+
+/* renormalizes the two corrections of a Newton iteration, (x0, x1, c) */
+inline qd_pack qd_newton_sum(const dd_pack &x0, const dd_pack &x1, vec c) {
+  vec t[5] = {x0.hi, x0.lo, x1.hi, x1.lo, c};
+  renorm(t);
+  qd_pack r = {{t[0], t[1], t[2], t[3]}};
+  return r;
+}
+
+/* 1/b and 1/sqrt(a) to about 2^-104, inv_dd and rsqrt_dd of qd_real.cc */
+inline dd_pack qd_inv_dd(const qd_pack &b) {
+  dd_pack one = {vec(1.0), vec(0.0)};
+  vec y = vec(1.0) / b.x[0];
+  dd_pack e = dd_sub(one, dd_mul(qd_hi(b), y));
+  return dd_two_sum(y, e.hi * y);
+}
+
+inline dd_pack qd_rsqrt_dd(const qd_pack &a) {
+  dd_pack one = {vec(1.0), vec(0.0)}, y2;
+  vec y = vec(1.0) / sqrt(a.x[0]);
+  y2.hi = two_sqr(y, y2.lo);
+  dd_pack e = dd_sub(one, dd_mul(qd_hi(a), y2));
+  return dd_two_sum(y, e.hi * (y * vec(0.5)));
+}
+
+/* 2^-600 above 2^900, 2^600 below 2^-900 and 1 otherwise, newton_scale of
+   qd_real.cc */
+inline vec qd_newton_scale(vec b) {
+  vec big(0x1p900), small(0x1p-900);
+  mask hi = andnot((big < b) | (b < -big), is_inf(b));
+  mask lo = (b < small) & (-small < b);
+  return select(hi, vec(0x1p-600), select(lo, vec(0x1p600), vec(1.0)));
+}
+
+/* Inf or NaN, !QD_ISFINITE */
+inline mask not_finite(vec a) {
+  return is_inf(a) | (a != a);
+}
+
+/* a k for a power of two k, mul_pwr2 */
+inline qd_pack qd_scale(const qd_pack &a, vec k) {
+  qd_pack r;
+  for (int i = 0; i < 4; i++)
+    r.x[i] = a.x[i] * k;
+  return r;
+}
+
+/* quad-double / quad-double, qd_real::sloppy_div */
+inline qd_pack qd_div(const qd_pack &a0, const qd_pack &b0) {
+  dd_pack y, q0, q1;
+  qd_pack r, a, b;
+  vec k;
+  mask bad;
+  int i;
+
+  /* a / b = (a k) / (b k); k = 1 leaves the lanes in range unchanged */
+  k = qd_newton_scale(b0.x[0]);
+  a = qd_scale(a0, k);
+  b = qd_scale(b0, k);
+
+  y = qd_inv_dd(b);
+  q0 = dd_mul(qd_hi(a), y);
+  r = qd_sub(a, qd_mul(b, q0));
+
+  q1 = dd_mul(qd_hi(r), y);
+  r = qd_sub(r, qd_mul(b, q1));
+
+  r = qd_newton_sum(q0, q1, r.x[0] * y.hi);
+
+  /* a[0] / b[0] for a zero, Inf or NaN divisor and an overflow */
+  bad = not_finite(b0.x[0]) | (b0.x[0] == vec(0.0)) | not_finite(r.x[0]);
+  r.x[0] = select(bad, a0.x[0] / b0.x[0], r.x[0]);
+  for (i = 1; i < 4; i++)
+    r.x[i] = select(bad, vec(0.0), r.x[i]);
+  return r;
+}
+
+/* 1 / b, inv(qd_real) */
+inline qd_pack qd_inv(const qd_pack &b) {
+  qd_pack one = {{vec(1.0), vec(0.0), vec(0.0), vec(0.0)}};
+  return qd_div(one, b);
+}
+
+/* sqrt(a) by Karp's trick, 0 for a = 0 and NaN for a < 0 */
+inline qd_pack qd_sqrt(const qd_pack &a0) {
+  dd_pack y, h, s0, s1, t;
+  qd_pack r, a;
+  vec e, k;
+  int i;
+
+  /* sqrt(a) = sqrt(a k) / sqrt(k) */
+  k = qd_newton_scale(a0.x[0]);
+  a = qd_scale(a0, k);
+
+  y = qd_rsqrt_dd(a);
+  h.hi = y.hi * vec(0.5);
+  h.lo = y.lo * vec(0.5);
+  s0 = dd_mul(qd_hi(a), y);
+  r = qd_sub(a, qd_mul(qd_from(s0), s0));
+
+  s1 = dd_mul(qd_hi(r), h);
+  t.hi = s0.hi * vec(2.0);
+  t.lo = s0.lo * vec(2.0);
+  r = qd_sub(r, qd_mul(qd_add(qd_from(t), s1), s1));
+
+  r = qd_newton_sum(s0, s1, r.x[0] * h.hi);
+
+  e = vec(std::numeric_limits<double>::quiet_NaN());
+  for (i = 0; i < 4; i++) {
+    r.x[i] = select(a.x[0] < vec(0.0), e, r.x[i]);
+    r.x[i] = select(a.x[0] == vec(0.0), vec(0.0), r.x[i]);
+  }
+  return qd_scale(r, vec(1.0) / sqrt(k));
+}
+
+/* 1/sqrt(a), rsqrt(qd_real):  Inf for a = 0 and NaN for a < 0 */
+inline qd_pack qd_rsqrt(const qd_pack &a0) {
+  dd_pack y0, y1, t;
+  qd_pack e, a;
+  vec nan, inf, k;
+  int i;
+
+  /* 1/sqrt(a) = sqrt(k) / sqrt(a k) */
+  k = qd_newton_scale(a0.x[0]);
+  a = qd_scale(a0, k);
+
+  y0 = qd_rsqrt_dd(a);
+  e = qd_add(qd_neg(qd_mul(a, qd_mul(qd_from(y0), y0))), vec(1.0));
+
+  t.hi = y0.hi * vec(0.5);
+  t.lo = y0.lo * vec(0.5);
+  y1 = dd_mul(qd_hi(e), t);
+  t.hi = y0.hi * vec(2.0);
+  t.lo = y0.lo * vec(2.0);
+  e = qd_sub(e, qd_mul(a, qd_mul(qd_add(qd_from(t), y1), y1)));
+
+  e = qd_newton_sum(y0, y1, e.x[0] * (y0.hi * vec(0.5)));
+
+  nan = vec(std::numeric_limits<double>::quiet_NaN());
+  inf = vec(std::numeric_limits<double>::infinity());
+  for (i = 0; i < 4; i++) {
+    e.x[i] = select(a.x[0] < vec(0.0), nan, e.x[i]);
+    e.x[i] = select(a.x[0] == vec(0.0), inf, e.x[i]);
+  }
+  return qd_scale(e, sqrt(k));
+}
+
+/*********** Arrays ************/
+/* c[i] = op(a[i], b[i]) for whole packets, returns the number of elements done */
+template <dd_pack (*op)(const dd_pack &, const dd_pack &)>
+inline std::size_t dd_map(const double *a, const double *b, double *c, std::size_t n) {
+  std::size_t i = 0;
+  dd_pack x, y, z;
+  for (; i + width <= n; i += width) {
+    load_dd(a + 2 * i, x.hi, x.lo);
+    load_dd(b + 2 * i, y.hi, y.lo);
+    z = op(x, y);
+    store_dd(c + 2 * i, z.hi, z.lo);
+  }
+  return i;
+}
+
+template <dd_pack (*op)(const dd_pack &)>
+inline std::size_t dd_map(const double *a, double *c, std::size_t n) {
+  std::size_t i = 0;
+  dd_pack x, z;
+  for (; i + width <= n; i += width) {
+    load_dd(a + 2 * i, x.hi, x.lo);
+    z = op(x);
+    store_dd(c + 2 * i, z.hi, z.lo);
+  }
+  return i;
+}
+
+template <qd_pack (*op)(const qd_pack &, const qd_pack &)>
+inline std::size_t qd_map(const double *a, const double *b, double *c, std::size_t n) {
+  std::size_t i = 0;
+  qd_pack x, y, z;
+  for (; i + width <= n; i += width) {
+    load_qd(a + 4 * i, x.x);
+    load_qd(b + 4 * i, y.x);
+    z = op(x, y);
+    store_qd(c + 4 * i, z.x);
+  }
+  return i;
+}
+
+template <qd_pack (*op)(const qd_pack &)>
+inline std::size_t qd_map(const double *a, double *c, std::size_t n) {
+  std::size_t i = 0;
+  qd_pack x, z;
+  for (; i + width <= n; i += width) {
+    load_qd(a + 4 * i, x.x);
+    z = op(x);
+    store_qd(c + 4 * i, z.x);
+  }
+  return i;
+}
+
+/* The element arrays are interleaved like dd_real[n] and qd_real[n]. */
+#define QD_SIMD_BINARY(name, type, op, k)                                  \
+  inline void name(const double *a, const double *b, double *c,           \
+                   std::size_t n) {                                       \
+    std::size_t i = type##_map<op>(a, b, c, n);                           \
+    if (i < n)                                                            \
+      scalar::name(a + k * i, b + k * i, c + k * i, n - i);               \
+  }
+#define QD_SIMD_UNARY(name, type, op, k)                                   \
+  inline void name(const double *a, double *c, std::size_t n) {           \
+    std::size_t i = type##_map<op>(a, c, n);                              \
+    if (i < n)                                                            \
+      scalar::name(a + k * i, c + k * i, n - i);                          \
+  }
+
+QD_SIMD_BINARY(dd_add_n, dd, dd_add, 2)
+QD_SIMD_BINARY(dd_sub_n, dd, dd_sub, 2)
+QD_SIMD_BINARY(dd_mul_n, dd, dd_mul, 2)
+QD_SIMD_BINARY(dd_div_n, dd, dd_div, 2)
+QD_SIMD_UNARY(dd_inv_n, dd, dd_inv, 2)
+QD_SIMD_UNARY(dd_sqrt_n, dd, dd_sqrt, 2)
+QD_SIMD_BINARY(qd_add_n, qd, qd_add, 4)
+QD_SIMD_BINARY(qd_sub_n, qd, qd_sub, 4)
+QD_SIMD_BINARY(qd_mul_n, qd, qd_mul, 4)
+QD_SIMD_BINARY(qd_div_n, qd, qd_div, 4)
+QD_SIMD_UNARY(qd_inv_n, qd, qd_inv, 4)
+QD_SIMD_UNARY(qd_sqrt_n, qd, qd_sqrt, 4)
+QD_SIMD_UNARY(qd_rsqrt_n, qd, qd_rsqrt, 4)
+
+#undef QD_SIMD_BINARY
+#undef QD_SIMD_UNARY
@@ -0,0 +1,593 @@
+/*
+ * include/td_inline.h
+ *
+ * Contains small functions (suitable for inlining) in the triple-double
+ * arithmetic package.  The algorithms are those of quad-double
+ * (qd_inline.h) truncated to three components.
+ */
+#ifndef _QD_TD_INLINE_H
+#define _QD_TD_INLINE_H
+
+#include <cmath>
+#include "inline.h"
+
+#ifndef QD_INLINE
+#define inline
+#endif
+
+/********** Constructors **********/
+inline td_real::td_real(std::ptrdiff_t h) {
+  *this = td_real(static_cast<int>(h));
+}
+
+/* rounds away the fourth component */
+inline td_real::td_real(const qd_real &a) {
+  x[0] = a[0];
+  x[1] = a[1];
+  x[2] = a[2] + a[3];
+}
+
+/********** Accessors **********/
+inline double td_real::operator[](int i) const {
+  return x[i];
+}
+
+inline double &td_real::operator[](int i) {
+  return x[i];
+}
+
+inline bool td_real::isnan() const {
+  return QD_ISNAN(x[0]) || QD_ISNAN(x[1]) || QD_ISNAN(x[2]);
+}
+
+/********** Renormalization **********/
+namespace qd {
+
+/* Renormalizes c0 + c1 + c2 + c3 into three nonoverlapping components
+   (c0, c1, c2); the last one is rounded.  Same as renorm of qd_inline.h
+   with the fourth output added to the third. */
+inline void td_renorm(double &c0, double &c1, double &c2, double c3) {
+  double s0, s1, s2 = 0.0, s3 = 0.0;
+
+  if (QD_ISINF(c0)) return;
+
+  s0 = qd::quick_two_sum(c2, c3, c3);
+  s0 = qd::quick_two_sum(c1, s0, c2);
+  c0 = qd::quick_two_sum(c0, s0, c1);
+
+  s0 = c0;
+  s1 = c1;
+  if (s1 != 0.0) {
+    s1 = qd::quick_two_sum(s1, c2, s2);
+    if (s2 != 0.0)
+      s2 = qd::quick_two_sum(s2, c3, s3);
+    else
+      s1 = qd::quick_two_sum(s1, c3, s2);
+  } else {
+    s0 = qd::quick_two_sum(s0, c2, s1);
+    if (s1 != 0.0)
+      s1 = qd::quick_two_sum(s1, c3, s2);
+    else
+      s0 = qd::quick_two_sum(s0, c3, s1);
+  }
+
+  c0 = s0;
+  c1 = s1;
+  c2 = s2 + s3;
+}
+
+/* (a, b, c) = a + b + c with |b| and |c| the errors of a */
+inline void td_three_sum(double &a, double &b, double &c) {
+  double t1, t2, t3;
+  t1 = qd::two_sum(a, b, t2);
+  a  = qd::two_sum(c, t1, t3);
+  b  = qd::two_sum(t2, t3, c);
+}
+
+/* s = td_three_accum(a, b, c) adds c to the dd-pair (a, b), as
+   quick_three_accum of qd_inline.h. */
+inline double td_three_accum(double &a, double &b, double c) {
+  double s;
+  bool za, zb;
+
+  s = qd::two_sum(b, c, b);
+  s = qd::two_sum(a, s, a);
+
+  za = (a != 0.0);
+  zb = (b != 0.0);
+
+  if (za && zb)
+    return s;
+
+  if (!zb) {
+    b = a;
+    a = s;
+  } else {
+    a = s;
+  }
+
+  return 0.0;
+}
+
+}
+
+/********** Additions ************/
+/* triple-double + double */
+inline td_real operator+(const td_real &a, double b) {
+  double c0, c1, c2;
+  double e;
+
+  c0 = qd::two_sum(a[0], b, e);
+  c1 = qd::two_sum(a[1], e, e);
+  c2 = qd::two_sum(a[2], e, e);
+
+  qd::td_renorm(c0, c1, c2, e);
+  return td_real(c0, c1, c2);
+}
+
+inline td_real operator+(double a, const td_real &b) {
+  return (b + a);
+}
+
+/* merges the components by magnitude, as qd_real::ieee_add */
+inline td_real td_real::ieee_add(const td_real &a, const td_real &b) {
+  int i, j, k;
+  double s, t;
+  double u, v;   /* double-length accumulator */
+  double x[3] = {0.0, 0.0, 0.0};
+
+  i = j = k = 0;
+  if (std::abs(a[i]) > std::abs(b[j]))
+    u = a[i++];
+  else
+    u = b[j++];
+  if (std::abs(a[i]) > std::abs(b[j]))
+    v = a[i++];
+  else
+    v = b[j++];
+
+  u = qd::quick_two_sum(u, v, v);
+
+  while (k < 3) {
+    if (i >= 3 && j >= 3) {
+      x[k] = u;
+      if (k < 2)
+        x[++k] = v;
+      break;
+    }
+
+    if (i >= 3)
+      t = b[j++];
+    else if (j >= 3)
+      t = a[i++];
+    else if (std::abs(a[i]) > std::abs(b[j])) {
+      t = a[i++];
+    } else
+      t = b[j++];
+
+    s = qd::td_three_accum(u, v, t);
+
+    if (s != 0.0) {
+      x[k++] = s;
+    }
+  }
+
+  /* add the rest. */
+  double r = 0.0;
+  for (k = i; k < 3; k++)
+    r += a[k];
+  for (k = j; k < 3; k++)
+    r += b[k];
+
+  qd::td_renorm(x[0], x[1], x[2], r);
+  return td_real(x[0], x[1], x[2]);
+}
+
+inline td_real td_real::sloppy_add(const td_real &a, const td_real &b) {
+  double s0, s1, s2;
+  double t0, t1, t2;
+
+  s0 = qd::two_sum(a[0], b[0], t0);
+  s1 = qd::two_sum(a[1], b[1], t1);
+  s2 = qd::two_sum(a[2], b[2], t2);
+
+  s1 = qd::two_sum(s1, t0, t0);
+  qd::td_three_sum(s2, t0, t1);
+  t0 = t0 + t1 + t2;
+
+  qd::td_renorm(s0, s1, s2, t0);
+  return td_real(s0, s1, s2);
+}
+
+/* triple-double + triple-double */
+inline td_real operator+(const td_real &a, const td_real &b) {
+#ifndef QD_IEEE_ADD
+  return td_real::sloppy_add(a, b);
+#else
+  return td_real::ieee_add(a, b);
+#endif
+}
+
+/********** Self-Additions ************/
+inline td_real &td_real::operator+=(double a) {
+  *this = *this + a;
+  return *this;
+}
+
+inline td_real &td_real::operator+=(const td_real &a) {
+  *this = *this + a;
+  return *this;
+}
+
+/********** Unary Minus **********/
+inline td_real td_real::operator-() const {
+  return td_real(-x[0], -x[1], -x[2]);
+}
+
+/********** Subtractions **********/
+inline td_real operator-(const td_real &a, double b) {
+  return (a + (-b));
+}
+
+inline td_real operator-(double a, const td_real &b) {
+  return (a + (-b));
+}
+
+inline td_real operator-(const td_real &a, const td_real &b) {
+  return (a + (-b));
+}
+
+/********** Self-Subtractions **********/
+inline td_real &td_real::operator-=(double a) {
+  return ((*this) += (-a));
+}
+
+inline td_real &td_real::operator-=(const td_real &a) {
+  return ((*this) += (-a));
+}
+
+/********** Multiplications **********/
+inline td_real mul_pwr2(const td_real &a, double b) {
+  return td_real(a[0] * b, a[1] * b, a[2] * b);
+}
+
+/* triple-double * double */
+inline td_real operator*(const td_real &a, double b) {
+  double p0, p1, p2;
+  double q0, q1;
+  double s1, s2;
+
+  p0 = qd::two_prod(a[0], b, q0);
+  p1 = qd::two_prod(a[1], b, q1);
+  p2 = a[2] * b;
+
+  s1 = qd::two_sum(q0, p1, s2);
+  s2 = qd::two_sum(s2, p2, p2);
+  s2 = qd::two_sum(s2, q1, q1);
+
+  qd::td_renorm(p0, s1, s2, q1 + p2);
+  return td_real(p0, s1, s2);
+}
+
+inline td_real operator*(double a, const td_real &b) {
+  return (b * a);
+}
+
+/* triple-double * triple-double
+   a0 * b0                 0
+        a0 * b1            1
+        a1 * b0            2
+             a0 * b2       3
+             a1 * b1       4
+             a2 * b0       5
+                  a1 * b2  6
+                  a2 * b1  7
+
+   The sloppy product drops the errors of the O(eps^2) terms 3-5,
+   the accurate one keeps them and adds the O(eps^3) terms 6-7. */
+inline td_real td_real::sloppy_mul(const td_real &a, const td_real &b) {
+  double p0, p1, p2;
+  double q0, q1, q2;
+  double s0, t0;
+
+  p0 = qd::two_prod(a[0], b[0], q0);
+  p1 = qd::two_prod(a[0], b[1], q1);
+  p2 = qd::two_prod(a[1], b[0], q2);
+
+  qd::td_three_sum(p1, p2, q0);
+
+  s0 = qd::two_sum(p2, q1 + q2 + a[0] * b[2] + a[1] * b[1] + a[2] * b[0], t0);
+  t0 += q0;
+
+  qd::td_renorm(p0, p1, s0, t0);
+  return td_real(p0, p1, s0);
+}
+
+inline td_real td_real::accurate_mul(const td_real &a, const td_real &b) {
+  double p0, p1, p2, p3, p4, p5;
+  double q0, q1, q2, q3, q4, q5;
+  double s0, s1, s2;
+  double t0, t1;
+
+  p0 = qd::two_prod(a[0], b[0], q0);
+
+  p1 = qd::two_prod(a[0], b[1], q1);
+  p2 = qd::two_prod(a[1], b[0], q2);
+
+  p3 = qd::two_prod(a[0], b[2], q3);
+  p4 = qd::two_prod(a[1], b[1], q4);
+  p5 = qd::two_prod(a[2], b[0], q5);
+
+  /* Start Accumulation */
+  qd::td_three_sum(p1, p2, q0);
+
+  /* Six-Two Sum of p2, q1, q2, p3, p4, p5. */
+  qd::td_three_sum(p2, q1, q2);
+  qd::td_three_sum(p3, p4, p5);
+  s0 = qd::two_sum(p2, p3, t0);
+  s1 = qd::two_sum(q1, p4, t1);
+  s2 = q2 + p5;
+  s1 = s1 + t0 + t1 + s2;
+
+  /* O(eps^3) order terms */
+  s1 += a[1] * b[2] + a[2] * b[1] + q0 + q3 + q4 + q5;
+
+  qd::td_renorm(p0, p1, s0, s1);
+  return td_real(p0, p1, s0);
+}
+
+inline td_real operator*(const td_real &a, const td_real &b) {
+#ifdef QD_SLOPPY_MUL
+  return td_real::sloppy_mul(a, b);
+#else
+  return td_real::accurate_mul(a, b);
+#endif
+}
+
+inline td_real sqr(const td_real &a) {
+  return a * a;
+}
+
+/********** Self-Multiplications **********/
+inline td_real &td_real::operator*=(double a) {
+  *this = (*this * a);
+  return *this;
+}
+
+inline td_real &td_real::operator*=(const td_real &a) {
+  *this = (*this * a);
+  return *this;
+}
+
+/********** Divisions **********/
+/* long division, one double of the quotient per step */
+inline td_real td_real::sloppy_div(const td_real &a, const td_real &b) {
+  double q0, q1, q2;
+  td_real r;
+
+  q0 = a[0] / b[0];
+  r = a - (b * q0);
+
+  q1 = r[0] / b[0];
+  r -= (b * q1);
+
+  q2 = r[0] / b[0];
+
+  qd::td_renorm(q0, q1, q2, 0.0);
+  return td_real(q0, q1, q2);
+}
+
+inline td_real td_real::accurate_div(const td_real &a, const td_real &b) {
+  double q0, q1, q2, q3;
+  td_real r;
+
+  q0 = a[0] / b[0];
+  r = a - (b * q0);
+
+  q1 = r[0] / b[0];
+  r -= (b * q1);
+
+  q2 = r[0] / b[0];
+  r -= (b * q2);
+
+  q3 = r[0] / b[0];
+
+  qd::td_renorm(q0, q1, q2, q3);
+  return td_real(q0, q1, q2);
+}
+
+inline td_real operator/(const td_real &a, const td_real &b) {
+#ifdef QD_SLOPPY_DIV
+  return td_real::sloppy_div(a, b);
+#else
+  return td_real::accurate_div(a, b);
+#endif
+}
+
+inline td_real operator/(const td_real &a, double b) {
+  return a / td_real(b);
+}
+
+inline td_real operator/(double a, const td_real &b) {
+  return td_real(a) / b;
+}
+
+inline td_real inv(const td_real &a) {
+  return 1.0 / a;
+}
+
+/********** Self-Divisions **********/
+inline td_real &td_real::operator/=(double a) {
+  *this = (*this / a);
+  return *this;
+}
+
+inline td_real &td_real::operator/=(const td_real &a) {
+  *this = (*this / a);
+  return *this;
+}
+
+/*********** Assignments ************/
+inline td_real &td_real::operator=(double a) {
+  x[0] = a;
+  x[1] = x[2] = 0.0;
+  return *this;
+}
+
+inline td_real &td_real::operator=(const dd_real &a) {
+  x[0] = a._hi();
+  x[1] = a._lo();
+  x[2] = 0.0;
+  return *this;
+}
+
+/********** Equality Comparison **********/
+inline bool operator==(const td_real &a, double b) {
+  return (a[0] == b && a[1] == 0.0 && a[2] == 0.0);
+}
+
+inline bool operator==(double a, const td_real &b) {
+  return (b == a);
+}
+
+inline bool operator==(const td_real &a, const td_real &b) {
+  return (a[0] == b[0] && a[1] == b[1] && a[2] == b[2]);
+}
+
+inline bool operator!=(const td_real &a, double b) {
+  return !(a == b);
+}
+
+inline bool operator!=(double a, const td_real &b) {
+  return !(a == b);
+}
+
+inline bool operator!=(const td_real &a, const td_real &b) {
+  return !(a == b);
+}
+
+/********** Less-Than Comparison ***********/
+inline bool operator<(const td_real &a, double b) {
+  return (a[0] < b || (a[0] == b && a[1] < 0.0));
+}
+
+inline bool operator<(double a, const td_real &b) {
+  return (b > a);
+}
+
+inline bool operator<(const td_real &a, const td_real &b) {
+  return (a[0] < b[0] ||
+          (a[0] == b[0] && (a[1] < b[1] ||
+                            (a[1] == b[1] && a[2] < b[2]))));
+}
+
+/********** Greater-Than Comparison ***********/
+inline bool operator>(const td_real &a, double b) {
+  return (a[0] > b || (a[0] == b && a[1] > 0.0));
+}
+
+inline bool operator>(double a, const td_real &b) {
+  return (b < a);
+}
+
+inline bool operator>(const td_real &a, const td_real &b) {
+  return (a[0] > b[0] ||
+          (a[0] == b[0] && (a[1] > b[1] ||
+                            (a[1] == b[1] && a[2] > b[2]))));
+}
+
+/********** Less-Than-Or-Equal-To Comparison **********/
+inline bool operator<=(const td_real &a, double b) {
+  return (a[0] < b || (a[0] == b && a[1] <= 0.0));
+}
+
+inline bool operator<=(double a, const td_real &b) {
+  return (b >= a);
+}
+
+inline bool operator<=(const td_real &a, const td_real &b) {
+  return !(a > b);
+}
+
+/********** Greater-Than-Or-Equal-To Comparison **********/
+inline bool operator>=(const td_real &a, double b) {
+  return (a[0] > b || (a[0] == b && a[1] >= 0.0));
+}
+
+inline bool operator>=(double a, const td_real &b) {
+  return (b <= a);
+}
+
+inline bool operator>=(const td_real &a, const td_real &b) {
+  return !(a < b);
+}
+
+/********** Miscellaneous **********/
+inline td_real abs(const td_real &a) {
+  return (a[0] < 0.0) ? -a : a;
+}
+
+inline td_real fabs(const td_real &a) {
+  return abs(a);
+}
+
+inline td_real max(const td_real &a, const td_real &b) {
+  return (a > b) ? a : b;
+}
+
+inline td_real min(const td_real &a, const td_real &b) {
+  return (a < b) ? a : b;
+}
+
+inline td_real aint(const td_real &a) {
+  return (a[0] >= 0) ? floor(a) : ceil(a);
+}
+
+inline bool td_real::is_zero() const {
+  return (x[0] == 0.0);
+}
+
+inline bool td_real::is_one() const {
+  return (x[0] == 1.0 && x[1] == 0.0 && x[2] == 0.0);
+}
+
+inline bool td_real::is_positive() const {
+  return (x[0] > 0.0);
+}
+
+inline bool td_real::is_negative() const {
+  return (x[0] < 0.0);
+}
+
+inline td_real::operator bool() const {
+  return (x[0] != 0.0);
+}
+
+inline td_real::operator double() const {
+  return to_double(*this);
+}
+
+inline td_real::operator dd_real() const {
+  double s, e;
+  s = qd::quick_two_sum(x[0], x[1] + x[2], e);
+  return dd_real(s, e);
+}
+
+inline td_real::operator qd_real() const {
+  return qd_real(x[0], x[1], x[2], 0.0);
+}
+
+inline double to_double(const td_real &a) {
+  return a[0];
+}
+
+inline int to_int(const td_real &a) {
+  return static_cast<int>(a[0]);
+}
+
+inline td_real ldexp(const td_real &a, int n) {
+  return td_real(std::ldexp(a[0], n), std::ldexp(a[1], n),
+                 std::ldexp(a[2], n));
+}
+
+#endif /* _QD_TD_INLINE_H */
@@ -0,0 +1,229 @@
+/*
+ * src/td_real.cc
+ *
+ * Contains implementation of non-inlined functions of the triple-double
+ * package.  Inlined functions are found in td_inline.h.  The elementary
+ * functions follow their quad-double versions in qd_real.cc with one
+ * Newton step less, and text input and output go through qd_real.
+ */
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "qd_config.h"
+#include "td_real.h"
+#include "poly.h"
+
+#ifndef QD_INLINE
+#include "td_inline.h"
+#endif
+
+using std::istream;
+using std::ostream;
+using std::ios_base;
+using std::string;
+
+void td_real::error(const char *msg) {
+  //if (msg) { cerr << "ERROR " << msg << endl; }
+}
+
+td_real::td_real(const char *s) {
+  if (td_real::read(s, *this)) {
+    td_real::error("(td_real::td_real): INPUT ERROR.");
+    *this = td_real::_nan;
+  }
+}
+
+/********** Rounding **********/
+td_real nint(const td_real &a) {
+  return td_real(nint(qd_real(a)));
+}
+
+td_real floor(const td_real &a) {
+  double x0, x1, x2;
+  x1 = x2 = 0.0;
+  x0 = std::floor(a[0]);
+
+  if (x0 == a[0]) {
+    x1 = std::floor(a[1]);
+
+    if (x1 == a[1])
+      x2 = std::floor(a[2]);
+
+    qd::td_renorm(x0, x1, x2, 0.0);
+  }
+
+  return td_real(x0, x1, x2);
+}
+
+td_real ceil(const td_real &a) {
+  double x0, x1, x2;
+  x1 = x2 = 0.0;
+  x0 = std::ceil(a[0]);
+
+  if (x0 == a[0]) {
+    x1 = std::ceil(a[1]);
+
+    if (x1 == a[1])
+      x2 = std::ceil(a[2]);
+
+    qd::td_renorm(x0, x1, x2, 0.0);
+  }
+
+  return td_real(x0, x1, x2);
+}
+
+/********** Powers and roots **********/
+td_real pow(const td_real &a, int n) {
+  if (n == 0)
+    return 1.0;
+
+  td_real r = a;    /* odd-case multiplier */
+  td_real s = 1.0;  /* current answer */
+  int N = std::abs(n);
+
+  /* Use binary exponentiation. */
+  while (N > 0) {
+    if (N % 2 == 1)
+      s *= r;
+    N /= 2;
+    if (N > 0)
+      r = sqr(r);
+  }
+
+  /* Compute the reciprocal if n is negative. */
+  return (n < 0) ? (1.0 / s) : s;
+}
+
+QD_API td_real sqrt(const td_real &a) {
+  /* Newton iteration x' = x + (1 - a * x^2) * x / 2 for 1/sqrt(a),
+     as in the quad-double sqrt; starting from the double precision
+     approximation, two steps give the 156 bits. */
+
+  if (a.is_zero())
+    return 0.0;
+
+  if (a.is_negative()) {
+    td_real::error("(td_real::sqrt): Negative argument.");
+    return td_real::_nan;
+  }
+
+  if (QD_ISINF(a[0]))
+    return a;
+
+  td_real r = (1.0 / std::sqrt(a[0]));
+  td_real h = mul_pwr2(a, 0.5);
+
+  r += ((0.5 - h * sqr(r)) * r);
+  r += ((0.5 - h * sqr(r)) * r);
+
+  r *= a;
+  return r;
+}
+
+/********** Exponential and logarithm **********/
+td_real exp(const td_real &a) {
+  /* Same reduction as the quad-double exp:
+
+          exp(kr + m * log(2)) = 2^m * exp(r)^k
+
+     with k = 2^16, so that |r| <= log(2) / 2^17 and the terms
+     up to r^9/9! are enough.  They are summed by Horner's rule. */
+
+  const double k = std::ldexp(1.0, 16);
+  const double inv_k = 1.0 / k;
+
+  if (a[0] <= -709.0)
+    return 0.0;
+
+  if (a[0] >=  709.0)
+    return td_real::_inf;
+
+  if (a.is_zero())
+    return 1.0;
+
+  if (a.is_one())
+    return td_real::_e;
+
+  if (a.isnan())
+    return td_real::_nan;
+
+  double m = std::floor(a.x[0] / td_real::_log2.x[0] + 0.5);
+  td_real r = mul_pwr2(a - td_real::_log2 * m, inv_k);
+
+  /* s = exp(r) - 1 */
+  td_real s = r * qd::poly::horner<9>(r, qd::poly::exp_series);
+
+  /* (1 + s)^2 - 1 = 2 s + s^2, sixteen times */
+  for (int j = 0; j < 16; ++j)
+    s = mul_pwr2(s, 2.0) + sqr(s);
+  s += 1.0;
+  return ldexp(s, static_cast<int>(m));
+}
+
+td_real log(const td_real &a) {
+  /* Newton iteration for exp(x) = a as in the quad-double log,
+
+         x' = x + a * exp(-x) - 1,
+
+     two steps from the double precision log(a[0]). */
+
+  if (a.is_one())
+    return 0.0;
+
+  if (a[0] == 0.0)
+    return -td_real::_inf;
+
+  if (!(a[0] > 0.0)) {
+    td_real::error("(td_real::log): Non-positive argument.");
+    return td_real::_nan;
+  }
+
+  if (QD_ISINF(a[0]))
+    return td_real::_inf;
+
+  td_real x = std::log(a[0]);   /* Initial approximation */
+
+  x = x + a * exp(-x) - 1.0;
+  x = x + a * exp(-x) - 1.0;
+
+  return x;
+}
+
+td_real log10(const td_real &a) {
+  return log(a) / td_real::_log10;
+}
+
+/********** Input and output **********/
+int td_real::read(const char *s, td_real &a) {
+  qd_real q;
+  int status = qd_real::read(s, q);
+  if (status == 0)
+    a = td_real(q);
+  return status;
+}
+
+void td_real::write(char *s, int len, int precision,
+    bool showpos, bool uppercase) const {
+  qd_real(*this).write(s, len, precision, showpos, uppercase);
+}
+
+string td_real::to_string(int precision, int width, ios_base::fmtflags fmt,
+    bool showpos, bool uppercase, char fill) const {
+  return qd_real(*this).to_string(precision, width, fmt, showpos, uppercase, fill);
+}
+
+istream &operator>>(istream &s, td_real &a) {
+  char str[255];
+  s >> str;
+  a = td_real(str);
+  return s;
+}
+
+ostream &operator<<(ostream &os, const td_real &a) {
+  bool showpos = (os.flags() & ios_base::showpos) != 0;
+  bool uppercase = (os.flags() & ios_base::uppercase) != 0;
+  return os << a.to_string((int)os.precision(), (int)os.width(), os.flags(),
+      showpos, uppercase, os.fill());
+}
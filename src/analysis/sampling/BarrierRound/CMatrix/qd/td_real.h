@@ -0,0 +1,229 @@
+/*
+ * include/td_real.h
+ *
+ * Triple-double precision (>= 156-bit significand) floating point
+ * arithmetic, built from the same error-free transformations as
+ * dd_real and qd_real (see inline.h).  A td_real is the unevaluated
+ * sum of three nonoverlapping doubles: about 47 decimal digits, in
+ * between double-double (31) and quad-double (62) at roughly half the
+ * cost of quad-double per operation.
+ *
+ * Only what the CMatrix kernels use is provided: the arithmetic,
+ * comparisons, sqrt, exp, log, rounding and the conversions from and
+ * to dd_real and qd_real.  Text input and output go through qd_real.
+ */
+#ifndef _QD_TD_REAL_H
+#define _QD_TD_REAL_H
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <limits>
+#include "qd_config.h"
+#include "dd_real.h"
+#include "qd_real.h"
+
+struct QD_API td_real {
+  double x[3];
+
+  constexpr td_real() : x{0.0, 0.0, 0.0} {}
+  constexpr td_real(double x0, double x1, double x2) : x{x0, x1, x2} {}
+  constexpr td_real(double h) : x{h, 0.0, 0.0} {}
+  constexpr td_real(int h) : x{static_cast<double>(h), 0.0, 0.0} {}
+  td_real(std::ptrdiff_t h); // for Eigen use
+  constexpr td_real(const dd_real &a) : x{a.x[0], a.x[1], 0.0} {}
+  explicit td_real(const qd_real &a);
+  explicit constexpr td_real(const double *xx) : x{xx[0], xx[1], xx[2]} {}
+  explicit td_real(const char *s);
+
+  static void error(const char *msg);
+
+  double operator[](int i) const;
+  double &operator[](int i);
+
+  static const td_real _2pi;
+  static const td_real _pi;
+  static const td_real _pi2;
+  static const td_real _e;
+  static const td_real _log2;
+  static const td_real _log10;
+  static const td_real _nan;
+  static const td_real _inf;
+
+  static constexpr double _eps = 1.0947644252537633e-47; // = 2^-156
+  static constexpr double _min_normalized = 1.8051943758648296e-276; // = 2^(-1022 + 2*53)
+  static const td_real _max;
+  static const td_real _safe_max;
+  static constexpr int _ndigits = 47;
+
+  bool isnan() const;
+  bool isfinite() const { return QD_ISFINITE(x[0]); }
+  bool isinf() const { return QD_ISINF(x[0]); }
+
+  static td_real ieee_add(const td_real &a, const td_real &b);
+  static td_real sloppy_add(const td_real &a, const td_real &b);
+
+  td_real &operator+=(double a);
+  td_real &operator+=(const td_real &a);
+
+  td_real &operator-=(double a);
+  td_real &operator-=(const td_real &a);
+
+  td_real operator-() const;
+
+  static td_real sloppy_mul(const td_real &a, const td_real &b);
+  static td_real accurate_mul(const td_real &a, const td_real &b);
+
+  td_real &operator*=(double a);
+  td_real &operator*=(const td_real &a);
+
+  static td_real sloppy_div(const td_real &a, const td_real &b);
+  static td_real accurate_div(const td_real &a, const td_real &b);
+
+  td_real &operator/=(double a);
+  td_real &operator/=(const td_real &a);
+
+  td_real &operator=(double a);
+  td_real &operator=(const dd_real &a);
+
+  bool is_zero() const;
+  bool is_one() const;
+  bool is_positive() const;
+  bool is_negative() const;
+
+  explicit operator bool() const;
+  explicit operator double() const;
+  explicit operator dd_real() const;
+  explicit operator qd_real() const;
+
+  void write(char *s, int len, int precision = _ndigits,
+      bool showpos = false, bool uppercase = false) const;
+  std::string to_string(int precision = _ndigits, int width = 0,
+      std::ios_base::fmtflags fmt = static_cast<std::ios_base::fmtflags>(0),
+      bool showpos = false, bool uppercase = false, char fill = ' ') const;
+  static int read(const char *s, td_real &a);
+};
+
+namespace std {
+  template <>
+  class numeric_limits<td_real> : public numeric_limits<double> {
+  public:
+    inline static double epsilon() { return td_real::_eps; }
+    inline static double min() { return td_real::_min_normalized; }
+    inline static td_real max() { return td_real::_max; }
+    inline static td_real safe_max() { return td_real::_safe_max; }
+    static const int digits = 156;
+    static const int digits10 = 46;
+  };
+}
+
+QD_API inline bool isnan(const td_real &a) { return a.isnan(); }
+QD_API inline bool isfinite(const td_real &a) { return a.isfinite(); }
+QD_API inline bool isinf(const td_real &a) { return a.isinf(); }
+
+/* Computes  td * d  where d is known to be a power of 2. */
+QD_API td_real mul_pwr2(const td_real &a, double d);
+
+QD_API td_real operator+(const td_real &a, double b);
+QD_API td_real operator+(double a, const td_real &b);
+QD_API td_real operator+(const td_real &a, const td_real &b);
+
+QD_API td_real operator-(const td_real &a, double b);
+QD_API td_real operator-(double a, const td_real &b);
+QD_API td_real operator-(const td_real &a, const td_real &b);
+
+QD_API td_real operator*(const td_real &a, double b);
+QD_API td_real operator*(double a, const td_real &b);
+QD_API td_real operator*(const td_real &a, const td_real &b);
+
+QD_API td_real operator/(const td_real &a, double b);
+QD_API td_real operator/(double a, const td_real &b);
+QD_API td_real operator/(const td_real &a, const td_real &b);
+
+QD_API td_real sqr(const td_real &a);
+QD_API td_real sqrt(const td_real &a);
+QD_API td_real inv(const td_real &a);
+
+QD_API bool operator==(const td_real &a, double b);
+QD_API bool operator==(double a, const td_real &b);
+QD_API bool operator==(const td_real &a, const td_real &b);
+
+QD_API bool operator!=(const td_real &a, double b);
+QD_API bool operator!=(double a, const td_real &b);
+QD_API bool operator!=(const td_real &a, const td_real &b);
+
+QD_API bool operator<(const td_real &a, double b);
+QD_API bool operator<(double a, const td_real &b);
+QD_API bool operator<(const td_real &a, const td_real &b);
+
+QD_API bool operator>(const td_real &a, double b);
+QD_API bool operator>(double a, const td_real &b);
+QD_API bool operator>(const td_real &a, const td_real &b);
+
+QD_API bool operator<=(const td_real &a, double b);
+QD_API bool operator<=(double a, const td_real &b);
+QD_API bool operator<=(const td_real &a, const td_real &b);
+
+QD_API bool operator>=(const td_real &a, double b);
+QD_API bool operator>=(double a, const td_real &b);
+QD_API bool operator>=(const td_real &a, const td_real &b);
+
+QD_API td_real floor(const td_real &a);
+QD_API td_real ceil(const td_real &a);
+QD_API td_real nint(const td_real &a);
+QD_API td_real aint(const td_real &a);
+
+QD_API td_real abs(const td_real &a);
+QD_API td_real fabs(const td_real &a);   /* same as abs */
+QD_API td_real max(const td_real &a, const td_real &b);
+QD_API td_real min(const td_real &a, const td_real &b);
+
+QD_API double to_double(const td_real &a);
+QD_API int    to_int(const td_real &a);
+
+QD_API td_real ldexp(const td_real &a, int exp);
+QD_API td_real exp(const td_real &a);
+QD_API td_real log(const td_real &a);
+QD_API td_real log10(const td_real &a);
+QD_API td_real pow(const td_real &a, int n);
+
+QD_API std::ostream &operator<<(std::ostream &s, const td_real &a);
+QD_API std::istream &operator>>(std::istream &s, td_real &a);
+
+/* constexpr constants: the quad-double constants rounded to three
+   components */
+inline constexpr td_real td_real::_2pi = td_real(6.283185307179586232e+00,
+                                                 2.449293598294706414e-16,
+                                                 -5.989539619436679332e-33);
+inline constexpr td_real td_real::_pi = td_real(3.141592653589793116e+00,
+                                                1.224646799147353207e-16,
+                                                -2.994769809718339666e-33);
+inline constexpr td_real td_real::_pi2 = td_real(1.570796326794896558e+00,
+                                                 6.123233995736766036e-17,
+                                                 -1.497384904859169833e-33);
+inline constexpr td_real td_real::_e = td_real(2.718281828459045091e+00,
+                                               1.445646891729250158e-16,
+                                               -2.127717108038176765e-33);
+inline constexpr td_real td_real::_log2 = td_real(6.931471805599452862e-01,
+                                                  2.319046813846299558e-17,
+                                                  5.707708438416212066e-34);
+inline constexpr td_real td_real::_log10 = td_real(2.302585092994045901e+00,
+                                                   -2.170756223382249351e-16,
+                                                   -9.984262454465776570e-33);
+inline constexpr td_real td_real::_nan = td_real(
+    dd_real::_nan.x[0], dd_real::_nan.x[0], dd_real::_nan.x[0]);
+inline constexpr td_real td_real::_inf = td_real(
+    dd_real::_inf.x[0], dd_real::_inf.x[0], dd_real::_inf.x[0]);
+inline constexpr td_real td_real::_max = td_real(
+    1.79769313486231570815e+308, 9.97920154767359795037e+291,
+    5.53956966280111259858e+275);
+inline constexpr td_real td_real::_safe_max = td_real(
+    1.7976931080746007281e+308,  9.97920154767359795037e+291,
+    5.53956966280111259858e+275);
+
+#ifdef QD_INLINE
+#include "td_inline.h"
+#endif
+
+#endif /* _QD_TD_REAL_H */
@@ -0,0 +1,525 @@
+/*
+ * include/text.h
+ *
+ * Decimal and hexadecimal text of double, dd_real, td_real and qd_real
+ * values and arrays, without heap allocation: the routines write into and
+ * read from buffers of the caller.  to_string and read of the qd classes
+ * build std::strings and spend one multiword operation per decimal digit;
+ * here the digits are made eight at a time, and the hex form copies the
+ * bits of each component, so it is exact and needs no multiword arithmetic.
+ *
+ *   decimal  -1.2345678901234567890123456789012e-05
+ *            The given number of significant digits (default_digits is
+ *            enough to resolve the precision of the type), rounded to
+ *            nearest, trailing zeros dropped.  Reading it back is accurate
+ *            to a few units in the last place of the type.
+ *   hex      0x1.5555555555555p-2+0x1.5555555555555p-56
+ *            The components as C99 hex floats, each after the first with its
+ *            sign; trailing zero components are left out.  Reads back to the
+ *            same bits.
+ *
+ * Both write nan, inf and -inf for the special values.  The readers take
+ * either form (a leading 0x selects hex) and accept NaN and Inf as well.
+ */
+#ifndef _QD_TEXT_H
+#define _QD_TEXT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+namespace qd {
+namespace text {
+
+enum format { decimal = 0, hex = 1 };
+
+/* most significant digits of write_decimal */
+const int max_digits = 70;
+
+/* The qd types are arrays of doubles, most significant first. */
+template <class T>
+inline int components() { return int(sizeof(T) / sizeof(double)); }
+
+template <class T>
+inline const double *parts(const T &a) { return reinterpret_cast<const double *>(&a); }
+
+template <class T>
+inline double *parts(T &a) { return reinterpret_cast<double *>(&a); }
+
+/* significant decimal digits that resolve the precision of T */
+template <class T>
+inline int default_digits() {
+  return 1 + (std::numeric_limits<T>::digits * 30103 + 99999) / 100000;
+}
+
+/* longest text of one value */
+template <class T>
+inline std::size_t max_length(format f, int digits) {
+  return f == hex ? std::size_t(24 * components<T>()) : std::size_t(digits + 7);
+}
+
+/*********** Helpers ************/
+inline bool is_blank(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == ',' || ch == ';';
+}
+
+inline const char *skip_blanks(const char *s, const char *end) {
+  while (s < end && is_blank(*s))
+    s++;
+  return s;
+}
+
+inline char lower(char ch) { return (ch >= 'A' && ch <= 'Z') ? char(ch - 'A' + 'a') : ch; }
+
+/* Writes the decimal digits of e (at least min_digits of them), returns the end. */
+inline char *write_int(char *p, int e, int min_digits) {
+  char buf[12];
+  int n = 0;
+  do {
+    buf[n++] = char('0' + e % 10);
+    e /= 10;
+  } while (e > 0);
+  while (n < min_digits)
+    buf[n++] = '0';
+  while (n > 0)
+    *p++ = buf[--n];
+  return p;
+}
+
+/* nan, inf or -inf if x0 is one of them, returns the end or 0 */
+inline char *write_special(double x0, char *p) {
+  if (x0 != x0) {
+    std::memcpy(p, "nan", 3);
+    return p + 3;
+  }
+  if (x0 == std::numeric_limits<double>::infinity()) {
+    std::memcpy(p, "inf", 3);
+    return p + 3;
+  }
+  if (x0 == -std::numeric_limits<double>::infinity()) {
+    std::memcpy(p, "-inf", 4);
+    return p + 4;
+  }
+  return 0;
+}
+
+/* nan, inf or infinity in any case after the sign, returns the end or 0 */
+inline const char *read_special(const char *s, const char *end, double &x) {
+  static const char *const names[] = { "infinity", "inf", "nan" };
+  for (int k = 0; k < 3; k++) {
+    std::size_t len = std::strlen(names[k]);
+    if (std::size_t(end - s) < len)
+      continue;
+    std::size_t i = 0;
+    while (i < len && lower(s[i]) == names[k][i])
+      i++;
+    if (i == len) {
+      x = (k == 2) ? std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::infinity();
+      return s + len;
+    }
+  }
+  return 0;
+}
+
+/*********** Decimal ************/
+/* Writes a in scientific notation with the given number of significant
+   digits (1 to max_digits) to s, which must hold digits + 7 characters.
+   Returns the number of characters written; no terminating 0 is added. */
+template <class T>
+std::size_t write_decimal(const T &a, char *s, int digits) {
+  using std::floor;
+  using std::ldexp;
+  using std::pow;
+
+  double x0 = parts(a)[0];
+  if (char *p = write_special(x0, s))
+    return std::size_t(p - s);
+
+  char *p = s;
+  if (x0 < 0.0 || (x0 == 0.0 && std::signbit(x0)))
+    *p++ = '-';
+  if (x0 == 0.0) {
+    *p++ = '0';
+    return std::size_t(p - s);
+  }
+  if (digits < 1)
+    digits = 1;
+  if (digits > max_digits)
+    digits = max_digits;
+
+  /* r = |a| / 10^e in [1, 10) */
+  T r = (x0 < 0.0) ? T(-a) : a;
+  int e = int(std::floor(std::log10(std::fabs(x0))));
+  if (e > 300) {
+    r = ldexp(r, -53);
+    r /= pow(T(10.0), e);
+    r = ldexp(r, 53);
+  } else if (e < -300) {
+    r *= pow(T(10.0), 300);
+    r *= pow(T(10.0), -e - 300);
+  } else if (e > 0) {
+    r /= pow(T(10.0), e);
+  } else if (e < 0) {
+    r *= pow(T(10.0), -e);
+  }
+  if (r >= 10.0) {
+    r /= 10.0;
+    e++;
+  } else if (r < 1.0) {
+    r *= 10.0;
+    e--;
+  }
+
+  /* digits + 1 digits in chunks of eight; the first chunk has the leading
+     digit.  A chunk out of [0, 1e8) by rounding carries into the one before. */
+  const int chunks = (digits + 8) / 8;
+  long long c[(max_digits + 8) / 8];
+  r *= 1e7;
+  for (int k = 0; k < chunks; k++) {
+    double q = parts(T(floor(r)))[0];
+    c[k] = (long long) q;
+    r -= q;
+    r *= 1e8;
+  }
+  for (int k = chunks - 1; k > 0; k--) {
+    if (c[k] < 0) {
+      c[k] += 100000000;
+      c[k - 1]--;
+    } else if (c[k] >= 100000000) {
+      c[k] -= 100000000;
+      c[k - 1]++;
+    }
+  }
+
+  /* buf[0] is a spare digit for a carry out of the leading one */
+  char buf[8 * ((max_digits + 8) / 8) + 1];
+  for (int i = 8; i >= 0; i--, c[0] /= 10)
+    buf[i] = char('0' + c[0] % 10);
+  for (int k = 1; k < chunks; k++)
+    for (int i = 8 * k + 8; i > 8 * k; i--, c[k] /= 10)
+      buf[i] = char('0' + c[k] % 10);
+
+  int start = (buf[0] == '0') ? 1 : 0;
+  if (buf[start + digits] >= '5') {
+    int i = start + digits - 1;
+    buf[i]++;
+    while (i > 0 && buf[i] > '9') {
+      buf[i] -= 10;
+      buf[--i]++;
+    }
+  }
+  if (start == 1 && buf[0] != '0')
+    start = 0;
+  e += 1 - start;
+
+  *p++ = buf[start];
+  int last = digits - 1;
+  while (last > 0 && buf[start + last] == '0')
+    last--;
+  if (last > 0) {
+    *p++ = '.';
+    std::memcpy(p, buf + start + 1, last);
+    p += last;
+  }
+  *p++ = 'e';
+  *p++ = (e < 0) ? '-' : '+';
+  p = write_int(p, (e < 0) ? -e : e, 2);
+  return std::size_t(p - s);
+}
+
+/* Reads a decimal number from [s, end) after the blanks, returns the
+   position after it, or 0 if there is none.  Digits past max_digits + 10
+   are only counted for the exponent. */
+template <class T>
+const char *read_decimal(const char *s, const char *end, T &a) {
+  using std::pow;
+  static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+
+  s = skip_blanks(s, end);
+  bool neg = false;
+  if (s < end && (*s == '+' || *s == '-'))
+    neg = (*s++ == '-');
+
+  double special;
+  if (const char *p = read_special(s, end, special)) {
+    a = T(neg ? -special : special);
+    return p;
+  }
+
+  T r = 0.0;
+  unsigned long acc = 0;
+  int nacc = 0, nd = 0, sig = 0, point = -1, e10 = 0;
+  bool any = false;
+  for (; s < end; s++) {
+    char ch = *s;
+    if (ch >= '0' && ch <= '9') {
+      any = true;
+      if (sig >= max_digits + 10) {
+        if (point < 0)
+          e10++;
+        continue;
+      }
+      if (sig > 0 || ch != '0')
+        sig++;
+      acc = acc * 10 + (unsigned long) (ch - '0');
+      nd++;
+      if (++nacc == 8) {
+        r = r * 1e8 + double(acc);
+        acc = 0;
+        nacc = 0;
+      }
+    } else if (ch == '.' && point < 0) {
+      point = nd;
+    } else {
+      break;
+    }
+  }
+  if (!any)
+    return 0;
+  if (nacc > 0)
+    r = r * pow10[nacc] + double(acc);
+  if (point >= 0)
+    e10 -= nd - point;
+
+  if (s < end && (*s == 'e' || *s == 'E')) {
+    s++;
+    bool eneg = false;
+    if (s < end && (*s == '+' || *s == '-'))
+      eneg = (*s++ == '-');
+    if (s >= end || *s < '0' || *s > '9')
+      return 0;
+    int e = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++)
+      if (e < 100000)
+        e = e * 10 + (*s - '0');
+    e10 += eneg ? -e : e;
+  }
+
+  if (r != 0.0) {
+    if (e10 > 0) {
+      r *= pow(T(10.0), e10 < 700 ? e10 : 700);
+    } else if (e10 < -300) {
+      r /= pow(T(10.0), 300);
+      r /= pow(T(10.0), e10 > -700 ? -e10 - 300 : 400);
+    } else if (e10 < 0) {
+      r /= pow(T(10.0), -e10);
+    }
+  }
+  a = neg ? T(-r) : r;
+  return s;
+}
+
+/*********** Hex ************/
+/* Writes one double as a C99 hex float, with a + if plus and x >= 0. */
+inline char *write_hex_part(double x, char *p, bool plus) {
+  static const char digit[] = "0123456789abcdef";
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+
+  if (bits >> 63)
+    *p++ = '-';
+  else if (plus)
+    *p++ = '+';
+  *p++ = '0';
+  *p++ = 'x';
+
+  int biased = int((bits >> 52) & 0x7ff);
+  uint64_t m = bits & ((uint64_t(1) << 52) - 1);
+  int e;
+  if (biased == 0) {
+    *p++ = '0';
+    e = (m != 0) ? -1022 : 0;
+  } else {
+    *p++ = '1';
+    e = biased - 1023;
+  }
+
+  if (m != 0) {
+    int n = 13;
+    while ((m & 0xf) == 0) {
+      m >>= 4;
+      n--;
+    }
+    *p++ = '.';
+    for (int i = n - 1; i >= 0; i--)
+      *p++ = digit[(m >> (4 * i)) & 0xf];
+  }
+  *p++ = 'p';
+  *p++ = (e < 0) ? '-' : '+';
+  return write_int(p, (e < 0) ? -e : e, 1);
+}
+
+/* Writes the components of a as hex floats to s, which must hold
+   24 * components<T>() characters.  Returns the number of characters. */
+template <class T>
+std::size_t write_hex(const T &a, char *s) {
+  const double *x = parts(a);
+  if (char *p = write_special(x[0], s))
+    return std::size_t(p - s);
+
+  int n = components<T>();
+  while (n > 1 && x[n - 1] == 0.0)
+    n--;
+  char *p = write_hex_part(x[0], s, false);
+  for (int k = 1; k < n; k++)
+    p = write_hex_part(x[k], p, true);
+  return std::size_t(p - s);
+}
+
+/* Reads one hex float with its sign from [s, end), returns the end or 0. */
+inline const char *read_hex_part(const char *s, const char *end, double &x) {
+  bool neg = false;
+  if (s < end && (*s == '+' || *s == '-'))
+    neg = (*s++ == '-');
+  if (end - s < 2 || s[0] != '0' || lower(s[1]) != 'x')
+    return 0;
+  s += 2;
+
+  /* 14 hex digits hold the 53 bits; more are dropped */
+  uint64_t m = 0;
+  int nd = 0, frac = 0, dropped = 0;
+  bool point = false, any = false;
+  for (; s < end; s++) {
+    char ch = lower(*s);
+    int d;
+    if (ch >= '0' && ch <= '9')
+      d = ch - '0';
+    else if (ch >= 'a' && ch <= 'f')
+      d = ch - 'a' + 10;
+    else if (ch == '.' && !point) {
+      point = true;
+      continue;
+    } else
+      break;
+
+    any = true;
+    if (m == 0 && d == 0) {
+      if (point)
+        frac++;
+      continue;
+    }
+    if (nd < 15) {
+      m = m * 16 + uint64_t(d);
+      nd++;
+      if (point)
+        frac++;
+    } else if (!point) {
+      dropped++;
+    }
+  }
+  if (!any)
+    return 0;
+
+  int e = 0;
+  if (s < end && lower(*s) == 'p') {
+    s++;
+    bool eneg = false;
+    if (s < end && (*s == '+' || *s == '-'))
+      eneg = (*s++ == '-');
+    if (s >= end || *s < '0' || *s > '9')
+      return 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++)
+      if (e < 100000)
+        e = e * 10 + (*s - '0');
+    if (eneg)
+      e = -e;
+  }
+
+  x = std::ldexp(double(m), e + 4 * (dropped - frac));
+  if (neg)
+    x = -x;
+  return s;
+}
+
+/* Reads the components written by write_hex from [s, end) after the
+   blanks, returns the position after them, or 0 if there is no number. */
+template <class T>
+const char *read_hex(const char *s, const char *end, T &a) {
+  s = skip_blanks(s, end);
+  double *x = parts(a);
+  for (int k = 0; k < components<T>(); k++)
+    x[k] = 0.0;
+
+  const char *t = s;
+  bool neg = false;
+  if (t < end && (*t == '+' || *t == '-'))
+    neg = (*t++ == '-');
+  double special;
+  if (const char *p = read_special(t, end, special)) {
+    x[0] = neg ? -special : special;
+    return p;
+  }
+
+  s = read_hex_part(s, end, x[0]);
+  for (int k = 1; s && k < components<T>(); k++) {
+    if (end - s < 3 || (s[0] != '+' && s[0] != '-') || s[1] != '0' || lower(s[2]) != 'x')
+      break;
+    s = read_hex_part(s, end, x[k]);
+  }
+  return s;
+}
+
+/*********** Values and arrays ************/
+template <class T>
+std::size_t write(const T &a, char *s, format f, int digits) {
+  return f == hex ? write_hex(a, s) : write_decimal(a, s, digits);
+}
+
+/* Reads one number in either form from [s, end) after the blanks. */
+template <class T>
+const char *read(const char *s, const char *end, T &a) {
+  s = skip_blanks(s, end);
+  const char *t = (s < end && (*s == '+' || *s == '-')) ? s + 1 : s;
+  if (end - t >= 2 && t[0] == '0' && lower(t[1]) == 'x')
+    return read_hex(s, end, a);
+  return read_decimal(s, end, a);
+}
+
+/* Writes a[0], ..., a[n - 1], each followed by sep, to s, which must hold
+   n * (max_length<T>(f, digits) + 1) characters.  Returns the number of
+   characters written. */
+template <class T>
+std::size_t write_n(const T *a, std::size_t n, char *s, format f, int digits, char sep = '\n') {
+  char *p = s;
+  for (std::size_t i = 0; i < n; i++) {
+    p += write(a[i], p, f, digits);
+    *p++ = sep;
+  }
+  return std::size_t(p - s);
+}
+
+/* Reads up to n numbers separated by blanks, commas, semicolons or
+   newlines from [s, end) into a.  Returns how many were read; if that is
+   fewer than n, *stop (if given) is where reading stopped. */
+template <class T>
+std::size_t read_n(const char *s, const char *end, T *a, std::size_t n, const char **stop = 0) {
+  std::size_t i = 0;
+  for (; i < n; i++) {
+    const char *t = read(s, end, a[i]);
+    if (!t || (t < end && !is_blank(*t)))
+      break;
+    s = t;
+  }
+  if (stop)
+    *stop = skip_blanks(s, end);
+  return i;
+}
+
+/* the number of blank separated words in [s, end), an upper bound of the
+   numbers that read_n finds */
+inline std::size_t count(const char *s, const char *end) {
+  std::size_t n = 0;
+  for (s = skip_blanks(s, end); s < end; s = skip_blanks(s, end)) {
+    n++;
+    while (s < end && !is_blank(*s))
+      s++;
+  }
+  return n;
+}
+
+}
+}
+
+#endif /* _QD_TEXT_H */
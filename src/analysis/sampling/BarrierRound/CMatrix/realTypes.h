@@ -0,0 +1,124 @@
+#pragma once
+// The precisions of the kernels: float, double and the qd types dd_real, td_real and qd_real.
+
+#include <qd/dd_real.h>
+#include <qd/qd_real.h>
+#include <qd/td_real.h>
+#include <qd/simd.h>
+#include <qd/fpu.h>
+#include <qd/self_check.h>
+
+#include "CMatrixCore.h"
+
+namespace Eigen
+{
+	template<> struct NumTraits<dd_real> : DefaultNumTraits<dd_real> {};
+	template<> struct NumTraits<td_real> : DefaultNumTraits<td_real> {};
+	template<> struct NumTraits<qd_real> : DefaultNumTraits<qd_real> {};
+
+	// for the float tier when A is given in dd_real or qd_real
+	namespace internal
+	{
+		template<> struct cast_impl<dd_real, float> { static float run(const dd_real& x) { return float(to_double(x)); } };
+		template<> struct cast_impl<td_real, float> { static float run(const td_real& x) { return float(to_double(x)); } };
+		template<> struct cast_impl<qd_real, float> { static float run(const qd_real& x) { return float(to_double(x)); } };
+	}
+}
+
+enum realType : uint32_t
+{
+	doubleType = 1,
+	dd_realType = 2,
+	qd_realType = 3,
+	floatType = 4,
+	td_realType = 5
+};
+
+template<typename T> realType realTypeOf();
+template<> inline realType realTypeOf<float>() { return floatType; }
+template<> inline realType realTypeOf<double>() { return doubleType; }
+template<> inline realType realTypeOf<dd_real>() { return dd_realType; }
+template<> inline realType realTypeOf<td_real>() { return td_realType; }
+template<> inline realType realTypeOf<qd_real>() { return qd_realType; }
+
+// batched exp and log for the elementwise CMatrix operators, see expArray in operators.h
+inline void expArray(const dd_real* x, dd_real* y, size_t n) { dd_exp_n(x, y, n); }
+inline void expArray(const qd_real* x, qd_real* y, size_t n) { qd_exp_n(x, y, n); }
+inline void logArray(const dd_real* x, dd_real* y, size_t n) { dd_log_n(x, y, n); }
+inline void logArray(const qd_real* x, qd_real* y, size_t n) { qd_log_n(x, y, n); }
+
+// packed arithmetic, see plusArray in operators.h; qd/simd.h picks AVX2 or AVX-512 at run time
+inline void plusArray(const dd_real* x1, const dd_real* x2, dd_real* y, size_t n) { qd::simd::dd_add_n(x1, x2, y, n); }
+inline void plusArray(const qd_real* x1, const qd_real* x2, qd_real* y, size_t n) { qd::simd::qd_add_n(x1, x2, y, n); }
+inline void minusArray(const dd_real* x1, const dd_real* x2, dd_real* y, size_t n) { qd::simd::dd_sub_n(x1, x2, y, n); }
+inline void minusArray(const qd_real* x1, const qd_real* x2, qd_real* y, size_t n) { qd::simd::qd_sub_n(x1, x2, y, n); }
+inline void timesArray(const dd_real* x1, const dd_real* x2, dd_real* y, size_t n) { qd::simd::dd_mul_n(x1, x2, y, n); }
+inline void timesArray(const qd_real* x1, const qd_real* x2, qd_real* y, size_t n) { qd::simd::qd_mul_n(x1, x2, y, n); }
+inline void rdivideArray(const dd_real* x1, const dd_real* x2, dd_real* y, size_t n) { qd::simd::dd_div_n(x1, x2, y, n); }
+inline void rdivideArray(const qd_real* x1, const qd_real* x2, qd_real* y, size_t n) { qd::simd::qd_div_n(x1, x2, y, n); }
+inline void rdivideArray(dd_real x1, const dd_real* x2, dd_real* y, size_t n)
+{
+	if (x1 == 1.0)
+		qd::simd::dd_inv_n(x2, y, n);
+	else
+		for (size_t i = 0; i < n; ++i)
+			y[i] = x1 / x2[i];
+}
+inline void rdivideArray(qd_real x1, const qd_real* x2, qd_real* y, size_t n)
+{
+	if (x1 == 1.0)
+		qd::simd::qd_inv_n(x2, y, n);
+	else
+		for (size_t i = 0; i < n; ++i)
+			y[i] = x1 / x2[i];
+}
+inline void sqrtArray(const dd_real* x, dd_real* y, size_t n) { qd::simd::dd_sqrt_n(x, y, n); }
+inline void sqrtArray(const qd_real* x, qd_real* y, size_t n) { qd::simd::qd_sqrt_n(x, y, n); }
+
+// both variants of the qd arithmetic, see arithmetic.h; dd_real has a single multiplication
+inline dd_real sloppyAdd(const dd_real& x, const dd_real& y) { return dd_real::sloppy_add(x, y); }
+inline dd_real sloppyDiv(const dd_real& x, const dd_real& y) { return dd_real::sloppy_div(x, y); }
+inline dd_real accurateAdd(const dd_real& x, const dd_real& y) { return dd_real::ieee_add(x, y); }
+inline dd_real accurateDiv(const dd_real& x, const dd_real& y) { return dd_real::accurate_div(x, y); }
+inline td_real sloppyAdd(const td_real& x, const td_real& y) { return td_real::sloppy_add(x, y); }
+inline td_real sloppyMul(const td_real& x, const td_real& y) { return td_real::sloppy_mul(x, y); }
+inline td_real sloppyDiv(const td_real& x, const td_real& y) { return td_real::sloppy_div(x, y); }
+inline td_real accurateAdd(const td_real& x, const td_real& y) { return td_real::ieee_add(x, y); }
+inline td_real accurateMul(const td_real& x, const td_real& y) { return td_real::accurate_mul(x, y); }
+inline td_real accurateDiv(const td_real& x, const td_real& y) { return td_real::accurate_div(x, y); }
+inline qd_real sloppyAdd(const qd_real& x, const qd_real& y) { return qd_real::sloppy_add(x, y); }
+inline qd_real sloppyMul(const qd_real& x, const qd_real& y) { return qd_real::sloppy_mul(x, y); }
+inline qd_real sloppyDiv(const qd_real& x, const qd_real& y) { return qd_real::sloppy_div(x, y); }
+inline qd_real accurateAdd(const qd_real& x, const qd_real& y) { return qd_real::ieee_add(x, y); }
+inline qd_real accurateMul(const qd_real& x, const qd_real& y) { return qd_real::accurate_mul(x, y); }
+inline qd_real accurateDiv(const qd_real& x, const qd_real& y) { return qd_real::accurate_div(x, y); }
+
+// Rank of each precision in the AdaptiveChol cascade (lower is cheaper); td_realType comes last
+// in realType since the values are stored in serialized factors
+inline int precisionRank(realType type)
+{
+	switch (type)
+	{
+	case floatType: return 0;
+	case doubleType: return 1;
+	case dd_realType: return 2;
+	case td_realType: return 3;
+	case qd_realType: return 4;
+	default: return -1;
+	}
+}
+
+// Throw if the arithmetic of the qd types is broken by the compiler flags (-ffast-math) or by the floating
+// point modes of the thread, see qd/self_check.h; call it under a qd::fpu_guard. The check runs once per
+// process. The deterministic build of compile.m (QD_DETERMINISTIC) also requires results that do not
+// depend on the processor: no FMA contraction, and packed operations equal to the scalar ones.
+inline void checkArithmetic()
+{
+	static const unsigned failed = qd::self_check();
+#ifdef QD_DETERMINISTIC
+	unsigned fatal = failed;
+#else
+	unsigned fatal = failed & qd::check_exact;
+#endif
+	assertThrow(!fatal, "The qd arithmetic self-check failed: " + qd::check_names(fatal) + ".");
+}
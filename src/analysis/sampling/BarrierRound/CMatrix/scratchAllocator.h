@@ -0,0 +1,167 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "CMatrixCore.h"
+#if defined(MATLAB_MEX_FILE)
+#include "mex.h"
+#endif
+
+// Bump allocator for the temporaries of a mex call. Memory is rewound (not freed)
+// at the end of each call, so the next call reuses the same warm, 32-byte aligned
+// pages instead of going through malloc. If a call needed more than one block, the
+// blocks are merged into one of the total size for the next call. Everything is
+// freed when MATLAB unloads the mex (mexAtExit).
+class ScratchArena
+{
+public:
+	static constexpr size_t kAlignment = 32;
+	static constexpr size_t kMinBlock = size_t(1) << 20;
+
+	ScratchArena() = default;
+	~ScratchArena()
+	{
+		release();
+	}
+
+	ScratchArena(const ScratchArena&) = delete;
+	ScratchArena& operator=(const ScratchArena&) = delete;
+
+	void* allocate(size_t bytes)
+	{
+		bytes = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+		if (current >= blocks.size() || offset + bytes > blocks[current].size)
+			nextBlock(bytes);
+
+		void* ptr = blocks[current].data + offset;
+		offset += bytes;
+		used += bytes;
+		return ptr;
+	}
+
+	// rewind to the beginning, keeping (and merging) the blocks
+	void reset()
+	{
+		if (blocks.size() > 1)
+		{
+			size_t total = 0;
+			for (auto& block : blocks)
+				total += block.size;
+			release();
+			blocks.push_back(Block::create(total));
+		}
+		current = 0;
+		offset = 0;
+		used = 0;
+	}
+
+	void release()
+	{
+		for (auto& block : blocks)
+			block.free();
+		blocks.clear();
+		current = 0;
+		offset = 0;
+		used = 0;
+	}
+
+	size_t capacity() const
+	{
+		size_t total = 0;
+		for (auto& block : blocks)
+			total += block.size;
+		return total;
+	}
+
+	size_t used = 0;
+
+private:
+	struct Block
+	{
+		uint8_t* data;
+		size_t size;
+
+		static Block create(size_t size)
+		{
+			void* ptr = nullptr;
+#if defined(_WIN32)
+			ptr = _aligned_malloc(size, kAlignment);
+#else
+			if (posix_memalign(&ptr, kAlignment, size) != 0)
+				ptr = nullptr;
+#endif
+			if (!ptr)
+				throw std::bad_alloc();
+			return { (uint8_t*)ptr, size };
+		}
+
+		void free()
+		{
+#if defined(_WIN32)
+			_aligned_free(data);
+#else
+			std::free(data);
+#endif
+		}
+	};
+
+	void nextBlock(size_t bytes)
+	{
+		size_t size = std::max(bytes, std::max(kMinBlock, capacity()));
+		blocks.push_back(Block::create(size));
+		current = blocks.size() - 1;
+		offset = 0;
+	}
+
+	std::vector<Block> blocks;
+	size_t current = 0;
+	size_t offset = 0;
+};
+
+// A mex has a single arena. Outside MATLAB each thread has its own, so the kernels
+// can be called concurrently.
+inline ScratchArena& scratchArena()
+{
+#if defined(MATLAB_MEX_FILE)
+	static ScratchArena arena;
+	static bool registered = (mexAtExit([] { scratchArena().release(); }), true);
+	(void)registered;
+#else
+	thread_local ScratchArena arena;
+#endif
+	return arena;
+}
+
+// n default-constructed values in the arena, valid until the enclosing ScratchScope ends
+template<typename T>
+T* scratchArray(size_t n)
+{
+	static_assert(std::is_trivially_destructible<T>::value, "scratch values are never destroyed");
+	T* ptr = (T*)scratchArena().allocate(std::max<size_t>(n, 1) * sizeof(T));
+	for (size_t i = 0; i < n; ++i)
+		new (ptr + i) T();
+	return ptr;
+}
+
+template<typename T>
+Map<T> scratchMatrix(Eigen::Index m, Eigen::Index n)
+{
+	return Map<T>(scratchArray<T>(m * n), m, n);
+}
+
+// Rewinds the arena when the mex call (or any other scope using the kernels) returns or throws
+struct ScratchScope
+{
+	ScratchScope() = default;
+	~ScratchScope()
+	{
+		scratchArena().reset();
+	}
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "CMatrixCore.h"
+#include "denseProduct.h"
+#include "parallel.h"
+
+// C = A * B for CSC matrices by Gustavson's algorithm in two passes over the columns of B.
+// The symbolic pass counts the nonzeros of each column of C so that C is allocated once;
+// the numeric pass fills each column through a dense accumulator. Both passes split the
+// columns of C across threads, each with its own accumulator and row markers.
+template<typename MatA, typename MatB>
+SparseMatrix<typename MatA::Scalar> sparseProduct(const MatA& A, const MatB& B)
+{
+	using T = typename MatA::Scalar;
+	using Ti = typename SparseMatrix<T>::StorageIndex;
+	using Index = Eigen::Index;
+
+	assertThrow(A.cols() == B.rows(), "sparseProduct: Incompatible sizes.");
+	assertThrow(A.isCompressed() && B.isCompressed(), "sparseProduct: inputs must be compressed.");
+
+	Index m = A.rows(), n = B.cols();
+	auto Ai = A.innerIndexPtr(), Aj = A.outerIndexPtr();
+	auto Bi = B.innerIndexPtr(), Bj = B.outerIndexPtr();
+	auto Ax = A.valuePtr();
+	auto Bx = B.valuePtr();
+
+	SparseMatrix<T> C(m, n);
+	Ti* Cj = C.outerIndexPtr();
+
+	// work of column j is about sum_p nnz(A(:, Bi[p]))
+	Index grain = std::max<Index>(1, n * 4096 / std::max<Index>(1, A.nonZeros() + B.nonZeros()));
+
+	// symbolic pass: Cj[j + 1] = nnz(C(:, j))
+	Cj[0] = 0;
+	parallelFor<Index>(0, n, grain, [&](Index first, Index last) {
+		std::vector<Index> mark(m, -1);
+		for (Index j = first; j < last; ++j)
+		{
+			Ti count = 0;
+			for (auto p = Bj[j]; p < Bj[j + 1]; ++p)
+			{
+				auto k = Bi[p];
+				for (auto q = Aj[k]; q < Aj[k + 1]; ++q)
+				{
+					auto i = Ai[q];
+					if (mark[i] != j)
+					{
+						mark[i] = j;
+						++count;
+					}
+				}
+			}
+			Cj[j + 1] = count;
+		}
+	});
+
+	for (Index j = 0; j < n; ++j)
+		Cj[j + 1] += Cj[j];
+	C.resizeNonZeros(Cj[n]);
+	Ti* Ci = C.innerIndexPtr();
+	T* Cx = C.valuePtr();
+
+	// numeric pass
+	parallelFor<Index>(0, n, grain, [&](Index first, Index last) {
+		std::vector<Index> mark(m, -1);
+		std::vector<T> x(m);
+		for (Index j = first; j < last; ++j)
+		{
+			Ti nnz = Cj[j];
+			for (auto p = Bj[j]; p < Bj[j + 1]; ++p)
+			{
+				auto k = Bi[p];
+				const T b = Bx[p];
+				for (auto q = Aj[k]; q < Aj[k + 1]; ++q)
+				{
+					auto i = Ai[q];
+					if (mark[i] != j)
+					{
+						mark[i] = j;
+						Ci[nnz++] = i;
+						x[i] = Ax[q] * b;
+					}
+					else
+						multiplyAdd(x[i], Ax[q], b);
+				}
+			}
+
+			std::sort(Ci + Cj[j], Ci + Cj[j + 1]);
+			for (auto p = Cj[j]; p < Cj[j + 1]; ++p)
+				Cx[p] = x[Ci[p]];
+		}
+	});
+
+	return C;
+}
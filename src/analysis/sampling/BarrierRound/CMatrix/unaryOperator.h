@@ -0,0 +1,112 @@
+#pragma once
+#include "CMatrixCore.h"
+#include "parallel.h"
+#include "scratchAllocator.h"
+
+// y[i] = f(x[i]) for i < n with the batched version of f, in chunks over the threads
+template <typename O, typename Tx, typename Tc>
+void batchedOperator(const Tx* x, Tc* y, size_t n)
+{
+	parallelFor<size_t>(0, n, 4096, [&](size_t first, size_t last) {
+		O::f_n(x + first, y + first, last - first);
+	});
+}
+
+// C has the pattern of A and its values in the scratch arena
+template <typename O, typename Tx>
+SparseMap<decltype(O::f(1, 1, Tx(1.0)))> unaryOperator(SparseMap<Tx> A)
+{
+	using OutputType = decltype(O::f(1, 1, Tx(1.0)));
+	auto m = A.rows(), n = A.cols();
+
+	auto Ax = A.valuePtr();
+	auto Ci = A.innerIndexPtr(), Cj = A.outerIndexPtr();
+	auto Cx = scratchArray<OutputType>(A.nonZeros());
+
+	if constexpr (O::Batched)
+		batchedOperator<O>(Ax, Cx, size_t(A.nonZeros()));
+	else
+	{
+		for (auto j = 0; j < n; ++j)
+		{
+			for (auto p = Cj[j]; p < Cj[j + 1]; ++p)
+			{
+				auto i = Ci[p];
+				Cx[p] = O::f(i, j, Ax[p]);
+			}
+		}
+	}
+
+	return SparseMap<OutputType>(m, n, A.nonZeros(), Cj, Ci, Cx);
+}
+
+// C must have the size of A, e.g. the output array
+template <typename O, typename Tx, typename Tc>
+void unaryOperator(Map<Tx> A, Map<Tc> C)
+{
+	auto m = A.rows(), n = A.cols();
+	assertThrow(C.rows() == m && C.cols() == n, "unaryOperator: mismatch output dimensions");
+
+	if constexpr (O::Batched)
+		batchedOperator<O>(A.data(), C.data(), size_t(m * n));
+	else
+	{
+		for (auto j = 0; j < n; ++j)
+			for (auto i = 0; i < m; ++i)
+				C(i, j) = O::f(i, j, A(i, j));
+	}
+}
+
+// C(0, j) is f folded over the nonzeros of column j, or 0 if there are none
+template <typename O, typename Tx, typename Tc>
+void reductionOperator(SparseMap<Tx> A, Map<Tc> C)
+{
+	auto n = A.cols();
+	assertThrow(C.rows() == 1 && C.cols() == n, "reductionOperator: mismatch output dimensions");
+
+	auto Ax = A.valuePtr();
+	auto Aj = A.outerIndexPtr();
+
+	for (auto j = 0; j < n; ++j)
+	{
+		Tx value = Tx(0.0);
+		bool null_value = true;
+		for (auto p = Aj[j]; p < Aj[j + 1]; ++p)
+		{
+			if (null_value)
+			{
+				value = Ax[p];
+				null_value = false;
+			}
+			else
+				value = O::f(value, Ax[p]);
+		}
+		C(0, j) = value;
+	}
+}
+
+// C(0, j) is f folded over column j
+template <typename O, typename Tx, typename Tc>
+void reductionOperator(Map<Tx> A, Map<Tc> C)
+{
+	auto m = A.rows(), n = A.cols();
+	assertThrow(C.rows() == 1 && C.cols() == n, "reductionOperator: mismatch output dimensions");
+
+	for (auto j = 0; j < n; ++j)
+	{
+		Tx value = Tx(0.0);
+		bool null_value = true;
+
+		for (auto i = 0; i < m; ++i)
+		{
+			if (null_value)
+			{
+				value = A(i, j);
+				null_value = false;
+			}
+			else
+				value = O::f(value, A(i, j));
+		}
+		C(0, j) = value;
+	}
+}
@@ -6,12 +6,18 @@ function compile(output, source, include, opts)
 % output - output location for the mex
 % source - filename for source C++ files
 % include - the list of directories to search for #include
+% opts - std, debug, fmath (-ffast-math) and deterministic: build for the
+%        same bits on every machine, without -march=native and without
+%        contracting a * b + c into fused multiply-adds (see qd/self_check.h)
 
 if nargin <= 3, opts = struct; end
 if nargin <= 2, include = {}; end
 
-defaults = struct('std', 'c++17', 'debug', false, 'tol', 1e-8, 'fmath', false);
+defaults = struct('std', 'c++17', 'debug', false, 'tol', 1e-8, 'fmath', false, 'deterministic', false);
 opts = setField(defaults, opts);
+if opts.fmath && opts.deterministic
+   error('The options fmath and deterministic cannot be combined.');
+end
 
 if ~iscell(include)
    include = {include};
@@ -37,31 +43,47 @@ end
 
 if (contains(compiler, 'MSVCPP'))
    fmath = '/fp:fast';
-   cmd = [cmd ' COMPFLAGS="$COMPFLAGS /O2 /arch:AVX2 /std:%std %fmath"'];
+   arch = '/arch:AVX2';
+   strict = '/fp:precise /DQD_DETERMINISTIC';
+   cmd = [cmd ' COMPFLAGS="$COMPFLAGS /O2 %arch /std:%std %fmath"'];
 elseif (contains(compiler, 'Clang++'))
    fmath = '-ffast-math';
-   cmd = [cmd ' CFLAGS="$CFLAGS -O3 -march=native -std=%std %fmath"'];
+   arch = '-march=native';
+   strict = '-ffp-contract=off -DQD_DETERMINISTIC';
+   cmd = [cmd ' CFLAGS="$CFLAGS -O3 %arch -std=%std %fmath"'];
 elseif (contains(compiler, 'g++'))
    fmath = '-ffast-math';
-   cmd = [cmd ' CFLAGS="$CFLAGS -O3 -march=native -std=%std %fmath"'];
+   arch = '-march=native';
+   strict = '-ffp-contract=off -DQD_DETERMINISTIC';
+   cmd = [cmd ' CFLAGS="$CFLAGS -O3 %arch -std=%std %fmath"'];
 else
    error('Currently, we only support MSVCPP, Clang++ or g++ as the compiler.');
 end
 
-if ~opts.fmath
+% The deterministic build runs on every processor of the architecture; the
+% packed dd/qd operations of qd/simd.h still pick AVX2 or AVX-512 at run time.
+% The kernels split their work by the size of the problem, not the number of
+% threads, so the core count of the node does not change the results either.
+if opts.deterministic
+   fmath = strict;
+   arch = '';
+elseif ~opts.fmath
    fmath = '';
 end
 
 
 cmd = [cmd ' %include %source'];
+if isunix && ~ismac
+   cmd = [cmd ' -lrt']; % shm_open needs librt before glibc 2.34
+end
 
 source = join(source, '" "');
 source = ['"' source{1} '"'];
 include = join(include, '" -I"');
 include = ['-I"' include{1} '"'];
 
-keywords = {'%std', '%output', '%include', '%source', '%fmath'};
-replaces = {opts.std, output, include, source, fmath};
+keywords = {'%std', '%output', '%include', '%source', '%fmath', '%arch'};
+replaces = {opts.std, output, include, source, fmath, arch};
 cmd = replace(cmd, keywords, replaces);
 
 clear mex
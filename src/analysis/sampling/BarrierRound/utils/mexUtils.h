@@ -37,32 +37,48 @@ namespace MexEnvironment
 #define assertThrow(val, msg) if (!(val)) throw std::runtime_error(msg);
 
 	/* ====== Parameters Info ====== */
-	// input
-	const mxArray** prhs;
-	size_t nrhs;
-	size_t rhs_id = 0; // index to next input
+	// The arguments of one mex call and the position of the next input and output.
+	// Every helper takes the context explicitly, so nothing here is global and the
+	// numerical work of a call can be handed to another thread.
+	struct MexContext
+	{
+		// input
+		const mxArray** prhs;
+		size_t nrhs;
+		size_t rhs_id = 0; // index to next input
+
+		// output
+		mxArray** plhs;
+		size_t nlhs;
+		size_t lhs_id = 0; // index to next output
+
+		MexContext(int nlhs_, mxArray* plhs_[], int nrhs_, const mxArray* prhs_[])
+			: prhs(prhs_), nrhs(size_t(nrhs_)), plhs(plhs_), nlhs(size_t(nlhs_))
+		{
+		}
 
-	// output
-	mxArray** plhs;
-	size_t nlhs;
-	size_t lhs_id = 0; // index to next output
+		bool hasInput() const
+		{
+			return rhs_id < nrhs;
+		}
+	};
 
-	const mxArray* input(int id = -1)
+	const mxArray* input(MexContext& ctx)
 	{
-		assertThrow(rhs_id < nrhs, "At least " + to_string(rhs_id + 1) + " input parameters are required.");
+		assertThrow(ctx.rhs_id < ctx.nrhs, "At least " + to_string(ctx.rhs_id + 1) + " input parameters are required.");
 
-		return prhs[rhs_id++];
+		return ctx.prhs[ctx.rhs_id++];
 	}
 
-	void output(mxArray* out)
+	void output(MexContext& ctx, mxArray* out)
 	{
-		assertThrow(lhs_id < nlhs, "At least " + to_string(lhs_id + 1) + " output parameters are required.");
+		assertThrow(ctx.lhs_id < ctx.nlhs, "At least " + to_string(ctx.lhs_id + 1) + " output parameters are required.");
 
-		plhs[lhs_id++] = out;
+		ctx.plhs[ctx.lhs_id++] = out;
 	}
 
 	const size_t kAnySize = size_t(-1);
-	void checkInputSize(size_t required_m, size_t required_n, size_t m, size_t n)
+	void checkInputSize(MexContext& ctx, size_t required_m, size_t required_n, size_t m, size_t n)
 	{
 		if ((required_m != kAnySize && required_m != m) || (required_n != kAnySize && required_n != n))
 		{
@@ -75,7 +91,7 @@ namespace MexEnvironment
 			if (required_n == kAnySize)
 				required_n_string = "*";
 
-			throw std::runtime_error("Incorrect dimension for " + to_string(rhs_id) + "-th parameter. "
+			throw std::runtime_error("Incorrect dimension for " + to_string(ctx.rhs_id) + "-th parameter. "
 				"It should be (" + required_m_string + "," + required_n_string + ")"
 				" instead of (" + to_string(m) + "," + to_string(n) + ")"
 				" where * indicates any non-negative numbers.");
@@ -83,10 +99,10 @@ namespace MexEnvironment
 	}
 
 	/* ====== Basic input/output Functions ====== */
-	string inputString()
+	string inputString(MexContext& ctx)
 	{
-		const mxArray* pt = input();
-		assertThrow(mxIsChar(pt), "The " + to_string(rhs_id) + "-th parameter should be a string.");
+		const mxArray* pt = input(ctx);
+		assertThrow(mxIsChar(pt), "The " + to_string(ctx.rhs_id) + "-th parameter should be a string.");
 
 		const char* x = mxArrayToString(pt);
 		string output = string(x);
@@ -94,90 +110,86 @@ namespace MexEnvironment
 		return output;
 	}
 
-	void outputString(const char* str)
+	void outputString(MexContext& ctx, const char* str)
 	{
-		output(mxCreateString(str));
+		output(ctx, mxCreateString(str));
 	}
 
 	template<typename T>
-	const T* inputArray(size_t& required_m, size_t& required_n)
+	const T* inputArray(MexContext& ctx, size_t& required_m, size_t& required_n)
 	{
-		const mxArray* pt = input();
+		const mxArray* pt = input(ctx);
 
 		auto nDim = mxGetNumberOfDimensions(pt);
 		assertThrow(!mxIsComplex(pt) && !mxIsSparse(pt) && nDim == 2,
-			"The " + to_string(rhs_id) + "-th parameter should be a real full 2-dim array.");
+			"The " + to_string(ctx.rhs_id) + "-th parameter should be a real full 2-dim array.");
 
 		assertThrow(mxGetClassID(pt) == MexType<T>(),
-			"The " + to_string(rhs_id) + "-th parameter should be " + typeid(T).name());
+			"The " + to_string(ctx.rhs_id) + "-th parameter should be " + typeid(T).name());
 
 		size_t m = mxGetM(pt), n = mxGetN(pt);
-		checkInputSize(required_m, required_n, m, n);
+		checkInputSize(ctx, required_m, required_n, m, n);
 		required_m = m; required_n = n;
 
 		return (T*)mxGetData(pt);
 	}
 
 	template<typename T>
-	const T* inputArray(size_t& required_m)
+	const T* inputArray(MexContext& ctx, size_t& required_m)
 	{
 		size_t required_n = 1;
-		return inputArray<T>(required_m, required_n);
+		return inputArray<T>(ctx, required_m, required_n);
 	}
 
 	template<typename T>
-	T inputScalar()
+	T inputScalar(MexContext& ctx)
 	{
 		size_t required_m = 1, required_n = 1;
-		return *inputArray<T>(required_m, required_n);
+		return *inputArray<T>(ctx, required_m, required_n);
 	}
 
 	template<typename T>
-	T inputScalar(T default_value)
+	T inputScalar(MexContext& ctx, T default_value)
 	{
-		if (rhs_id < nrhs)
-			return inputScalar<T>();
+		if (ctx.hasInput())
+			return inputScalar<T>(ctx);
 		else
 			return default_value;
 	}
 
 	template<typename T>
-	T* outputArray(size_t m, size_t n = 1)
+	T* outputArray(MexContext& ctx, size_t m, size_t n = 1)
 	{
 		mxArray* pt = mxCreateNumericMatrix(m, n, MexType<T>(), mxREAL);
-		output(pt);
+		output(ctx, pt);
 
 		return (T*)mxGetData(pt);
 	}
 
 	template<typename T>
-	void outputArray(T* x, size_t m, size_t n = 1)
+	void outputArray(MexContext& ctx, T* x, size_t m, size_t n = 1)
 	{
-		double* out = outputArray<T>(m, n);
+		T* out = outputArray<T>(ctx, m, n);
 		for (size_t s = 0; s < m * n; ++s)
 			out[s] = T(x[s]);
 	}
 
 	template<typename T>
-	void outputScalar(T val)
+	void outputScalar(MexContext& ctx, T val)
 	{
-		*outputArray<T>(1, 1) = val;
+		*outputArray<T>(ctx, 1, 1) = val;
 	}
 };
 
-int main();
+// the body of the mex, called once per mexFunction call with its own context
+int mexMain(MexEnvironment::MexContext& ctx);
 
 void mexFunction(int nlhs, mxArray* plhs[], int nrhs, const mxArray* prhs[])
 {
 	try
 	{
-		MexEnvironment::nlhs = nlhs;
-		MexEnvironment::nrhs = nrhs;
-		MexEnvironment::plhs = plhs;
-		MexEnvironment::prhs = prhs;
-		MexEnvironment::lhs_id = 0;
-		MexEnvironment::rhs_id = 0;
-		main();
+		MexEnvironment::MexContext ctx(nlhs, plhs, nrhs, prhs);
+		mexMain(ctx);
 	}
 	catch (const char* str)
 	{